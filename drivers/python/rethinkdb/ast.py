@@ -932,8 +932,8 @@ class DB(RqlTopLevelQuery):
     def table_list(self):
         return TableList(self)
 
-    def table_create(self, table_name, primary_key=(), datacenter=(), durability=()):
-        return TableCreate(self, table_name, primary_key=primary_key, datacenter=datacenter, durability=durability)
+    def table_create(self, table_name, primary_key=(), datacenter=(), durability=(), block_size=()):
+        return TableCreate(self, table_name, primary_key=primary_key, datacenter=datacenter, durability=durability, block_size=block_size)
 
     def table_drop(self, table_name):
         return TableDrop(self, table_name)
@@ -957,9 +957,10 @@ class Table(RqlQuery):
     tt = p.Term.TABLE
     st = 'table'
 
-    def insert(self, records, upsert=(), durability=(), return_vals=()):
+    def insert(self, records, upsert=(), durability=(), return_vals=(), bulk_load=()):
         return Insert(self, exprJSON(records), upsert=upsert,
-                      durability=durability, return_vals=return_vals)
+                      durability=durability, return_vals=return_vals,
+                      bulk_load=bulk_load)
 
     def get(self, key):
         return Get(self, key)
@@ -967,9 +968,11 @@ class Table(RqlQuery):
     def get_all(self, *keys, **kwargs):
         return GetAll(self, *keys, **kwargs)
 
-    def index_create(self, name, fundef=(), multi=()):
+    def index_create(self, name, fundef=(), multi=(), covering=()):
         args = [self, name] + ([func_wrap(fundef)] if fundef else [])
         kwargs = {"multi" : multi} if multi else {}
+        if covering:
+            kwargs["covering"] = covering
         return IndexCreate(*args, **kwargs)
 
     def index_drop(self, name):
@@ -1,6 +1,6 @@
 # Copyright 2010-2012 RethinkDB, all rights reserved.
 
-__all__ = ['connect', 'Connection', 'Cursor', 'protobuf_implementation']
+__all__ = ['connect', 'Connection', 'Cursor', 'PreparedQuery', 'protobuf_implementation']
 
 import errno
 import socket
@@ -17,7 +17,7 @@ from rethinkdb import ql2_pb2 as p
 
 from rethinkdb import repl # For the repl connection
 from rethinkdb.errors import *
-from rethinkdb.ast import Datum, DB, expr
+from rethinkdb.ast import Datum, DB, Func, expr
 
 class Cursor(object):
     def __init__(self, conn, query, term, format_opts, opts):
@@ -62,11 +62,26 @@ class Cursor(object):
             self.end_flag = True
             self.conn._end_cursor(self)
 
+# A function registered with the server by `Connection.prepare`.  Running it
+# sends only the arguments; the server reuses the compiled function.
+class PreparedQuery(object):
+    def __init__(self, conn, term, prepared_id):
+        self.conn = conn
+        self.term = term
+        self.prepared_id = prepared_id
+        self.generation = conn.generation
+
+    def run(self, *args, **global_opt_args):
+        return self.conn._execute(self, args, **global_opt_args)
+
 class Connection(object):
     def __init__(self, host, port, db, auth_key, timeout):
         self.socket = None
         self.host = host
         self.next_token = 1
+        # Prepared queries belong to the server side of the connection, so they
+        # are lost on reconnect.
+        self.generation = 0
         self.db = db
         self.auth_key = auth_key
         self.timeout = timeout
@@ -91,6 +106,7 @@ class Connection(object):
 
     def reconnect(self, noreply_wait=True):
         self.close(noreply_wait)
+        self.generation += 1
 
         try:
             self.socket = socket.create_connection((self.host, self.port), self.timeout)
@@ -129,6 +145,22 @@ class Connection(object):
             self.socket = None
         self.cursor_cache = { }
 
+    def prepare(self, func):
+        term = expr(func)
+        if not isinstance(term, Func):
+            raise RqlDriverError("Only functions can be prepared.")
+        token = self.next_token
+        self.next_token += 1
+
+        # Construct query
+        query = p.Query()
+        query.type = p.Query.PREPARE
+        query.token = token
+        term.build(query.query)
+
+        prepared_id = self._send_query(query, term)
+        return PreparedQuery(self, term, int(prepared_id))
+
     def noreply_wait(self):
         token = self.next_token
         self.next_token += 1
@@ -172,9 +204,30 @@ class Connection(object):
         query = p.Query()
         query.type = p.Query.START
         query.token = token
+        self._set_global_opt_args(query, global_opt_args)
+
+        # Compile query to protobuf
+        term.build(query.query)
+        return self._send_query(query, term, global_opt_args)
+
+    def _execute(self, prepared, args, **global_opt_args):
+        if prepared.generation != self.generation:
+            raise RqlDriverError("Prepared query belongs to a previous connection.")
+        token = self.next_token
+        self.next_token += 1
+
+        # Construct query
+        query = p.Query()
+        query.type = p.Query.EXECUTE
+        query.token = token
+        query.prepared_id = prepared.prepared_id
+        self._set_global_opt_args(query, global_opt_args)
 
-        # Set global opt args
+        # Only the arguments are sent, as an array
+        expr(list(args)).build(query.query)
+        return self._send_query(query, prepared.term, global_opt_args)
 
+    def _set_global_opt_args(self, query, global_opt_args):
         # The 'db' option will default to this connection's default
         # if not otherwise specified.
         if 'db' in global_opt_args:
@@ -188,10 +241,6 @@ class Connection(object):
             pair.key = k
             expr(v).build(pair.val)
 
-        # Compile query to protobuf
-        term.build(query.query)
-        return self._send_query(query, term, global_opt_args)
-
     def _handle_cursor_response(self, response):
         cursor = self.cursor_cache[response.token]
         cursor._extend(response)
@@ -35,8 +35,8 @@ def db_drop(db_name):
 def db_list():
     return DbList()
 
-def table_create(table_name, primary_key=(), datacenter=(), durability=()):
-    return TableCreateTL(table_name, primary_key=primary_key, datacenter=datacenter, durability=durability)
+def table_create(table_name, primary_key=(), datacenter=(), durability=(), block_size=()):
+    return TableCreateTL(table_name, primary_key=primary_key, datacenter=datacenter, durability=durability, block_size=block_size)
 
 def table_drop(table_name):
     return TableDropTL(table_name)
@@ -15,6 +15,7 @@
 #include "arch/types.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/io/disk/aio.hpp"
 #include "arch/io/disk/filestat.hpp"
 #include "arch/io/disk/pool.hpp"
 #include "arch/io/disk/conflict_resolving.hpp"
@@ -43,15 +44,33 @@ public:
 
     linux_disk_manager_t(linux_event_queue_t *queue,
                          int batch_factor,
+                         io_backend_t io_backend,
                          int max_concurrent_io_requests,
                          perfmon_collection_t *stats) :
         stack_stats(stats, "stack"),
         conflict_resolver(stats),
         accounter(batch_factor),
         backend_stats(stats, "backend", accounter.producer),
-        backend(queue, backend_stats.producer, max_concurrent_io_requests),
         outstanding_txn(0)
     {
+        /* Construct the backend that actually runs the operations. */
+        switch (io_backend) {
+        case io_backend_t::pool:
+            pool_backend.init(new pool_diskmgr_t(queue, backend_stats.producer,
+                                                 max_concurrent_io_requests));
+            pool_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                               &backend_stats, ph::_1);
+            break;
+        case io_backend_t::native_aio:
+            aio_backend.init(new aio_diskmgr_t(queue, backend_stats.producer,
+                                               max_concurrent_io_requests));
+            aio_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                              &backend_stats, ph::_1);
+            break;
+        default:
+            unreachable();
+        }
+
         /* Hook up the `submit_fun`s of the parts of the IO stack that are above the
         queue. (The parts below the queue use the `passive_producer_t` interface instead
         of a callback function.) */
@@ -61,7 +80,6 @@ public:
                                                  &accounter, ph::_1);
 
         /* Hook up everything's `done_fun`. */
-        backend.done_fun = std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
         backend_stats.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
         accounter.done_fun = std::bind(&conflict_resolving_diskmgr_t::done,
                                        &conflict_resolver, ph::_1);
@@ -179,7 +197,8 @@ private:
     holding back operations that must be run after other, currently-running, operations.
     Then it goes to the account manager, which queues up running IO operations according
     to which account they are part of. Finally the "backend" pops the IO operations
-    from the queue.
+    from the queue. Exactly one of `pool_backend` and `aio_backend` is used, depending
+    on the `io_backend_t` the disk manager was created with.
 
     At two points in the process--once as soon as it is submitted, and again right
     as the backend pops it off the queue--its statistics are recorded. The "stack stats"
@@ -192,7 +211,8 @@ private:
     conflict_resolving_diskmgr_t conflict_resolver;
     accounting_diskmgr_t accounter;
     stats_diskmgr_2_t backend_stats;
-    pool_diskmgr_t backend;
+    scoped_ptr_t<pool_diskmgr_t> pool_backend;
+    scoped_ptr_t<aio_diskmgr_t> aio_backend;
 
 
     intptr_t outstanding_txn;
@@ -201,10 +221,12 @@ private:
 };
 
 io_backender_t::io_backender_t(file_direct_io_mode_t _direct_io_mode,
-                               int max_concurrent_io_requests)
+                               int max_concurrent_io_requests,
+                               io_backend_t io_backend)
     : direct_io_mode(_direct_io_mode),
       diskmgr(new linux_disk_manager_t(&linux_thread_pool_t::get_thread()->queue,
                                        DEFAULT_IO_BATCH_FACTOR,
+                                       io_backend,
                                        max_concurrent_io_requests,
                                        &stats)) { }
 
@@ -489,6 +511,20 @@ file_open_result_t open_file(const char *path, const int mode, io_backender_t *b
         unreachable();
     }
 
+#ifdef __linux__
+    // Callers that do their own read-ahead don't want the kernel's read-ahead
+    // filling up the page cache on top of it.  (With direct I/O there is no
+    // kernel read-ahead to turn off.)
+    if ((mode & linux_file_t::mode_random_access)
+        && open_res.outcome != file_open_result_t::DIRECT) {
+        const int fadvise_res = posix_fadvise(fd.get(), 0, 0, POSIX_FADV_RANDOM);
+        if (fadvise_res != 0) {
+            logWRN("Could not disable kernel read-ahead for file \"%s\": %s",
+                   path, errno_string(fadvise_res).c_str());
+        }
+    }
+#endif  // __linux__
+
     const int64_t file_size = get_file_size(fd.get());
 
     // Call fsync() on the parent directory to guarantee that the newly
@@ -29,7 +29,8 @@ public:
     // stops us from specifying this on a file-by-file basis, but right now there's no desire for
     // that.  See https://github.com/rethinkdb/rethinkdb/issues/97#issuecomment-19778177 .
     io_backender_t(file_direct_io_mode_t direct_io_mode,
-                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS);
+                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS,
+                   io_backend_t io_backend = io_backend_t::pool);
     ~io_backender_t();
     linux_disk_manager_t *get_diskmgr_ptr() { return diskmgr.get(); }
     file_direct_io_mode_t get_direct_io_mode() const;
@@ -66,7 +67,9 @@ public:
         mode_read = 1 << 0,
         mode_write = 1 << 1,
         mode_create = 1 << 2,
-        mode_truncate = 1 << 3
+        mode_truncate = 1 << 3,
+        // The caller does its own read-ahead, so the kernel shouldn't.
+        mode_random_access = 1 << 4
     };
 
     int64_t get_file_size();
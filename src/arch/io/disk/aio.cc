@@ -0,0 +1,268 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/io/disk/aio.hpp"
+
+#include <limits.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+
+#include "arch/io/disk.hpp"
+#include "config/args.hpp"
+#include "utils.hpp"
+
+/* Resizes and datasync-wrapped writes are rare (they come from the extent
+manager and the metablock manager), so the fallback pool can stay small. */
+const int AIO_FALLBACK_POOL_THREADS = 2;
+
+#if AIO_DISKMGR_SUPPORTED
+
+/* We talk to the kernel directly instead of going through libaio, so that we
+don't need another library dependency. */
+
+static int sys_io_setup(unsigned nr_events, aio_context_t *ctx) {
+    return syscall(__NR_io_setup, nr_events, ctx);
+}
+
+static int sys_io_destroy(aio_context_t ctx) {
+    return syscall(__NR_io_destroy, ctx);
+}
+
+static int sys_io_submit(aio_context_t ctx, long nr, iocb **iocbpp) {  // NOLINT(runtime/int)
+    return syscall(__NR_io_submit, ctx, nr, iocbpp);
+}
+
+static int sys_io_getevents(aio_context_t ctx, long min_nr, long nr,  // NOLINT(runtime/int)
+                            io_event *events, timespec *timeout) {
+    return syscall(__NR_io_getevents, ctx, min_nr, nr, events, timeout);
+}
+
+bool aio_diskmgr_t::is_supported() {
+    aio_context_t ctx = 0;
+    if (sys_io_setup(1, &ctx) != 0) {
+        return false;
+    }
+    int res = sys_io_destroy(ctx);
+    guarantee_err(res == 0, "Could not destroy AIO context");
+    return true;
+}
+
+aio_diskmgr_t::aio_diskmgr_t(linux_event_queue_t *_queue,
+                             passive_producer_t<action_t *> *_source,
+                             int max_concurrent_io_requests)
+    : queue_depth(max_concurrent_io_requests),
+      source(_source),
+      queue(_queue),
+      fallback_pool(_queue, &fallback_queue, AIO_FALLBACK_POOL_THREADS),
+      n_pending(0),
+      n_fallback(0),
+      aio_context(0),
+      iocbs(max_concurrent_io_requests),
+      iocb_ptrs(max_concurrent_io_requests) {
+    guarantee(max_concurrent_io_requests > 0);
+    guarantee(max_concurrent_io_requests < MAXIMUM_MAX_CONCURRENT_IO_REQUESTS);
+
+    int res = sys_io_setup(queue_depth, &aio_context);
+    guarantee_err(res == 0, "Could not create AIO context");
+
+    fallback_pool.done_fun = std::bind(&aio_diskmgr_t::on_fallback_done, this, ph::_1);
+
+    queue->watch_resource(completion_event.get_notify_fd(), poll_event_in, this);
+
+    if (source->available->get()) { pump(); }
+    source->available->set_callback(this);
+}
+
+aio_diskmgr_t::~aio_diskmgr_t() {
+    assert_thread();
+    source->available->unset_callback();
+
+    /* It is an error to shut down the disk manager while requests are still out */
+    rassert(n_pending == 0);
+    rassert(n_fallback == 0);
+    rassert(unsubmitted.empty());
+
+    queue->forget_resource(completion_event.get_notify_fd(), this);
+
+    int res = sys_io_destroy(aio_context);
+    guarantee_err(res == 0, "Could not destroy AIO context");
+}
+
+void aio_diskmgr_t::pump() {
+    assert_thread();
+    while (source->available->get()
+           && n_pending + n_fallback + static_cast<int>(unsubmitted.size())
+              < queue_depth) {
+        action_t *a = source->pop();
+
+        // Resizes have no buffers, so they're checked before asking for them.
+        bool use_fallback = a->get_is_resize() || a->wrap_in_datasyncs;
+        if (!use_fallback) {
+            iovec *vecs;
+            size_t vecs_len;
+            a->get_bufs(&vecs, &vecs_len);
+            use_fallback = vecs_len > IOV_MAX;
+        }
+
+        if (use_fallback) {
+            ++n_fallback;
+            fallback_queue.push(a);
+        } else {
+            unsubmitted.push_back(a);
+        }
+    }
+    submit_unsubmitted();
+}
+
+void aio_diskmgr_t::submit_unsubmitted() {
+    while (!unsubmitted.empty()) {
+        const size_t n = std::min(unsubmitted.size(), iocbs.size());
+        for (size_t i = 0; i < n; ++i) {
+            action_t *a = unsubmitted[i];
+
+            iovec *vecs;
+            size_t vecs_len;
+            a->get_bufs(&vecs, &vecs_len);
+
+            iocb *cb = &iocbs[i];
+            memset(cb, 0, sizeof(*cb));
+            cb->aio_data = reinterpret_cast<uintptr_t>(a);
+            cb->aio_lio_opcode = a->get_is_read() ? IOCB_CMD_PREADV : IOCB_CMD_PWRITEV;
+            cb->aio_fildes = a->fd;
+            cb->aio_buf = reinterpret_cast<uintptr_t>(vecs);
+            cb->aio_nbytes = vecs_len;
+            cb->aio_offset = a->offset;
+            cb->aio_flags = IOCB_FLAG_RESFD;
+            cb->aio_resfd = completion_event.get_notify_fd();
+            iocb_ptrs[i] = cb;
+        }
+
+        int res;
+        do {
+            res = sys_io_submit(aio_context, n, iocb_ptrs.data());
+        } while (res == -1 && get_errno() == EINTR);
+
+        if (res == -1) {
+            const int errsv = get_errno();
+            if (errsv == EAGAIN) {
+                if (n_pending > 0) {
+                    // We'll try again when something completes.
+                    break;
+                }
+                // Nothing is in flight, so nothing would wake us up to retry.
+                // Run the operations through the pool instead.
+                while (!unsubmitted.empty()) {
+                    ++n_fallback;
+                    fallback_queue.push(unsubmitted.front());
+                    unsubmitted.pop_front();
+                }
+                break;
+            }
+            // The kernel rejected the first operation of the batch (for
+            // example because its file descriptor doesn't support AIO). Fail
+            // it and carry on with the rest.
+            action_t *a = unsubmitted.front();
+            unsubmitted.pop_front();
+            a->io_result = -errsv;
+            done_fun(a);
+            continue;
+        }
+
+        guarantee(res > 0 && static_cast<size_t>(res) <= n);
+        unsubmitted.erase(unsubmitted.begin(), unsubmitted.begin() + res);
+        n_pending += res;
+        if (static_cast<size_t>(res) < n) {
+            // The kernel is full, try again when something completes.
+            break;
+        }
+    }
+}
+
+void aio_diskmgr_t::on_event(DEBUG_VAR int events) {
+    assert_thread();
+    rassert(events == poll_event_in);
+    completion_event.consume_wakey_wakeys();
+
+    std::vector<action_t *> completed;
+    io_event io_events[MAX_IO_EVENT_PROCESSING_BATCH_SIZE];
+    for (;;) {
+        timespec zero_timeout;
+        zero_timeout.tv_sec = 0;
+        zero_timeout.tv_nsec = 0;
+        int res;
+        do {
+            res = sys_io_getevents(aio_context, 0, MAX_IO_EVENT_PROCESSING_BATCH_SIZE,
+                                   io_events, &zero_timeout);
+        } while (res == -1 && get_errno() == EINTR);
+        guarantee_err(res >= 0, "Could not get AIO events");
+
+        for (int i = 0; i < res; ++i) {
+            action_t *a = reinterpret_cast<action_t *>(io_events[i].data);
+            const int64_t result = io_events[i].res;
+            if (result < 0 || result == static_cast<int64_t>(a->get_count())) {
+                a->io_result = result;
+            } else {
+                // A short transfer.  The pool backend would have retried, but
+                // for the aligned, in-bounds requests we make this means
+                // something is wrong with the device.
+                a->io_result = -EIO;
+            }
+            completed.push_back(a);
+        }
+        n_pending -= res;
+        rassert(n_pending >= 0);
+
+        if (res < MAX_IO_EVENT_PROCESSING_BATCH_SIZE) {
+            break;
+        }
+    }
+
+    // Refill the kernel's queue before running callbacks, like
+    // `pool_diskmgr_action_t::done()` does.
+    pump();
+
+    for (size_t i = 0; i < completed.size(); ++i) {
+        done_fun(completed[i]);
+    }
+}
+
+#else  // AIO_DISKMGR_SUPPORTED
+
+bool aio_diskmgr_t::is_supported() {
+    return false;
+}
+
+aio_diskmgr_t::aio_diskmgr_t(linux_event_queue_t *_queue,
+                             passive_producer_t<action_t *> *_source,
+                             int max_concurrent_io_requests)
+    : queue_depth(max_concurrent_io_requests),
+      source(_source),
+      queue(_queue),
+      fallback_pool(_queue, &fallback_queue, AIO_FALLBACK_POOL_THREADS),
+      n_pending(0),
+      n_fallback(0) {
+    crash("The AIO disk manager is not supported on this platform.");
+}
+
+aio_diskmgr_t::~aio_diskmgr_t() { }
+
+void aio_diskmgr_t::pump() { }
+
+#endif  // AIO_DISKMGR_SUPPORTED
+
+void aio_diskmgr_t::on_source_availability_changed() {
+    assert_thread();
+    if (source->available->get()) pump();
+}
+
+void aio_diskmgr_t::on_fallback_done(action_t *a) {
+    assert_thread();
+    --n_fallback;
+    rassert(n_fallback >= 0);
+    // The operation no longer counts against the queue depth.
+    pump();
+    done_fun(a);
+}
@@ -0,0 +1,106 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_AIO_HPP_
+#define ARCH_IO_DISK_AIO_HPP_
+
+#if defined(__linux) && !defined(NO_EVENTFD) && !defined(LEGACY_LINUX)
+#define AIO_DISKMGR_SUPPORTED 1
+#else
+#define AIO_DISKMGR_SUPPORTED 0
+#endif
+
+#include <deque>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/function.hpp>
+
+#include "arch/io/disk/pool.hpp"
+#include "arch/runtime/event_queue.hpp"
+#include "concurrency/queue/passive_producer.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+
+#if AIO_DISKMGR_SUPPORTED
+#include <linux/aio_abi.h>
+#include "arch/runtime/system_event/eventfd_event.hpp"
+#endif
+
+/* The AIO disk manager submits reads and writes to the kernel through Linux
+native AIO (`io_submit()`), in batches, and gets told about completions through
+an eventfd that is watched by the thread's event queue. Unlike the
+`pool_diskmgr_t`, the number of requests in flight is not bounded by a number of
+blocker threads, and no thread handoff is needed per request.
+
+Kernel AIO is only truly asynchronous on files opened with `O_DIRECT`. With
+buffered I/O, `io_submit()` may block the calling thread.
+
+Operations that AIO cannot express (resizes and writes that need to be wrapped
+in datasyncs) are forwarded to an internal `pool_diskmgr_t`, so callers see no
+difference between the two backends. It uses the same action type as the
+`pool_diskmgr_t` and plugs into the I/O stack at the same place. */
+
+class aio_diskmgr_t : private availability_callback_t,
+#if AIO_DISKMGR_SUPPORTED
+                      private linux_event_callback_t,
+#endif
+                      public home_thread_mixin_debug_only_t {
+public:
+    typedef pool_diskmgr_action_t action_t;
+
+    /* Returns true if an AIO context can be created on this system. */
+    static bool is_supported();
+
+    /* The `aio_diskmgr_t` will draw actions to run from `source`. It will call
+    `done_fun` on each one when it's done. At most `max_concurrent_io_requests`
+    operations are in progress at any time, whether in the kernel or in the
+    fallback pool. */
+    aio_diskmgr_t(linux_event_queue_t *queue, passive_producer_t<action_t *> *source,
+                  int max_concurrent_io_requests);
+    boost::function<void(action_t *)> done_fun;
+    ~aio_diskmgr_t();
+
+private:
+    void on_source_availability_changed();
+    void pump();
+
+    /* Called by `fallback_pool` when a forwarded operation is done. */
+    void on_fallback_done(action_t *a);
+
+    const int queue_depth;
+    passive_producer_t<action_t *> *source;
+    linux_event_queue_t *const queue;
+
+    /* Operations that AIO can't express go here, and from there to the pool. */
+    unlimited_fifo_queue_t<action_t *> fallback_queue;
+    pool_diskmgr_t fallback_pool;
+
+    /* The number of operations that have been given to the kernel and have not
+    completed yet. Does not include operations handled by `fallback_pool`. */
+    int n_pending;
+
+    /* The number of operations in `fallback_queue` or `fallback_pool`. They count
+    against `queue_depth` too, so that `pump()` stops taking operations from
+    `source` while the pool is behind. */
+    int n_fallback;
+
+#if AIO_DISKMGR_SUPPORTED
+    void on_event(int events);
+
+    /* Submits everything in `unsubmitted` that the kernel will take. */
+    void submit_unsubmitted();
+
+    aio_context_t aio_context;
+    eventfd_event_t completion_event;
+
+    /* Operations popped from `source` that the kernel hasn't accepted yet
+    (`io_submit()` returned `EAGAIN` or accepted only a prefix of a batch). */
+    std::deque<action_t *> unsubmitted;
+
+    /* Scratch space reused by each call to `submit_unsubmitted()`. */
+    std::vector<iocb> iocbs;
+    std::vector<iocb *> iocb_ptrs;
+#endif  // AIO_DISKMGR_SUPPORTED
+
+    DISABLE_COPYING(aio_diskmgr_t);
+};
+
+#endif  // ARCH_IO_DISK_AIO_HPP_
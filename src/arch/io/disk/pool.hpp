@@ -21,6 +21,7 @@
 #endif
 
 struct iovec;
+class aio_diskmgr_t;
 class pool_diskmgr_t;
 class printf_buffer_t;
 
@@ -99,6 +100,7 @@ struct pool_diskmgr_action_t
 
 private:
     friend class pool_diskmgr_t;
+    friend class aio_diskmgr_t;
     pool_diskmgr_t *parent;
 
     enum action_type_t {ACTION_READ, ACTION_WRITE, ACTION_RESIZE};
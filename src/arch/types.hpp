@@ -101,6 +101,13 @@ enum class file_direct_io_mode_t {
     buffered_desired
 };
 
+// Which disk manager actually runs the I/O operations: a pool of threads doing
+// blocking syscalls, or Linux native AIO.
+enum class io_backend_t {
+    pool,
+    native_aio
+};
+
 
 
 class semantic_checking_file_t {
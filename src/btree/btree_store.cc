@@ -330,8 +330,8 @@ void btree_store_t<protocol_t>::sindex_queue_push(
 
 template <class protocol_t>
 void btree_store_t<protocol_t>::add_progress_tracker(
-        map_insertion_sentry_t<uuid_u, const parallel_traversal_progress_t *> *sentry,
-        uuid_u id, const parallel_traversal_progress_t *p) {
+        map_insertion_sentry_t<uuid_u, const traversal_progress_t *> *sentry,
+        uuid_u id, const traversal_progress_t *p) {
     assert_thread();
     sentry->reset(&progress_trackers, id, p);
 }
@@ -179,8 +179,8 @@ public:
             const new_mutex_in_line_t *acq);
 
     void add_progress_tracker(
-        map_insertion_sentry_t<uuid_u, const parallel_traversal_progress_t *> *sentry,
-        uuid_u id, const parallel_traversal_progress_t *p);
+        map_insertion_sentry_t<uuid_u, const traversal_progress_t *> *sentry,
+        uuid_u id, const traversal_progress_t *p);
 
     progress_completion_fraction_t get_progress(uuid_u id);
 
@@ -390,7 +390,7 @@ public:
 
     std::vector<internal_disk_backed_queue_t *> sindex_queues;
     new_mutex_t sindex_queue_mutex;
-    std::map<uuid_u, const parallel_traversal_progress_t *> progress_trackers;
+    std::map<uuid_u, const traversal_progress_t *> progress_trackers;
 
     // Mind the constructor ordering. We must destruct drainer before destructing
     // many of the other structures.
@@ -0,0 +1,227 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "btree/bulk_load.hpp"
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "btree/slice.hpp"
+
+int64_t node_key_count(buf_lock_t *buf) {
+    buf_read_t read(buf);
+    return node::key_count(static_cast<const node_t *>(read.get_data_read()));
+}
+
+btree_bulk_loader_t::btree_bulk_loader_t(value_sizer_t<void> *sizer,
+                                         superblock_t *superblock,
+                                         btree_stats_t *stats)
+    : sizer_(sizer), superblock_(superblock), stats_(stats),
+      has_greatest_key_(false), unflushed_count_(0), population_change_(0) {
+    ensure_stat_block(superblock_);
+
+    // Walk down the right spine.  The rightmost leaf holds the keys greater than
+    // the last separator on the way, which gets greater with every level.
+    std::vector<buf_lock_t> path;
+    path.push_back(get_root(sizer_, superblock_));
+    for (;;) {
+        block_id_t child_id;
+        {
+            buf_read_t read(&path.back());
+            const node_t *node = static_cast<const node_t *>(read.get_data_read());
+            if (!node::is_internal(node)) {
+                const btree_key_t *key
+                    = leaf::greatest_key(reinterpret_cast<const leaf_node_t *>(node));
+                if (key != NULL) {
+                    has_greatest_key_ = true;
+                    greatest_key_ = store_key_t(key);
+                }
+                break;
+            }
+            const internal_node_t *inode
+                = reinterpret_cast<const internal_node_t *>(node);
+            if (inode->npairs >= 2) {
+                has_greatest_key_ = true;
+                greatest_key_ = store_key_t(
+                    &internal_node::get_pair_by_index(inode, inode->npairs - 2)->key);
+            }
+            child_id = internal_node::get_pair_by_index(inode, inode->npairs - 1)->lnode;
+        }
+        buf_lock_t child(&path.back(), child_id, access_t::write);
+        path.push_back(std::move(child));
+    }
+
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        spine_.push_back(std::move(*it));
+    }
+}
+
+btree_bulk_loader_t::~btree_bulk_loader_t() {
+    flush_count();
+    if (population_change_ != 0) {
+        // The stat block is detached from the rest of the btree, so we pass the
+        // txn as its parent (just like apply_keyvalue_change does).
+        buf_lock_t stat_block(buf_parent_t(spine_[0].txn()),
+                              superblock_->get_stat_block_id(), access_t::write);
+        buf_write_t stat_block_write(&stat_block);
+        auto stat_block_buf
+            = static_cast<btree_statblock_t *>(stat_block_write.get_data_write());
+        stat_block_buf->population += population_change_;
+    }
+}
+
+bool btree_bulk_loader_t::can_append(const btree_key_t *key) const {
+    return !has_greatest_key_ || btree_key_cmp(key, greatest_key_.btree_key()) > 0;
+}
+
+void btree_bulk_loader_t::append(const btree_key_t *key, const void *value,
+                                 repli_timestamp_t tstamp) {
+    guarantee(can_append(key), "keys must be appended in ascending order");
+
+    bool leaf_is_full;
+    {
+        buf_read_t read(&spine_[0]);
+        leaf_is_full = leaf::is_full(
+            sizer_, static_cast<const leaf_node_t *>(read.get_data_read()), key, value);
+    }
+    if (leaf_is_full) {
+        add_leaf(key);
+    }
+
+    {
+        buf_write_t write(&spine_[0]);
+        leaf::insert(sizer_, static_cast<leaf_node_t *>(write.get_data_write()),
+                     key, value, tstamp, key_modification_proof_t::real_proof());
+    }
+
+    has_greatest_key_ = true;
+    greatest_key_ = store_key_t(key);
+    ++unflushed_count_;
+    ++population_change_;
+    stats_->pm_keys_set.record();
+}
+
+void btree_bulk_loader_t::flush_count() {
+    if (unflushed_count_ == 0) {
+        return;
+    }
+    for (size_t level = 1; level < spine_.size(); ++level) {
+        buf_write_t write(&spine_[level]);
+        auto node = static_cast<internal_node_t *>(write.get_data_write());
+        if (!internal_node::is_counted(node)) {
+            break;
+        }
+        internal_node::set_child_key_count(
+            node, node->npairs - 1,
+            internal_node::child_key_count(node, node->npairs - 1) + unflushed_count_);
+    }
+    unflushed_count_ = 0;
+}
+
+void btree_bulk_loader_t::add_leaf(const btree_key_t *next_key) {
+    const block_size_t block_size = sizer_->block_size();
+
+    // The counts of the nodes that change hands below have to be right.
+    flush_count();
+
+    // New internal nodes have the format of the tree's other internal nodes, and
+    // keep key counts if there are none yet.
+    bool counted = true;
+    if (spine_.size() > 1) {
+        buf_read_t read(&spine_[1]);
+        counted = internal_node::is_counted(
+            static_cast<const internal_node_t *>(read.get_data_read()));
+    }
+
+    // Find the lowest internal node on the spine that has room for another child.
+    // Each full node below it hands its last child over to a new node to its right,
+    // so that no node ends up with a single child.
+    size_t room = 1;
+    while (room < spine_.size()) {
+        buf_read_t read(&spine_[room]);
+        if (!internal_node::is_full(
+                static_cast<const internal_node_t *>(read.get_data_read()))) {
+            break;
+        }
+        ++room;
+    }
+
+    // separators[level] will separate spine_[level] from the new node to its right.
+    // The rightmost leaf is full, so it isn't empty and greatest_key_ is set.
+    rassert(has_greatest_key_);
+    std::vector<store_key_t> separators(room);
+    separator_key(greatest_key_.btree_key(), next_key, separators[0].btree_key());
+    for (size_t level = 1; level < room; ++level) {
+        buf_read_t read(&spine_[level]);
+        auto node = static_cast<const internal_node_t *>(read.get_data_read());
+        separators[level]
+            = store_key_t(&internal_node::get_pair_by_index(node, node->npairs - 2)->key);
+    }
+
+    if (room == spine_.size()) {
+        // Every node on the spine is full, so the tree grows a new root.
+        superblock_->expose_buf().detach_child(spine_.back().block_id());
+        buf_lock_t root(superblock_->expose_buf(), alt_create_t::create);
+        {
+            buf_write_t write(&root);
+            internal_node::init(block_size,
+                                static_cast<internal_node_t *>(write.get_data_write()),
+                                counted);
+        }
+        root.manually_touch_recency(spine_.back().get_recency());
+        insert_root(root.block_id(), superblock_);
+        spine_.push_back(std::move(root));
+    }
+
+    // Create the new nodes top-down, each as the child of the one above it.
+    std::vector<buf_lock_t> new_nodes(room);
+    for (size_t level = room; level-- > 0;) {
+        buf_lock_t *parent = level + 1 == room ? &spine_[room] : &new_nodes[level + 1];
+        new_nodes[level] = buf_lock_t(parent, alt_create_t::create);
+        buf_write_t write(&new_nodes[level]);
+        if (level == 0) {
+            leaf::init(sizer_, static_cast<leaf_node_t *>(write.get_data_write()));
+        } else {
+            internal_node::init(block_size,
+                                static_cast<internal_node_t *>(write.get_data_write()),
+                                counted);
+        }
+    }
+
+    // Move the last child of each full node over to the new node next to it.
+    for (size_t level = 1; level < room; ++level) {
+        const block_id_t moved_child = spine_[level - 1].block_id();
+        spine_[level].detach_child(moved_child);
+        {
+            buf_write_t write(&spine_[level]);
+            internal_node::remove(block_size,
+                                  static_cast<internal_node_t *>(write.get_data_write()),
+                                  greatest_key_.btree_key());
+        }
+        {
+            buf_write_t write(&new_nodes[level]);
+            DEBUG_VAR bool success = internal_node::insert(
+                block_size, static_cast<internal_node_t *>(write.get_data_write()),
+                separators[level - 1].btree_key(),
+                moved_child, node_key_count(&spine_[level - 1]),
+                new_nodes[level - 1].block_id(), node_key_count(&new_nodes[level - 1]));
+            rassert(success);
+        }
+        new_nodes[level].manually_touch_recency(
+            superceding_recency(new_nodes[level].get_recency(),
+                                spine_[level - 1].get_recency()));
+    }
+
+    {
+        buf_write_t write(&spine_[room]);
+        bool success = internal_node::insert(
+            block_size, static_cast<internal_node_t *>(write.get_data_write()),
+            separators[room - 1].btree_key(),
+            spine_[room - 1].block_id(), node_key_count(&spine_[room - 1]),
+            new_nodes[room - 1].block_id(), node_key_count(&new_nodes[room - 1]));
+        guarantee(success, "could not insert internal btree node");
+    }
+
+    for (size_t level = 0; level < room; ++level) {
+        spine_[level] = std::move(new_nodes[level]);
+    }
+}
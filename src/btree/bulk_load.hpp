@@ -0,0 +1,72 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BTREE_BULK_LOAD_HPP_
+#define BTREE_BULK_LOAD_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "buffer_cache/alt/alt.hpp"
+#include "repli_timestamp.hpp"
+
+class btree_stats_t;
+class superblock_t;
+template <class> class value_sizer_t;
+
+/* Appends key/value pairs to the right edge of a btree, i.e. after every key that
+the tree already has an entry for.  Pairs go into the rightmost leaf until it is
+full, then into a new leaf to the right of it, and new internal nodes are added
+along the right spine the same way.  Unlike splits, which leave both halves half
+empty, this fills every node it passes completely, and it holds on to the right
+spine instead of descending from the root for every key.  That makes it the way to
+build a tree out of sorted data.
+
+A loader lives for one transaction: it acquires the right spine for write when it is
+constructed and releases it (and updates the stat block) when it is destroyed.  In
+between, the superblock has to stay acquired for write, because the root may
+change. */
+class btree_bulk_loader_t {
+public:
+    btree_bulk_loader_t(value_sizer_t<void> *sizer, superblock_t *superblock,
+                        btree_stats_t *stats);
+    ~btree_bulk_loader_t();
+
+    // Whether `key` is greater than every key in the tree, so it can be appended.
+    bool can_append(const btree_key_t *key) const;
+
+    // `can_append(key)` must be true.
+    void append(const btree_key_t *key, const void *value, repli_timestamp_t tstamp);
+
+    // The leaf that the last pair went into, or the rightmost leaf if nothing has
+    // been appended yet.
+    buf_parent_t rightmost_leaf() { return buf_parent_t(&spine_[0]); }
+
+private:
+    // Starts a new rightmost leaf for `next_key`, adding nodes to the right spine
+    // as necessary.
+    void add_leaf(const btree_key_t *next_key);
+
+    // Adds the pairs appended since the last call to the key counts on the spine.
+    void flush_count();
+
+    value_sizer_t<void> *const sizer_;
+    superblock_t *const superblock_;
+    btree_stats_t *const stats_;
+
+    // The right spine of the tree: spine_[0] is the rightmost leaf and
+    // spine_.back() is the root.
+    std::vector<buf_lock_t> spine_;
+
+    // Every key in the tree is less than or equal to this one.
+    bool has_greatest_key_;
+    store_key_t greatest_key_;
+
+    // The pairs appended to spine_[0] that the counts above it don't include yet.
+    int64_t unflushed_count_;
+    int64_t population_change_;
+
+    DISABLE_COPYING(btree_bulk_loader_t);
+};
+
+#endif  // BTREE_BULK_LOAD_HPP_
@@ -1,6 +1,8 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "btree/depth_first_traversal.hpp"
 
+#include <algorithm>
+
 #include "btree/operations.hpp"
 #include "rdb_protocol/profile.hpp"
 
@@ -84,6 +86,7 @@ bool btree_depth_first_traversal(counted_t<counted_buf_lock_t> block,
     buf_read_t read(block.get());
     const node_t *node = static_cast<const node_t *>(read.get_data_read());
     if (node::is_internal(node)) {
+        read.mark_pinned();
         const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(node);
         int start_index = internal_node::get_offset_index(inode, range.left.btree_key());
         int end_index;
@@ -94,7 +97,24 @@ bool btree_depth_first_traversal(counted_t<counted_buf_lock_t> block,
             r.decrement();
             end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
         }
+        // Loads of the children after the one we descend into are started ahead of
+        // time, so that a cold scan has several reads in flight.  In traversal
+        // order, children 1 to prefetch_end - 1 have been prefetched (child 0 gets
+        // acquired right away).
+        int prefetch_end = 1;
+        int prefetch_window = 1;
         for (int i = 0; i < end_index - start_index; ++i) {
+            const int prefetch_target
+                = std::min(end_index - start_index, i + 1 + prefetch_window);
+            for (; prefetch_end < prefetch_target; ++prefetch_end) {
+                int prefetch_index = (direction == FORWARD
+                                      ? start_index + prefetch_end
+                                      : (end_index - 1) - prefetch_end);
+                block.get()->cache()->prefetch(
+                    internal_node::get_pair_by_index(inode, prefetch_index)->lnode);
+            }
+            prefetch_window = std::min(2 * prefetch_window, BTREE_PREFETCH_MAX_CHILDREN);
+
             int true_index = (direction == FORWARD ? start_index + i : (end_index - 1) - i);
             const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, true_index);
             counted_t<counted_buf_lock_t> lock;
@@ -151,3 +171,86 @@ bool btree_depth_first_traversal(counted_t<counted_buf_lock_t> block,
         return true;
     }
 }
+
+/* Returns the number of keys of `range` in the subtree of `block`.  The subtree
+lies inside the range's left bound if `left_inside` is set, and inside its right
+bound if `right_inside` is set.  A counted internal node answers for the children
+that lie inside both bounds without loading them, so only the nodes along the two
+bounds get read. */
+uint64_t count_keys_in_subtree(buf_lock_t *block,
+                               const key_range_t &range,
+                               bool left_inside,
+                               bool right_inside,
+                               profile::trace_t *trace) {
+    buf_read_t read(block);
+    const node_t *node = static_cast<const node_t *>(read.get_data_read());
+    if (node::is_internal(node)) {
+        read.mark_pinned();
+        const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(node);
+        int start_index = (left_inside
+                           ? 0
+                           : internal_node::get_offset_index(inode, range.left.btree_key()));
+        int end_index;
+        if (right_inside || range.right.unbounded) {
+            end_index = inode->npairs;
+        } else {
+            store_key_t r = range.right.key;
+            r.decrement();
+            end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
+        }
+        const bool counted = internal_node::is_counted(inode);
+        uint64_t count = 0;
+        for (int i = start_index; i < end_index; ++i) {
+            // Child `i` holds the keys above the key of pair `i - 1`, up to and
+            // including the key of pair `i`.
+            const bool child_left_inside = left_inside || i > start_index;
+            const bool child_right_inside = right_inside || i < end_index - 1;
+            if (counted && child_left_inside && child_right_inside) {
+                count += internal_node::child_key_count(inode, i);
+            } else {
+                const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, i);
+                profile::starter_t starter("Acquire block for read.", trace);
+                buf_lock_t lock(block, pair->lnode, access_t::read);
+                count += count_keys_in_subtree(&lock, range, child_left_inside,
+                                               child_right_inside, trace);
+            }
+        }
+        return count;
+    } else {
+        const leaf_node_t *lnode = reinterpret_cast<const leaf_node_t *>(node);
+        if (left_inside && right_inside) {
+            return leaf::key_count(lnode);
+        }
+        uint64_t count = 0;
+        for (auto it = leaf::inclusive_lower_bound(range.left.btree_key(), *lnode);
+             it != leaf::end(*lnode); ++it) {
+            if (!range.right.unbounded &&
+                btree_key_cmp((*it).first, range.right.key.btree_key()) >= 0) {
+                break;
+            }
+            ++count;
+        }
+        return count;
+    }
+}
+
+uint64_t btree_count_keys(superblock_t *superblock,
+                          const key_range_t &range,
+                          profile::trace_t *trace) {
+    block_id_t root_block_id = superblock->get_root_block_id();
+    if (root_block_id == NULL_BLOCK_ID) {
+        superblock->release();
+        return 0;
+    }
+    buf_lock_t root_block;
+    {
+        profile::starter_t starter("Acquire block for read.", trace);
+        root_block = buf_lock_t(superblock->expose_buf(), root_block_id,
+                                access_t::read);
+        superblock->release();
+        root_block.read_acq_signal()->wait();
+    }
+    return count_keys_in_subtree(&root_block, range,
+                                 range.left.size() == 0, range.right.unbounded,
+                                 trace);
+}
@@ -70,4 +70,11 @@ bool btree_depth_first_traversal(superblock_t *superblock,
                                  depth_first_traversal_callback_t *cb,
                                  direction_t direction);
 
+/* Returns the number of keys in `range`.  On a tree whose internal nodes keep key
+counts, only the nodes along the range's two bounds get read; other trees have
+their leaves in the range scanned.  Releases `superblock`. */
+uint64_t btree_count_keys(superblock_t *superblock,
+                          const key_range_t &range,
+                          profile::trace_t *trace);
+
 #endif /* BTREE_DEPTH_FIRST_TRAVERSAL_HPP_ */
@@ -13,26 +13,30 @@ class ibuf_t;
 
 // We can't use "internal" for internal stuff obviously.
 namespace impl {
-size_t pair_size_with_key(const btree_key_t *key);
-size_t pair_size_with_key_size(uint8_t size);
+size_t pair_size_with_key(const internal_node_t *node, const btree_key_t *key);
+size_t pair_size_with_key_size(const internal_node_t *node, uint8_t size);
+int64_t get_count(const btree_internal_pair *pair);
+void set_count(btree_internal_pair *pair, int64_t count);
 
 void delete_pair(internal_node_t *node, uint16_t offset);
 uint16_t insert_pair(internal_node_t *node, const btree_internal_pair *pair);
-uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key);
+uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key, int64_t count);
 void delete_offset(internal_node_t *node, int index);
 void insert_offset(internal_node_t *node, uint16_t offset, int index);
 void make_last_pair_special(internal_node_t *node);
 bool is_equal(const btree_key_t *key1, const btree_key_t *key2);
 }  // namespace internal_node::impl
 
-void init(block_size_t block_size, internal_node_t *node) {
-    node->magic = internal_node_t::expected_magic;
+void init(block_size_t block_size, internal_node_t *node, bool counted) {
+    // Offsets into the node are uint16_t.
+    rassert(block_size.ser_value() <= MAX_BTREE_BLOCK_SIZE);
+    node->magic = counted ? internal_node_t::counted_magic : internal_node_t::expected_magic;
     node->npairs = 0;
     node->frontmost_offset = block_size.value();
 }
 
 void init(block_size_t block_size, internal_node_t *node, const internal_node_t *lnode, const uint16_t *offsets, int numpairs) {
-    init(block_size, node);
+    init(block_size, node, is_counted(lnode));
     rassert(get_pair_by_index(lnode, lnode->npairs-1)->key.size == 0);
     for (int i = 0; i < numpairs; i++) {
         node->pair_offsets[i] = impl::insert_pair(node, get_pair(lnode, offsets[i]));
@@ -48,7 +52,8 @@ block_id_t lookup(const internal_node_t *node, const btree_key_t *key) {
 }
 
 // TODO: If it's unused, let's get rid of it.
-bool insert(UNUSED block_size_t block_size, internal_node_t *node, const btree_key_t *key, block_id_t lnode, block_id_t rnode) {
+bool insert(UNUSED block_size_t block_size, internal_node_t *node, const btree_key_t *key,
+            block_id_t lnode, int64_t lcount, block_id_t rnode, int64_t rcount) {
     //TODO: write a unit test for this
     rassert(key->size <= MAX_KEY_SIZE, "key too large");
     if (is_full(node)) return false;
@@ -56,17 +61,18 @@ bool insert(UNUSED block_size_t block_size, internal_node_t *node, const btree_k
         btree_key_t special;
         special.size = 0;
 
-        const uint16_t special_offset = impl::insert_pair(node, rnode, &special);
+        const uint16_t special_offset = impl::insert_pair(node, rnode, &special, rcount);
         impl::insert_offset(node, special_offset, 0);
     }
 
     int index = get_offset_index(node, key);
     rassert(!impl::is_equal(&get_pair_by_index(node, index)->key, key),
         "tried to insert duplicate key into internal node!");
-    const uint16_t offset = impl::insert_pair(node, lnode, key);
+    const uint16_t offset = impl::insert_pair(node, lnode, key, lcount);
     impl::insert_offset(node, offset, index);
 
     get_pair_by_index(node, index + 1)->lnode = rnode;
+    set_child_key_count(node, index + 1, rcount);
     return true;
 }
 
@@ -88,7 +94,7 @@ void split(block_size_t block_size, internal_node_t *node, internal_node_t *rnod
     uint16_t first_pairs = 0;
     int index = 0;
     while (first_pairs < total_pairs/2) { // finds the median index
-        first_pairs += pair_size(get_pair_by_index(node, index));
+        first_pairs += pair_size(node, get_pair_by_index(node, index));
         index++;
     }
     int median_index = index;
@@ -130,7 +136,8 @@ void merge(block_size_t block_size, const internal_node_t *node, internal_node_t
         const uint16_t new_offset = impl::insert_pair(rnode, get_pair_by_index(node, i));
         rnode->pair_offsets[i] = new_offset;
     }
-    const uint16_t new_offset = impl::insert_pair(rnode, get_pair_by_index(node, node->npairs-1)->lnode, key_from_parent);
+    const uint16_t new_offset = impl::insert_pair(rnode, get_pair_by_index(node, node->npairs-1)->lnode, key_from_parent,
+                                                  child_key_count(node, node->npairs-1));
     rnode->pair_offsets[node->npairs - 1] = new_offset;
 
     const uint16_t new_npairs = rnode->npairs + node->npairs;
@@ -151,11 +158,12 @@ bool level(block_size_t block_size, internal_node_t *node,
 
     if (nodecmp(node, sibling) < 0) {
         const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(node, 0)->key))->key;
-        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(key_from_parent) >= node->frontmost_offset)
+        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(node, key_from_parent) >= node->frontmost_offset)
             return false;
         uint16_t special_pair_offset = node->pair_offsets[node->npairs-1];
         block_id_t last_offset = get_pair(node, special_pair_offset)->lnode;
-        uint16_t new_pair_offset = impl::insert_pair(node, last_offset, key_from_parent);
+        uint16_t new_pair_offset = impl::insert_pair(node, last_offset, key_from_parent,
+                                                     child_key_count(node, node->npairs-1));
         node->pair_offsets[node->npairs - 1] = new_pair_offset;
 
         uint16_t new_npairs = node->npairs;
@@ -164,7 +172,7 @@ bool level(block_size_t block_size, internal_node_t *node,
         // and increase efficiency.
         for (;;) {
             const btree_internal_pair *pair_to_move = get_pair_by_index(sibling, 0);
-            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(pair_to_move);
+            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(sibling, pair_to_move);
             if (new_npairs * sizeof(*node->pair_offsets) + (block_size.value() - node->frontmost_offset) + size_change >= sibling->npairs * sizeof(*sibling->pair_offsets) + (block_size.value() - sibling->frontmost_offset) - size_change) {
                 break;
             }
@@ -189,6 +197,9 @@ bool level(block_size_t block_size, internal_node_t *node,
 
         btree_internal_pair *special_pair = get_pair(node, special_pair_offset);
         special_pair->lnode = pair_for_parent->lnode;
+        if (is_counted(node)) {
+            impl::set_count(special_pair, impl::get_count(pair_for_parent));
+        }
 
         keycpy(replacement_key, &pair_for_parent->key);
 
@@ -200,10 +211,11 @@ bool level(block_size_t block_size, internal_node_t *node,
     } else {
         uint16_t offset;
         const btree_key_t *key_from_parent = &get_pair_by_index(parent, get_offset_index(parent, &get_pair_by_index(sibling, 0)->key))->key;
-        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(key_from_parent) >= node->frontmost_offset)
+        if (sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(node, key_from_parent) >= node->frontmost_offset)
             return false;
         block_id_t first_child = get_pair_by_index(sibling, sibling->npairs-1)->lnode;
-        offset = impl::insert_pair(node, first_child, key_from_parent);
+        offset = impl::insert_pair(node, first_child, key_from_parent,
+                                   child_key_count(sibling, sibling->npairs-1));
         impl::insert_offset(node, offset, 0);
         if (moved_children_out != NULL) {
             moved_children_out->push_back(first_child);
@@ -215,7 +227,7 @@ bool level(block_size_t block_size, internal_node_t *node,
         // drastically reduce the number and increase efficiency.
         for (;;) {
             const btree_internal_pair *pair_to_move = get_pair_by_index(sibling, sibling->npairs-1);
-            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(pair_to_move);
+            uint16_t size_change = sizeof(*node->pair_offsets) + pair_size(sibling, pair_to_move);
             if (node->npairs * sizeof(*node->pair_offsets) + (block_size.value() - node->frontmost_offset) + size_change >= sibling->npairs * sizeof(*sibling->pair_offsets) + (block_size.value() - sibling->frontmost_offset) - size_change) {
                 break;
             }
@@ -276,12 +288,13 @@ void update_key(internal_node_t *node, const btree_key_t *key_to_replace, const
 
     const int index = get_offset_index(node, key_to_replace);
     const block_id_t tmp_lnode = get_pair_by_index(node, index)->lnode;
+    const int64_t tmp_count = child_key_count(node, index);
     impl::delete_pair(node, node->pair_offsets[index]);
 
-    guarantee(sizeof(internal_node_t) + (node->npairs) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(replacement_key) < node->frontmost_offset,
+    guarantee(sizeof(internal_node_t) + (node->npairs) * sizeof(*node->pair_offsets) + impl::pair_size_with_key(node, replacement_key) < node->frontmost_offset,
         "cannot fit updated key in internal node");
 
-    const uint16_t new_offset = impl::insert_pair(node, tmp_lnode, replacement_key);
+    const uint16_t new_offset = impl::insert_pair(node, tmp_lnode, replacement_key, tmp_count);
     node->pair_offsets[index] = new_offset;
 
     rassert(is_sorted(node->pair_offsets, node->pair_offsets+node->npairs-1, internal_key_comp(node)),
@@ -290,7 +303,7 @@ void update_key(internal_node_t *node, const btree_key_t *key_to_replace, const
 }
 
 bool is_full(const internal_node_t *node) {
-    return sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key_size(MAX_KEY_SIZE) >=  node->frontmost_offset;
+    return sizeof(internal_node_t) + (node->npairs + 1) * sizeof(*node->pair_offsets) + impl::pair_size_with_key_size(node, MAX_KEY_SIZE) >=  node->frontmost_offset;
 }
 
 bool change_unsafe(const internal_node_t *node) {
@@ -331,7 +344,7 @@ bool is_mergable(block_size_t block_size, const internal_node_t *node, const int
         (node->npairs + sibling->npairs + 1)*sizeof(*node->pair_offsets) +
         (block_size.value() - node->frontmost_offset) +
         (block_size.value() - sibling->frontmost_offset) + key_from_parent->size +
-        impl::pair_size_with_key_size(MAX_KEY_SIZE) +
+        impl::pair_size_with_key_size(node, MAX_KEY_SIZE) +
         INTERNAL_EPSILON < block_size.value(); // must still have enough room for an arbitrary key  // TODO: we can't be tighter?
 }
 
@@ -339,8 +352,31 @@ bool is_singleton(const internal_node_t *node) {
     return node->npairs == 2;
 }
 
-size_t pair_size(const btree_internal_pair *pair) {
-    return impl::pair_size_with_key_size(pair->key.size);
+bool is_counted(const internal_node_t *node) {
+    return node->magic == internal_node_t::counted_magic;
+}
+
+int64_t child_key_count(const internal_node_t *node, int index) {
+    return is_counted(node) ? impl::get_count(get_pair_by_index(node, index)) : 0;
+}
+
+void set_child_key_count(internal_node_t *node, int index, int64_t count) {
+    if (is_counted(node)) {
+        rassert(count >= 0);
+        impl::set_count(get_pair_by_index(node, index), count);
+    }
+}
+
+int64_t key_count(const internal_node_t *node) {
+    int64_t count = 0;
+    for (int i = 0; i < node->npairs; ++i) {
+        count += child_key_count(node, i);
+    }
+    return count;
+}
+
+size_t pair_size(const internal_node_t *node, const btree_internal_pair *pair) {
+    return impl::pair_size_with_key_size(node, pair->key.size);
 }
 
 const btree_internal_pair *get_pair(const internal_node_t *node, uint16_t offset) {
@@ -359,7 +395,20 @@ btree_internal_pair *get_pair_by_index(internal_node_t *node, int index) {
 }
 
 int get_offset_index(const internal_node_t *node, const btree_key_t *key) {
-    return std::lower_bound(node->pair_offsets, node->pair_offsets+node->npairs-1, (uint16_t) internal_key_comp::faux_offset, internal_key_comp(node, key)) - node->pair_offsets;
+    // The first pair whose key is not less than `key`, if not the last pair (whose
+    // key is empty but which covers all the greater keys).
+    const uint64_t key_prefix = btree_key_prefix(key);
+    int beg = 0;
+    int end = node->npairs - 1;
+    while (beg < end) {
+        const int test_point = beg + (end - beg) / 2;
+        if (btree_key_cmp(key, key_prefix, &get_pair_by_index(node, test_point)->key) > 0) {
+            beg = test_point + 1;
+        } else {
+            end = test_point;
+        }
+    }
+    return beg;
 }
 
 int nodecmp(const internal_node_t *node1, const internal_node_t *node2) {
@@ -371,23 +420,35 @@ int nodecmp(const internal_node_t *node1, const internal_node_t *node2) {
 
 namespace impl {
 
-size_t pair_size_with_key(const btree_key_t *key) {
-    return pair_size_with_key_size(key->size);
+size_t pair_size_with_key(const internal_node_t *node, const btree_key_t *key) {
+    return pair_size_with_key_size(node, key->size);
 }
 
-size_t pair_size_with_key_size(uint8_t size) {
-    return offsetof(btree_internal_pair, key) + offsetof(btree_key_t, contents) + size;
+size_t pair_size_with_key_size(const internal_node_t *node, uint8_t size) {
+    return offsetof(btree_internal_pair, key) + offsetof(btree_key_t, contents) + size
+        + (is_counted(node) ? sizeof(int64_t) : 0);
+}
+
+// The count of a pair in a counted node follows the key's contents.
+int64_t get_count(const btree_internal_pair *pair) {
+    int64_t count;
+    memcpy(&count, pair->key.contents + pair->key.size, sizeof(count));
+    return count;
+}
+
+void set_count(btree_internal_pair *pair, int64_t count) {
+    memcpy(pair->key.contents + pair->key.size, &count, sizeof(count));
 }
 
 void delete_pair(internal_node_t *node, uint16_t offset) {
     btree_internal_pair *pair_to_delete = get_pair(node, offset);
     btree_internal_pair *front_pair = get_pair(node, node->frontmost_offset);
-    const size_t shift = pair_size(pair_to_delete);
+    const size_t shift = pair_size(node, pair_to_delete);
     const size_t size = offset - node->frontmost_offset;
 
-    rassert(node->magic == internal_node_t::expected_magic);
+    DEBUG_VAR const block_magic_t magic = node->magic;
     memmove(reinterpret_cast<char *>(front_pair) + shift, front_pair, size);
-    rassert(node->magic == internal_node_t::expected_magic);
+    rassert(node->magic == magic);
 
 
     node->frontmost_offset = node->frontmost_offset + shift;
@@ -403,31 +464,35 @@ void delete_pair(internal_node_t *node, uint16_t offset) {
     memcpy(node->pair_offsets, new_pair_offsets.data(), sizeof(uint16_t) * node->npairs);
 }
 
+// `pair` must come from a node with the same format as `node`.
 uint16_t insert_pair(internal_node_t *node, const btree_internal_pair *pair) {
-    const uint16_t frontmost_offset = node->frontmost_offset - pair_size(pair);
+    const uint16_t frontmost_offset = node->frontmost_offset - pair_size(node, pair);
     node->frontmost_offset = frontmost_offset;
 
     // insert contents
-    memcpy(get_pair(node, frontmost_offset), pair, pair_size(pair));
+    memcpy(get_pair(node, frontmost_offset), pair, pair_size(node, pair));
     return frontmost_offset;
 }
 
-uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key) {
-    const uint16_t frontmost_offset = node->frontmost_offset - pair_size_with_key(key);
+uint16_t insert_pair(internal_node_t *node, block_id_t lnode, const btree_key_t *key, int64_t count) {
+    const uint16_t frontmost_offset = node->frontmost_offset - pair_size_with_key(node, key);
     node->frontmost_offset = frontmost_offset;
 
     btree_internal_pair *new_pair = get_pair(node, frontmost_offset);
 
     // Use a buffer to prepare the key/value pair which we can then use to generate a patch
-    scoped_array_t<char> pair_buf(pair_size_with_key(key));
+    scoped_array_t<char> pair_buf(pair_size_with_key(node, key));
     btree_internal_pair *new_buf_pair = reinterpret_cast<btree_internal_pair *>(pair_buf.data());
 
     // insert contents
     new_buf_pair->lnode = lnode;
     keycpy(&new_buf_pair->key, key);
+    if (is_counted(node)) {
+        set_count(new_buf_pair, count);
+    }
 
     // Patch the new pair into node_buf
-    memcpy(new_pair, new_buf_pair, pair_size_with_key(key));
+    memcpy(new_pair, new_buf_pair, pair_size_with_key(node, key));
 
     return frontmost_offset;
 }
@@ -452,7 +517,8 @@ void make_last_pair_special(internal_node_t *node) {
     const uint16_t old_offset = node->pair_offsets[index];
     btree_key_t tmp;
     tmp.size = 0;
-    const uint16_t new_offset = insert_pair(node, get_pair(node, old_offset)->lnode, &tmp);
+    const uint16_t new_offset = insert_pair(node, get_pair(node, old_offset)->lnode, &tmp,
+                                            child_key_count(node, index));
     node->pair_offsets[index] = new_offset;
     delete_pair(node, old_offset);
 }
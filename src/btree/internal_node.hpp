@@ -13,9 +13,11 @@ struct internal_node_t;
 // See internal_node_t in node.hpp
 
 /* EPSILON used to prevent split then merge */
-#define INTERNAL_EPSILON (sizeof(btree_key_t) + MAX_KEY_SIZE + sizeof(block_id_t))
+#define INTERNAL_EPSILON (sizeof(btree_key_t) + MAX_KEY_SIZE + sizeof(block_id_t) + sizeof(int64_t))
 
 //Note: This struct is stored directly on disk.  Changing it invalidates old data.
+// In a counted node (see internal_node_t::counted_magic), each pair is followed by
+// an unaligned int64_t: the number of keys in the subtree at lnode.
 struct btree_internal_pair {
     block_id_t lnode;
     btree_key_t key;
@@ -27,11 +29,14 @@ class internal_key_comp;
 // In a perfect world, this namespace would be 'branch'.
 namespace internal_node {
 
-void init(block_size_t block_size, internal_node_t *node);
+void init(block_size_t block_size, internal_node_t *node, bool counted);
 void init(block_size_t block_size, internal_node_t *node, const internal_node_t *lnode, const uint16_t *offsets, int numpairs);
 
 block_id_t lookup(const internal_node_t *node, const btree_key_t *key);
-bool insert(block_size_t block_size, internal_node_t *node, const btree_key_t *key, block_id_t lnode, block_id_t rnode);
+// `lcount` and `rcount` are the numbers of keys under `lnode` and `rnode`.  They
+// are ignored unless the node is counted.
+bool insert(block_size_t block_size, internal_node_t *node, const btree_key_t *key,
+            block_id_t lnode, int64_t lcount, block_id_t rnode, int64_t rcount);
 bool remove(block_size_t block_size, internal_node_t *node, const btree_key_t *key);
 void split(block_size_t block_size, internal_node_t *node, internal_node_t *rnode, btree_key_t *median);
 void merge(block_size_t block_size, const internal_node_t *node, internal_node_t *rnode, const internal_node_t *parent);
@@ -47,9 +52,15 @@ bool change_unsafe(const internal_node_t *node);
 bool is_mergable(block_size_t block_size, const internal_node_t *node, const internal_node_t *sibling, const internal_node_t *parent);
 bool is_singleton(const internal_node_t *node);
 
+// Counted nodes keep the number of keys under each child; the others return 0.
+bool is_counted(const internal_node_t *node);
+int64_t child_key_count(const internal_node_t *node, int index);
+void set_child_key_count(internal_node_t *node, int index, int64_t count);
+int64_t key_count(const internal_node_t *node);
+
 void validate(block_size_t block_size, const internal_node_t *node);
 
-size_t pair_size(const btree_internal_pair *pair);
+size_t pair_size(const internal_node_t *node, const btree_internal_pair *pair);
 const btree_internal_pair *get_pair(const internal_node_t *node, uint16_t offset);
 btree_internal_pair *get_pair(internal_node_t *node, uint16_t offset);
 
@@ -3,6 +3,7 @@
 #define BTREE_KEYS_HPP_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -37,6 +38,29 @@ inline int btree_key_cmp(const btree_key_t *left, const btree_key_t *right) {
     return sized_strcmp(left->contents, left->size, right->contents, right->size);
 }
 
+// The first eight bytes of the key as a big-endian number, padded with zero bytes.
+// Keys whose prefixes differ compare the same way as their prefixes, so searches
+// compute the prefix of the key they look for once and then mostly get away with
+// one integer comparison per probe instead of a memcmp.
+inline uint64_t btree_key_prefix(const btree_key_t *key) {
+    uint64_t prefix = 0;
+    memcpy(&prefix, key->contents, key->size < sizeof(prefix) ? key->size : sizeof(prefix));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    prefix = __builtin_bswap64(prefix);
+#endif
+    return prefix;
+}
+
+// Like btree_key_cmp, with `left_prefix` being `btree_key_prefix(left)`.
+inline int btree_key_cmp(const btree_key_t *left, uint64_t left_prefix,
+                         const btree_key_t *right) {
+    const uint64_t right_prefix = btree_key_prefix(right);
+    if (left_prefix != right_prefix) {
+        return left_prefix < right_prefix ? -1 : 1;
+    }
+    return btree_key_cmp(left, right);
+}
+
 struct store_key_t {
 public:
     store_key_t() {
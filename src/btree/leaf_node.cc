@@ -443,6 +443,8 @@ void validate(DEBUG_VAR value_sizer_t<void> *sizer, DEBUG_VAR const leaf_node_t
 }
 
 void init(value_sizer_t<void> *sizer, leaf_node_t *node) {
+    // Offsets into the node are uint16_t.
+    rassert(sizer->block_size().ser_value() <= MAX_BTREE_BLOCK_SIZE);
     node->magic = sizer->btree_leaf_magic();
     node->num_pairs = 0;
     node->live_size = 0;
@@ -515,6 +517,16 @@ bool is_empty(const leaf_node_t *node) {
     return node->num_pairs == 0;
 }
 
+int key_count(const leaf_node_t *node) {
+    int count = 0;
+    for (int i = 0; i < node->num_pairs; ++i) {
+        if (entry_is_live(get_entry(node, node->pair_offsets[i]))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
 bool is_full(value_sizer_t<void> *sizer, const leaf_node_t *node, const btree_key_t *key, const void *value) {
 
     // Upon an insertion, we preserve `MANDATORY_TIMESTAMPS - 1`
@@ -1008,7 +1020,9 @@ void split(value_sizer_t<void> *sizer, leaf_node_t *node, leaf_node_t *rnode, bt
     move_elements(sizer, node, s, node->num_pairs, 0, rnode, node_copysize,
                   tstamp_back_offset, NULL);
 
-    keycpy(median_out, entry_key(get_entry(node, node->pair_offsets[s - 1])));
+    separator_key(entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])),
+                  entry_key(get_entry(rnode, rnode->pair_offsets[0])),
+                  median_out);
 }
 
 void merge(value_sizer_t<void> *sizer, leaf_node_t *left, leaf_node_t *right) {
@@ -1021,9 +1035,12 @@ void merge(value_sizer_t<void> *sizer, leaf_node_t *left, leaf_node_t *right) {
     int mandatory = mandatory_cost(sizer, left, MANDATORY_TIMESTAMPS, &tstamp_back_offset);
 
     int left_copysize = mandatory;
-    // Uncount the uint16_t cost of mandatory  entries.  Sigh.
+    // Uncount the uint16_t cost of mandatory  entries.  Sigh.  Those are the
+    // live entries, which live_size counts, and the deletions in front of
+    // tstamp_back_offset.  Deletions behind it cost nothing, since
+    // move_elements drops them.
     for (int i = 0; i < left->num_pairs; ++i) {
-        if (left->pair_offsets[i] < tstamp_back_offset || entry_is_deletion(get_entry(left, left->pair_offsets[i]))) {
+        if (left->pair_offsets[i] < tstamp_back_offset || entry_is_live(get_entry(left, left->pair_offsets[i]))) {
             left_copysize -= sizeof(uint16_t);
         }
     }
@@ -1137,9 +1154,13 @@ bool level(value_sizer_t<void> *sizer, int nodecmp_node_with_sib,
     guarantee(sibling->num_pairs > 0);
 
     if (nodecmp_node_with_sib < 0) {
-        keycpy(replacement_key_out, entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])));
+        separator_key(entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1])),
+                      entry_key(get_entry(sibling, sibling->pair_offsets[0])),
+                      replacement_key_out);
     } else {
-        keycpy(replacement_key_out, entry_key(get_entry(sibling, sibling->pair_offsets[sibling->num_pairs - 1])));
+        separator_key(entry_key(get_entry(sibling, sibling->pair_offsets[sibling->num_pairs - 1])),
+                      entry_key(get_entry(node, node->pair_offsets[0])),
+                      replacement_key_out);
     }
 
     return true;
@@ -1155,6 +1176,7 @@ bool is_mergable(value_sizer_t<void> *sizer, const leaf_node_t *node, const leaf
 bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
     int beg = 0;
     int end = node->num_pairs;
+    const uint64_t key_prefix = btree_key_prefix(key);
 
     // beg == 0 or key > *(beg - 1).
     // end == num_pairs or key < *end.
@@ -1165,7 +1187,7 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
 
         const btree_key_t *ek = entry_key(get_entry(node, node->pair_offsets[test_point]));
 
-        int res = sized_strcmp(key->contents, key->size, ek->contents, ek->size);
+        int res = btree_key_cmp(key, key_prefix, ek);
 
         if (res < 0) {
             // key < *test_point.
@@ -1187,6 +1209,13 @@ bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out) {
     return false;
 }
 
+const btree_key_t *greatest_key(const leaf_node_t *node) {
+    if (node->num_pairs == 0) {
+        return NULL;
+    }
+    return entry_key(get_entry(node, node->pair_offsets[node->num_pairs - 1]));
+}
+
 bool lookup(value_sizer_t<void> *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out) {
     int index;
     if (find_key(node, key, &index)) {
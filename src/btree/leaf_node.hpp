@@ -122,6 +122,9 @@ void init(value_sizer_t<void> *sizer, leaf_node_t *node);
 
 bool is_empty(const leaf_node_t *node);
 
+// The number of live keys in the node.
+int key_count(const leaf_node_t *node);
+
 bool is_full(value_sizer_t<void> *sizer, const leaf_node_t *node, const btree_key_t *key, const void *value);
 
 bool is_underfull(value_sizer_t<void> *sizer, const leaf_node_t *node);
@@ -141,6 +144,10 @@ bool is_mergable(value_sizer_t<void> *sizer, const leaf_node_t *node, const leaf
 
 bool find_key(const leaf_node_t *node, const btree_key_t *key, int *index_out);
 
+// The greatest key that has an entry in the node, either a live one or a deletion
+// entry, or NULL if there is none.
+const btree_key_t *greatest_key(const leaf_node_t *node);
+
 bool lookup(value_sizer_t<void> *sizer, const leaf_node_t *node, const btree_key_t *key, void *value_out);
 
 void insert(value_sizer_t<void> *sizer, leaf_node_t *node, const btree_key_t *key, const void *value, repli_timestamp_t tstamp, UNUSED key_modification_proof_t km_proof);
@@ -6,8 +6,32 @@
 
 const block_magic_t btree_superblock_t::expected_magic = { { 's', 'u', 'p', 'e' } };
 const block_magic_t internal_node_t::expected_magic = { { 'i', 'n', 't', 'e' } };
+const block_magic_t internal_node_t::counted_magic = { { 'i', 'n', 't', 'c' } };
 const block_magic_t btree_sindex_block_t::expected_magic = { { 's', 'i', 'n', 'd' } };
 
+void separator_key(const btree_key_t *left, const btree_key_t *right, btree_key_t *out) {
+    int prefix = 0;
+    while (prefix < left->size && prefix < right->size
+           && left->contents[prefix] == right->contents[prefix]) {
+        ++prefix;
+    }
+    // Since left < right, either left is a prefix of right (and can't be shortened)
+    // or left's byte after the common prefix is less than right's.
+    if (prefix + 1 < left->size) {
+        rassert(prefix < right->size && left->contents[prefix] < right->contents[prefix]);
+        // The common prefix plus left's next byte, incremented, is greater than left.
+        // It is less than right unless it's all of right.
+        const uint8_t next = left->contents[prefix] + 1;
+        if (next < right->contents[prefix] || prefix + 1 < right->size) {
+            memcpy(out->contents, left->contents, prefix);
+            out->contents[prefix] = next;
+            out->size = prefix + 1;
+            return;
+        }
+    }
+    keycpy(out, left);
+}
+
 namespace node {
 
 bool is_underfull(value_sizer_t<void> *sizer, const node_t *node) {
@@ -47,11 +71,19 @@ void merge(value_sizer_t<void> *sizer, node_t *node, node_t *rnode, const intern
     }
 }
 
+int64_t key_count(const node_t *node) {
+    if (is_leaf(node)) {
+        return leaf::key_count(reinterpret_cast<const leaf_node_t *>(node));
+    } else {
+        return internal_node::key_count(reinterpret_cast<const internal_node_t *>(node));
+    }
+}
+
 void validate(DEBUG_VAR value_sizer_t<void> *sizer, DEBUG_VAR const node_t *node) {
 #ifndef NDEBUG
     if (node->magic == sizer->btree_leaf_magic()) {
         leaf::validate(sizer, reinterpret_cast<const leaf_node_t *>(node));
-    } else if (node->magic == internal_node_t::expected_magic) {
+    } else if (is_internal(node)) {
         internal_node::validate(sizer->block_size(), reinterpret_cast<const internal_node_t *>(node));
     } else {
         unreachable("Invalid leaf node type.");
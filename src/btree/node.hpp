@@ -77,6 +77,9 @@ struct internal_node_t {
     uint16_t pair_offsets[0];
 
     static const block_magic_t expected_magic;
+    // Nodes with this magic also keep the number of keys under each child (see
+    // btree_internal_pair).  Every internal node of a tree has the same magic.
+    static const block_magic_t counted_magic;
 } __attribute__ ((__packed__));
 
 // A node_t is either a btree_internal_node or a btree_leaf_node.
@@ -87,7 +90,8 @@ struct node_t {
 namespace node {
 
 inline bool is_internal(const node_t *node) {
-    if (node->magic == internal_node_t::expected_magic) {
+    if (node->magic == internal_node_t::expected_magic
+        || node->magic == internal_node_t::counted_magic) {
         return true;
     }
     return false;
@@ -108,6 +112,10 @@ void split(value_sizer_t<void> *sizer, node_t *node, node_t *rnode, btree_key_t
 
 void merge(value_sizer_t<void> *sizer, node_t *node, node_t *rnode, const internal_node_t *parent);
 
+// The number of keys under `node`, or 0 if it's an internal node that isn't
+// counted.
+int64_t key_count(const node_t *node);
+
 void validate(value_sizer_t<void> *sizer, const node_t *node);
 
 }  // namespace node
@@ -116,4 +124,10 @@ inline void keycpy(btree_key_t *dest, const btree_key_t *src) {
     memcpy(dest, src, sizeof(btree_key_t) + src->size);
 }
 
+// Writes the shortest key `k` with `left <= k < right` to `out`, which is what an
+// internal node needs to tell the two nodes apart.  `left` must be less than `right`.
+// Separators are usually much shorter than the keys themselves (especially secondary
+// index keys, which share long prefixes), so internal nodes fit more of them.
+void separator_key(const btree_key_t *left, const btree_key_t *right, btree_key_t *out);
+
 #endif // BTREE_NODE_HPP_
@@ -19,7 +19,11 @@ void real_superblock_t::release() {
 
 block_id_t real_superblock_t::get_root_block_id() {
     buf_read_t read(&sb_buf_);
-    return static_cast<const btree_superblock_t *>(read.get_data_read())->root_block;
+    const btree_superblock_t *sb
+        = static_cast<const btree_superblock_t *>(read.get_data_read());
+    // Every btree operation starts here.
+    read.mark_pinned();
+    return sb->root_block;
 }
 
 void real_superblock_t::set_root_block_id(const block_id_t new_root_block) {
@@ -352,6 +356,19 @@ void ensure_stat_block(superblock_t *sb) {
     }
 }
 
+int64_t get_btree_population(superblock_t *sb) {
+    const block_id_t node_id = sb->get_stat_block_id();
+
+    if (node_id == NULL_BLOCK_ID) {
+        // Nothing has ever been written to the btree.
+        return 0;
+    }
+    buf_lock_t stat_block(buf_parent_t(sb->expose_buf().txn()),
+                          node_id, access_t::read);
+    buf_read_t read(&stat_block);
+    return static_cast<const btree_statblock_t *>(read.get_data_read())->population;
+}
+
 buf_lock_t get_root(value_sizer_t<void> *sizer, superblock_t *sb) {
     const block_id_t node_id = sb->get_root_block_id();
 
@@ -391,6 +408,40 @@ void detach_all_children(const node_t *node, buf_parent_t parent,
     }
 }
 
+// Recounts the keys under the child of `parent` that `key` belongs to, or under
+// its neighbour `offset` pairs to the right, which `child` must hold.
+void update_child_key_count(internal_node_t *parent, const btree_key_t *key,
+                            buf_lock_t *child, int offset = 0) {
+    if (!internal_node::is_counted(parent)) {
+        return;
+    }
+    const int index = internal_node::get_offset_index(parent, key) + offset;
+    rassert(internal_node::get_pair_by_index(parent, index)->lnode == child->block_id());
+    buf_read_t child_read(child);
+    internal_node::set_child_key_count(
+        parent, index,
+        node::key_count(static_cast<const node_t *>(child_read.get_data_read())));
+}
+
+void add_to_key_counts(buf_lock_t *last_buf, std::vector<buf_lock_t> *ancestors,
+                       const btree_key_t *key, int64_t change) {
+    if (change == 0 || last_buf->empty()) {
+        return;
+    }
+    for (size_t i = 0; i <= ancestors->size(); ++i) {
+        buf_lock_t *lock = i == 0 ? last_buf : &(*ancestors)[ancestors->size() - i];
+        buf_write_t write(lock);
+        auto node = static_cast<internal_node_t *>(write.get_data_write());
+        if (!internal_node::is_counted(node)) {
+            rassert(ancestors->empty());
+            return;
+        }
+        const int index = internal_node::get_offset_index(node, key);
+        internal_node::set_child_key_count(
+            node, index, internal_node::child_key_count(node, index) + change);
+    }
+}
+
 // Split the node if necessary. If the node is a leaf_node, provide the new
 // value that will be inserted; if it's an internal node, provide NULL (we
 // split internal nodes proactively).
@@ -421,6 +472,17 @@ void check_and_handle_split(value_sizer_t<void> *sizer,
         }
     }
 
+    // A new root above a leaf keeps key counts; above an internal node, it has the
+    // same format as the rest of the tree.
+    bool counted = true;
+    {
+        buf_read_t buf_read(buf);
+        const node_t *node = static_cast<const node_t *>(buf_read.get_data_read());
+        if (node::is_internal(node)) {
+            counted = internal_node::is_counted(reinterpret_cast<const internal_node_t *>(node));
+        }
+    }
+
     // If we are splitting the root, we must detach it from sb first.
     // It will later be attached to a newly created root, together with its
     // newly created sibling.
@@ -464,7 +526,8 @@ void check_and_handle_split(value_sizer_t<void> *sizer,
         {
             buf_write_t last_write(last_buf);
             internal_node::init(sizer->block_size(),
-                                static_cast<internal_node_t *>(last_write.get_data_write()));
+                                static_cast<internal_node_t *>(last_write.get_data_write()),
+                                counted);
         }
         // We set the recency of the new root block to the max of the subtrees'
         // recency and the current transaction's recency.
@@ -474,12 +537,20 @@ void check_and_handle_split(value_sizer_t<void> *sizer,
     }
 
     {
+        int64_t lcount = 0;
+        int64_t rcount = 0;
+        if (counted) {
+            buf_read_t buf_read(buf);
+            lcount = node::key_count(static_cast<const node_t *>(buf_read.get_data_read()));
+            buf_read_t rbuf_read(&rbuf);
+            rcount = node::key_count(static_cast<const node_t *>(rbuf_read.get_data_read()));
+        }
         buf_write_t last_write(last_buf);
         DEBUG_VAR bool success
             = internal_node::insert(sizer->block_size(),
                                     static_cast<internal_node_t *>(last_write.get_data_write()),
                                     median,
-                                    buf->block_id(), rbuf.block_id());
+                                    buf->block_id(), lcount, rbuf.block_id(), rcount);
         rassert(success, "could not insert internal btree node");
     }
 
@@ -613,9 +684,11 @@ void check_and_handle_underfull(value_sizer_t<void> *sizer,
 
             if (!parent_is_singleton) {
                 buf_write_t last_buf_write(last_buf);
-                internal_node::remove(sizer->block_size(),
-                                      static_cast<internal_node_t *>(last_buf_write.get_data_write()),
+                auto parent_node
+                    = static_cast<internal_node_t *>(last_buf_write.get_data_write());
+                internal_node::remove(sizer->block_size(), parent_node,
                                       key_in_middle.btree_key());
+                update_child_key_count(parent_node, key, buf);
             } else {
                 // The parent has only 1 key after the merge (which means that
                 // it's the root and our node is its only child). Insert our
@@ -681,9 +754,14 @@ void check_and_handle_underfull(value_sizer_t<void> *sizer,
 
             if (leveled) {
                 buf_write_t last_buf_write(last_buf);
-                internal_node::update_key(static_cast<internal_node_t *>(last_buf_write.get_data_write()),
+                auto parent_node
+                    = static_cast<internal_node_t *>(last_buf_write.get_data_write());
+                internal_node::update_key(parent_node,
                                           key_in_middle.btree_key(),
                                           replacement_key);
+                update_child_key_count(parent_node, key, buf);
+                update_child_key_count(parent_node, key, &sib_buf,
+                                       -nodecmp_node_with_sib);
             }
         }
     }
@@ -95,6 +95,11 @@ public:
 
     promise_t<superblock_t *> *pass_back_superblock;
 
+    // In a tree whose internal nodes keep key counts, the nodes above last_buf,
+    // root first, so that the counts along the path can be updated.  Otherwise
+    // the nodes are released on the way down and this is empty.
+    std::vector<buf_lock_t> ancestors;
+
     // The parent buf of buf, if buf is not the root node.  This is hacky.
     buf_lock_t last_buf;
 
@@ -109,6 +114,7 @@ public:
     void swap(keyvalue_location_t &other) {
         std::swap(superblock, other.superblock);
         std::swap(stat_block, other.stat_block);
+        ancestors.swap(other.ancestors);
         last_buf.swap(other.last_buf);
         buf.swap(other.buf);
         std::swap(there_originally_was_value, other.there_originally_was_value);
@@ -221,6 +227,11 @@ void check_and_handle_underfull(value_sizer_t<void> *sizer,
                                 const btree_key_t *key,
                                 const value_deleter_t *detacher);
 
+// Adds `change` to the key counts of the children that `key` belongs to in
+// `last_buf` and `ancestors` (see keyvalue_location_t), if the tree is counted.
+void add_to_key_counts(buf_lock_t *last_buf, std::vector<buf_lock_t> *ancestors,
+                       const btree_key_t *key, int64_t change);
+
 // Metainfo functions
 bool get_superblock_metainfo(buf_lock_t *superblock,
                              const std::vector<char> &key,
@@ -244,6 +255,11 @@ void insert_root(block_id_t root_id, superblock_t *sb);
 /* Create a stat block for the superblock if it doesn't already have one. */
 void ensure_stat_block(superblock_t *sb);
 
+/* Returns the number of keys in the btree, as recorded in its stat block.  The
+stat block isn't part of the superblock's snapshot, so the value reflects the
+writes that have been applied by the time it is read. */
+int64_t get_btree_population(superblock_t *sb);
+
 void get_btree_superblock(txn_t *txn, access_t access,
                           scoped_ptr_t<real_superblock_t> *got_superblock_out);
 
@@ -57,6 +57,7 @@ void find_keyvalue_location_for_write(
             if (!node::is_internal(static_cast<const node_t *>(read.get_data_read()))) {
                 break;
             }
+            read.mark_pinned();
         }
         // Check if the node is overfull and proactively split it if it is (since this is an internal node).
         {
@@ -72,6 +73,17 @@ void find_keyvalue_location_for_write(
                                        detacher);
         }
 
+        // Counted trees keep the old previous node, so that the counts on the path
+        // can be updated, unless a merge has just made buf the root and deleted it.
+        bool keep_last_buf = false;
+        if (!last_buf.empty()
+            && (keyvalue_location_out->superblock == NULL
+                || superblock->get_root_block_id() != buf.block_id())) {
+            buf_read_t read(&last_buf);
+            keep_last_buf = internal_node::is_counted(
+                static_cast<const internal_node_t *>(read.get_data_read()));
+        }
+
         // Release the superblock, if we've gone past the root (and haven't
         // already released it). If we're still at the root or at one of
         // its direct children, we might still want to replace the root, so
@@ -88,6 +100,9 @@ void find_keyvalue_location_for_write(
 
         // Release the old previous node (unless we're at the root), and set
         // the next previous node (which is the current node).
+        if (keep_last_buf) {
+            keyvalue_location_out->ancestors.push_back(std::move(last_buf));
+        }
         last_buf.reset_buf_lock();
 
         // Look up and acquire the next node.
@@ -125,6 +140,52 @@ void find_keyvalue_location_for_write(
     keyvalue_location_out->buf.swap(buf);
 }
 
+/* For callers that apply a sorted run of changes: once the change at `kv_loc` has
+ * been applied, this points `kv_loc` at `key` in the same leaf, so that neighbouring
+ * keys don't each descend from the root again.  It returns false (and leaves
+ * `kv_loc` alone) if `key` belongs to a different leaf, or if the leaf's parent is
+ * no longer in the state that find_keyvalue_location_for_write leaves it in, i.e.
+ * with room for another split and enough children for another merge.  Then the
+ * caller has to release `kv_loc` and look the key up from the superblock. */
+template <class Value>
+bool reuse_keyvalue_location_for_write(keyvalue_location_t<Value> *kv_loc,
+                                       const btree_key_t *key) {
+    if (kv_loc->buf.empty() || kv_loc->last_buf.empty()) {
+        return false;
+    }
+    value_sizer_t<Value> sizer(kv_loc->buf.cache()->max_block_size());
+
+    {
+        buf_read_t parent_read(&kv_loc->last_buf);
+        auto parent = static_cast<const internal_node_t *>(parent_read.get_data_read());
+        if (internal_node::lookup(parent, key) != kv_loc->buf.block_id()
+            || internal_node::is_full(parent)) {
+            return false;
+        }
+        // While the parent is the root we still hold the superblock, and a merge
+        // may make the leaf the new root; below the root the parent mustn't get
+        // underfull.
+        if (kv_loc->superblock != NULL
+            ? internal_node::is_singleton(parent)
+            : internal_node::is_underfull(sizer.block_size(), parent)) {
+            return false;
+        }
+    }
+
+    kv_loc->there_originally_was_value = false;
+    kv_loc->value.reset();
+    scoped_malloc_t<Value> tmp(sizer.max_possible_size());
+    {
+        buf_read_t read(&kv_loc->buf);
+        auto node = static_cast<const leaf_node_t *>(read.get_data_read());
+        if (leaf::lookup(&sizer, node, key, tmp.get())) {
+            kv_loc->there_originally_was_value = true;
+            kv_loc->value = std::move(tmp);
+        }
+    }
+    return true;
+}
+
 template <class Value>
 void find_keyvalue_location_for_read(
         superblock_t *superblock, const btree_key_t *key,
@@ -165,6 +226,7 @@ void find_keyvalue_location_for_read(
             if (!node::is_internal(static_cast<const node_t *>(data))) {
                 break;
             }
+            read.mark_pinned();
 
             node_id = internal_node::lookup(static_cast<const internal_node_t *>(data),
                                             key);
@@ -291,6 +353,8 @@ void apply_keyvalue_change(keyvalue_location_t<Value> *kv_loc,
         }
     }
 
+    add_to_key_counts(&kv_loc->last_buf, &kv_loc->ancestors, key, population_change);
+
     // Check to see if the leaf is underfull (following a change in
     // size or a deletion, and merge/level if it is.
     check_and_handle_underfull(&sizer, &kv_loc->buf, &kv_loc->last_buf,
@@ -69,6 +69,9 @@
 class parent_releaser_t;
 
 struct acquisition_waiter_callback_t {
+    // Called when the waiter gets queued for `you_may_acquire`, which may take a
+    // while because only a few coroutines do the acquiring.
+    virtual void prefetch() = 0;
     virtual void you_may_acquire() = 0;
     virtual void cancel() = 0;
 protected:
@@ -174,8 +177,9 @@ public:
                         acquisition_waiter_stacks[i].pop_back();
 
                         // Spawn a coroutine so that it's safe to acquire
-                        // blocks.
+                        // blocks.  Meanwhile, the block can be loaded.
                         level_count(i) += 1;
+                        waiter_cb->prefetch();
                         pending_acquires.push(waiter_cb);
                         diff -= 1;
                     }
@@ -238,18 +242,21 @@ void subtrees_traverse(traversal_state_t *state,
                        const counted_t<ranged_block_ids_t> &ids_source);
 void do_a_subtree_traversal(traversal_state_t *state, int level,
                             buf_parent_t parent, block_id_t block_id,
-                            btree_key_t *left_exclusive_or_null,
-                            btree_key_t *right_inclusive_or_null,
-                            lock_in_line_callback_t *acq_start_cb);
+                            const btree_key_t *left_exclusive_or_null,
+                            const btree_key_t *right_inclusive_or_null,
+                            lock_in_line_callback_t *acq_start_cb,
+                            parent_releaser_t *counting_parent, int child_index);
 
 void process_a_leaf_node(traversal_state_t *state,
                          buf_lock_t buf, int level,
                          const btree_key_t *left_exclusive_or_null,
-                         const btree_key_t *right_inclusive_or_null);
+                         const btree_key_t *right_inclusive_or_null,
+                         parent_releaser_t *counting_parent, int child_index);
 void process_a_internal_node(traversal_state_t *state,
                              buf_lock_t buf, int level,
                              const btree_key_t *left_exclusive_or_null,
-                             const btree_key_t *right_inclusive_or_null);
+                             const btree_key_t *right_inclusive_or_null,
+                             parent_releaser_t *counting_parent, int child_index);
 
 struct node_ready_callback_t {
     virtual void on_node_ready(buf_lock_t buf) = 0;
@@ -269,6 +276,10 @@ struct acquire_a_node_fsm_t : public acquisition_waiter_callback_t {
 
     explicit acquire_a_node_fsm_t(buf_parent_t _parent) : parent(_parent) { }
 
+    void prefetch() {
+        parent.cache()->prefetch(block_id);
+    }
+
     void you_may_acquire() {
         rassert(coro_t::self());
 
@@ -318,6 +329,15 @@ class parent_releaser_t {
 public:
     virtual buf_parent_t expose_parent() = 0;
     virtual void release() = 0;
+
+    // A parent that counts its children holds on to its node until the subtree
+    // of every interesting child has been processed, and adds the population
+    // changes to the node's key counts.  Each child calls `child_started` when it
+    // is found and `child_finished` when its subtree is done.
+    virtual bool counts_children() { return false; }
+    virtual void child_started() { }
+    virtual void child_finished(UNUSED int child_index,
+                                UNUSED int64_t population_change) { }
 protected:
     virtual ~parent_releaser_t() { }
 };
@@ -325,17 +345,82 @@ protected:
 struct internal_node_releaser_t : public parent_releaser_t {
     buf_lock_t buf_;
     traversal_state_t *state_;
+
+    // Only used when counting: the releaser of the node's parent (if that counts
+    // its children too) and the node's index in it, whether the node's children
+    // are all in line, the children that haven't finished, and their population
+    // changes.
+    bool counting_;
+    parent_releaser_t *counting_parent_;
+    int child_index_;
+    bool in_line_;
+    int unfinished_children_;
+    std::vector<int64_t> population_changes_;
+
     buf_parent_t expose_parent() {
         return buf_parent_t(&buf_);
     }
     virtual void release() {
+        if (!counting_) {
+            state_->helper->postprocess_internal_node(&buf_);
+            delete this;
+        } else {
+            in_line_ = true;
+            maybe_finish();
+        }
+    }
+    bool counts_children() {
+        return counting_;
+    }
+    void child_started() {
+        rassert(counting_);
+        ++unfinished_children_;
+    }
+    void child_finished(int child_index, int64_t population_change) {
+        rassert(counting_ && unfinished_children_ > 0);
+        population_changes_[child_index] += population_change;
+        --unfinished_children_;
+        maybe_finish();
+    }
+    void maybe_finish() {
+        if (!in_line_ || unfinished_children_ > 0) {
+            return;
+        }
+        int64_t population_change = 0;
+        for (size_t i = 0; i < population_changes_.size(); ++i) {
+            population_change += population_changes_[i];
+        }
+        if (population_change != 0) {
+            buf_write_t write(&buf_);
+            auto node = static_cast<internal_node_t *>(write.get_data_write());
+            for (size_t i = 0; i < population_changes_.size(); ++i) {
+                internal_node::set_child_key_count(
+                    node, i,
+                    internal_node::child_key_count(node, i) + population_changes_[i]);
+            }
+        }
         state_->helper->postprocess_internal_node(&buf_);
+        parent_releaser_t *counting_parent = counting_parent_;
+        const int child_index = child_index_;
         delete this;
+        if (counting_parent != NULL) {
+            counting_parent->child_finished(child_index, population_change);
+        }
     }
     internal_node_releaser_t(buf_lock_t &&buf,
-                             traversal_state_t *state)
+                             traversal_state_t *state,
+                             bool counting,
+                             parent_releaser_t *counting_parent,
+                             int child_index,
+                             int num_children)
         : buf_(std::move(buf)),
-          state_(state) { }
+          state_(state),
+          counting_(counting),
+          counting_parent_(counting_parent),
+          child_index_(child_index),
+          in_line_(false),
+          unfinished_children_(0),
+          population_changes_(counting ? num_children : 0, 0) { }
 
     virtual ~internal_node_releaser_t() { }
 };
@@ -426,6 +511,8 @@ struct do_a_subtree_traversal_fsm_t : public node_ready_callback_t {
     bool left_unbounded;
     store_key_t right_inclusive;
     bool right_unbounded;
+    parent_releaser_t *counting_parent;
+    int child_index;
 
     void on_node_ready(buf_lock_t buf) {
         rassert(coro_t::self());
@@ -444,20 +531,25 @@ struct do_a_subtree_traversal_fsm_t : public node_ready_callback_t {
                 state->helper->progress->inform(level, parallel_traversal_progress_t::ACQUIRE, parallel_traversal_progress_t::LEAF);
             }
             process_a_leaf_node(state, std::move(buf), level,
-                                left_exclusive_or_null, right_inclusive_or_null);
+                                left_exclusive_or_null, right_inclusive_or_null,
+                                counting_parent, child_index);
         } else {
             // The node is internal
             if (state->helper->progress) {
                 state->helper->progress->inform(level, parallel_traversal_progress_t::ACQUIRE, parallel_traversal_progress_t::INTERNAL);
             }
             process_a_internal_node(state, std::move(buf), level,
-                                    left_exclusive_or_null, right_inclusive_or_null);
+                                    left_exclusive_or_null, right_inclusive_or_null,
+                                    counting_parent, child_index);
         }
 
         delete this;
     }
 
     void on_cancel() {
+        if (counting_parent != NULL) {
+            counting_parent->child_finished(child_index, 0);
+        }
         delete this;
     }
 };
@@ -466,10 +558,13 @@ void do_a_subtree_traversal(traversal_state_t *state, int level,
                             buf_parent_t parent, block_id_t block_id,
                             const btree_key_t *left_exclusive_or_null,
                             const btree_key_t *right_inclusive_or_null,
-                            lock_in_line_callback_t *acq_start_cb) {
+                            lock_in_line_callback_t *acq_start_cb,
+                            parent_releaser_t *counting_parent, int child_index) {
     do_a_subtree_traversal_fsm_t *fsm = new do_a_subtree_traversal_fsm_t;
     fsm->state = state;
     fsm->level = level;
+    fsm->counting_parent = counting_parent;
+    fsm->child_index = child_index;
 
     if (left_exclusive_or_null) {
         fsm->left_exclusive.assign(left_exclusive_or_null);
@@ -492,25 +587,36 @@ void process_a_internal_node(traversal_state_t *state,
                              buf_lock_t buf,
                              int level,
                              const btree_key_t *left_exclusive_or_null,
-                             const btree_key_t *right_inclusive_or_null) {
+                             const btree_key_t *right_inclusive_or_null,
+                             parent_releaser_t *counting_parent, int child_index) {
     counted_t<ranged_block_ids_t> ids_source;
+    // Writes to a counted node's subtree have to be added to its key counts.
+    bool counting;
     {
         buf_read_t read(&buf);
         const internal_node_t *node
             = static_cast<const internal_node_t *>(read.get_data_read());
+        read.mark_pinned();
 
         ids_source = make_counted<ranged_block_ids_t>(
                     state->max_block_size, node,
                     left_exclusive_or_null, right_inclusive_or_null, level);
+        counting = state->helper->btree_node_mode() == access_t::write
+            && internal_node::is_counted(node);
     }
+    rassert(counting || counting_parent == NULL);
 
-    subtrees_traverse(state, new internal_node_releaser_t(std::move(buf), state),
+    subtrees_traverse(state,
+                      new internal_node_releaser_t(std::move(buf), state, counting,
+                                                   counting_parent, child_index,
+                                                   ids_source->num_block_ids()),
                       level + 1, ids_source);
 }
 
 void process_a_leaf_node(traversal_state_t *state, buf_lock_t buf,
         int level, const btree_key_t *left_exclusive_or_null,
-        const btree_key_t *right_inclusive_or_null) {
+        const btree_key_t *right_inclusive_or_null,
+        parent_releaser_t *counting_parent, int child_index) {
     // TODO: The below comment is wrong because we acquire the stat block
     // This can be run in the scheduler thread.
     //
@@ -544,6 +650,12 @@ void process_a_leaf_node(traversal_state_t *state, buf_lock_t buf,
         // Don't acquire the block to not change the value.
     }
 
+    // This comes before the level count goes down, so that the traversal doesn't
+    // finish before the counts above the leaf are updated.
+    if (counting_parent != NULL) {
+        counting_parent->child_finished(child_index, population_change);
+    }
+
     if (state->helper->progress) {
         state->helper->progress->inform(level, parallel_traversal_progress_t::RELEASE, parallel_traversal_progress_t::LEAF);
     }
@@ -562,9 +674,16 @@ void interesting_children_callback_t::receive_interesting_child(int child_index)
     const btree_key_t *right_incl_or_null;
     ids_source->get_block_id_and_bounding_interval(child_index, &block_id, &left_excl_or_null, &right_incl_or_null);
 
+    parent_releaser_t *counting_parent = NULL;
+    if (releaser->counts_children()) {
+        counting_parent = releaser;
+        counting_parent->child_started();
+    }
+
     ++acquisition_countdown;
     do_a_subtree_traversal(state, level, releaser->expose_parent(),
-                           block_id, left_excl_or_null, right_incl_or_null, this);
+                           block_id, left_excl_or_null, right_incl_or_null, this,
+                           counting_parent, child_index);
 }
 
 void interesting_children_callback_t::no_more_interesting_children() {
@@ -41,6 +41,15 @@ public:
     perfmon_multi_membership_t pm_keys_membership;
 };
 
+/* Whatever a protocol derives from a secondary index's opaque definition and keeps
+around between writes (the rdb protocol keeps the deserialized mapping function).
+A secondary index's btree_slice_t exists exactly as long as the index does in its
+store, so this is thrown away when the index is dropped or recreated. */
+class sindex_compiled_definition_t {
+public:
+    virtual ~sindex_compiled_definition_t() { }
+};
+
 /* btree_slice_t is a thin wrapper around cache_t that handles initializing the buffer
 cache for the purpose of storing a btree. There are many btree_slice_ts per
 btree_key_value_store_t. */
@@ -64,6 +73,9 @@ public:
 
     btree_stats_t stats;
 
+    // Only used for secondary index slices.  Empty until the protocol fills it in.
+    scoped_ptr_t<sindex_compiled_definition_t> compiled_sindex_definition;
+
 private:
     cache_t *cache_;
 
@@ -89,7 +89,7 @@ cache_t::cache_t(serializer_t *serializer,
                  perfmon_collection_t *perfmon_collection)
     : stats_(make_scoped<alt_cache_stats_t>(perfmon_collection)),
       throttler_(MINIMUM_SOFT_UNWRITTEN_CHANGES_LIMIT),
-      page_cache_(serializer, balancer, &throttler_) { }
+      page_cache_(serializer, balancer, &throttler_, stats_.get()) { }
 
 cache_t::~cache_t() { }
 
@@ -751,6 +751,11 @@ const void *buf_read_t::get_data_read(uint32_t *block_size_out) {
     return page_acq_.get_buf_read();
 }
 
+void buf_read_t::mark_pinned() {
+    guarantee(page_acq_.has());
+    page_acq_.mark_pinned();
+}
+
 buf_write_t::buf_write_t(buf_lock_t *lock)
     : lock_(lock) {
     guarantee(lock_->access() == access_t::write);
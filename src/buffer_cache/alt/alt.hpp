@@ -56,6 +56,11 @@ public:
     // might consider supporting a mem_cap paremeter.
     cache_account_t create_cache_account(int priority);
 
+    // Starts loading a block that is about to be acquired, so that several reads
+    // can be in flight while the caller works through the blocks one by one.  See
+    // page_cache_t::prefetch.
+    void prefetch(block_id_t block_id) { page_cache_.prefetch(block_id); }
+
 private:
     friend class txn_t;
     friend class buf_read_t;
@@ -323,6 +328,11 @@ public:
         return data;
     }
 
+    // Asks the cache to keep this block in memory in preference to other blocks.
+    // The btree does this for superblocks and internal nodes, which every lookup
+    // has to go through.  Call this after get_data_read().
+    void mark_pinned();
+
 private:
     buf_lock_t *lock_;
     alt::page_acq_t page_acq_;
@@ -2,6 +2,7 @@
 #include "buffer_cache/alt/blob.hpp"
 
 #include <stdint.h>
+#include <string.h>
 
 #include <limits>
 
@@ -90,6 +91,16 @@ char *small_buffer(char *ref, int maxreflen) {
     return ref + big_size_offset(maxreflen);
 }
 
+const char *small_buffer(const char *ref, int maxreflen) {
+    return ref + big_size_offset(maxreflen);
+}
+
+int init_small_ref(char *ref, int maxreflen, const char *data, int64_t size) {
+    set_small_size(ref, maxreflen, size);
+    memcpy(small_buffer(ref, maxreflen), data, size);
+    return big_size_offset(maxreflen) + size;
+}
+
 int64_t big_size(const char *ref, int maxreflen) {
     return *reinterpret_cast<const int64_t *>(ref + big_size_offset(maxreflen));
 }
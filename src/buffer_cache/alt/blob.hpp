@@ -122,6 +122,20 @@ void shrink(block_size_t block_size, int levels, int64_t offset, int64_t size, i
 // The maxreflen value appropriate for use with memcached btrees.  It's 251.  This should be renamed.
 extern int btree_maxreflen;
 
+// Whether a blob of `proposed_size` bytes keeps its data in the ref itself.
+bool size_would_be_small(int64_t proposed_size, int maxreflen);
+
+// Whether the blob keeps its data in the ref itself, with no blocks of its own.
+bool is_small(const char *ref, int maxreflen);
+
+// The data of a blob for which `is_small` is true.
+const char *small_buffer(const char *ref, int maxreflen);
+
+// Makes `ref` (an array of length maxreflen) the ref of a blob that holds the `size`
+// bytes at `data` in the ref itself, and returns the ref's size.
+// `size_would_be_small(size, maxreflen)` must be true.
+int init_small_ref(char *ref, int maxreflen, const char *data, int64_t size);
+
 // The size of a blob, equivalent to blob_t(ref, maxreflen).valuesize().
 int64_t value_size(const char *ref, int maxreflen);
 
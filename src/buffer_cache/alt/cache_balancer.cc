@@ -12,6 +12,12 @@ const uint64_t alt_cache_balancer_t::rebalance_timeout_ms = 500;
 
 const double alt_cache_balancer_t::read_ahead_proportion = 0.9;
 
+const double alt_cache_balancer_t::compressed_proportion = 0.3;
+
+// With 4K blocks and a fan-out in the hundreds, internal nodes are well under 1% of
+// a btree, so this is plenty for every lookup to need at most one leaf read.
+const double cache_balancer_t::default_pinned_memory_proportion = 0.25;
+
 alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     evicter(_evicter),
     new_size(0),
@@ -19,8 +25,12 @@ alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     bytes_loaded(evicter->get_clamped_bytes_loaded()),
     access_count(evicter->access_count()) { }
 
-alt_cache_balancer_t::alt_cache_balancer_t(uint64_t _total_cache_size) :
+alt_cache_balancer_t::alt_cache_balancer_t(uint64_t _total_cache_size,
+                                           cache_eviction_policy_t _eviction_policy,
+                                           bool _compress_evicted_pages) :
     total_cache_size(_total_cache_size),
+    eviction_policy_(_eviction_policy),
+    compress_evicted_pages(_compress_evicted_pages),
     rebalance_timer(rebalance_check_interval_ms, this),
     last_rebalance_time(0),
     read_ahead_ok(true),
@@ -10,6 +10,7 @@
 
 #include "threading.hpp"
 #include "arch/timing.hpp"
+#include "buffer_cache/alt/eviction_policy.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/queue/single_value_producer.hpp"
 #include "containers/scoped.hpp"
@@ -30,6 +31,24 @@ public:
     // Tells caches whether to start read ahead initially
     virtual bool read_ahead_ok_at_start() const = 0;
 
+    // Which eviction policy the caches should use
+    virtual cache_eviction_policy_t eviction_policy() const = 0;
+
+    // How much of each cache's memory limit is set aside for pinned pages (btree
+    // superblocks and internal nodes).  Pinned pages beyond that are evicted
+    // before anything else.
+    virtual double pinned_memory_proportion() const {
+        return default_pinned_memory_proportion;
+    }
+
+    static const double default_pinned_memory_proportion;
+
+    // How much of each cache's memory limit may hold compressed copies of evicted
+    // pages.  Zero turns the compressed tier off.
+    virtual double compressed_memory_proportion() const {
+        return 0;
+    }
+
 protected:
     friend class alt::evicter_t;
 
@@ -54,6 +73,10 @@ public:
         return false;
     }
 
+    cache_eviction_policy_t eviction_policy() const {
+        return cache_eviction_policy_t::random_sample;
+    }
+
 private:
     void add_evicter(alt::evicter_t *) { }
     void remove_evicter(alt::evicter_t *) { }
@@ -72,7 +95,9 @@ class alt_cache_balancer_t :
     public repeating_timer_callback_t
 {
 public:
-    explicit alt_cache_balancer_t(uint64_t _total_cache_size);
+    alt_cache_balancer_t(uint64_t _total_cache_size,
+                         cache_eviction_policy_t _eviction_policy,
+                         bool _compress_evicted_pages);
     ~alt_cache_balancer_t();
 
     uint64_t base_mem_per_store() const {
@@ -83,6 +108,14 @@ public:
         return true;
     }
 
+    cache_eviction_policy_t eviction_policy() const {
+        return eviction_policy_;
+    }
+
+    double compressed_memory_proportion() const {
+        return compress_evicted_pages ? compressed_proportion : 0;
+    }
+
 private:
     friend class alt::evicter_t;
 
@@ -94,6 +127,9 @@ private:
     // Controls how much read ahead is allowed out of total cache size
     static const double read_ahead_proportion;
 
+    // How much of the cache the compressed tier gets, if it's turned on
+    static const double compressed_proportion;
+
     // Constants to determine when to stop read-ahead
     static const uint64_t read_ahead_ratio_numerator;
     static const uint64_t read_ahead_ratio_denominator;
@@ -134,6 +170,8 @@ private:
                                    bool new_read_ahead_ok);
 
     const uint64_t total_cache_size;
+    const cache_eviction_policy_t eviction_policy_;
+    const bool compress_evicted_pages;
     repeating_timer_t rebalance_timer;
     microtime_t last_rebalance_time;
     bool read_ahead_ok;
@@ -0,0 +1,121 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "buffer_cache/alt/compressed_page_tier.hpp"
+
+#include <zlib.h>
+
+#include "buffer_cache/alt/page.hpp"
+#include "buffer_cache/alt/stats.hpp"
+#include "serializer/serializer.hpp"
+
+namespace alt {
+
+const double compressed_page_tier_t::MIN_SPACE_SAVING = 0.25;
+
+compressed_page_tier_t::compressed_page_tier_t(alt_cache_stats_t *stats)
+    : stats_(stats), bytes_(0) { }
+
+compressed_page_tier_t::~compressed_page_tier_t() {
+    // The pages remove themselves (through evicter_t::remove_page) before the
+    // page cache goes away.
+    rassert(entries_.empty());
+}
+
+void compressed_page_tier_t::add(page_t *page) {
+    rassert(page->buf_.has());
+    rassert(!page->has_compressed_copy_);
+    const uint32_t ser_buf_size = page->ser_buf_size_;
+
+    // KSI: We could compress into a scratch buffer that we keep around, instead
+    // of allocating one for every evicted page.
+    uLongf compressed_size = compressBound(ser_buf_size);
+    scoped_malloc_t<char> data(compressed_size);
+    int res = compress2(reinterpret_cast<Bytef *>(data.get()), &compressed_size,
+                        reinterpret_cast<const Bytef *>(page->buf_.get()),
+                        ser_buf_size, Z_BEST_SPEED);
+    guarantee(res == Z_OK, "compress2 failed (%d)", res);
+
+    if (compressed_size > ser_buf_size * (1.0 - MIN_SPACE_SAVING)) {
+        return;
+    }
+
+    // Don't hold on to compressBound's worth of slack.
+    scoped_malloc_t<char> trimmed(data.get(), data.get() + compressed_size);
+
+    entry_t entry;
+    entry.page = page;
+    entry.ser_buf_size = ser_buf_size;
+    entry.compressed_size = compressed_size;
+    entry.data = std::move(trimmed);
+    entries_.push_back(std::move(entry));
+    auto it = entries_.end();
+    --it;
+    index_.insert(std::make_pair(page, it));
+
+    bytes_ += compressed_size;
+    page->has_compressed_copy_ = true;
+    if (stats_ != NULL) {
+        stats_->pm_cache_compressed_bytes_saved += ser_buf_size - compressed_size;
+    }
+}
+
+scoped_malloc_t<ser_buffer_t> compressed_page_tier_t::take(page_t *page,
+                                                           block_size_t max_block_size) {
+    auto it = find(page);
+    if (it == entries_.end()) {
+        return scoped_malloc_t<ser_buffer_t>();
+    }
+
+    scoped_malloc_t<ser_buffer_t> buf = serializer_t::allocate_buffer(max_block_size);
+    uLongf size = it->ser_buf_size;
+    int res = uncompress(reinterpret_cast<Bytef *>(buf.get()), &size,
+                         reinterpret_cast<const Bytef *>(it->data.get()),
+                         it->compressed_size);
+    guarantee(res == Z_OK && size == it->ser_buf_size,
+              "uncompress failed (%d)", res);
+
+    erase(it);
+    if (stats_ != NULL) {
+        ++stats_->pm_cache_compressed_hits;
+    }
+    return buf;
+}
+
+void compressed_page_tier_t::remove(page_t *page) {
+    auto it = find(page);
+    if (it != entries_.end()) {
+        erase(it);
+    }
+}
+
+page_t *compressed_page_tier_t::drop_oldest() {
+    if (entries_.empty()) {
+        return NULL;
+    }
+    page_t *page = entries_.front().page;
+    erase(entries_.begin());
+    return page;
+}
+
+std::list<compressed_page_tier_t::entry_t>::iterator
+compressed_page_tier_t::find(page_t *page) {
+    if (!page->has_compressed_copy_) {
+        return entries_.end();
+    }
+    auto it = index_.find(page);
+    guarantee(it != index_.end());
+    return it->second;
+}
+
+void compressed_page_tier_t::erase(std::list<entry_t>::iterator it) {
+    rassert(it->page->has_compressed_copy_);
+    it->page->has_compressed_copy_ = false;
+    bytes_ -= it->compressed_size;
+    if (stats_ != NULL) {
+        stats_->pm_cache_compressed_bytes_saved
+            -= it->ser_buf_size - it->compressed_size;
+    }
+    index_.erase(it->page);
+    entries_.erase(it);
+}
+
+}  // namespace alt
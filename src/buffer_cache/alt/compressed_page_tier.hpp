@@ -0,0 +1,76 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_ALT_COMPRESSED_PAGE_TIER_HPP_
+#define BUFFER_CACHE_ALT_COMPRESSED_PAGE_TIER_HPP_
+
+#include <stdint.h>
+
+#include <list>
+#include <unordered_map>
+
+#include "containers/scoped.hpp"
+#include "serializer/types.hpp"
+
+class alt_cache_stats_t;
+
+namespace alt {
+
+class page_t;
+
+/* Keeps zlib-compressed copies of the buffers of recently evicted disk-backed pages,
+so that reloading one of them doesn't need a serializer read.  A page_t with a
+compressed copy stays around in the evicted bag (with its block token), which is
+what keeps the copy valid: the page can't change without being reloaded first.
+
+Copies are kept in FIFO order.  The evicter calls drop_oldest() to keep the tier
+within its share of the cache's memory limit. */
+class compressed_page_tier_t {
+public:
+    // `stats` may be NULL.
+    explicit compressed_page_tier_t(alt_cache_stats_t *stats);
+    ~compressed_page_tier_t();
+
+    // Keeps a compressed copy of the page's buffer, which must be loaded.  Does
+    // nothing if the buffer doesn't compress well.
+    void add(page_t *page);
+
+    // Returns the decompressed buffer of `page` and forgets the copy, or returns
+    // an empty buffer if we have no copy.
+    scoped_malloc_t<ser_buffer_t> take(page_t *page, block_size_t max_block_size);
+
+    // Forgets the copy of `page`, if there is one.
+    void remove(page_t *page);
+
+    // Forgets the oldest copy and returns the page it belonged to, or NULL if the
+    // tier is empty.
+    page_t *drop_oldest();
+
+    // How much memory the copies use.
+    uint64_t size() const { return bytes_; }
+
+    // Copies that don't save at least this fraction of the block get discarded.
+    static const double MIN_SPACE_SAVING;
+
+private:
+    struct entry_t {
+        page_t *page;
+        uint32_t ser_buf_size;
+        uint32_t compressed_size;
+        scoped_malloc_t<char> data;
+    };
+
+    std::list<entry_t>::iterator find(page_t *page);
+    void erase(std::list<entry_t>::iterator it);
+
+    alt_cache_stats_t *const stats_;
+
+    // Oldest first.
+    std::list<entry_t> entries_;
+    std::unordered_map<page_t *, std::list<entry_t>::iterator> index_;
+    uint64_t bytes_;
+
+    DISABLE_COPYING(compressed_page_tier_t);
+};
+
+}  // namespace alt
+
+#endif  // BUFFER_CACHE_ALT_COMPRESSED_PAGE_TIER_HPP_
@@ -4,6 +4,7 @@
 #include "buffer_cache/alt/page.hpp"
 #include "buffer_cache/alt/page_cache.hpp"
 #include "buffer_cache/alt/cache_balancer.hpp"
+#include "buffer_cache/alt/stats.hpp"
 
 namespace alt {
 
@@ -12,6 +13,7 @@ evicter_t::evicter_t()
       page_cache_(NULL),
       balancer_(NULL),
       throttler_(NULL),
+      stats_(NULL),
       bytes_loaded_counter_(0),
       access_count_counter_(0),
       access_time_counter_(INITIAL_ACCESS_TIME) { }
@@ -25,14 +27,21 @@ evicter_t::~evicter_t() {
 
 void evicter_t::initialize(page_cache_t *page_cache,
                            cache_balancer_t *balancer,
-                           alt_txn_throttler_t *throttler) {
+                           alt_txn_throttler_t *throttler,
+                           alt_cache_stats_t *stats) {
     guarantee(balancer != NULL);
     initialized_ = true;  // Can you really say this class is 'initialized_'?
     page_cache_ = page_cache;
     memory_limit_ = balancer->base_mem_per_store();
     page_cache_ = page_cache;
     throttler_ = throttler;
+    stats_ = stats;
     balancer_ = balancer;
+    policy_ = make_eviction_policy(balancer->eviction_policy(),
+                                   page_cache_->max_block_size());
+    if (balancer->compressed_memory_proportion() > 0) {
+        compressed_tier_.init(new compressed_page_tier_t(stats));
+    }
     balancer_->add_evicter(this);
     throttler_->inform_memory_limit_change(memory_limit_,
                                            page_cache_->max_block_size());
@@ -86,6 +95,7 @@ void evicter_t::notify_bytes_loading(int64_t in_memory_buf_change) {
 void evicter_t::add_deferred_loaded(page_t *page) {
     assert_thread();
     guarantee(initialized_);
+    policy_->on_page_loading(page);
     evicted_.add(page, page->hypothetical_memory_usage());
 }
 
@@ -99,6 +109,7 @@ void evicter_t::catch_up_deferred_load(page_t *page) {
 void evicter_t::add_not_yet_loaded(page_t *page) {
     assert_thread();
     guarantee(initialized_);
+    policy_->on_page_loading(page);
     unevictable_.add(page, page->hypothetical_memory_usage());
     evict_if_necessary();
     notify_bytes_loading(page->hypothetical_memory_usage());
@@ -107,9 +118,30 @@ void evicter_t::add_not_yet_loaded(page_t *page) {
 void evicter_t::reloading_page(page_t *page) {
     assert_thread();
     guarantee(initialized_);
+    policy_->on_page_loading(page);
     notify_bytes_loading(page->hypothetical_memory_usage());
 }
 
+scoped_malloc_t<ser_buffer_t> evicter_t::take_compressed_copy(page_t *page) {
+    assert_thread();
+    guarantee(initialized_);
+    if (!compressed_tier_.has()) {
+        return scoped_malloc_t<ser_buffer_t>();
+    }
+    return compressed_tier_->take(page, page_cache_->max_block_size());
+}
+
+void evicter_t::count_page_acquisition(bool was_in_memory) {
+    assert_thread();
+    if (stats_ != NULL) {
+        if (was_in_memory) {
+            ++stats_->pm_cache_hits;
+        } else {
+            ++stats_->pm_cache_misses;
+        }
+    }
+}
+
 bool evicter_t::page_is_in_unevictable_bag(page_t *page) const {
     assert_thread();
     guarantee(initialized_);
@@ -133,7 +165,7 @@ void evicter_t::add_to_evictable_unbacked(page_t *page) {
 void evicter_t::add_to_evictable_disk_backed(page_t *page) {
     assert_thread();
     guarantee(initialized_);
-    evictable_disk_backed_.add(page, page->hypothetical_memory_usage());
+    correct_eviction_category(page)->add(page, page->hypothetical_memory_usage());
     evict_if_necessary();
     notify_bytes_loading(page->hypothetical_memory_usage());
 }
@@ -145,6 +177,8 @@ void evicter_t::move_unevictable_to_evictable(page_t *page) {
     unevictable_.remove(page, page->hypothetical_memory_usage());
     eviction_bag_t *new_bag = correct_eviction_category(page);
     rassert(new_bag == &evictable_disk_backed_
+            || new_bag == &evictable_disk_backed_hot_
+            || new_bag == &evictable_disk_backed_pinned_
             || new_bag == &evictable_unbacked_);
     new_bag->add(page, page->hypothetical_memory_usage());
     evict_if_necessary();
@@ -169,7 +203,12 @@ eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
     } else if (page->is_not_loaded()) {
         return &evicted_;
     } else if (page->is_disk_backed()) {
-        return &evictable_disk_backed_;
+        if (page->is_pinned()) {
+            return &evictable_disk_backed_pinned_;
+        }
+        return policy_->is_hot(page)
+            ? &evictable_disk_backed_hot_
+            : &evictable_disk_backed_;
     } else {
         return &evictable_unbacked_;
     }
@@ -180,6 +219,9 @@ void evicter_t::remove_page(page_t *page) {
     guarantee(initialized_);
     eviction_bag_t *bag = correct_eviction_category(page);
     bag->remove(page, page->hypothetical_memory_usage());
+    if (compressed_tier_.has()) {
+        compressed_tier_->remove(page);
+    }
     evict_if_necessary();
     notify_bytes_loading(-static_cast<int64_t>(page->hypothetical_memory_usage()));
 }
@@ -189,7 +231,21 @@ uint64_t evicter_t::in_memory_size() const {
     guarantee(initialized_);
     return unevictable_.size()
         + evictable_disk_backed_.size()
-        + evictable_unbacked_.size();
+        + evictable_disk_backed_hot_.size()
+        + evictable_disk_backed_pinned_.size()
+        + evictable_unbacked_.size()
+        + compressed_size();
+}
+
+uint64_t evicter_t::compressed_size() const {
+    assert_thread();
+    guarantee(initialized_);
+    return compressed_tier_.has() ? compressed_tier_->size() : 0;
+}
+
+uint64_t evicter_t::pinned_memory_limit() const {
+    return static_cast<uint64_t>(memory_limit_
+                                 * balancer_->pinned_memory_proportion());
 }
 
 void evicter_t::evict_if_necessary() {
@@ -201,10 +257,49 @@ void evicter_t::evict_if_necessary() {
     // currently being written for the purpose of eviction.
 
     page_t *page;
-    while (in_memory_size() > memory_limit_
-           && evictable_disk_backed_.remove_oldish(&page, access_time_counter_)) {
+    while (in_memory_size() > memory_limit_) {
+        // Pinned pages only get evicted if they're over their budget, or if there
+        // is nothing else.
+        eviction_bag_t *bag;
+        if (evictable_disk_backed_pinned_.size() > pinned_memory_limit()
+            || (evictable_disk_backed_.size() == 0
+                && evictable_disk_backed_hot_.size() == 0)) {
+            bag = &evictable_disk_backed_pinned_;
+        } else {
+            bag = policy_->choose_victim_bag(&evictable_disk_backed_,
+                                             &evictable_disk_backed_hot_,
+                                             memory_limit_);
+        }
+        if (!bag->remove_oldish(&page, access_time_counter_)) {
+            // Nothing left to evict but compressed copies.
+            if (compressed_tier_.has() && compressed_tier_->size() > 0) {
+                shrink_compressed_tier(compressed_tier_->size() - 1);
+                continue;
+            }
+            break;
+        }
         evicted_.add(page, page->hypothetical_memory_usage());
+        if (compressed_tier_.has() && !page->is_pinned()) {
+            compressed_tier_->add(page);
+        }
         page->evict_self();
+        if (bag != &evictable_disk_backed_pinned_) {
+            policy_->on_evicted(page, bag == &evictable_disk_backed_hot_,
+                                memory_limit_);
+        }
+        page_cache_->consider_evicting_current_page(page->block_id());
+    }
+
+    if (compressed_tier_.has()) {
+        shrink_compressed_tier(static_cast<uint64_t>(
+            memory_limit_ * balancer_->compressed_memory_proportion()));
+    }
+}
+
+void evicter_t::shrink_compressed_tier(uint64_t limit) {
+    while (compressed_tier_->size() > limit) {
+        page_t *page = compressed_tier_->drop_oldest();
+        // Without its compressed copy, the page's current_page_t may be deletable.
         page_cache_->consider_evicting_current_page(page->block_id());
     }
 }
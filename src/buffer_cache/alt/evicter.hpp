@@ -5,11 +5,14 @@
 
 #include <functional>
 
+#include "buffer_cache/alt/compressed_page_tier.hpp"
 #include "buffer_cache/alt/eviction_bag.hpp"
+#include "buffer_cache/alt/eviction_policy.hpp"
 #include "concurrency/cache_line_padded.hpp"
 #include "concurrency/pubsub.hpp"
 #include "threading.hpp"
 
+class alt_cache_stats_t;
 class cache_balancer_t;
 class alt_txn_throttler_t;
 
@@ -34,13 +37,22 @@ public:
     void remove_page(page_t *page);
     void reloading_page(page_t *page);
 
+    // Counts a page acquisition towards the cache hit ratio.
+    void count_page_acquisition(bool was_in_memory);
+
+    // Returns the page's buffer, decompressed from the compressed tier, or an
+    // empty buffer if the tier has no copy of it.
+    scoped_malloc_t<ser_buffer_t> take_compressed_copy(page_t *page);
+
     // Evicter will be unusable until initialize is called
     explicit evicter_t();
     ~evicter_t();
 
+    // `stats` may be NULL (which some unit tests do).
     void initialize(page_cache_t *page_cache,
                     cache_balancer_t *balancer,
-                    alt_txn_throttler_t *throttler);
+                    alt_txn_throttler_t *throttler,
+                    alt_cache_stats_t *stats);
     void update_memory_limit(uint64_t new_memory_limit,
                              uint64_t bytes_loaded_accounted_for,
                              uint64_t access_count_accounted_for,
@@ -56,6 +68,8 @@ public:
     uint64_t get_clamped_bytes_loaded() const;
 
     uint64_t in_memory_size() const;
+    // The part of in_memory_size() that compressed copies of evicted pages use.
+    uint64_t compressed_size() const;
 
     // This is decremented past UINT64_MAX to force code to be aware of access time
     // rollovers.
@@ -68,10 +82,26 @@ private:
     // Evicts any evictable pages until under the memory limit
     void evict_if_necessary();
 
+    // How much of memory_limit_ pinned pages may use before they get evicted
+    // ahead of unpinned ones.
+    uint64_t pinned_memory_limit() const;
+
+    // Drops compressed copies until the compressed tier fits in its share of
+    // memory_limit_.
+    void shrink_compressed_tier(uint64_t limit);
+
     bool initialized_;
     page_cache_t *page_cache_;
     cache_balancer_t *balancer_;
     alt_txn_throttler_t *throttler_;
+    alt_cache_stats_t *stats_;
+
+    // Decides which evictable disk-backed pages are hot and which pages to evict
+    // first.
+    scoped_ptr_t<eviction_policy_t> policy_;
+
+    // Compressed copies of evicted pages, if the balancer wants us to keep them.
+    scoped_ptr_t<compressed_page_tier_t> compressed_tier_;
 
     uint64_t memory_limit_;
 
@@ -84,9 +114,13 @@ private:
     // This gets incremented every time a page is accessed.
     uint64_t access_time_counter_;
 
-    // These track every page's eviction status.
+    // These track every page's eviction status.  Evictable disk-backed pages are
+    // split into cold and hot ones by policy_.
     eviction_bag_t unevictable_;
     eviction_bag_t evictable_disk_backed_;
+    eviction_bag_t evictable_disk_backed_hot_;
+    // Disk-backed pages that have been pinned (see page_t::mark_pinned).
+    eviction_bag_t evictable_disk_backed_pinned_;
     eviction_bag_t evictable_unbacked_;
     eviction_bag_t evicted_;
 
@@ -0,0 +1,101 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "buffer_cache/alt/eviction_policy.hpp"
+
+#include "buffer_cache/alt/eviction_bag.hpp"
+#include "buffer_cache/alt/page.hpp"
+
+bool parse_cache_eviction_policy(const std::string &name,
+                                 cache_eviction_policy_t *policy_out) {
+    if (name == "random") {
+        *policy_out = cache_eviction_policy_t::random_sample;
+        return true;
+    } else if (name == "2q") {
+        *policy_out = cache_eviction_policy_t::two_queue;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+namespace alt {
+
+scoped_ptr_t<eviction_policy_t> make_eviction_policy(cache_eviction_policy_t policy,
+                                                     block_size_t max_block_size) {
+    switch (policy) {
+    case cache_eviction_policy_t::random_sample:
+        return scoped_ptr_t<eviction_policy_t>(new random_sample_eviction_policy_t());
+    case cache_eviction_policy_t::two_queue:
+        return scoped_ptr_t<eviction_policy_t>(
+            new two_queue_eviction_policy_t(max_block_size));
+    default:
+        unreachable();
+    }
+}
+
+eviction_bag_t *random_sample_eviction_policy_t::choose_victim_bag(
+        eviction_bag_t *cold, DEBUG_VAR eviction_bag_t *hot,
+        UNUSED uint64_t memory_limit) {
+    rassert(hot->size() == 0);
+    return cold;
+}
+
+// The 2Q paper recommends 25% of the cache for the probationary queue and a ghost
+// queue that remembers half as many pages as the cache holds.
+const double two_queue_eviction_policy_t::COLD_MEMORY_FRACTION = 0.25;
+const double two_queue_eviction_policy_t::GHOST_BLOCKS_PER_BLOCK = 0.5;
+
+two_queue_eviction_policy_t::two_queue_eviction_policy_t(block_size_t max_block_size)
+    : max_block_size_(max_block_size.ser_value()) { }
+
+void two_queue_eviction_policy_t::on_page_loading(page_t *page) {
+    auto it = ghosts_.find(page->block_id());
+    if (it != ghosts_.end()) {
+        // The block was evicted from the cold bag not long ago and is already
+        // wanted again, so it isn't part of a one-off scan.  (The stale entry
+        // stays in ghost_fifo_ until it ages out.)
+        ghosts_.erase(it);
+        page->record_access();
+    }
+}
+
+bool two_queue_eviction_policy_t::is_hot(const page_t *page) const {
+    return page->access_count() > 1;
+}
+
+eviction_bag_t *two_queue_eviction_policy_t::choose_victim_bag(
+        eviction_bag_t *cold, eviction_bag_t *hot, uint64_t memory_limit) {
+    if (cold->size() == 0) {
+        return hot;
+    }
+    if (hot->size() == 0
+        || cold->size() > static_cast<uint64_t>(memory_limit * COLD_MEMORY_FRACTION)) {
+        return cold;
+    }
+    return hot;
+}
+
+void two_queue_eviction_policy_t::on_evicted(page_t *page, bool was_hot,
+                                             uint64_t memory_limit) {
+    if (was_hot) {
+        // Hot pages that fall out of the cache have to earn their way back.
+        return;
+    }
+
+    const size_t max_ghosts = static_cast<size_t>(
+        (memory_limit / max_block_size_) * GHOST_BLOCKS_PER_BLOCK);
+    if (ghosts_.insert(page->block_id()).second) {
+        ghost_fifo_.push_back(page->block_id());
+    }
+    while (ghosts_.size() > max_ghosts && !ghost_fifo_.empty()) {
+        ghosts_.erase(ghost_fifo_.front());
+        ghost_fifo_.pop_front();
+    }
+    // Stale entries (for ghosts that were hit) can make the FIFO longer than the
+    // set; don't let them pile up.
+    while (ghost_fifo_.size() > 2 * max_ghosts + 1) {
+        ghosts_.erase(ghost_fifo_.front());
+        ghost_fifo_.pop_front();
+    }
+}
+
+}  // namespace alt
@@ -0,0 +1,109 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_ALT_EVICTION_POLICY_HPP_
+#define BUFFER_CACHE_ALT_EVICTION_POLICY_HPP_
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <unordered_set>
+
+#include "containers/scoped.hpp"
+#include "serializer/types.hpp"
+
+// Which pages the evicter throws out first when a cache is over its memory limit.
+enum class cache_eviction_policy_t {
+    // Evict the least recently used of a few randomly sampled pages.
+    random_sample,
+    // A 2Q-style policy: pages that have only been used once since they were
+    // loaded (for example by a table scan or a backfill) are evicted before pages
+    // that get used repeatedly (like btree internal nodes).
+    two_queue
+};
+
+// Parses "random" or "2q".  Returns false if `name` is neither.
+bool parse_cache_eviction_policy(const std::string &name,
+                                 cache_eviction_policy_t *policy_out);
+
+namespace alt {
+
+class eviction_bag_t;
+class page_t;
+
+/* An `eviction_policy_t` decides, for the evicter, where evictable disk-backed
+pages live and which of them get evicted first. The evicter keeps those pages in
+two bags: a "cold" bag for pages on probation and a "hot" bag for pages the policy
+wants to protect. Within a bag, victims are picked by sampled access time. */
+class eviction_policy_t {
+public:
+    virtual ~eviction_policy_t() { }
+
+    // Called when a page's block is about to be read from disk, either because
+    // a page_t was just created for it or because an evicted page is reloaded.
+    virtual void on_page_loading(page_t *page) = 0;
+
+    // Whether an evictable disk-backed page belongs in the hot bag.  The answer
+    // may only change while the page is unevictable.
+    virtual bool is_hot(const page_t *page) const = 0;
+
+    // Picks the bag to take the next victim from.  Must return a non-empty bag
+    // if either bag is non-empty.
+    virtual eviction_bag_t *choose_victim_bag(eviction_bag_t *cold,
+                                              eviction_bag_t *hot,
+                                              uint64_t memory_limit) = 0;
+
+    // Called after `page` was evicted from the cold or the hot bag.
+    virtual void on_evicted(page_t *page, bool was_hot, uint64_t memory_limit) = 0;
+};
+
+scoped_ptr_t<eviction_policy_t> make_eviction_policy(cache_eviction_policy_t policy,
+                                                     block_size_t max_block_size);
+
+// The policy we always used to have: every page is cold.
+class random_sample_eviction_policy_t : public eviction_policy_t {
+public:
+    random_sample_eviction_policy_t() { }
+
+    void on_page_loading(page_t *) { }
+    bool is_hot(const page_t *) const { return false; }
+    eviction_bag_t *choose_victim_bag(eviction_bag_t *cold, eviction_bag_t *hot,
+                                      uint64_t memory_limit);
+    void on_evicted(page_t *, bool, uint64_t) { }
+
+private:
+    DISABLE_COPYING(random_sample_eviction_policy_t);
+};
+
+// Simplified 2Q (Johnson & Shasha).  A page is hot once it has been acquired
+// more than once while in memory, or if its block was recently evicted from the
+// cold bag (the "ghost" list, which remembers block ids but holds no data).  The
+// cold bag is evicted from first as long as it holds more than
+// `COLD_MEMORY_FRACTION` of the memory limit, so a scan can only push out other
+// cold pages.
+class two_queue_eviction_policy_t : public eviction_policy_t {
+public:
+    explicit two_queue_eviction_policy_t(block_size_t max_block_size);
+
+    void on_page_loading(page_t *page);
+    bool is_hot(const page_t *page) const;
+    eviction_bag_t *choose_victim_bag(eviction_bag_t *cold, eviction_bag_t *hot,
+                                      uint64_t memory_limit);
+    void on_evicted(page_t *page, bool was_hot, uint64_t memory_limit);
+
+    static const double COLD_MEMORY_FRACTION;
+    // The ghost list remembers this many blocks per block of memory limit.
+    static const double GHOST_BLOCKS_PER_BLOCK;
+
+private:
+    const uint32_t max_block_size_;
+
+    // Recently evicted cold blocks, oldest first, and the same set for lookups.
+    std::deque<block_id_t> ghost_fifo_;
+    std::unordered_set<block_id_t> ghosts_;
+
+    DISABLE_COPYING(two_queue_eviction_policy_t);
+};
+
+}  // namespace alt
+
+#endif  // BUFFER_CACHE_ALT_EVICTION_POLICY_HPP_
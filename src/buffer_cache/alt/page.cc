@@ -45,6 +45,9 @@ page_t::page_t(block_id_t block_id, page_cache_t *page_cache)
       max_ser_block_size_(page_cache->max_block_size().ser_value()),
       ser_buf_size_(0),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      pinned_(false),
+      has_compressed_copy_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_deferred_loaded(this);
 
@@ -61,6 +64,9 @@ page_t::page_t(block_id_t block_id, page_cache_t *page_cache,
       max_ser_block_size_(page_cache->max_block_size().ser_value()),
       ser_buf_size_(0),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      pinned_(false),
+      has_compressed_copy_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
 
@@ -80,6 +86,9 @@ page_t::page_t(block_id_t block_id, block_size_t block_size,
       ser_buf_size_(block_size.ser_value()),
       buf_(std::move(buf)),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      pinned_(false),
+      has_compressed_copy_(false),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_unbacked(this);
@@ -96,6 +105,9 @@ page_t::page_t(block_id_t block_id,
       buf_(std::move(buf)),
       block_token_(block_token),
       access_time_(READ_AHEAD_ACCESS_TIME),
+      access_count_(0),
+      pinned_(false),
+      has_compressed_copy_(false),
       snapshot_refcount_(0) {
     rassert(buf_.has());
     page_cache->evicter().add_to_evictable_disk_backed(this);
@@ -107,6 +119,9 @@ page_t::page_t(page_t *copyee, page_cache_t *page_cache, cache_account_t *accoun
       max_ser_block_size_(page_cache->max_block_size().ser_value()),
       ser_buf_size_(0),
       access_time_(page_cache->evicter().next_access_time()),
+      access_count_(0),
+      pinned_(copyee->pinned_),
+      has_compressed_copy_(false),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
     coro_t::spawn_now_dangerously(std::bind(&page_t::load_from_copyee,
@@ -419,6 +434,9 @@ void page_t::add_waiter(page_acq_t *acq, cache_account_t *account) {
         = acq->page_cache()->evicter().correct_eviction_category(this);
     waiters_.push_back(acq);
     acq->page_cache()->evicter().change_to_correct_eviction_bag(old_bag, this);
+    // We're unevictable now, so this can't change which bag we belong in.
+    record_access();
+    acq->page_cache()->evicter().count_page_acquisition(buf_.has());
     if (buf_.has()) {
         acq->buf_ready_signal_.pulse();
     } else if (loader_ != NULL) {
@@ -449,8 +467,9 @@ void page_t::load_using_block_token(page_t *page, page_cache_t *page_cache,
     counted_t<standard_block_token_t> block_token = page->block_token_;
     rassert(block_token.has());
 
-    scoped_malloc_t<ser_buffer_t> buf;
-    {
+    scoped_malloc_t<ser_buffer_t> buf
+        = page_cache->evicter().take_compressed_copy(page);
+    if (!buf.has()) {
         serializer_t *const serializer = page_cache->serializer_;
         buf = serializer_t::allocate_buffer(page_cache->max_block_size());
 
@@ -525,6 +544,7 @@ void page_t::evict_self() {
     rassert(block_token_.has());
     rassert(buf_.has());
     buf_.reset();
+    access_count_ = 0;
 }
 
 
@@ -578,6 +598,16 @@ const void *page_acq_t::get_buf_read() {
     return page_->get_page_buf(page_cache_);
 }
 
+void page_acq_t::mark_pinned() {
+    rassert(page_ != NULL);
+    page_->mark_pinned();
+}
+
+void page_acq_t::mark_unpinned() {
+    rassert(page_ != NULL);
+    page_->mark_unpinned();
+}
+
 page_ptr_t::page_ptr_t() : page_(NULL) {
 }
 
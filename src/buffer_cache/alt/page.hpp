@@ -54,12 +54,39 @@ public:
     uint32_t hypothetical_memory_usage() const;
     uint64_t access_time() const { return access_time_; }
 
+    // How many times the page has been acquired since it was last loaded
+    // (saturating).  The eviction policy uses this to tell apart pages that get
+    // reused from pages that were only touched once, e.g. by a scan.
+    uint32_t access_count() const { return access_count_; }
+    void record_access() {
+        if (access_count_ < MAX_ACCESS_COUNT) {
+            ++access_count_;
+        }
+    }
+
+    // Pinned pages are evicted only when the cache's pinned memory budget is used
+    // up, or when nothing else is left to evict.  This may only be called while the
+    // page has waiters (since it changes the eviction bag we belong in).
+    bool is_pinned() const { return pinned_; }
+    void mark_pinned() {
+        rassert(!waiters_.empty());
+        pinned_ = true;
+    }
+    // Makes the page an ordinary evictable one again.  The same restriction
+    // applies.
+    void mark_unpinned() {
+        rassert(!waiters_.empty());
+        pinned_ = false;
+    }
+
     bool is_loading() const {
         return loader_ != NULL && page_t::loader_is_loading(loader_);
     }
     bool has_waiters() const { return !waiters_.empty(); }
     bool is_not_loaded() const { return !buf_.has(); }
     bool is_disk_backed() const { return block_token_.has(); }
+    // Whether the evicter's compressed_page_tier_t holds a copy of our buffer.
+    bool has_compressed_copy() const { return has_compressed_copy_; }
 
     void evict_self();
 
@@ -105,6 +132,7 @@ private:
                                        cache_account_t *account);
 
     friend class page_cache_t;
+    friend class compressed_page_tier_t;
     friend backindex_bag_index_t *access_backindex(page_t *page);
 
     // The block id.  Used to (potentially) delete the page_t and current_page_t when
@@ -126,6 +154,13 @@ private:
 
     uint64_t access_time_;
 
+    static const uint32_t MAX_ACCESS_COUNT = 255;
+    uint32_t access_count_;
+
+    bool pinned_;
+
+    bool has_compressed_copy_;
+
     // How many page_ptr_t's point at this page, expecting nothing to modify it,
     // other than themselves.
     size_t snapshot_refcount_;
@@ -237,6 +272,10 @@ public:
     void *get_buf_write(block_size_t block_size);
     const void *get_buf_read();
 
+    // See page_t::mark_pinned and page_t::mark_unpinned.
+    void mark_pinned();
+    void mark_unpinned();
+
 private:
     friend class page_t;
 
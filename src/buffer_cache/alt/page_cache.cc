@@ -184,7 +184,8 @@ public:
 
 page_cache_t::page_cache_t(serializer_t *serializer,
                            cache_balancer_t *balancer,
-                           alt_txn_throttler_t *throttler)
+                           alt_txn_throttler_t *throttler,
+                           alt_cache_stats_t *stats)
     : max_block_size_(serializer->max_block_size()),
       serializer_(serializer),
       free_list_(serializer),
@@ -206,6 +207,8 @@ page_cache_t::page_cache_t(serializer_t *serializer,
         default_reads_account_.init(serializer->home_thread(),
                                     serializer->make_io_account(CACHE_READS_IO_PRIORITY));
         writes_io_account_.init(serializer->make_io_account(CACHE_WRITES_IO_PRIORITY));
+        prefetch_account_.init(serializer->home_thread(),
+                               serializer->make_io_account(CACHE_PREFETCH_IO_PRIORITY));
         index_write_sink_.init(new page_cache_index_write_sink_t);
         recencies_ = serializer->get_all_recencies();
     }
@@ -217,7 +220,7 @@ page_cache_t::page_cache_t(serializer_t *serializer,
     // initialize the read_ahead_cb_ after the evicter_ because that way reentrant
     // usage by the balancer (before page_cache_t construction completes) would be
     // more likely to trip an assertion.
-    evicter_.initialize(this, balancer, throttler);
+    evicter_.initialize(this, balancer, throttler, stats);
     read_ahead_cb_ = local_read_ahead_cb;
 }
 
@@ -246,6 +249,7 @@ page_cache_t::~page_cache_t() {
         // time.
         default_reads_account_.reset();
         writes_io_account_.reset();
+        prefetch_account_.reset();
         index_write_sink_.reset();
     }
 }
@@ -334,6 +338,29 @@ current_page_t *page_cache_t::page_for_block_id(block_id_t block_id) {
     return current_pages_[block_id];
 }
 
+void page_cache_t::prefetch(block_id_t block_id) {
+    assert_thread();
+
+    // A deleted block has an invalid recency (and might not be in current_pages_).
+    if (recency_for_block_id(block_id) == repli_timestamp_t::invalid) {
+        return;
+    }
+
+    // If there is a current_page_t, the page is loaded, being loaded, or
+    // about to be, and maybe newer than what's on disk.
+    resize_current_pages_to_id(block_id);
+    if (current_pages_[block_id] != NULL) {
+        return;
+    }
+
+    // The page gets evicted just like any other page that nobody acquired.  Until
+    // then it keeps the current_page_t around, so the next acquirer finds it.
+    current_page_t *current_page = new current_page_t(block_id);
+    current_pages_[block_id] = current_page;
+    current_page->convert_from_serializer_if_necessary(
+        current_page_help_t(block_id, this), &prefetch_account_);
+}
+
 current_page_t *page_cache_t::page_for_new_block_id(block_id_t *block_id_out) {
     assert_thread();
     block_id_t block_id = free_list_.acquire_block_id();
@@ -708,6 +735,10 @@ bool current_page_t::should_be_evicted() const {
             || page->page_ptr_count() != 1) {
             return false;
         }
+        // A compressed copy is only good for as long as the page_t is around.
+        if (page->has_compressed_copy()) {
+            return false;
+        }
         // is_loading is false and is_not_loaded is true -- it must be disk-backed.
         rassert(page->is_disk_backed());
     }
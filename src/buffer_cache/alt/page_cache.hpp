@@ -25,6 +25,7 @@
 #include "repli_timestamp.hpp"
 #include "serializer/types.hpp"
 
+class alt_cache_stats_t;
 class alt_txn_throttler_t;
 class cache_balancer_t;
 class auto_drainer_t;
@@ -309,9 +310,11 @@ class page_cache_index_write_sink_t;
 
 class page_cache_t : public home_thread_mixin_t {
 public:
+    // `stats` may be NULL.
     page_cache_t(serializer_t *serializer,
                  cache_balancer_t *balancer,
-                 alt_txn_throttler_t *throttler);
+                 alt_txn_throttler_t *throttler,
+                 alt_cache_stats_t *stats);
     ~page_cache_t();
 
     // Takes a txn to be flushed.  Calls on_flush_complete() (which resets the
@@ -337,6 +340,12 @@ public:
         return &default_reads_account_;
     }
 
+    // Starts loading the current version of the block from the serializer, using
+    // the prefetch I/O account, unless the cache already knows about the block.
+    // Nothing gets acquired, so this is only a hint -- the block may have changed
+    // by the time somebody acquires it.  Does nothing if the block is deleted.
+    void prefetch(block_id_t block_id);
+
     // Considers wiping out the current_page_t (and its page_t pointee) for a
     // particular block id, to save memory, if the right conditions are met.  (This
     // should only be called by things "outside" of current_page_t, like
@@ -433,6 +442,9 @@ private:
     // separation might be tricky in practice.
     cache_account_t default_reads_account_;
     scoped_ptr_t<file_account_t> writes_io_account_;
+    // Prefetches get an account of their own, with a lower priority than reads
+    // that somebody is waiting for.
+    cache_account_t prefetch_account_;
 
     // This fifo enforcement pair ensures ordering of index_write operations after we
     // move to the serializer thread and get a bunch of blocks written.
@@ -6,5 +6,9 @@
 alt_cache_stats_t::alt_cache_stats_t(perfmon_collection_t *parent)
     : cache_collection(),
       cache_membership(parent, &cache_collection, "cache"),
-      cache_collection_membership(&cache_collection) { }
+      cache_collection_membership(&cache_collection,
+          &pm_cache_hits, "cache_hits",
+          &pm_cache_misses, "cache_misses",
+          &pm_cache_compressed_hits, "cache_compressed_hits",
+          &pm_cache_compressed_bytes_saved, "cache_compressed_bytes_saved") { }
 
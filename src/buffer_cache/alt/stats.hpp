@@ -11,9 +11,16 @@ public:
     perfmon_collection_t cache_collection;
     perfmon_membership_t cache_membership;
 
-    /*
-      LSI: insert perfmons here
-    */
+    // Page acquisitions that found the page in memory, and ones that had to
+    // wait for it to be read from disk.  Together they give the hit ratio.
+    perfmon_counter_t pm_cache_hits;
+    perfmon_counter_t pm_cache_misses;
+
+    // Misses that were served from the compressed tier instead of the
+    // serializer, and how much memory the tier currently saves over keeping those
+    // pages uncompressed.
+    perfmon_counter_t pm_cache_compressed_hits;
+    perfmon_counter_t pm_cache_compressed_bytes_saved;
 
     perfmon_multi_membership_t cache_collection_membership;
 };
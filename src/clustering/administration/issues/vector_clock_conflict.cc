@@ -32,6 +32,7 @@ void check_namespaces_for_protocol(
             check("namespace", it->first, "primary_pinnings", it->second.get_ref().primary_pinnings, out);
             check("namespace", it->first, "secondary_pinnings", it->second.get_ref().secondary_pinnings, out);
             check("namespace", it->first, "database", it->second.get_ref().database, out);
+            check("namespace", it->first, "block_size", it->second.get_ref().block_size, out);
         }
     }
 }
@@ -28,6 +28,7 @@
 #include <limits>
 
 #include "arch/io/disk.hpp"
+#include "arch/io/disk/aio.hpp"
 #include "arch/os_signal.hpp"
 #include "arch/runtime/starter.hpp"
 #include "extproc/extproc_spawner.hpp"
@@ -656,6 +657,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
                           const name_string_t &machine_name,
                           const file_direct_io_mode_t direct_io_mode,
                           const int max_concurrent_io_requests,
+                          const io_backend_t io_backend,
                           bool *const result_out) {
     machine_id_t our_machine_id = generate_uuid();
 
@@ -667,7 +669,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
     machine_semilattice_metadata.datacenter = vclock_t<datacenter_id_t>(nil_uuid(), our_machine_id);
     cluster_metadata.machines.machines.insert(std::make_pair(our_machine_id, make_deletable(machine_semilattice_metadata)));
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests, io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -762,7 +764,11 @@ void run_rethinkdb_serve(const base_path_t &base_path,
                          const serve_info_t &serve_info,
                          const file_direct_io_mode_t direct_io_mode,
                          const int max_concurrent_io_requests,
+                         const io_backend_t io_backend,
                          const uint64_t total_cache_size,
+                         const cache_eviction_policy_t cache_eviction_policy,
+                         const bool compress_evicted_pages,
+                         const log_serializer_dynamic_config_t &serializer_config,
                          const machine_id_t *our_machine_id,
                          const cluster_semilattice_metadata_t *cluster_metadata,
                          directory_lock_t *data_directory_lock,
@@ -792,7 +798,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
 
     logINF("Loading data from directory %s\n", base_path.path().c_str());
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests, io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -835,6 +841,9 @@ void run_rethinkdb_serve(const base_path_t &base_path,
                             cluster_metadata_file.get(),
                             auth_metadata_file.get(),
                             total_cache_size,
+                            cache_eviction_policy,
+                            compress_evicted_pages,
+                            serializer_config,
                             look_up_peers_addresses(*serve_info.joins),
                             serve_info.ports,
                             serve_info.web_assets,
@@ -854,14 +863,19 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              const name_string_t &machine_name,
                              const file_direct_io_mode_t direct_io_mode,
                              const int max_concurrent_io_requests,
+                             const io_backend_t io_backend,
                              const uint64_t total_cache_size,
+                             const cache_eviction_policy_t cache_eviction_policy,
+                             const bool compress_evicted_pages,
+                             const log_serializer_dynamic_config_t &serializer_config,
                              const bool new_directory,
                              const serve_info_t &serve_info,
                              directory_lock_t *data_directory_lock,
                              bool *const result_out) {
     if (!new_directory) {
         run_rethinkdb_serve(base_path, serve_info, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
+                            max_concurrent_io_requests, io_backend, total_cache_size,
+                            cache_eviction_policy, compress_evicted_pages, serializer_config,
                             NULL, NULL, data_directory_lock,
                             result_out);
     } else {
@@ -894,7 +908,8 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
         }
 
         run_rethinkdb_serve(base_path, serve_info, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
+                            max_concurrent_io_requests, io_backend, total_cache_size,
+                            cache_eviction_policy, compress_evicted_pages, serializer_config,
                             &our_machine_id, &cluster_metadata,
                             data_directory_lock, result_out);
     }
@@ -947,12 +962,46 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              strprintf("%d", DEFAULT_MAX_CONCURRENT_IO_REQUESTS)));
     help.add("--io-threads n",
              "how many simultaneous I/O operations can happen at the same time");
+    options_out->push_back(options::option_t(options::names_t("--io-backend"),
+                                             options::OPTIONAL,
+                                             "pool"));
+    help.add("--io-backend {pool,aio}",
+             "run disk I/O on a thread pool (the default) or through Linux native "
+             "AIO (use together with direct I/O)");
     options_out->push_back(options::option_t(options::names_t("--no-direct-io"),
                                              options::OPTIONAL_NO_PARAMETER));
     help.add("--no-direct-io", "disable direct I/O");
     options_out->push_back(options::option_t(options::names_t("--cache-size"),
                                              options::OPTIONAL));
     help.add("--cache-size mb", "total cache size (in megabytes) for the process");
+    options_out->push_back(options::option_t(options::names_t("--cache-eviction-policy"),
+                                             options::OPTIONAL,
+                                             "random"));
+    help.add("--cache-eviction-policy {random,2q}",
+             "how the cache picks pages to evict: the least recently used of a few "
+             "random pages (the default), or a scan-resistant 2Q policy that keeps "
+             "frequently used pages");
+    options_out->push_back(options::option_t(options::names_t("--cache-compression"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--cache-compression",
+             "keep compressed copies of evicted pages in part of the cache, so that "
+             "reading them again doesn't need a disk read");
+    options_out->push_back(options::option_t(options::names_t("--disk-compression"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--disk-compression",
+             "store table data blocks zlib-compressed when that saves disk space");
+    options_out->push_back(options::option_t(options::names_t("--gc-min-rate"),
+                                             options::OPTIONAL,
+                                             strprintf("%lld", DEFAULT_GC_MIN_BYTES_PER_SEC / MEGABYTE)));
+    help.add("--gc-min-rate mb",
+             "how fast (in megabytes per second) the garbage collector moves data "
+             "when there is little garbage");
+    options_out->push_back(options::option_t(options::names_t("--gc-max-rate"),
+                                             options::OPTIONAL,
+                                             strprintf("%lld", DEFAULT_GC_MAX_BYTES_PER_SEC / MEGABYTE)));
+    help.add("--gc-max-rate mb",
+             "how fast (in megabytes per second) the garbage collector may move data "
+             "before it gets too far behind to be throttled");
     return help;
 }
 
@@ -1224,6 +1273,50 @@ MUST_USE bool parse_io_threads_option(const std::map<std::string, options::value
     return true;
 }
 
+MUST_USE bool parse_io_backend_option(const std::map<std::string, options::values_t> &opts,
+                                      io_backend_t *io_backend_out) {
+    const std::string io_backend = get_single_option(opts, "--io-backend");
+    if (io_backend == "pool") {
+        *io_backend_out = io_backend_t::pool;
+    } else if (io_backend == "aio") {
+        if (!aio_diskmgr_t::is_supported()) {
+            fprintf(stderr, "ERROR: io-backend 'aio' is not supported on this system\n");
+            return false;
+        }
+        *io_backend_out = io_backend_t::native_aio;
+    } else {
+        fprintf(stderr, "ERROR: io-backend must be 'pool' or 'aio'\n");
+        return false;
+    }
+    return true;
+}
+
+MUST_USE bool parse_cache_eviction_policy_option(
+        const std::map<std::string, options::values_t> &opts,
+        cache_eviction_policy_t *policy_out) {
+    const std::string policy = get_single_option(opts, "--cache-eviction-policy");
+    if (!parse_cache_eviction_policy(policy, policy_out)) {
+        fprintf(stderr, "ERROR: cache-eviction-policy must be 'random' or '2q'\n");
+        return false;
+    }
+    return true;
+}
+
+MUST_USE bool parse_serializer_options(const std::map<std::string, options::values_t> &opts,
+                                       log_serializer_dynamic_config_t *config_out) {
+    config_out->compress_blocks = exists_option(opts, "--disk-compression");
+
+    const int min_rate = get_single_int(opts, "--gc-min-rate");
+    const int max_rate = get_single_int(opts, "--gc-max-rate");
+    if (min_rate <= 0 || max_rate < min_rate) {
+        fprintf(stderr, "ERROR: gc-min-rate must be positive and at most gc-max-rate\n");
+        return false;
+    }
+    config_out->gc_min_bytes_per_sec = min_rate * MEGABYTE;
+    config_out->gc_max_bytes_per_sec = max_rate * MEGABYTE;
+    return true;
+}
+
 file_direct_io_mode_t parse_direct_io_mode_option(const std::map<std::string, options::values_t> &opts) {
     return exists_option(opts, "--no-direct-io") ?
         file_direct_io_mode_t::buffered_desired :
@@ -1260,6 +1353,11 @@ int main_rethinkdb_create(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
         const int num_workers = get_cpu_count();
 
         bool is_new_directory = false;
@@ -1281,6 +1379,7 @@ int main_rethinkdb_create(int argc, char *argv[]) {
                                      machine_name,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      &result),
                            num_workers);
 
@@ -1371,8 +1470,25 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
         uint64_t total_cache_size = get_total_cache_size(opts);
 
+        cache_eviction_policy_t cache_eviction_policy;
+        if (!parse_cache_eviction_policy_option(opts, &cache_eviction_policy)) {
+            return EXIT_FAILURE;
+        }
+
+        const bool compress_evicted_pages = exists_option(opts, "--cache-compression");
+
+        log_serializer_dynamic_config_t serializer_config;
+        if (!parse_serializer_options(opts, &serializer_config)) {
+            return EXIT_FAILURE;
+        }
+
         // Open and lock the directory, but do not create it
         bool is_new_directory = false;
         directory_lock_t data_directory_lock(base_path, false, &is_new_directory);
@@ -1408,7 +1524,11 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                      serve_info,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
+                                     cache_eviction_policy,
+                                     compress_evicted_pages,
+                                     serializer_config,
                                      static_cast<machine_id_t*>(NULL),
                                      static_cast<cluster_semilattice_metadata_t*>(NULL),
                                      &data_directory_lock,
@@ -1630,8 +1750,25 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        io_backend_t io_backend;
+        if (!parse_io_backend_option(opts, &io_backend)) {
+            return EXIT_FAILURE;
+        }
+
         uint64_t total_cache_size = get_total_cache_size(opts);
 
+        cache_eviction_policy_t cache_eviction_policy;
+        if (!parse_cache_eviction_policy_option(opts, &cache_eviction_policy)) {
+            return EXIT_FAILURE;
+        }
+
+        const bool compress_evicted_pages = exists_option(opts, "--cache-compression");
+
+        log_serializer_dynamic_config_t serializer_config;
+        if (!parse_serializer_options(opts, &serializer_config)) {
+            return EXIT_FAILURE;
+        }
+
         // Attempt to create the directory early so that the log file can use it.
         // If we create the file, it will be cleaned up unless directory_initialized()
         // is called on it.  This will be done after the metadata files have been created.
@@ -1672,7 +1809,11 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                      machine_name,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
+                                     cache_eviction_policy,
+                                     compress_evicted_pages,
+                                     serializer_config,
                                      is_new_directory,
                                      serve_info,
                                      &data_directory_lock,
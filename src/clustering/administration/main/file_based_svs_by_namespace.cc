@@ -83,6 +83,7 @@ void
 file_based_svs_by_namespace_t<protocol_t>::get_svs(
             perfmon_collection_t *serializers_perfmon_collection,
             namespace_id_t namespace_id,
+            int block_size,
             stores_lifetimer_t<protocol_t> *stores_out,
             scoped_ptr_t<multistore_ptr_t<protocol_t> > *svs_out,
             typename protocol_t::context_t *ctx) {
@@ -122,6 +123,7 @@ file_based_svs_by_namespace_t<protocol_t>::get_svs(
                                             namespace_id, balancer_,
                                             serializers_perfmon_collection, ctx);
         filepath_file_opener_t file_opener(serializer_filepath, io_backender_);
+        standard_serializer_t::dynamic_config_t serializer_config = serializer_config_;
         if (res == 0) {
             // TODO: Could we handle failure when loading the serializer?  Right
             // now, we don't.
@@ -129,7 +131,7 @@ file_based_svs_by_namespace_t<protocol_t>::get_svs(
             {
                 scoped_ptr_t<serializer_t> ser
                     = make_scoped<standard_serializer_t>(
-                        standard_serializer_t::dynamic_config_t(),
+                        serializer_config,
                         &file_opener,
                         serializers_perfmon_collection);
                 ser = make_scoped<merger_serializer_t>(std::move(ser),
@@ -150,12 +152,18 @@ file_based_svs_by_namespace_t<protocol_t>::get_svs(
                                          stores_out_stores, store_views.data()));
             mptr.init(new multistore_ptr_t<protocol_t>(store_views.data(), num_stores));
         } else {
-            standard_serializer_t::create(&file_opener,
-                                          standard_serializer_t::static_config_t());
+            standard_serializer_t::static_config_t static_config;
+            if (block_size != 0) {
+                guarantee(block_size >= MIN_BTREE_BLOCK_SIZE
+                          && block_size <= MAX_BTREE_BLOCK_SIZE,
+                          "invalid btree block size %d", block_size);
+                static_config.block_size_ = block_size;
+            }
+            standard_serializer_t::create(&file_opener, static_config);
             {
                 scoped_ptr_t<serializer_t> ser
                     = make_scoped<standard_serializer_t>(
-                        standard_serializer_t::dynamic_config_t(),
+                        serializer_config,
                         &file_opener,
                         serializers_perfmon_collection);
                 ser = make_scoped<merger_serializer_t>(std::move(ser),
@@ -207,10 +215,14 @@ template<class protocol_t>
 void file_based_svs_by_namespace_t<protocol_t>::destroy_svs(namespace_id_t namespace_id) {
     // TODO: Handle errors?  It seems like we can't really handle the error so
     // let's just ignore it?
-    const std::string filepath = file_name_for(namespace_id).permanent_path();
-    const int res = ::unlink(filepath.c_str());
-    guarantee_err(res == 0 || get_errno() == ENOENT,
-                  "unlink failed for file %s", filepath.c_str());
+    const serializer_filepath_t filepath = file_name_for(namespace_id);
+    const std::string paths[] = { filepath.permanent_path(),
+                                  filepath.index_snapshot_path() };
+    for (const std::string &path : paths) {
+        const int res = ::unlink(path.c_str());
+        guarantee_err(res == 0 || get_errno() == ENOENT,
+                      "unlink failed for file %s", path.c_str());
+    }
 }
 
 template<class protocol_t>
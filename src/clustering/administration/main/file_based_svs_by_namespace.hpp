@@ -5,6 +5,7 @@
 #include <string>
 
 #include "clustering/administration/reactor_driver.hpp"
+#include "serializer/log/config.hpp"
 
 class cache_balancer_t;
 
@@ -13,12 +14,15 @@ class file_based_svs_by_namespace_t : public svs_by_namespace_t<protocol_t> {
 public:
     file_based_svs_by_namespace_t(io_backender_t *io_backender,
                                   cache_balancer_t *balancer,
-                                  const base_path_t& base_path)
+                                  const base_path_t& base_path,
+                                  const log_serializer_dynamic_config_t &serializer_config)
         : io_backender_(io_backender), balancer_(balancer),
-          base_path_(base_path), thread_counter_(0) { }
+          base_path_(base_path), serializer_config_(serializer_config),
+          thread_counter_(0) { }
 
     void get_svs(perfmon_collection_t *serializers_perfmon_collection,
                  namespace_id_t namespace_id,
+                 int block_size,
                  stores_lifetimer_t<protocol_t> *stores_out,
                  scoped_ptr_t<multistore_ptr_t<protocol_t> > *svs_out,
                  typename protocol_t::context_t *);
@@ -31,6 +35,8 @@ private:
     io_backender_t *io_backender_;
     cache_balancer_t *balancer_;
     const base_path_t base_path_;
+    // The options for the table serializers from the command line.
+    const log_serializer_dynamic_config_t serializer_config_;
 
     threadnum_t next_thread(int num_db_threads);
     int thread_counter_; // should only be used by `next_thread`
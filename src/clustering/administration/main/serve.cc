@@ -70,6 +70,9 @@ bool do_serve(
     metadata_persistence::cluster_persistent_file_t *cluster_metadata_file,
     metadata_persistence::auth_persistent_file_t *auth_metadata_file,
     uint64_t total_cache_size,
+    cache_eviction_policy_t cache_eviction_policy,
+    bool compress_evicted_pages,
+    const log_serializer_dynamic_config_t &serializer_config,
     const peer_address_set_t &joins,
     service_address_ports_t address_ports,
     std::string web_assets,
@@ -263,7 +266,9 @@ bool do_serve(
 
             if (i_am_a_server) {
                 // Proxies do not have caches to balance
-                cache_balancer.init(new alt_cache_balancer_t(total_cache_size));
+                cache_balancer.init(new alt_cache_balancer_t(total_cache_size,
+                                                             cache_eviction_policy,
+                                                             compress_evicted_pages));
             }
 
             // Reactor drivers
@@ -276,7 +281,7 @@ bool do_serve(
 
             if (i_am_a_server) {
                 dummy_svs_source.init(new file_based_svs_by_namespace_t<mock::dummy_protocol_t>(
-                    io_backender, cache_balancer.get(), base_path));
+                    io_backender, cache_balancer.get(), base_path, serializer_config));
                 dummy_reactor_driver.init(new reactor_driver_t<mock::dummy_protocol_t>(
                     base_path,
                     io_backender,
@@ -309,7 +314,7 @@ bool do_serve(
 
             if (i_am_a_server) {
                 memcached_svs_source.init(new file_based_svs_by_namespace_t<memcached_protocol_t>(
-                    io_backender, cache_balancer.get(), base_path));
+                    io_backender, cache_balancer.get(), base_path, serializer_config));
                 memcached_reactor_driver.init(new reactor_driver_t<memcached_protocol_t>(
                     base_path,
                     io_backender,
@@ -342,7 +347,7 @@ bool do_serve(
 
             if (i_am_a_server) {
                 rdb_svs_source.init(new file_based_svs_by_namespace_t<rdb_protocol_t>(
-                    io_backender, cache_balancer.get(), base_path));
+                    io_backender, cache_balancer.get(), base_path, serializer_config));
                 rdb_reactor_driver.init(new reactor_driver_t<rdb_protocol_t>(
                         base_path,
                         io_backender,
@@ -492,6 +497,9 @@ bool serve(io_backender_t *io_backender,
            metadata_persistence::cluster_persistent_file_t *cluster_persistent_file,
            metadata_persistence::auth_persistent_file_t *auth_persistent_file,
            uint64_t total_cache_size,
+           cache_eviction_policy_t cache_eviction_policy,
+           bool compress_evicted_pages,
+           const log_serializer_dynamic_config_t &serializer_config,
            const peer_address_set_t &joins,
            service_address_ports_t address_ports,
            std::string web_assets,
@@ -503,6 +511,9 @@ bool serve(io_backender_t *io_backender,
                     cluster_persistent_file,
                     auth_persistent_file,
                     total_cache_size,
+                    cache_eviction_policy,
+                    compress_evicted_pages,
+                    serializer_config,
                     joins,
                     address_ports,
                     web_assets,
@@ -523,6 +534,9 @@ bool serve_proxy(const peer_address_set_t &joins,
                     NULL,
                     NULL,
                     0,
+                    cache_eviction_policy_t::random_sample,
+                    false,
+                    log_serializer_dynamic_config_t(),
                     joins,
                     address_ports,
                     web_assets,
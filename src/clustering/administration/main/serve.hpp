@@ -8,6 +8,8 @@
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/persist.hpp"
 #include "arch/address.hpp"
+#include "buffer_cache/alt/eviction_policy.hpp"
+#include "serializer/log/config.hpp"
 
 class os_signal_cond_t;
 
@@ -90,6 +92,9 @@ bool serve(io_backender_t *io_backender,
            metadata_persistence::cluster_persistent_file_t *cluster_persistent_file,
            metadata_persistence::auth_persistent_file_t *auth_persistent_file,
            uint64_t total_cache_size,
+           cache_eviction_policy_t cache_eviction_policy,
+           bool compress_evicted_pages,
+           const log_serializer_dynamic_config_t &serializer_config,
            const peer_address_set_t &joins,
            service_address_ports_t ports,
            std::string web_assets,
@@ -74,8 +74,14 @@ public:
     vclock_t<region_map_t<protocol_t, std::set<machine_id_t> > > secondary_pinnings;
     vclock_t<std::string> primary_key; //TODO this should actually never be changed...
     vclock_t<database_id_t> database;
-
-    RDB_MAKE_ME_SERIALIZABLE_11(blueprint, primary_datacenter, replica_affinities, ack_expectations, shards, name, port, primary_pinnings, secondary_pinnings, primary_key, database);
+    /* The block size (in bytes) that the table's files get created with, or 0 for
+    `DEFAULT_BTREE_BLOCK_SIZE`.  Changing it doesn't affect files that already
+    exist, since a serializer file keeps its block size in its static header.
+    Metadata files from before this field existed get 0 for every namespace (see
+    `metadata_persistence::unsized_cluster_metadata_t`). */
+    vclock_t<int> block_size;
+
+    RDB_MAKE_ME_SERIALIZABLE_12(blueprint, primary_datacenter, replica_affinities, ack_expectations, shards, name, port, primary_pinnings, secondary_pinnings, primary_key, database, block_size);
 };
 
 template <class protocol_t>
@@ -102,13 +108,16 @@ void debug_print(printf_buffer_t *buf, const namespace_semilattice_metadata_t<pr
     debug_print(buf, m.primary_key);
     buf->appendf(", database=");
     debug_print(buf, m.database);
+    buf->appendf(", block_size=");
+    debug_print(buf, m.block_size);
     buf->appendf("}");
 }
 
 template<class protocol_t>
 namespace_semilattice_metadata_t<protocol_t> new_namespace(
     uuid_u machine, uuid_u database, uuid_u datacenter,
-    const name_string_t &name, const std::string &key, int port) {
+    const name_string_t &name, const std::string &key, int port,
+    int block_size = 0) {
 
     namespace_semilattice_metadata_t<protocol_t> ns;
     ns.database           = make_vclock(database, machine);
@@ -116,6 +125,7 @@ namespace_semilattice_metadata_t<protocol_t> new_namespace(
     ns.name               = make_vclock(name, machine);
     ns.primary_key        = make_vclock(key, machine);
     ns.port               = make_vclock(port, machine);
+    ns.block_size         = make_vclock(block_size, machine);
 
     std::map<uuid_u, ack_expectation_t> ack_expectations;
     ack_expectations[datacenter] = ack_expectation_t(1, true);
@@ -138,10 +148,10 @@ namespace_semilattice_metadata_t<protocol_t> new_namespace(
 }
 
 template<class protocol_t>
-RDB_MAKE_SEMILATTICE_JOINABLE_11(namespace_semilattice_metadata_t<protocol_t>, blueprint, primary_datacenter, replica_affinities, ack_expectations, shards, name, port, primary_pinnings, secondary_pinnings, primary_key, database);
+RDB_MAKE_SEMILATTICE_JOINABLE_12(namespace_semilattice_metadata_t<protocol_t>, blueprint, primary_datacenter, replica_affinities, ack_expectations, shards, name, port, primary_pinnings, secondary_pinnings, primary_key, database, block_size);
 
 template<class protocol_t>
-RDB_MAKE_EQUALITY_COMPARABLE_11(namespace_semilattice_metadata_t<protocol_t>, blueprint, primary_datacenter, replica_affinities, ack_expectations, shards, name, port, primary_pinnings, secondary_pinnings, primary_key, database);
+RDB_MAKE_EQUALITY_COMPARABLE_12(namespace_semilattice_metadata_t<protocol_t>, blueprint, primary_datacenter, replica_affinities, ack_expectations, shards, name, port, primary_pinnings, secondary_pinnings, primary_key, database, block_size);
 
 // ctx-less json adapter concept for ack_expectation_t
 json_adapter_if_t::json_adapter_map_t get_json_subfields(ack_expectation_t *target);
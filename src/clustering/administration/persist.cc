@@ -40,6 +40,70 @@ struct cluster_metadata_superblock_t {
 /* Etymology: (R)ethink(D)B (m)eta(d)ata */
 const block_magic_t expected_magic = { { 'R', 'D', 'm', 'd' } };
 
+/* Cluster metadata files whose namespaces have a block size.  Older cluster files
+have `expected_magic`, and their metadata blob is read as an
+`unsized_cluster_metadata_t`. */
+const block_magic_t cluster_metadata_magic = { { 'R', 'D', 'm', 'b' } };
+
+/* Namespace metadata from before namespaces had a block size.  Their files were
+all created with `DEFAULT_BTREE_BLOCK_SIZE`, which a block size of 0 stands for. */
+template <class protocol_t>
+class unsized_namespace_metadata_t {
+public:
+    namespace_semilattice_metadata_t<protocol_t> ns;
+
+    RDB_MAKE_ME_SERIALIZABLE_11(ns.blueprint, ns.primary_datacenter, ns.replica_affinities, ns.ack_expectations, ns.shards, ns.name, ns.port, ns.primary_pinnings, ns.secondary_pinnings, ns.primary_key, ns.database);
+};
+
+template <class protocol_t>
+class unsized_namespaces_metadata_t {
+public:
+    std::map<namespace_id_t, deletable_t<unsized_namespace_metadata_t<protocol_t> > > namespaces;
+
+    RDB_MAKE_ME_SERIALIZABLE_1(namespaces);
+
+    cow_ptr_t<namespaces_semilattice_metadata_t<protocol_t> > with_block_sizes() const {
+        namespaces_semilattice_metadata_t<protocol_t> res;
+        for (auto it = namespaces.begin(); it != namespaces.end(); ++it) {
+            deletable_t<namespace_semilattice_metadata_t<protocol_t> > *ns
+                = &res.namespaces[it->first];
+            if (it->second.is_deleted()) {
+                ns->mark_deleted();
+            } else {
+                *ns = make_deletable(it->second.get_ref().ns);
+                // An unversioned value, which any block size that gets set later
+                // supersedes.
+                ns->get_mutable()->block_size = vclock_t<int>(0);
+            }
+        }
+        return cow_ptr_t<namespaces_semilattice_metadata_t<protocol_t> >(res);
+    }
+};
+
+class unsized_cluster_metadata_t {
+public:
+    unsized_namespaces_metadata_t<mock::dummy_protocol_t> dummy_namespaces;
+    unsized_namespaces_metadata_t<memcached_protocol_t> memcached_namespaces;
+    unsized_namespaces_metadata_t<rdb_protocol_t> rdb_namespaces;
+
+    machines_semilattice_metadata_t machines;
+    datacenters_semilattice_metadata_t datacenters;
+    databases_semilattice_metadata_t databases;
+
+    RDB_MAKE_ME_SERIALIZABLE_6(dummy_namespaces, memcached_namespaces, rdb_namespaces, machines, datacenters, databases);
+
+    cluster_semilattice_metadata_t with_block_sizes() const {
+        cluster_semilattice_metadata_t res;
+        res.dummy_namespaces = dummy_namespaces.with_block_sizes();
+        res.memcached_namespaces = memcached_namespaces.with_block_sizes();
+        res.rdb_namespaces = rdb_namespaces.with_block_sizes();
+        res.machines = machines;
+        res.datacenters = datacenters;
+        res.databases = databases;
+        return res;
+    }
+};
+
 template <class T>
 static void write_blob(buf_parent_t parent, char *ref, int maxreflen,
                        const T &value) {
@@ -237,7 +301,7 @@ cluster_persistent_file_t::cluster_persistent_file_t(io_backender_t *io_backende
         = static_cast<cluster_metadata_superblock_t *>(sb_write.get_data_write());
 
     memset(sb, 0, get_cache_block_size().value());
-    sb->magic = expected_magic;
+    sb->magic = cluster_metadata_magic;
     sb->machine_id = machine_id;
     write_blob(buf_parent_t(&superblock),
                sb->metadata_blob,
@@ -272,10 +336,18 @@ cluster_semilattice_metadata_t cluster_persistent_file_t::read_metadata() {
 
     const cluster_metadata_superblock_t *sb
         = static_cast<const cluster_metadata_superblock_t *>(sb_read.get_data_read());
-    cluster_semilattice_metadata_t metadata;
-    read_blob(buf_parent_t(&superblock), sb->metadata_blob,
-              cluster_metadata_superblock_t::METADATA_BLOB_MAXREFLEN, &metadata);
-    return metadata;
+    if (sb->magic == cluster_metadata_magic) {
+        cluster_semilattice_metadata_t metadata;
+        read_blob(buf_parent_t(&superblock), sb->metadata_blob,
+                  cluster_metadata_superblock_t::METADATA_BLOB_MAXREFLEN, &metadata);
+        return metadata;
+    } else {
+        guarantee(sb->magic == expected_magic, "Unrecognized cluster metadata file.");
+        unsized_cluster_metadata_t metadata;
+        read_blob(buf_parent_t(&superblock), sb->metadata_blob,
+                  cluster_metadata_superblock_t::METADATA_BLOB_MAXREFLEN, &metadata);
+        return metadata.with_block_sizes();
+    }
 }
 
 void cluster_persistent_file_t::update_metadata(const cluster_semilattice_metadata_t &metadata) {
@@ -288,6 +360,8 @@ void cluster_persistent_file_t::update_metadata(const cluster_semilattice_metada
         = static_cast<cluster_metadata_superblock_t *>(sb_write.get_data_write());
     write_blob(buf_parent_t(&superblock), sb->metadata_blob,
                cluster_metadata_superblock_t::METADATA_BLOB_MAXREFLEN, metadata);
+    // The blob is in the current format now, even if the file is older.
+    sb->magic = cluster_metadata_magic;
 }
 
 machine_id_t cluster_persistent_file_t::read_machine_id() {
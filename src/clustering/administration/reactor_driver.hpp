@@ -65,7 +65,10 @@ private:
 template <class protocol_t>
 class svs_by_namespace_t {
 public:
+    // `block_size` is what a new file for the table gets created with (0 meaning
+    // the default); it doesn't matter if the table's file already exists.
     virtual void get_svs(perfmon_collection_t *perfmon_collection, namespace_id_t namespace_id,
+                         int block_size,
                          stores_lifetimer_t<protocol_t> *stores_out,
                          scoped_ptr_t<multistore_ptr_t<protocol_t> > *svs_out,
                          typename protocol_t::context_t *) = 0;
@@ -275,6 +275,20 @@ public:
         return compute_write_durability(peer, namespace_id_, parent_->ack_info->per_thread_ack_info());
     }
 
+    // Computes the block size that a new file for the given table should be
+    // created with, or 0 for the default.
+    static int compute_block_size(const namespace_id_t &namespace_id, per_thread_ack_info_t<protocol_t> *ack_info) {
+        cow_ptr_t<namespaces_semilattice_metadata_t<protocol_t> > nmd = ack_info->get_namespaces_view();
+
+        typename std::map<namespace_id_t, deletable_t<namespace_semilattice_metadata_t<protocol_t> > >::const_iterator ns_it
+            = nmd->namespaces.find(namespace_id);
+
+        if (ns_it == nmd->namespaces.end() || ns_it->second.is_deleted() || ns_it->second.get_ref().block_size.in_conflict()) {
+            return 0;
+        }
+        return ns_it->second.get_ref().block_size.get();
+    }
+
 private:
     typedef boost::optional<directory_echo_wrapper_t<cow_ptr_t<reactor_business_card_t<protocol_t> > > >
         extract_reactor_directory_per_peer_result_type;
@@ -303,7 +317,8 @@ private:
         perfmon_collection_t *serializers_collection = &perfmon_collections->serializers_collection;
 
         // TODO: We probably shouldn't have to pass in this perfmon collection.
-        svs_by_namespace_->get_svs(serializers_collection, namespace_id_, &stores_lifetimer_, &svs_, ctx);
+        const int block_size = compute_block_size(namespace_id_, parent_->ack_info->per_thread_ack_info());
+        svs_by_namespace_->get_svs(serializers_collection, namespace_id_, block_size, &stores_lifetimer_, &svs_, ctx);
 
         auto const extract_reactor_directory_per_peer_fun =
             boost::bind(&watchable_and_reactor_t<protocol_t>::extract_reactor_directory_per_peer,
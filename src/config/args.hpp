@@ -16,7 +16,9 @@
  */
 
 #define SOFTWARE_NAME_STRING "RethinkDB"
-#define SERIALIZER_VERSION_STRING "1.12"
+#define SERIALIZER_VERSION_STRING "1.13"
+// The last version without compressed blocks, which we can still read.
+#define SERIALIZER_UNCOMPRESSED_VERSION_STRING "1.12"
 
 /**
  * Basic configuration parameters.
@@ -45,18 +47,30 @@
 // useful.
 #define DEFAULT_IO_BATCH_FACTOR                   1
 
-// Currently, each cache uses two IO accounts:
-// one account for writes, and one account for reads.
+// Currently, each cache uses three IO accounts:
+// one account for writes, one account for reads, and one for
+// reads that traversals issue ahead of time (prefetches).
 // By adjusting the priorities of these accounts, reads
 // can be prioritized over writes or the other way around.
 #define CACHE_READS_IO_PRIORITY                   (512 / CPU_SHARDING_FACTOR)
 #define CACHE_WRITES_IO_PRIORITY                  (64 / CPU_SHARDING_FACTOR)
+#define CACHE_PREFETCH_IO_PRIORITY                (256 / CPU_SHARDING_FACTOR)
+
+// The most children of an internal node that a depth-first btree traversal
+// prefetches ahead of the one it's in.  It starts out prefetching one child
+// ahead and doubles that with every child it visits, so that short range
+// reads don't load much more than they need.
+#define BTREE_PREFETCH_MAX_CHILDREN               16
 
 // The cache priority to use for secondary index post construction
 // 100 = same priority as all other read operations in the cache together.
 // 0 = minimal priority
 #define SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY   5
 
+// How much memory a secondary index that is built in bulk may use for sorting its
+// keys before they go to disk.
+#define SINDEX_BULK_BUILD_SORT_MEMORY             (32 * MEGABYTE)
+
 // Garbage Collection uses its own two IO accounts.
 // There is one low-priority account that is meant to guarantee
 // (performance-wise) unintrusive garbage collection.
@@ -82,6 +96,12 @@
 // Size of each btree node (in bytes) on disk
 #define DEFAULT_BTREE_BLOCK_SIZE                  (4 * KILOBYTE)
 
+// The range of btree block sizes (in bytes) a table can be created with.  Leaf
+// and internal nodes address their contents with uint16_t offsets, so blocks can't
+// get any larger than 64 KB.
+#define MIN_BTREE_BLOCK_SIZE                      (4 * KILOBYTE)
+#define MAX_BTREE_BLOCK_SIZE                      (64 * KILOBYTE)
+
 // Size of each extent (in bytes)
 #define DEFAULT_EXTENT_SIZE                       (512 * KILOBYTE)
 
@@ -166,6 +186,16 @@
 #define GC_YOUNG_EXTENT_MAX_SIZE                  50
 // What's the definition of a "young" extent in microseconds?
 #define GC_YOUNG_EXTENT_TIMELIMIT_MICROS          50000
+// How often the GC recomputes the cost-benefit scores of all old extents.  In
+// between, an extent's score is only recomputed when some of its blocks become
+// garbage, relative to the time of the last full rescoring.
+#define GC_RESCORE_INTERVAL_MICROS                (5 * MILLION)
+
+// How fast the GC may move live data (in bytes per second) while the garbage ratio
+// is between the low and the high ratio.  Above the high ratio the GC isn't
+// throttled at all.
+#define DEFAULT_GC_MIN_BYTES_PER_SEC              (2 * MEGABYTE)
+#define DEFAULT_GC_MAX_BYTES_PER_SEC              (128 * MEGABYTE)
 
 // If the size of the LBA on a given disk exceeds LBA_MIN_SIZE_FOR_GC, then the fraction of the
 // entries that are live and not garbage should be at least LBA_MIN_UNGARBAGE_FRACTION.
@@ -203,6 +233,10 @@
 // freed. This value is per thread.
 #define COROUTINE_FREE_LIST_SIZE                  64
 
+// How many freed `ql::datum_t`s to keep around (maximally) for reuse by new ones.
+// This value is per thread.
+#define DATUM_FREE_LIST_SIZE                      4096
+
 #define MAX_COROS_PER_THREAD                      10000
 
 
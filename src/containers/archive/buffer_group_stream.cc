@@ -29,6 +29,21 @@ int64_t buffer_group_read_stream_t::read(void *p, int64_t n) {
     return original_n - n;
 }
 
+bool buffer_group_read_stream_t::seek(int64_t offset) {
+    bufnum_ = 0;
+    bufpos_ = 0;
+    while (bufnum_ < group_->num_buffers()) {
+        const int64_t size = group_->get_buffer(bufnum_).size;
+        if (offset < size) {
+            bufpos_ = offset;
+            return true;
+        }
+        offset -= size;
+        ++bufnum_;
+    }
+    return offset == 0;
+}
+
 bool buffer_group_read_stream_t::entire_stream_consumed() const {
     return bufnum_ == group_->num_buffers();
 }
@@ -15,6 +15,10 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
 
+    // Makes the next read start `offset` bytes into the buffer group.  Returns false
+    // if the buffer group is shorter than that.
+    MUST_USE bool seek(int64_t offset);
+
     bool entire_stream_consumed() const;
 
 private:
@@ -0,0 +1,203 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_EXTERNAL_SORTER_HPP_
+#define CONTAINERS_EXTERNAL_SORTER_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "containers/disk_backed_queue.hpp"
+#include "containers/scoped.hpp"
+#include "containers/uuid.hpp"
+#include "utils.hpp"
+
+/* Sorts more items than fit in memory.  Items are collected in memory until they
+take up `max_memory_bytes`; then they get sorted and written out as a run (an
+internal_disk_backed_queue_t, whose file is gone as soon as the queue is).  Once all
+items have been added, the runs are merged, at most `MAX_MERGE_FAN_IN` at a time, and
+the items come out in ascending order.  If there never was a run, nothing touches
+the disk at all.
+
+`T` has to be serializable.  Equal items come out in no particular order. */
+template <class T, class less_t = std::less<T> >
+class external_sorter_t {
+public:
+    static const size_t MAX_MERGE_FAN_IN = 16;
+
+    // Runs get files called `name` plus a uuid in `base_path`.
+    external_sorter_t(io_backender_t *io_backender, const base_path_t &base_path,
+                      const std::string &name, perfmon_collection_t *stats_parent,
+                      size_t max_memory_bytes)
+        : io_backender_(io_backender), base_path_(base_path), name_(name),
+          stats_parent_(stats_parent), max_memory_bytes_(max_memory_bytes),
+          memory_bytes_(0), finished_(false), next_in_memory_(0) { }
+
+    // `size` is about how much memory the item takes up.  This blocks while a run
+    // gets written, and may be called by several coroutines at once.
+    void add(const T &item, size_t size) {
+        guarantee(!finished_);
+        in_memory_.push_back(item);
+        memory_bytes_ += size;
+        if (memory_bytes_ >= max_memory_bytes_) {
+            std::vector<T> items;
+            items.swap(in_memory_);
+            memory_bytes_ = 0;
+            runs_.push_back(write_run(&items));
+        }
+    }
+
+    // Must be called after the last `add` has returned and before `next`.  Does all
+    // but the last merge pass.
+    void finish() {
+        guarantee(!finished_);
+        finished_ = true;
+        std::sort(in_memory_.begin(), in_memory_.end(), less_t());
+        if (runs_.empty()) {
+            return;
+        }
+
+        if (!in_memory_.empty()) {
+            runs_.push_back(write_run(&in_memory_));
+        }
+        while (runs_.size() > MAX_MERGE_FAN_IN) {
+            std::vector<scoped_ptr_t<internal_disk_backed_queue_t> > group;
+            for (size_t i = 0; i < MAX_MERGE_FAN_IN; ++i) {
+                group.push_back(std::move(runs_[i]));
+            }
+            runs_.erase(runs_.begin(), runs_.begin() + MAX_MERGE_FAN_IN);
+
+            merger_t merger(std::move(group));
+            scoped_ptr_t<internal_disk_backed_queue_t> merged = new_run();
+            std::vector<T> chunk;
+            T item;
+            while (merger.next(&item)) {
+                chunk.push_back(item);
+                if (chunk.size() == RUN_WRITE_CHUNK_SIZE) {
+                    push_chunk(merged.get(), &chunk);
+                }
+            }
+            push_chunk(merged.get(), &chunk);
+            runs_.push_back(std::move(merged));
+        }
+        merger_.init(new merger_t(std::move(runs_)));
+    }
+
+    // Returns false once every item has been returned.
+    bool next(T *out) {
+        guarantee(finished_);
+        if (merger_.has()) {
+            return merger_->next(out);
+        }
+        if (next_in_memory_ == in_memory_.size()) {
+            return false;
+        }
+        *out = in_memory_[next_in_memory_];
+        ++next_in_memory_;
+        return true;
+    }
+
+private:
+    // How many items go to disk in one transaction.
+    static const size_t RUN_WRITE_CHUNK_SIZE = 1000;
+
+    class merger_t {
+    public:
+        explicit merger_t(std::vector<scoped_ptr_t<internal_disk_backed_queue_t> > &&runs)
+            : runs_(std::move(runs)) {
+            for (size_t i = 0; i < runs_.size(); ++i) {
+                pop_head(i);
+            }
+        }
+
+        bool next(T *out) {
+            if (heads_.empty()) {
+                return false;
+            }
+            const size_t run = heads_.top().second;
+            *out = heads_.top().first;
+            heads_.pop();
+            pop_head(run);
+            return true;
+        }
+
+    private:
+        typedef std::pair<T, size_t> head_t;
+
+        // Puts the smallest head on top of the priority queue.
+        struct head_greater_t {
+            bool operator()(const head_t &a, const head_t &b) const {
+                return less_t()(b.first, a.first);
+            }
+        };
+
+        void pop_head(size_t run) {
+            if (!runs_[run]->empty()) {
+                head_t head;
+                head.second = run;
+                deserializing_viewer_t<T> viewer(&head.first);
+                runs_[run]->pop(&viewer);
+                heads_.push(head);
+            }
+        }
+
+        std::vector<scoped_ptr_t<internal_disk_backed_queue_t> > runs_;
+        std::priority_queue<head_t, std::vector<head_t>, head_greater_t> heads_;
+
+        DISABLE_COPYING(merger_t);
+    };
+
+    scoped_ptr_t<internal_disk_backed_queue_t> new_run() {
+        return make_scoped<internal_disk_backed_queue_t>(
+            io_backender_,
+            serializer_filepath_t(base_path_, name_ + "_" + uuid_to_str(generate_uuid())),
+            stats_parent_);
+    }
+
+    scoped_ptr_t<internal_disk_backed_queue_t> write_run(std::vector<T> *items) {
+        std::sort(items->begin(), items->end(), less_t());
+        scoped_ptr_t<internal_disk_backed_queue_t> run = new_run();
+        std::vector<T> chunk;
+        for (auto it = items->begin(); it != items->end(); ++it) {
+            chunk.push_back(*it);
+            if (chunk.size() == RUN_WRITE_CHUNK_SIZE) {
+                push_chunk(run.get(), &chunk);
+            }
+        }
+        push_chunk(run.get(), &chunk);
+        items->clear();
+        return run;
+    }
+
+    static void push_chunk(internal_disk_backed_queue_t *run, std::vector<T> *chunk) {
+        if (chunk->empty()) {
+            return;
+        }
+        scoped_array_t<write_message_t> wms(chunk->size());
+        for (size_t i = 0; i < chunk->size(); ++i) {
+            wms[i] << (*chunk)[i];
+        }
+        run->push(wms);
+        chunk->clear();
+    }
+
+    io_backender_t *const io_backender_;
+    const base_path_t base_path_;
+    const std::string name_;
+    perfmon_collection_t *const stats_parent_;
+    const size_t max_memory_bytes_;
+
+    std::vector<T> in_memory_;
+    size_t memory_bytes_;
+    std::vector<scoped_ptr_t<internal_disk_backed_queue_t> > runs_;
+
+    bool finished_;
+    size_t next_in_memory_;
+    scoped_ptr_t<merger_t> merger_;
+
+    DISABLE_COPYING(external_sorter_t);
+};
+
+#endif  // CONTAINERS_EXTERNAL_SORTER_HPP_
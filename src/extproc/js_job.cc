@@ -445,7 +445,7 @@ counted_t<const ql::datum_t> js_make_datum(const v8::Handle<v8::Value> &value,
             v8::Handle<v8::Array> properties = objh->GetPropertyNames();
             guarantee(!properties.IsEmpty());
 
-            std::map<std::string, counted_t<const ql::datum_t> > datum_map;
+            ql::datum_object_t datum_object;
 
             uint32_t len = properties->Length();
             for (uint32_t i = 0; i < len; ++i) {
@@ -466,9 +466,15 @@ counted_t<const ql::datum_t> js_make_datum(const v8::Handle<v8::Value> &value,
                 keyh->WriteUtf8(temp_buffer.data(), length);
                 std::string key_string(temp_buffer.data(), length);
 
-                datum_map.insert(std::make_pair(key_string, item));
+                datum_object.append_unsorted(std::move(key_string), std::move(item));
             }
-            result = make_counted<const ql::datum_t>(std::move(datum_map));
+            // V8 lists each property name once, so this shouldn't happen.
+            std::string duplicate;
+            if (!datum_object.sort_fields(&duplicate)) {
+                errmsg->assign("Duplicate key `" + duplicate + "` in JavaScript object.");
+                return result;
+            }
+            result = make_counted<const ql::datum_t>(std::move(datum_object));
         }
     } else if (value->IsNumber()) {
         double num_val = value->NumberValue();
@@ -537,7 +543,7 @@ v8::Handle<v8::Value> js_from_datum(const counted_t<const ql::datum_t> &datum) {
             return date;
         } else {
             v8::Handle<v8::Object> obj = v8::Object::New();
-            const std::map<std::string, counted_t<const ql::datum_t> > &source_map = datum->as_object();
+            const ql::datum_object_t &source_map = datum->as_object();
 
             for (auto it = source_map.begin(); it != source_map.end(); ++it) {
                 DECLARE_HANDLE_SCOPE(scope);
@@ -1,12 +1,16 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/btree.hpp"
 
+#include <algorithm>
 #include <functional>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "btree/backfill.hpp"
+#include "btree/bulk_load.hpp"
 #include "btree/concurrent_traversal.hpp"
+#include "btree/depth_first_traversal.hpp"
 #include "btree/erase_range.hpp"
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
@@ -14,7 +18,9 @@
 #include "buffer_cache/alt/alt_serialize_onto_blob.hpp"
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
+#include "containers/archive/stl_types.hpp"
 #include "containers/archive/vector_stream.hpp"
+#include "containers/external_sorter.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/blob_wrapper.hpp"
 #include "rdb_protocol/func.hpp"
@@ -63,6 +69,22 @@ void actually_delete_rdb_value(buf_parent_t parent, void *value) {
     blob.clear(parent);
 }
 
+/* The keys of a covering secondary index (see `make_covered_sindex_value`) can have
+a small blob that starts with the value of the row, which is always a large blob ref,
+while every other small value starts with a serialized datum.  Returns the row's value
+if `value` is such a blob, and NULL otherwise. */
+const rdb_value_t *covered_sindex_row_value(const rdb_value_t *value) {
+    const char *ref = value->value_ref();
+    if (!blob::is_small(ref, blob::btree_maxreflen) || value->value_size() == 0) {
+        return NULL;
+    }
+    const char *data = blob::small_buffer(ref, blob::btree_maxreflen);
+    if (blob::is_small(data, blob::btree_maxreflen)) {
+        return NULL;
+    }
+    return reinterpret_cast<const rdb_value_t *>(data);
+}
+
 void detach_rdb_value(buf_parent_t parent, const void *value) {
     // This const_cast is ok, since `detach_subtrees` is one of the operations
     // that does not actually change value.
@@ -71,6 +93,37 @@ void detach_rdb_value(buf_parent_t parent, const void *value) {
                 static_cast<rdb_value_t *>(non_const_value)->value_ref(),
                 blob::btree_maxreflen);
     blob.detach_subtrees(parent);
+
+    // The entry of a covering index refers to the row's blob from within its own.
+    const rdb_value_t *row_value
+        = covered_sindex_row_value(static_cast<const rdb_value_t *>(value));
+    if (row_value != NULL) {
+        detach_rdb_value(parent, row_value);
+    }
+}
+
+/* Reads the index value and the covered fields of an entry that
+`make_covered_sindex_value` made, or returns false if `value` is just a copy of the
+row's value. */
+bool read_covered_sindex_value(const rdb_value_t *value, block_size_t block_size,
+                               counted_t<const ql::datum_t> *index_val_out,
+                               counted_t<const ql::datum_t> *fields_out) {
+    const rdb_value_t *row_value = covered_sindex_row_value(value);
+    if (row_value == NULL) {
+        return false;
+    }
+    const char *data = blob::small_buffer(value->value_ref(), blob::btree_maxreflen);
+    const int row_value_size = row_value->inline_size(block_size);
+    std::vector<char> entry_data(data + row_value_size, data + value->value_size());
+
+    counted_t<const ql::datum_t> entry;
+    inplace_vector_read_stream_t read_stream(&entry_data);
+    archive_result_t res = deserialize(&read_stream, &entry);
+    guarantee_deserialization(res, "covered sindex value");
+    guarantee(entry->get_type() == ql::datum_t::R_ARRAY && entry->size() == 2);
+    *index_val_out = entry->get(0);
+    *fields_out = entry->get(1);
+    return true;
 }
 
 void rdb_get(const store_key_t &store_key, btree_slice_t *slice,
@@ -130,7 +183,8 @@ void kv_location_set(keyvalue_location_t<rdb_value_t> *kv_location,
     const block_size_t block_size = kv_location->buf.cache()->get_block_size();
     {
         blob_t blob(block_size, new_value->value_ref(), blob::btree_maxreflen);
-        serialize_onto_blob(buf_parent_t(&kv_location->buf), &blob, data);
+        serialize_onto_blob(buf_parent_t(&kv_location->buf), &blob,
+                            ql::row_datum_t(data));
     }
 
     if (mod_info_out) {
@@ -180,6 +234,37 @@ void kv_location_set(keyvalue_location_t<rdb_value_t> *kv_location,
                           deletion_context->balancing_detacher(), &null_cb);
 }
 
+/* Checks that `new_val` may replace `old_val` (which is null if `started_empty`) as
+the row with the key `key`, and returns whether the replacement deletes the row. */
+bool check_replacement_value(const counted_t<const ql::datum_t> &old_val,
+                             bool started_empty,
+                             const counted_t<const ql::datum_t> &new_val,
+                             const store_key_t &key,
+                             const std::string &primary_key) {
+    if (new_val->get_type() == ql::datum_t::R_NULL) {
+        return true;
+    } else if (new_val->get_type() == ql::datum_t::R_OBJECT) {
+        new_val->rcheck_valid_replace(
+            old_val, counted_t<const ql::datum_t>(), primary_key);
+        counted_t<const ql::datum_t> pk = new_val->get(primary_key, ql::NOTHROW);
+        rcheck_target(
+            new_val, ql::base_exc_t::GENERIC,
+            key.compare(store_key_t(pk->print_primary())) == 0,
+            (started_empty
+             ? strprintf("Primary key `%s` cannot be changed (null -> %s)",
+                         primary_key.c_str(), new_val->print().c_str())
+             : strprintf("Primary key `%s` cannot be changed (%s -> %s)",
+                         primary_key.c_str(),
+                         old_val->print().c_str(), new_val->print().c_str())));
+        return false;
+    } else {
+        rfail_typed_target(
+            new_val, "Inserted value must be an OBJECT (got %s):\n%s",
+            new_val->get_type_name().c_str(), new_val->print().c_str());
+    }
+    unreachable();
+}
+
 batched_replace_response_t rdb_replace_and_return_superblock(
     const btree_loc_info_t &info,
     const btree_point_replacer_t *replacer,
@@ -226,27 +311,8 @@ batched_replace_response_t rdb_replace_and_return_superblock(
             bool conflict = resp.add("new_val", new_val, ql::CLOBBER);
             guarantee(conflict); // We set it to `old_val` previously.
         }
-        if (new_val->get_type() == ql::datum_t::R_NULL) {
-            ended_empty = true;
-        } else if (new_val->get_type() == ql::datum_t::R_OBJECT) {
-            ended_empty = false;
-            new_val->rcheck_valid_replace(
-                old_val, counted_t<const ql::datum_t>(), primary_key);
-            counted_t<const ql::datum_t> pk = new_val->get(primary_key, ql::NOTHROW);
-            rcheck_target(
-                new_val, ql::base_exc_t::GENERIC,
-                key.compare(store_key_t(pk->print_primary())) == 0,
-                (started_empty
-                 ? strprintf("Primary key `%s` cannot be changed (null -> %s)",
-                             primary_key.c_str(), new_val->print().c_str())
-                 : strprintf("Primary key `%s` cannot be changed (%s -> %s)",
-                             primary_key.c_str(),
-                             old_val->print().c_str(), new_val->print().c_str())));
-        } else {
-            rfail_typed_target(
-                new_val, "Inserted value must be an OBJECT (got %s):\n%s",
-                new_val->get_type_name().c_str(), new_val->print().c_str());
-        }
+        ended_empty = check_replacement_value(old_val, started_empty, new_val, key,
+                                              primary_key);
 
         // We use `conflict` below to store whether or not there was a key
         // conflict when constructing the stats object.  It defaults to `true`
@@ -394,9 +460,135 @@ batched_replace_response_t rdb_batched_replace(
             current_superblock.init(superblock_promise.wait());
         }
     } // Make sure the drainer is destructed before the return statement.
+
+    // The secondary indexes are updated for the whole batch at once, so that each
+    // index gets its changes in key order.
+    sindex_cb->update_sindexes();
     return stats;
 }
 
+/* Hands the keys that rdb_batched_bulk_load couldn't append over to the original
+replacer. */
+class subset_replacer_t : public btree_batched_replacer_t {
+public:
+    subset_replacer_t(const btree_batched_replacer_t *_replacer,
+                      const std::vector<size_t> *_indexes)
+        : replacer(_replacer), indexes(_indexes) { }
+
+    counted_t<const ql::datum_t> replace(
+        const counted_t<const ql::datum_t> &d, size_t index) const {
+        return replacer->replace(d, (*indexes)[index]);
+    }
+    bool should_return_vals() const { return replacer->should_return_vals(); }
+private:
+    const btree_batched_replacer_t *const replacer;
+    const std::vector<size_t> *const indexes;
+};
+
+struct key_index_less_t {
+    explicit key_index_less_t(const std::vector<store_key_t> *_keys) : keys(_keys) { }
+    bool operator()(size_t a, size_t b) const { return (*keys)[a] < (*keys)[b]; }
+    const std::vector<store_key_t> *keys;
+};
+
+batched_replace_response_t rdb_batched_bulk_load(
+    const btree_info_t &info,
+    scoped_ptr_t<superblock_t> *superblock,
+    const std::vector<store_key_t> &keys,
+    const btree_batched_replacer_t *replacer,
+    rdb_modification_report_cb_t *sindex_cb,
+    profile::trace_t *trace) {
+    // Only single-row writes can return values, so there's nothing to gain from
+    // appending; the replace path fills in `old_val` and `new_val`.
+    if (replacer->should_return_vals()) {
+        return rdb_batched_replace(info, superblock, keys, replacer, sindex_cb, trace);
+    }
+
+    const std::string &primary_key = *info.primary_key;
+    ql::datum_ptr_t resp(ql::datum_t::R_OBJECT);
+    int64_t num_inserted = 0;
+    int64_t num_skipped = 0;
+
+    // Go through the keys in order.  The first occurrence of each key that sorts
+    // after everything in the tree gets appended; everything else (including
+    // later occurrences, so that they see the earlier ones) gets replaced.
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), key_index_less_t(&keys));
+
+    std::vector<size_t> remaining;
+    {
+        const block_size_t block_size = (*superblock)->cache()->get_block_size();
+        value_sizer_t<rdb_value_t> sizer(block_size);
+        btree_bulk_loader_t loader(&sizer, superblock->get(), &info.slice->stats);
+        for (auto it = order.begin(); it != order.end(); ++it) {
+            const store_key_t &key = keys[*it];
+            if (!loader.can_append(key.btree_key())) {
+                remaining.push_back(*it);
+                continue;
+            }
+
+            counted_t<const ql::datum_t> new_val;
+            try {
+                counted_t<const ql::datum_t> old_val
+                    = make_counted<ql::datum_t>(ql::datum_t::R_NULL);
+                new_val = replacer->replace(old_val, *it);
+                if (check_replacement_value(old_val, true, new_val, key,
+                                            primary_key)) {
+                    ++num_skipped;
+                    continue;
+                }
+            } catch (const ql::base_exc_t &e) {
+                resp.add_error(e.what());
+                continue;
+            }
+
+            scoped_malloc_t<rdb_value_t> new_value(blob::btree_maxreflen);
+            memset(new_value.get(), 0, blob::btree_maxreflen);
+            {
+                blob_t blob(block_size, new_value->value_ref(), blob::btree_maxreflen);
+                serialize_onto_blob(loader.rightmost_leaf(), &blob,
+                                    ql::row_datum_t(new_val));
+            }
+            loader.append(key.btree_key(), new_value.get(), info.timestamp);
+            ++num_inserted;
+
+            rdb_modification_report_t mod_report(key);
+            mod_report.info.added = std::make_pair(
+                new_val,
+                std::vector<char>(new_value->value_ref(),
+                    new_value->value_ref() + new_value->inline_size(block_size)));
+            sindex_cb->on_mod_report(mod_report);
+        }
+    }
+
+    if (num_inserted != 0) {
+        bool conflict = resp.add("inserted",
+                                 make_counted<ql::datum_t>(
+                                     static_cast<double>(num_inserted)));
+        guarantee(!conflict);
+    }
+    if (num_skipped != 0) {
+        bool conflict = resp.add("skipped",
+                                 make_counted<ql::datum_t>(
+                                     static_cast<double>(num_skipped)));
+        guarantee(!conflict);
+    }
+
+    // This also updates the secondary indexes for the rows appended above.
+    std::vector<store_key_t> remaining_keys;
+    remaining_keys.reserve(remaining.size());
+    for (auto it = remaining.begin(); it != remaining.end(); ++it) {
+        remaining_keys.push_back(keys[*it]);
+    }
+    subset_replacer_t subset_replacer(replacer, &remaining);
+    batched_replace_response_t stats = rdb_batched_replace(
+        info, superblock, remaining_keys, &subset_replacer, sindex_cb, trace);
+    return resp.to_counted()->merge(stats, ql::stats_merge);
+}
+
 void rdb_set(const store_key_t &key,
              counted_t<const ql::datum_t> data,
              bool overwrite,
@@ -754,17 +946,60 @@ typedef rdb_protocol_details::terminal_variant_t terminal_variant_t;
 class sindex_data_t {
 public:
     sindex_data_t(const key_range_t &_pkey_range, const datum_range_t &_range,
-                  ql::map_wire_func_t wire_func, sindex_multi_bool_t _multi)
+                  ql::map_wire_func_t wire_func, sindex_multi_bool_t _multi,
+                  bool _covers_read)
         : pkey_range(_pkey_range), range(_range),
-          func(wire_func.compile_wire_func()), multi(_multi) { }
+          func(wire_func.compile_wire_func()), multi(_multi),
+          covers_read(_covers_read) { }
 private:
     friend class rget_cb_t;
     const key_range_t pkey_range;
     const datum_range_t range;
     const counted_t<ql::func_t> func;
     const sindex_multi_bool_t multi;
+    // Whether the read can use the covered fields instead of the rows.
+    const bool covers_read;
 };
 
+/* If a read with `transforms` and `terminal` only looks at some fields of the rows,
+which means it gives the same result when it only gets those fields, adds them to
+`fields_out` and returns true. */
+bool rget_fields_read(const std::vector<transform_variant_t> &transforms,
+                      const boost::optional<terminal_variant_t> &terminal,
+                      std::set<std::string> *fields_out) {
+    for (auto it = transforms.begin(); it != transforms.end(); ++it) {
+        // The transforms after a `map` or `concat_map` don't get the rows anymore.
+        if (const ql::map_wire_func_t *map = boost::get<ql::map_wire_func_t>(&*it)) {
+            return ql::func_fields_read(map->compile_wire_func(), fields_out);
+        } else if (const ql::concatmap_wire_func_t *concatmap
+                   = boost::get<ql::concatmap_wire_func_t>(&*it)) {
+            return ql::func_fields_read(concatmap->compile_wire_func(), fields_out);
+        } else if (const ql::filter_wire_func_t *filter
+                   = boost::get<ql::filter_wire_func_t>(&*it)) {
+            if (!ql::func_fields_read(filter->filter_func.compile_wire_func(),
+                                      fields_out)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    // Otherwise the rows themselves end up in the result, unless we just count them.
+    return terminal && boost::get<ql::count_wire_func_t>(&*terminal) != NULL;
+}
+
+/* Whether a read with `transforms` and `terminal` gives the same result when it gets
+just the `covered_fields` of the rows, because it only looks at those. */
+bool sindex_covers_read(const std::set<std::string> &covered_fields,
+                        const std::vector<transform_variant_t> &transforms,
+                        const boost::optional<terminal_variant_t> &terminal) {
+    std::set<std::string> fields_read;
+    return !covered_fields.empty()
+        && rget_fields_read(transforms, terminal, &fields_read)
+        && std::includes(covered_fields.begin(), covered_fields.end(),
+                         fields_read.begin(), fields_read.end());
+}
+
 class job_data_t {
 public:
     job_data_t(ql::env_t *_env, const ql::batchspec_t &batchspec,
@@ -776,7 +1011,8 @@ public:
           sorting(_sorting),
           accumulator(_terminal
                       ? ql::make_terminal(env, *_terminal)
-                      : ql::make_append(sorting, &batcher)) {
+                      : ql::make_append(sorting, &batcher)),
+          reads_row_fields(rget_fields_read(_transforms, _terminal, &row_fields)) {
         for (size_t i = 0; i < _transforms.size(); ++i) {
             transformers.emplace_back(ql::make_op(env, _transforms[i]));
         }
@@ -787,7 +1023,9 @@ public:
           batcher(std::move(jd.batcher)),
           transformers(std::move(jd.transformers)),
           sorting(jd.sorting),
-          accumulator(jd.accumulator.release()) {
+          accumulator(jd.accumulator.release()),
+          row_fields(std::move(jd.row_fields)),
+          reads_row_fields(jd.reads_row_fields) {
     }
 private:
     friend class rget_cb_t;
@@ -796,6 +1034,9 @@ private:
     std::vector<scoped_ptr_t<ql::op_t> > transformers;
     sorting_t sorting;
     scoped_ptr_t<ql::accumulator_t> accumulator;
+    // If `reads_row_fields` is true, only the `row_fields` of the rows get used.
+    std::set<std::string> row_fields;
+    bool reads_row_fields;
 };
 
 class io_data_t {
@@ -838,6 +1079,11 @@ rget_cb_t::rget_cb_t(io_data_t &&_io,
       job(std::move(_job)),
       sindex(std::move(_sindex)),
       bad_init(false) {
+    // Reads of a secondary index also use the rows to compute the index values.
+    if (sindex && job.reads_row_fields
+        && !ql::func_fields_read(sindex->func, &job.row_fields)) {
+        job.reads_row_fields = false;
+    }
     io.response->last_key = !reversed(job.sorting)
         ? range.left
         : (!range.right.unbounded ? range.right.key : store_key_t::max());
@@ -869,17 +1115,27 @@ THROWS_ONLY(interrupted_exc_t) {
         return done_traversing_t::NO;
     }
 
-    lazy_json_t row(static_cast<const rdb_value_t *>(keyvalue.value()),
-                    keyvalue.expose_buf());
+    const rdb_value_t *value = static_cast<const rdb_value_t *>(keyvalue.value());
     counted_t<const ql::datum_t> val;
-    // We only load the value if we actually use it (`count` does not).
-    if (job.accumulator->uses_val() || job.transformers.size() != 0 || sindex) {
-        val = row.get();
+    counted_t<const ql::datum_t> sindex_val; // NULL if no sindex.
+    if (sindex && sindex->covers_read
+        && read_covered_sindex_value(value,
+                                     keyvalue.expose_buf().cache()->get_block_size(),
+                                     &sindex_val, &val)) {
+        // The entry of the covering index has everything the read needs.
         io.slice->stats.pm_keys_read.record();
     } else {
-        row.reset();
+        const rdb_value_t *row_value = sindex ? covered_sindex_row_value(value) : NULL;
+        lazy_json_t row(row_value != NULL ? row_value : value, keyvalue.expose_buf());
+        // We only load the value if we actually use it (`count` does not).
+        if (job.accumulator->uses_val() || job.transformers.size() != 0 || sindex) {
+            val = job.reads_row_fields ? row.get_fields(job.row_fields) : row.get();
+            io.slice->stats.pm_keys_read.record();
+        } else {
+            row.reset();
+        }
+        guarantee(!row.references_parent());
     }
-    guarantee(!row.references_parent());
     keyvalue.reset();
     waiter.wait_interruptible();
 
@@ -891,15 +1147,17 @@ THROWS_ONLY(interrupted_exc_t) {
         }
 
         // Check whether we're out of sindex range.
-        counted_t<const ql::datum_t> sindex_val; // NULL if no sindex.
         if (sindex) {
-            sindex_val = sindex->func->call(job.env, val)->as_datum();
-            if (sindex->multi == sindex_multi_bool_t::MULTI
-                && sindex_val->get_type() == ql::datum_t::R_ARRAY) {
-                boost::optional<uint64_t> tag = *ql::datum_t::extract_tag(key);
-                guarantee(tag);
-                sindex_val = sindex_val->get(*tag, ql::NOTHROW);
-                guarantee(sindex_val);
+            // Entries of covering indexes store the index value.
+            if (!sindex_val.has()) {
+                sindex_val = sindex->func->call(job.env, val)->as_datum();
+                if (sindex->multi == sindex_multi_bool_t::MULTI
+                    && sindex_val->get_type() == ql::datum_t::R_ARRAY) {
+                    boost::optional<uint64_t> tag = *ql::datum_t::extract_tag(key);
+                    guarantee(tag);
+                    sindex_val = sindex_val->get(*tag, ql::NOTHROW);
+                    guarantee(sindex_val);
+                }
             }
             if (!sindex->range.contains(sindex_val)) {
                 return done_traversing_t::NO;
@@ -965,13 +1223,18 @@ void rdb_rget_secondary_slice(
     sorting_t sorting,
     const ql::map_wire_func_t &sindex_func,
     sindex_multi_bool_t sindex_multi,
+    const std::vector<std::string> &sindex_covered_fields,
     rget_read_response_t *response) {
     r_sanity_check(boost::get<ql::exc_t>(&response->result) == NULL);
     profile::starter_t starter("Do range scan on secondary index.", ql_env->trace);
+    const bool covers_read = sindex_covers_read(
+        std::set<std::string>(sindex_covered_fields.begin(),
+                              sindex_covered_fields.end()),
+        transforms, terminal);
     rget_cb_t callback(
         io_data_t(response, slice),
         job_data_t(ql_env, batchspec, transforms, terminal, sorting),
-        sindex_data_t(pk_range, sindex_range, sindex_func, sindex_multi),
+        sindex_data_t(pk_range, sindex_range, sindex_func, sindex_multi, covers_read),
         sindex_region.inner);
     btree_concurrent_traversal(
         superblock, sindex_region.inner, &callback,
@@ -979,6 +1242,42 @@ void rdb_rget_secondary_slice(
     callback.finish();
 }
 
+bool rdb_rget_is_plain_count(const std::vector<transform_variant_t> &transforms,
+                             const boost::optional<terminal_variant_t> &terminal) {
+    return transforms.empty()
+        && terminal && boost::get<ql::count_wire_func_t>(&*terminal) != NULL;
+}
+
+void rdb_count_slice(
+    superblock_t *superblock,
+    const key_range_t &range,
+    bool whole_btree,
+    ql::env_t *ql_env,
+    sorting_t sorting,
+    rget_read_response_t *response) {
+    r_sanity_check(boost::get<ql::exc_t>(&response->result) == NULL);
+    uint64_t count;
+    if (whole_btree) {
+        profile::starter_t starter("Read key count of index.", ql_env->trace);
+        const int64_t population = get_btree_population(superblock);
+        superblock->release();
+        guarantee(population >= 0);
+        count = population;
+    } else {
+        profile::starter_t starter("Count keys of index range.", ql_env->trace);
+        count = btree_count_keys(superblock, range, ql_env->trace.get_or_null());
+    }
+
+    // This is what the `count` terminal would have produced.
+    ql::grouped_t<uint64_t> result;
+    if (count != 0) {
+        result[counted_t<const ql::datum_t>()] = count;
+    }
+    response->result = result;
+    response->last_key = key_max(sorting);
+    response->truncated = false;
+}
+
 void rdb_distribution_get(int max_depth,
                           const store_key_t &left_key,
                           superblock_t *superblock,
@@ -1071,132 +1370,309 @@ void rdb_modification_report_cb_t::on_mod_report(
     wm << rdb_sindex_change_t(mod_report);
     store_->sindex_queue_push(wm, acq.get());
 
+    mod_reports_.push_back(mod_report);
+}
+
+void rdb_modification_report_cb_t::update_sindexes() {
     rdb_live_deletion_context_t deletion_context;
-    rdb_update_sindexes(sindexes_, &mod_report, sindex_block_->txn(),
+    rdb_update_sindexes(sindexes_, mod_reports_, sindex_block_->txn(),
                         &deletion_context);
+    mod_reports_.clear();
 }
 
 typedef btree_store_t<rdb_protocol_t>::sindex_access_vector_t sindex_access_vector_t;
 
+/* Computes the keys of `doc` in an index, and the index value that each of them is
+for (which is only different from key to key in a multi index). */
 void compute_keys(const store_key_t &primary_key, counted_t<const ql::datum_t> doc,
-                  ql::map_wire_func_t *mapping, sindex_multi_bool_t multi, ql::env_t *env,
-                  std::vector<store_key_t> *keys_out) {
+                  const ql::map_wire_func_t &mapping, sindex_multi_bool_t multi,
+                  ql::env_t *env, std::vector<store_key_t> *keys_out,
+                  std::vector<counted_t<const ql::datum_t> > *index_vals_out) {
     guarantee(keys_out->empty());
+    guarantee(index_vals_out->empty());
     counted_t<const ql::datum_t> index =
-        mapping->compile_wire_func()->call(env, doc)->as_datum();
+        mapping.compile_wire_func()->call(env, doc)->as_datum();
 
     if (multi == sindex_multi_bool_t::MULTI && index->get_type() == ql::datum_t::R_ARRAY) {
         for (uint64_t i = 0; i < index->size(); ++i) {
+            counted_t<const ql::datum_t> index_val = index->get(i, ql::THROW);
             keys_out->push_back(
-                store_key_t(index->get(i, ql::THROW)->print_secondary(primary_key, i)));
+                store_key_t(index_val->print_secondary(primary_key, i)));
+            index_vals_out->push_back(index_val);
         }
     } else {
         keys_out->push_back(store_key_t(index->print_secondary(primary_key)));
+        index_vals_out->push_back(index);
     }
 }
 
-/* Used below by rdb_update_sindexes. */
-void rdb_update_single_sindex(
-        const btree_store_t<rdb_protocol_t>::sindex_access_t *sindex,
-        const deletion_context_t *deletion_context,
-        const rdb_modification_report_t *modification,
-        auto_drainer_t::lock_t) {
+void serialize_sindex_definition(write_message_t *wm,
+                                 const ql::map_wire_func_t &mapping,
+                                 sindex_multi_bool_t multi,
+                                 const std::vector<std::string> &covered_fields) {
+    *wm << mapping;
+    *wm << multi;
+    *wm << covered_fields;
+}
+
+void deserialize_sindex_definition(const std::vector<char> &data,
+                                   ql::map_wire_func_t *mapping_out,
+                                   sindex_multi_bool_t *multi_out,
+                                   std::vector<std::string> *covered_fields_out) {
+    inplace_vector_read_stream_t read_stream(&data);
+    archive_result_t success = deserialize(&read_stream, mapping_out);
+    guarantee_deserialization(success, "sindex definition");
+    success = deserialize(&read_stream, multi_out);
+    guarantee_deserialization(success, "sindex definition");
+    success = deserialize(&read_stream, covered_fields_out);
+    if (success == archive_result_t::SOCK_EOF) {
+        // The index is older than covering indexes.
+        covered_fields_out->clear();
+    } else {
+        guarantee_deserialization(success, "sindex definition");
+    }
+}
+
+/* The keys of a covering index get a small blob that holds the row's value followed
+by the array [index value, object with the covered fields of the row], so that reads
+which only use those fields don't have to load the row's blob.  This only pays off if
+the row's blob isn't small itself, and only works if the entry fits into a small blob;
+otherwise the keys get a copy of the row's value like in any other index (and this
+returns false).  `covered_sindex_row_value` tells the two apart. */
+bool make_covered_sindex_value(const std::vector<std::string> &covered_fields,
+                               const counted_t<const ql::datum_t> &doc,
+                               const counted_t<const ql::datum_t> &index_val,
+                               const std::vector<char> &row_value,
+                               std::vector<char> *value_out) {
+    if (covered_fields.empty()
+        || blob::is_small(row_value.data(), blob::btree_maxreflen)) {
+        return false;
+    }
+
+    std::map<std::string, counted_t<const ql::datum_t> > fields;
+    for (auto it = covered_fields.begin(); it != covered_fields.end(); ++it) {
+        counted_t<const ql::datum_t> field = doc->get(*it, ql::NOTHROW);
+        if (field.has()) {
+            fields[*it] = field;
+        }
+    }
+    std::vector<counted_t<const ql::datum_t> > entry;
+    entry.push_back(index_val);
+    entry.push_back(make_counted<const ql::datum_t>(std::move(fields)));
+
+    write_message_t wm;
+    wm.append(row_value.data(), row_value.size());
+    wm << make_counted<const ql::datum_t>(std::move(entry));
+    vector_stream_t stream;
+    stream.reserve(wm.size());
+    int write_res = send_write_message(&stream, &wm);
+    guarantee(write_res == 0);
+
+    const std::vector<char> &data = stream.vector();
+    if (!blob::size_would_be_small(data.size(), blob::btree_maxreflen)) {
+        return false;
+    }
+    value_out->resize(blob::btree_maxreflen);
+    value_out->resize(blob::init_small_ref(value_out->data(), blob::btree_maxreflen,
+                                           data.data(), data.size()));
+    return true;
+}
+
+/* The deserialized opaque definition of a secondary index, which we keep in the
+index's btree_slice_t so that we don't deserialize (and thereby compile) the mapping
+function again for every write. */
+class rdb_sindex_definition_t : public sindex_compiled_definition_t {
+public:
+    explicit rdb_sindex_definition_t(const secondary_index_t &sindex)
+        : sindex_id(sindex.id), multi(sindex_multi_bool_t::MULTI) {
+        deserialize_sindex_definition(sindex.opaque_definition,
+                                      &mapping, &multi, &covered_fields);
+    }
+
+    const uuid_u sindex_id;
+    ql::map_wire_func_t mapping;
+    sindex_multi_bool_t multi;
+    std::vector<std::string> covered_fields;
+};
+
+const rdb_sindex_definition_t *get_sindex_definition(
+        const btree_store_t<rdb_protocol_t>::sindex_access_t *sindex) {
+    scoped_ptr_t<sindex_compiled_definition_t> *cached
+        = &sindex->btree->compiled_sindex_definition;
+    // The slice goes away with the index, but be paranoid about the slice of a
+    // recreated index getting mixed up with the old one.
+    if (!cached->has()
+        || static_cast<rdb_sindex_definition_t *>(cached->get())->sindex_id
+           != sindex->sindex.id) {
+        cached->reset();
+        cached->init(new rdb_sindex_definition_t(sindex->sindex));
+    }
+    return static_cast<const rdb_sindex_definition_t *>(cached->get());
+}
+
+/* A change to one key of a secondary index: setting it to `value_ref` (or to
+`covered_value`, if that isn't empty), or deleting it if `value_ref` is NULL. */
+struct sindex_key_change_t {
+    sindex_key_change_t(const store_key_t &_key, const std::vector<char> *_value_ref)
+        : key(_key), value_ref(_value_ref) { }
+
+    const std::vector<char> &value() const {
+        return covered_value.empty() ? *value_ref : covered_value;
+    }
+
+    store_key_t key;
+    const std::vector<char> *value_ref;
+    std::vector<char> covered_value;
+};
+
+bool sindex_key_change_less(const sindex_key_change_t &a,
+                            const sindex_key_change_t &b) {
+    return a.key < b.key;
+}
+
+/* Appends the changes `modification` makes to the index to `changes_out`. */
+void compute_sindex_key_changes(const rdb_sindex_definition_t *definition,
+                                const rdb_modification_report_t *modification,
+                                ql::env_t *env,
+                                std::vector<sindex_key_change_t> *changes_out) {
     // Note if you get this error it's likely that you've passed in a default
     // constructed mod_report. Don't do that.  Mod reports should always be passed
     // to a function as an output parameter before they're passed to this
     // function.
     guarantee(modification->primary_key.size() != 0);
 
-    ql::map_wire_func_t mapping;
-    sindex_multi_bool_t multi = sindex_multi_bool_t::MULTI;
-    inplace_vector_read_stream_t read_stream(&sindex->sindex.opaque_definition);
-    archive_result_t success = deserialize(&read_stream, &mapping);
-    guarantee_deserialization(success, "sindex deserialize");
-    success = deserialize(&read_stream, &multi);
-    guarantee_deserialization(success, "sindex deserialize");
-
-    // TODO we just use a NULL environment here. People should not be able
-    // to do anything that requires an environment like gets from other
-    // tables etc. but we don't have a nice way to disallow those things so
-    // for now we pass null and it will segfault if an illegal sindex
-    // mapping is passed.
-    cond_t non_interruptor;
-    ql::env_t env(NULL, &non_interruptor);
-
-    superblock_t *super_block = sindex->super_block.get();
-
+    // If computing the keys fails, the row just isn't (or wasn't) in the index.
+    std::vector<store_key_t> deleted_keys;
     if (modification->info.deleted.first) {
         guarantee(!modification->info.deleted.second.empty());
+        std::vector<counted_t<const ql::datum_t> > deleted_index_vals;
         try {
-            counted_t<const ql::datum_t> deleted = modification->info.deleted.first;
-
-            std::vector<store_key_t> keys;
-
-            compute_keys(modification->primary_key, deleted, &mapping, multi, &env, &keys);
-
-            for (auto it = keys.begin(); it != keys.end(); ++it) {
-                promise_t<superblock_t *> return_superblock_local;
-                {
-                    keyvalue_location_t<rdb_value_t> kv_location;
-                    find_keyvalue_location_for_write(super_block,
-                                                     it->btree_key(),
-                                                     deletion_context->balancing_detacher(),
-                                                     &kv_location,
-                                                     &sindex->btree->stats,
-                                                     env.trace.get_or_null(),
-                                                     &return_superblock_local);
-
-                    if (kv_location.value.has()) {
-                        kv_location_delete(&kv_location, *it,
-                            repli_timestamp_t::distant_past, deletion_context, NULL);
-                    }
-                    // The keyvalue location gets destroyed here.
-                }
-                super_block = return_superblock_local.wait();
-            }
+            compute_keys(modification->primary_key, modification->info.deleted.first,
+                         definition->mapping, definition->multi, env, &deleted_keys,
+                         &deleted_index_vals);
         } catch (const ql::base_exc_t &) {
-            // Do nothing (it wasn't actually in the index).
+            deleted_keys.clear();
         }
     }
 
+    std::vector<store_key_t> added_keys;
+    std::vector<counted_t<const ql::datum_t> > added_index_vals;
     if (modification->info.added.first) {
         try {
-            counted_t<const ql::datum_t> added = modification->info.added.first;
-
-            std::vector<store_key_t> keys;
-
-            compute_keys(modification->primary_key, added, &mapping, multi, &env, &keys);
+            compute_keys(modification->primary_key, modification->info.added.first,
+                         definition->mapping, definition->multi, env, &added_keys,
+                         &added_index_vals);
+        } catch (const ql::base_exc_t &) {
+            added_keys.clear();
+            added_index_vals.clear();
+        }
+    }
 
-            for (auto it = keys.begin(); it != keys.end(); ++it) {
-                promise_t<superblock_t *> return_superblock_local;
-                {
-                    keyvalue_location_t<rdb_value_t> kv_location;
+    // Keys that stay in the index don't have to be deleted first; setting them
+    // replaces their old value.  If the value itself is the same (which happens
+    // for unchanged values that are small enough to be stored inline), they don't
+    // need to be touched at all.
+    const std::set<store_key_t> added_key_set(added_keys.begin(), added_keys.end());
+    const std::set<store_key_t> deleted_key_set(deleted_keys.begin(), deleted_keys.end());
+    const bool same_value = modification->info.deleted.first
+        && modification->info.added.first
+        && modification->info.added.second == modification->info.deleted.second;
+
+    for (auto it = deleted_keys.begin(); it != deleted_keys.end(); ++it) {
+        if (added_key_set.count(*it) == 0) {
+            changes_out->push_back(sindex_key_change_t(*it, NULL));
+        }
+    }
+    for (size_t i = 0; i < added_keys.size(); ++i) {
+        if (!same_value || deleted_key_set.count(added_keys[i]) == 0) {
+            changes_out->push_back(
+                sindex_key_change_t(added_keys[i], &modification->info.added.second));
+            make_covered_sindex_value(definition->covered_fields,
+                                      modification->info.added.first,
+                                      added_index_vals[i],
+                                      modification->info.added.second,
+                                      &changes_out->back().covered_value);
+        }
+    }
+}
 
-                    find_keyvalue_location_for_write(super_block,
-                                                     it->btree_key(),
-                                                     deletion_context->balancing_detacher(),
-                                                     &kv_location,
-                                                     &sindex->btree->stats,
-                                                     env.trace.get_or_null(),
-                                                     &return_superblock_local);
+/* Applies `changes` in key order.  Consecutive keys that land in the same leaf
+share one descent from the superblock. */
+void apply_sindex_key_changes(
+        const btree_store_t<rdb_protocol_t>::sindex_access_t *sindex,
+        std::vector<sindex_key_change_t> *changes,
+        const deletion_context_t *deletion_context,
+        profile::trace_t *trace) {
+    // The sort is stable so that changes to the same key (which can only come from
+    // the same row being written more than once in a batch) keep their order.
+    std::stable_sort(changes->begin(), changes->end(), &sindex_key_change_less);
 
-                    kv_location_set(&kv_location, *it,
-                                    modification->info.added.second,
+    superblock_t *super_block = sindex->super_block.get();
+    size_t i = 0;
+    while (i < changes->size()) {
+        promise_t<superblock_t *> return_superblock_local;
+        {
+            keyvalue_location_t<rdb_value_t> kv_location;
+            find_keyvalue_location_for_write(super_block,
+                                             (*changes)[i].key.btree_key(),
+                                             deletion_context->balancing_detacher(),
+                                             &kv_location,
+                                             &sindex->btree->stats,
+                                             trace,
+                                             &return_superblock_local);
+
+            do {
+                const sindex_key_change_t &change = (*changes)[i];
+                if (change.value_ref != NULL) {
+                    kv_location_set(&kv_location, change.key, change.value(),
                                     repli_timestamp_t::distant_past,
                                     deletion_context);
-                    // The keyvalue location gets destroyed here.
+                } else if (kv_location.value.has()) {
+                    kv_location_delete(&kv_location, change.key,
+                                       repli_timestamp_t::distant_past,
+                                       deletion_context, NULL);
                 }
-                super_block = return_superblock_local.wait();
-            }
-        } catch (const ql::base_exc_t &) {
-            // Do nothing (we just drop the row from the index).
+                ++i;
+            } while (i < changes->size()
+                     && reuse_keyvalue_location_for_write(
+                         &kv_location, (*changes)[i].key.btree_key()));
+            // The keyvalue location gets destroyed here.
         }
+        super_block = return_superblock_local.wait();
     }
 }
 
-void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
-                         const rdb_modification_report_t *modification,
-                         txn_t *txn, const deletion_context_t *deletion_context) {
+/* Used below by rdb_update_sindexes. */
+void rdb_update_single_sindex(
+        const btree_store_t<rdb_protocol_t>::sindex_access_t *sindex,
+        const deletion_context_t *deletion_context,
+        const rdb_modification_report_t *modifications,
+        size_t num_modifications,
+        auto_drainer_t::lock_t) {
+    const rdb_sindex_definition_t *definition = get_sindex_definition(sindex);
+
+    // TODO we just use a NULL environment here. People should not be able
+    // to do anything that requires an environment like gets from other
+    // tables etc. but we don't have a nice way to disallow those things so
+    // for now we pass null and it will segfault if an illegal sindex
+    // mapping is passed.
+    cond_t non_interruptor;
+    ql::env_t env(NULL, &non_interruptor);
+
+    std::vector<sindex_key_change_t> changes;
+    for (size_t i = 0; i < num_modifications; ++i) {
+        compute_sindex_key_changes(definition, &modifications[i], &env, &changes);
+    }
+
+    apply_sindex_key_changes(sindex, &changes, deletion_context,
+                             env.trace.get_or_null());
+}
+
+void update_sindexes_and_delete_old_values(
+        const sindex_access_vector_t &sindexes,
+        const rdb_modification_report_t *modifications,
+        size_t num_modifications,
+        txn_t *txn, const deletion_context_t *deletion_context) {
     {
         auto_drainer_t drainer;
 
@@ -1205,15 +1681,35 @@ void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
                                                     ++it) {
             coro_t::spawn_sometime(std::bind(
                         &rdb_update_single_sindex, &*it, deletion_context,
-                        modification, auto_drainer_t::lock_t(&drainer)));
+                        modifications, num_modifications,
+                        auto_drainer_t::lock_t(&drainer)));
         }
     }
 
     /* All of the sindex have been updated now it's time to actually clear the
-     * deleted blob if it exists. */
-    if (modification->info.deleted.first) {
-        deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
-                modification->info.deleted.second.data());
+     * deleted blobs if they exist. */
+    for (size_t i = 0; i < num_modifications; ++i) {
+        if (modifications[i].info.deleted.first) {
+            deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
+                    modifications[i].info.deleted.second.data());
+        }
+    }
+}
+
+void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
+                         const rdb_modification_report_t *modification,
+                         txn_t *txn, const deletion_context_t *deletion_context) {
+    update_sindexes_and_delete_old_values(sindexes, modification, 1,
+                                          txn, deletion_context);
+}
+
+void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
+                         const std::vector<rdb_modification_report_t> &modifications,
+                         txn_t *txn, const deletion_context_t *deletion_context) {
+    if (!modifications.empty()) {
+        update_sindexes_and_delete_old_values(sindexes, modifications.data(),
+                                              modifications.size(),
+                                              txn, deletion_context);
     }
 }
 
@@ -1360,53 +1856,327 @@ public:
     signal_t *interruptor_;  
 };
 
-void post_construct_secondary_indexes(
+/* A secondary index that is built from scratch: the scan puts all of its keys into
+`sorter`, and then they are appended to the empty index tree in order. */
+/* Also reports the progress of the build: the scan of the primary btree counts as
+the first half, appending the sorted keys as the second. */
+class sindex_bulk_build_t : public traversal_progress_t {
+public:
+    sindex_bulk_build_t(btree_store_t<rdb_protocol_t> *store,
+                        const secondary_index_t &sindex)
+        : definition(sindex),
+          sorter(store->io_backender_, store->base_path_,
+                 "sindex_build_" + uuid_to_str(sindex.id),
+                 &store->perfmon_collection, SINDEX_BULK_BUILD_SORT_MEMORY),
+          scan_progress(NULL), appending(false), num_sorted(0), num_appended(0) { }
+
+    progress_completion_fraction_t guess_completion() const {
+        progress_completion_fraction_t res;
+        if (!appending) {
+            if (scan_progress != NULL) {
+                res = scan_progress->guess_completion();
+            }
+            if (!res.invalid()) {
+                res.estimate_of_total_nodes *= 2;
+            }
+        } else if (num_sorted == 0) {
+            res = progress_completion_fraction_t(1, 1);
+        } else {
+            res.estimate_of_released_nodes = num_sorted + num_appended;
+            res.estimate_of_total_nodes = 2 * num_sorted;
+        }
+        return res;
+    }
+
+    const rdb_sindex_definition_t definition;
+    external_sorter_t<std::pair<store_key_t, std::vector<char> > > sorter;
+
+    // The scan of the primary btree, while it's running.
+    const parallel_traversal_progress_t *scan_progress;
+    bool appending;
+    // How many index entries went into `sorter`, and how many of them we've
+    // appended to the index so far.
+    int64_t num_sorted;
+    int64_t num_appended;
+
+private:
+    DISABLE_COPYING(sindex_bulk_build_t);
+};
+
+class sindex_bulk_scan_helper_t : public btree_traversal_helper_t {
+public:
+    sindex_bulk_scan_helper_t(
+            btree_store_t<rdb_protocol_t> *store,
+            const std::vector<scoped_ptr_t<sindex_bulk_build_t> > *builds)
+        : store_(store), builds_(builds) { }
+
+    void process_a_leaf(buf_lock_t *leaf_node_buf,
+                        const btree_key_t *, const btree_key_t *,
+                        signal_t *, int *) THROWS_ONLY(interrupted_exc_t) {
+        // See rdb_update_single_sindex for why the environment is NULL.
+        cond_t non_interruptor;
+        ql::env_t env(NULL, &non_interruptor);
+
+        buf_read_t leaf_read(leaf_node_buf);
+        const leaf_node_t *leaf_node
+            = static_cast<const leaf_node_t *>(leaf_read.get_data_read());
+        const block_size_t block_size = leaf_node_buf->cache()->get_block_size();
+
+        for (auto it = leaf::begin(*leaf_node); it != leaf::end(*leaf_node); ++it) {
+            store_->btree->stats.pm_keys_read.record();
+
+            const btree_key_t *key = (*it).first;
+            guarantee(key);
+            const store_key_t pk(key);
+            const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>((*it).second);
+            counted_t<const ql::datum_t> doc
+                = get_data(rdb_value, buf_parent_t(leaf_node_buf));
+            const std::vector<char> value_ref(
+                rdb_value->value_ref(),
+                rdb_value->value_ref() + rdb_value->inline_size(block_size));
+
+            for (auto build = builds_->begin(); build != builds_->end(); ++build) {
+                std::vector<store_key_t> keys;
+                std::vector<counted_t<const ql::datum_t> > index_vals;
+                try {
+                    compute_keys(pk, doc, (*build)->definition.mapping,
+                                 (*build)->definition.multi, &env, &keys,
+                                 &index_vals);
+                } catch (const ql::base_exc_t &) {
+                    // The row just isn't in this index.
+                    continue;
+                }
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    std::vector<char> covered_value;
+                    const std::vector<char> &value
+                        = make_covered_sindex_value(
+                            (*build)->definition.covered_fields, doc, index_vals[i],
+                            value_ref, &covered_value)
+                        ? covered_value : value_ref;
+                    (*build)->sorter.add(
+                        std::make_pair(keys[i], value),
+                        sizeof(std::pair<store_key_t, std::vector<char> >)
+                        + value.size());
+                    ++(*build)->num_sorted;
+                }
+            }
+        }
+    }
+
+    void postprocess_internal_node(buf_lock_t *) { }
+
+    void filter_interesting_children(buf_parent_t,
+                                     ranged_block_ids_t *ids_source,
+                                     interesting_children_callback_t *cb) {
+        for (int i = 0, e = ids_source->num_block_ids(); i < e; ++i) {
+            cb->receive_interesting_child(i);
+        }
+        cb->no_more_interesting_children();
+    }
+
+    access_t btree_superblock_mode() { return access_t::read; }
+    access_t btree_node_mode() { return access_t::read; }
+
+private:
+    btree_store_t<rdb_protocol_t> *store_;
+    const std::vector<scoped_ptr_t<sindex_bulk_build_t> > *builds_;
+
+    DISABLE_COPYING(sindex_bulk_scan_helper_t);
+};
+
+/* Sets up a bulk build for each of `sindexes_to_post_construct`, unless some of
+them already have a tree, in which case they have to be post constructed row by row
+(so that we don't overwrite anything). */
+void prepare_sindex_bulk_builds(
         btree_store_t<rdb_protocol_t> *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
+        std::vector<scoped_ptr_t<sindex_bulk_build_t> > *builds_out,
         signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t) {
-    cond_t local_interruptor;
+    write_token_pair_t token_pair;
+    store->new_write_token_pair(&token_pair);
+
+    scoped_ptr_t<txn_t> wtxn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_write(repli_timestamp_t::distant_past,
+                                        2,
+                                        write_durability_t::SOFT,
+                                        &token_pair,
+                                        &wtxn,
+                                        &superblock,
+                                        interruptor);
+
+    buf_lock_t sindex_block
+        = store->acquire_sindex_block_for_write(superblock->expose_buf(),
+                                                superblock->get_sindex_block_id());
+    superblock.reset();
+
+    sindex_access_vector_t sindexes;
+    store->acquire_sindex_superblocks_for_write(sindexes_to_post_construct,
+                                                &sindex_block,
+                                                &sindexes);
+    for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+        if (it->super_block->get_root_block_id() != NULL_BLOCK_ID) {
+            return;
+        }
+    }
+    for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+        builds_out->push_back(make_scoped<sindex_bulk_build_t>(store, it->sindex));
+    }
+}
+
+/* Appends the sorted keys of `build` to its (empty) index tree.  Like the row by
+row post construction, this uses a new write transaction for every chunk. */
+void bulk_build_secondary_index(btree_store_t<rdb_protocol_t> *store,
+                                sindex_bulk_build_t *build,
+                                signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    // Number of index entries we append before yielding
+    const int MAX_CHUNK_SIZE = 1000;
+
+    std::set<uuid_u> sindex_ids;
+    sindex_ids.insert(build->definition.sindex_id);
+
+    build->sorter.finish();
+    build->appending = true;
+    std::pair<store_key_t, std::vector<char> > item;
+    bool has_item = build->sorter.next(&item);
+    while (has_item) {
+        write_token_pair_t token_pair;
+        store->new_write_token_pair(&token_pair);
+
+        scoped_ptr_t<txn_t> wtxn;
+        sindex_access_vector_t sindexes;
+        {
+            scoped_ptr_t<real_superblock_t> superblock;
+            // HARD durability for the same reason as in
+            // post_construct_traversal_helper_t.
+            store->acquire_superblock_for_write(repli_timestamp_t::distant_past,
+                                                2 + MAX_CHUNK_SIZE,
+                                                write_durability_t::HARD,
+                                                &token_pair,
+                                                &wtxn,
+                                                &superblock,
+                                                interruptor);
+
+            buf_lock_t sindex_block
+                = store->acquire_sindex_block_for_write(
+                    superblock->expose_buf(), superblock->get_sindex_block_id());
+            superblock.reset();
+
+            store->acquire_sindex_superblocks_for_write(sindex_ids,
+                                                        &sindex_block,
+                                                        &sindexes);
+        }
+        if (sindexes.empty()) {
+            // The index has been dropped in the meantime.
+            return;
+        }
+
+        {
+            value_sizer_t<rdb_value_t> sizer(wtxn->cache()->get_block_size());
+            btree_bulk_loader_t loader(&sizer, sindexes[0].super_block.get(),
+                                       &sindexes[0].btree->stats);
+            for (int i = 0; has_item && i < MAX_CHUNK_SIZE; ++i) {
+                // A multi index gets the same key twice if an array has the same
+                // element twice.
+                if (loader.can_append(item.first.btree_key())) {
+                    scoped_malloc_t<rdb_value_t> value(
+                        item.second.data(), item.second.data() + item.second.size());
+                    loader.append(item.first.btree_key(), value.get(),
+                                  repli_timestamp_t::distant_past);
+                }
+                ++build->num_appended;
+                has_item = build->sorter.next(&item);
+            }
+        }
+
+        sindexes.clear();
+        wtxn.reset();
+        coro_t::yield();
+    }
+}
 
-    wait_any_t wait_any(&local_interruptor, interruptor);
+void post_construct_secondary_indexes(
+        btree_store_t<rdb_protocol_t> *store,
+        const std::set<uuid_u> &sindexes_to_post_construct,
+        signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    // New indexes are empty, so instead of inserting every row into them one by
+    // one we collect and sort their keys and then build their trees bottom-up.
+    // Writes that happen in the meantime are in the sindex queue, which gets
+    // applied once we're done (just like for the row by row construction).
+    std::vector<scoped_ptr_t<sindex_bulk_build_t> > bulk_builds;
+    prepare_sindex_bulk_builds(store, sindexes_to_post_construct, &bulk_builds,
+                               interruptor);
 
-    post_construct_traversal_helper_t helper(store,
-            sindexes_to_post_construct, &local_interruptor, interruptor);
     /* Notice the ordering of progress_tracker and insertion_sentries matters.
      * insertion_sentries puts pointers in the progress tracker map. Once
      * insertion_sentries is destructed nothing has a reference to
-     * progress_tracker so we know it's safe to destruct it. */
+     * progress_tracker (or the bulk builds) so we know it's safe to destruct
+     * it.  The sentries stay around until the bulk builds have appended their
+     * keys, so that the progress of that shows up as well. */
     parallel_traversal_progress_t progress_tracker;
-    helper.progress = &progress_tracker;
-
-    std::vector<map_insertion_sentry_t<uuid_u, const parallel_traversal_progress_t *> >
+    std::vector<map_insertion_sentry_t<uuid_u, const traversal_progress_t *> >
         insertion_sentries(sindexes_to_post_construct.size());
-    auto sentry = insertion_sentries.begin();
-    for (auto it = sindexes_to_post_construct.begin();
-         it != sindexes_to_post_construct.end(); ++it) {
-        store->add_progress_tracker(&*sentry, *it, &progress_tracker);
+    if (bulk_builds.empty()) {
+        auto sentry = insertion_sentries.begin();
+        for (auto it = sindexes_to_post_construct.begin();
+             it != sindexes_to_post_construct.end(); ++it, ++sentry) {
+            store->add_progress_tracker(&*sentry, *it, &progress_tracker);
+        }
+    } else {
+        auto sentry = insertion_sentries.begin();
+        for (auto it = bulk_builds.begin(); it != bulk_builds.end(); ++it, ++sentry) {
+            (*it)->scan_progress = &progress_tracker;
+            store->add_progress_tracker(&*sentry, (*it)->definition.sindex_id,
+                                        it->get());
+        }
     }
 
-    object_buffer_t<fifo_enforcer_sink_t::exit_read_t> read_token;
-    store->new_read_token(&read_token);
-
-    // Mind the destructor ordering.
-    // The superblock must be released before txn (`btree_parallel_traversal`
-    // usually already takes care of that).
-    // The txn must be destructed before the cache_account.
-    cache_account_t cache_account;
-    scoped_ptr_t<txn_t> txn;
-    scoped_ptr_t<real_superblock_t> superblock;
+    {
+        cond_t local_interruptor;
 
-    store->acquire_superblock_for_read(
-        &read_token,
-        &txn,
-        &superblock,
-        interruptor,
-        true /* USE_SNAPSHOT */);
+        wait_any_t wait_any(&local_interruptor, interruptor);
 
-    cache_account
-        = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY);
-    txn->set_account(&cache_account);
+        scoped_ptr_t<btree_traversal_helper_t> helper;
+        if (bulk_builds.empty()) {
+            helper.init(new post_construct_traversal_helper_t(store,
+                    sindexes_to_post_construct, &local_interruptor, interruptor));
+        } else {
+            helper.init(new sindex_bulk_scan_helper_t(store, &bulk_builds));
+        }
+        helper->progress = &progress_tracker;
+
+        object_buffer_t<fifo_enforcer_sink_t::exit_read_t> read_token;
+        store->new_read_token(&read_token);
+
+        // Mind the destructor ordering.
+        // The superblock must be released before txn (`btree_parallel_traversal`
+        // usually already takes care of that).
+        // The txn must be destructed before the cache_account.
+        cache_account_t cache_account;
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+
+        store->acquire_superblock_for_read(
+            &read_token,
+            &txn,
+            &superblock,
+            interruptor,
+            true /* USE_SNAPSHOT */);
+
+        cache_account
+            = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY);
+        txn->set_account(&cache_account);
+
+        btree_parallel_traversal(superblock.get(), helper.get(), &wait_any);
+    }
 
-    btree_parallel_traversal(superblock.get(), &helper, &wait_any);
+    for (auto it = bulk_builds.begin(); it != bulk_builds.end(); ++it) {
+        if (interruptor->is_pulsed()) {
+            throw interrupted_exc_t();
+        }
+        bulk_build_secondary_index(store, it->get(), interruptor);
+    }
 }
@@ -139,6 +139,18 @@ batched_replace_response_t rdb_batched_replace(
     rdb_modification_report_cb_t *sindex_cb,
     profile::trace_t *trace);
 
+// Like rdb_batched_replace, but rows whose keys come after every key in the tree
+// are inserted with a btree_bulk_loader_t instead of one by one.  The replacer
+// gets called with a null row for them.  Meant for inserts into new tables or
+// key ranges.
+batched_replace_response_t rdb_batched_bulk_load(
+    const btree_info_t &info,
+    scoped_ptr_t<superblock_t> *superblock,
+    const std::vector<store_key_t> &keys,
+    const btree_batched_replacer_t *replacer,
+    rdb_modification_report_cb_t *sindex_cb,
+    profile::trace_t *trace);
+
 void rdb_set(const store_key_t &key, counted_t<const ql::datum_t> data,
              bool overwrite,
              btree_slice_t *slice, repli_timestamp_t timestamp,
@@ -207,6 +219,19 @@ void rdb_erase_small_range(key_tester_t *tester,
                            signal_t *interruptor,
                            std::vector<rdb_modification_report_t> *mod_reports_out);
 
+/* The opaque definition of a secondary index is its mapping, whether it's a multi
+index, and the fields of the rows that it covers, i.e. that it keeps a copy of in its
+leaves (see `make_covered_sindex_value` in btree.cc).  Definitions of indexes that
+were created before covering indexes existed end after `multi`. */
+void serialize_sindex_definition(write_message_t *wm,
+                                 const ql::map_wire_func_t &mapping,
+                                 sindex_multi_bool_t multi,
+                                 const std::vector<std::string> &covered_fields);
+void deserialize_sindex_definition(const std::vector<char> &data,
+                                   ql::map_wire_func_t *mapping_out,
+                                   sindex_multi_bool_t *multi_out,
+                                   std::vector<std::string> *covered_fields_out);
+
 /* RGETS */
 size_t estimate_rget_response_size(const counted_t<const ql::datum_t> &datum);
 
@@ -234,6 +259,25 @@ void rdb_rget_secondary_slice(
     sorting_t sorting,
     const ql::map_wire_func_t &sindex_func,
     sindex_multi_bool_t sindex_multi,
+    const std::vector<std::string> &sindex_covered_fields,
+    rget_read_response_t *response);
+
+/* A `count` with no transforms only needs the number of keys in range, so it
+doesn't have to go through the rget machinery.  If `whole_btree` is true, every key
+of the btree is in range and the count comes from the btree's stat block in a
+single block read.  Otherwise every leaf of `range` still gets visited, only without
+loading the values: there are no per-subtree counts, so range counts stay linear in
+the size of the range. */
+bool rdb_rget_is_plain_count(
+    const std::vector<rdb_protocol_details::transform_variant_t> &transforms,
+    const boost::optional<rdb_protocol_details::terminal_variant_t> &terminal);
+
+void rdb_count_slice(
+    superblock_t *superblock,
+    const key_range_t &range,
+    bool whole_btree,
+    ql::env_t *ql_env,
+    sorting_t sorting,
     rget_read_response_t *response);
 
 void rdb_distribution_get(int max_depth,
@@ -286,8 +330,13 @@ public:
             buf_lock_t *sindex_block,
             auto_drainer_t::lock_t lock);
 
+    // Pushes the change onto the sindex queue right away, but only remembers it for
+    // the post-constructed indexes until `update_sindexes` is called.
     void on_mod_report(const rdb_modification_report_t &mod_report);
 
+    // Applies the changes of all reports so far to the post-constructed indexes.
+    void update_sindexes();
+
     ~rdb_modification_report_cb_t();
 
 private:
@@ -298,6 +347,7 @@ private:
 
     /* Fields initialized by calls to on_mod_report */
     btree_store_t<rdb_protocol_t>::sindex_access_vector_t sindexes_;
+    std::vector<rdb_modification_report_t> mod_reports_;
 };
 
 void rdb_update_sindexes(
@@ -306,6 +356,14 @@ void rdb_update_sindexes(
         txn_t *txn,
         const deletion_context_t *deletion_context);
 
+/* Like the above, for a batch of modifications.  Each index gets the changes of the
+whole batch sorted by key, which is much cheaper than applying them row by row. */
+void rdb_update_sindexes(
+        const btree_store_t<rdb_protocol_t>::sindex_access_vector_t &sindexes,
+        const std::vector<rdb_modification_report_t> &modifications,
+        txn_t *txn,
+        const deletion_context_t *deletion_context);
+
 
 void rdb_erase_major_range_sindexes(
         const btree_store_t<rdb_protocol_t>::sindex_access_vector_t &sindexes,
@@ -5,12 +5,16 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <algorithm>
+#include <limits>
 
 #include "errors.hpp"
 #include <boost/detail/endian.hpp>
 
+#include "config/args.hpp"
+#include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
@@ -18,11 +22,80 @@
 #include "rdb_protocol/pseudo_time.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "stl_utils.hpp"
+#include "thread_local.hpp"
 
 namespace ql {
 
 const size_t tag_size = 8;
 
+static bool field_name_less(const datum_object_t::value_type &field,
+                            const std::string &key) {
+    return field.first < key;
+}
+
+static bool field_less(const datum_object_t::value_type &a,
+                       const datum_object_t::value_type &b) {
+    return a.first < b.first;
+}
+
+datum_object_t::datum_object_t(std::map<std::string, counted_t<const datum_t> > &&map) {
+    fields.reserve(map.size());
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        fields.push_back(value_type(it->first, std::move(it->second)));
+    }
+}
+
+datum_object_t::const_iterator datum_object_t::find(const std::string &key) const {
+    const_iterator it = std::lower_bound(fields.begin(), fields.end(), key,
+                                         &field_name_less);
+    return (it != fields.end() && it->first == key) ? it : fields.end();
+}
+
+bool datum_object_t::set(const std::string &key, counted_t<const datum_t> val,
+                         clobber_bool_t clobber_bool) {
+    if (fields.empty() || fields.back().first < key) {
+        fields.push_back(value_type(key, std::move(val)));
+        return false;
+    }
+    auto it = std::lower_bound(fields.begin(), fields.end(), key, &field_name_less);
+    if (it != fields.end() && it->first == key) {
+        if (clobber_bool == CLOBBER) {
+            it->second = std::move(val);
+        }
+        return true;
+    }
+    fields.insert(it, value_type(key, std::move(val)));
+    return false;
+}
+
+size_t datum_object_t::erase(const std::string &key) {
+    auto it = std::lower_bound(fields.begin(), fields.end(), key, &field_name_less);
+    if (it == fields.end() || it->first != key) {
+        return 0;
+    }
+    fields.erase(it);
+    return 1;
+}
+
+void datum_object_t::append_unsorted(std::string &&key,
+                                     counted_t<const datum_t> &&val) {
+    fields.push_back(value_type(std::move(key), std::move(val)));
+}
+
+bool datum_object_t::sort_fields(std::string *duplicate_out) {
+    // Fields usually arrive sorted (e.g. when we wrote them out ourselves).
+    if (!std::is_sorted(fields.begin(), fields.end(), &field_less)) {
+        std::stable_sort(fields.begin(), fields.end(), &field_less);
+    }
+    for (size_t i = 1; i < fields.size(); ++i) {
+        if (fields[i - 1].first == fields[i].first) {
+            *duplicate_out = fields[i].first;
+            return false;
+        }
+    }
+    return true;
+}
+
 const std::set<std::string> datum_t::_allowed_pts = std::set<std::string>();
 
 const char* const datum_t::reql_type_string = "$reql_type$";
@@ -59,15 +132,22 @@ datum_t::datum_t(std::vector<counted_t<const datum_t> > &&_array)
 
 datum_t::datum_t(std::map<std::string, counted_t<const datum_t> > &&_object)
     : type(R_OBJECT),
-      r_object(new std::map<std::string, counted_t<const datum_t> >(
-                   std::move(_object))) {
+      r_object(new datum_object_t(std::move(_object))) {
+    maybe_sanitize_ptype();
+}
+
+datum_t::datum_t(datum_object_t &&_object)
+    : type(R_OBJECT),
+      r_object(new datum_object_t(std::move(_object))) {
     maybe_sanitize_ptype();
 }
 
 datum_t::datum_t(grouped_data_t &&gd)
     : type(R_OBJECT),
-      r_object(new std::map<std::string, counted_t<const datum_t> >()) {
-    (*r_object)[reql_type_string] = make_counted<const datum_t>("GROUPED_DATA");
+      r_object(new datum_object_t()) {
+    UNUSED bool b = r_object->set(reql_type_string,
+                                  make_counted<const datum_t>("GROUPED_DATA"),
+                                  CLOBBER);
     std::vector<counted_t<const datum_t> > v;
     v.reserve(gd.size());
     for (auto kv = gd.begin(); kv != gd.end(); ++kv) {
@@ -75,7 +155,7 @@ datum_t::datum_t(grouped_data_t &&gd)
                         std::vector<counted_t<const datum_t> >{
                             std::move(kv->first), std::move(kv->second)}));
     }
-    (*r_object)["data"] = make_counted<const datum_t>(std::move(v));
+    b = r_object->set("data", make_counted<const datum_t>(std::move(v)), CLOBBER);
     // We don't sanitize the ptype because this is a fake ptype that should only
     // be used for serialization.
 }
@@ -93,13 +173,58 @@ datum_t::datum_t(datum_t::type_t _type) : type(_type) {
         r_array = new std::vector<counted_t<const datum_t> >();
     } break;
     case R_OBJECT: {
-        r_object = new std::map<std::string, counted_t<const datum_t> >();
+        r_object = new datum_object_t();
     } break;
     case UNINITIALIZED: // fallthru
     default: unreachable();
     }
 }
 
+// A freed datum on the free list.  `length` is the length of the list starting
+// here, so that the list can be capped without keeping a separate count.
+struct free_datum_t {
+    free_datum_t *next;
+    size_t length;
+};
+
+// The list is bypassed where TLS isn't a plain per-thread variable, and under
+// valgrind so that it still catches uses of freed datums.
+TLS_with_init(free_datum_t *, free_datums, NULL);
+
+void *datum_t::operator new(size_t size) {
+    rassert(size == sizeof(datum_t));
+#if !defined(THREADED_COROUTINES) && !defined(VALGRIND)
+    free_datum_t *head = TLS_get_free_datums();
+    if (head != NULL) {
+        TLS_set_free_datums(head->next);
+        return head;
+    }
+#endif
+    return ::operator new(size);
+}
+
+void datum_t::operator delete(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+#if !defined(THREADED_COROUTINES) && !defined(VALGRIND)
+    static_assert(sizeof(datum_t) >= sizeof(free_datum_t),
+                  "A freed datum_t must have room for a free list entry.");
+    // Datums are often freed on a different thread than the one that allocated
+    // them, which is fine: the memory just moves to this thread's list.
+    free_datum_t *head = TLS_get_free_datums();
+    const size_t length = head == NULL ? 0 : head->length;
+    if (length < DATUM_FREE_LIST_SIZE) {
+        free_datum_t *entry = static_cast<free_datum_t *>(ptr);
+        entry->next = head;
+        entry->length = length + 1;
+        TLS_set_free_datums(entry);
+        return;
+    }
+#endif
+    ::operator delete(ptr);
+}
+
 datum_t::~datum_t() {
     switch (type) {
     case R_NULL: // fallthru
@@ -134,7 +259,7 @@ void datum_t::init_array() {
 
 void datum_t::init_object() {
     type = R_OBJECT;
-    r_object = new std::map<std::string, counted_t<const datum_t> >();
+    r_object = new datum_object_t();
 }
 
 void datum_t::init_json(cJSON *json) {
@@ -173,16 +298,241 @@ void datum_t::init_json(cJSON *json) {
         init_object();
         json_object_iterator_t it(json);
         while (cJSON *item = it.next()) {
-            bool conflict = add(item->string, make_counted<datum_t>(item));
-            rcheck(!conflict, base_exc_t::GENERIC,
-                   strprintf("Duplicate key `%s` in JSON.", item->string));
+            std::string key(item->string);
+            check_str_validity(key);
+            r_object->append_unsorted(std::move(key), make_counted<datum_t>(item));
         }
+        std::string duplicate;
+        rcheck(r_object->sort_fields(&duplicate), base_exc_t::GENERIC,
+               strprintf("Duplicate key `%s` in JSON.", duplicate.c_str()));
         maybe_sanitize_ptype();
     } break;
     default: unreachable();
     }
 }
 
+// The JSON parser below gives the same datums as `cJSON_Parse`, so that it doesn't
+// matter which path a document takes into the database.  That includes some of
+// cJSON's leniency: it drops NULs and unpaired surrogates from `\u` escapes, reads
+// `0x...` as 0 followed by garbage, and ignores anything after the top-level value.
+// It is stricter in two places, where cJSON reads past the input or uses garbage:
+// strings without a closing quote and `\u` escapes without four hex digits are
+// errors.
+
+static const char *skip_json_whitespace(const char *json) {
+    while (*json != '\0' && static_cast<unsigned char>(*json) <= 32) {
+        ++json;
+    }
+    return json;
+}
+
+static bool parse_json_hex4(const char *json, unsigned int *out) {
+    *out = 0;
+    for (int i = 0; i < 4; ++i) {
+        const char c = json[i];
+        *out <<= 4;
+        if (c >= '0' && c <= '9') {
+            *out |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            *out |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            *out |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void append_utf8(unsigned int code_point, std::string *out) {
+    if (code_point < 0x80) {
+        out->push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+// Unescapes the JSON string starting at the quote at `*json` into `out`.
+static bool parse_json_string(const char **json, std::string *out) {
+    const char *ptr = *json;
+    if (*ptr != '"') {
+        return false;
+    }
+    ++ptr;
+    for (;;) {
+        // Copy runs of characters that don't need unescaping all at once.
+        const char *run = ptr;
+        while (*ptr != '"' && *ptr != '\\' && *ptr != '\0') {
+            ++ptr;
+        }
+        out->append(run, ptr - run);
+        if (*ptr == '"') {
+            *json = ptr + 1;
+            return true;
+        } else if (*ptr == '\0') {
+            return false;
+        }
+        ++ptr;
+        switch (*ptr) {
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'n': out->push_back('\n'); break;
+        case 'r': out->push_back('\r'); break;
+        case 't': out->push_back('\t'); break;
+        case 'u': {
+            unsigned int code_point;
+            if (!parse_json_hex4(ptr + 1, &code_point)) {
+                return false;
+            }
+            ptr += 4;
+            // Like cJSON, we drop NULs, lone low surrogates, and high surrogates
+            // that aren't followed by a low surrogate.
+            if (code_point == 0 || (code_point >= 0xDC00 && code_point <= 0xDFFF)) {
+                break;
+            }
+            if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                unsigned int low;
+                if (ptr[1] != '\\' || ptr[2] != 'u' || !parse_json_hex4(ptr + 3, &low)) {
+                    break;
+                }
+                ptr += 6;
+                if (low < 0xDC00 || low > 0xDFFF) {
+                    break;
+                }
+                code_point = 0x10000 | ((code_point & 0x3FF) << 10) | (low & 0x3FF);
+            }
+            append_utf8(code_point, out);
+        } break;
+        case '\0': return false;
+        default: out->push_back(*ptr); break;
+        }
+        ++ptr;
+    }
+}
+
+bool datum_t::init_json(const char **json_inout) {
+    r_sanity_check(type == UNINITIALIZED);
+    const char *json = skip_json_whitespace(*json_inout);
+    switch (*json) {
+    case 'n': {
+        if (strncmp(json, "null", 4) != 0) return false;
+        type = R_NULL;
+        json += 4;
+    } break;
+    case 'f': {
+        if (strncmp(json, "false", 5) != 0) return false;
+        type = R_BOOL;
+        r_bool = false;
+        json += 5;
+    } break;
+    case 't': {
+        if (strncmp(json, "true", 4) != 0) return false;
+        type = R_BOOL;
+        r_bool = true;
+        json += 4;
+    } break;
+    case '"': {
+        std::string str;
+        if (!parse_json_string(&json, &str)) return false;
+        init_str(str.size(), str.data());
+        check_str_validity(r_str);
+    } break;
+    case '[': {
+        init_array();
+        json = skip_json_whitespace(json + 1);
+        if (*json == ']') {
+            ++json;
+            break;
+        }
+        for (;;) {
+            auto item = make_counted<datum_t>();
+            if (!item->init_json(&json)) return false;
+            add(std::move(item));
+            json = skip_json_whitespace(json);
+            if (*json == ']') {
+                ++json;
+                break;
+            } else if (*json != ',') {
+                return false;
+            }
+            ++json;
+        }
+    } break;
+    case '{': {
+        init_object();
+        json = skip_json_whitespace(json + 1);
+        if (*json == '}') {
+            ++json;
+            maybe_sanitize_ptype();
+            break;
+        }
+        for (;;) {
+            std::string key;
+            if (!parse_json_string(&json, &key)) return false;
+            json = skip_json_whitespace(json);
+            if (*json != ':') return false;
+            ++json;
+            auto item = make_counted<datum_t>();
+            if (!item->init_json(&json)) return false;
+            check_str_validity(key);
+            r_object->append_unsorted(std::move(key), std::move(item));
+            json = skip_json_whitespace(json);
+            if (*json == '}') {
+                ++json;
+                break;
+            } else if (*json != ',') {
+                return false;
+            }
+            ++json;
+        }
+        std::string duplicate;
+        rcheck(r_object->sort_fields(&duplicate), base_exc_t::GENERIC,
+               strprintf("Duplicate key `%s` in JSON.", duplicate.c_str()));
+        maybe_sanitize_ptype();
+    } break;
+    default: {
+        if (*json != '-' && (*json < '0' || *json > '9')) return false;
+        double num;
+        if (json[0] == '0' && (json[1] == 'x' || json[1] == 'X')) {
+            // `strtod` would parse a hexadecimal float, cJSON stops at the `x`.
+            num = 0;
+            json += 1;
+        } else {
+            char *end;
+            num = strtod(json, &end);
+            if (end == json) return false;
+            json = end;
+        }
+        type = R_NUM;
+        r_num = num;
+        // so we can use `isfinite` in a GCC 4.4.3-compatible way
+        using namespace std;  // NOLINT(build/namespaces)
+        rcheck(isfinite(r_num), base_exc_t::GENERIC,
+               strprintf("Non-finite value `%lf` in JSON.", r_num));
+    } break;
+    }
+    *json_inout = json;
+    return true;
+}
+
+counted_t<const datum_t> datum_t::parse_json(const char *json) {
+    scoped_ptr_t<datum_t> ret(new datum_t());
+    if (!ret->init_json(&json)) {
+        return counted_t<const datum_t>();
+    }
+    return counted_t<const datum_t>(ret.release());
+}
+
 void datum_t::check_str_validity(const wire_string_t *str) {
     for (size_t i = 0; i < str->size(); ++i) {
         if (str->data()[i] == '\0') {
@@ -743,8 +1093,7 @@ counted_t<const datum_t> datum_t::get(size_t index, throw_bool_t throw_bool) con
 
 counted_t<const datum_t> datum_t::get(const std::string &key,
                                       throw_bool_t throw_bool) const {
-    std::map<std::string, counted_t<const datum_t> >::const_iterator it
-        = as_object().find(key);
+    datum_object_t::const_iterator it = as_object().find(key);
     if (it != as_object().end()) return it->second;
     if (throw_bool == THROW) {
         rfail(base_exc_t::NON_EXISTENCE,
@@ -753,7 +1102,7 @@ counted_t<const datum_t> datum_t::get(const std::string &key,
     return counted_t<const datum_t>();
 }
 
-const std::map<std::string, counted_t<const datum_t> > &datum_t::as_object() const {
+const datum_object_t &datum_t::as_object() const {
     check_type(R_OBJECT);
     return *r_object;
 }
@@ -773,8 +1122,7 @@ cJSON *datum_t::as_json_raw() const {
     } break;
     case R_OBJECT: {
         scoped_cJSON_t obj(cJSON_CreateObject());
-        for (std::map<std::string, counted_t<const datum_t> >::const_iterator
-                 it = r_object->begin(); it != r_object->end(); ++it) {
+        for (auto it = r_object->begin(); it != r_object->end(); ++it) {
             obj.AddItemToObject(it->first.c_str(), it->second->as_json_raw());
         }
         return obj.release();
@@ -789,6 +1137,111 @@ scoped_cJSON_t datum_t::as_json() const {
     return scoped_cJSON_t(as_json_raw());
 }
 
+static void write_json_string(const char *str, size_t size, std::string *out) {
+    out->push_back('"');
+    const char *const end = str + size;
+    while (str != end) {
+        // Copy runs of characters that don't need escaping all at once.
+        const char *run = str;
+        while (str != end && static_cast<unsigned char>(*str) > 31
+               && *str != '"' && *str != '\\') {
+            ++str;
+        }
+        out->append(run, str - run);
+        if (str == end) {
+            break;
+        }
+        out->push_back('\\');
+        switch (*str) {
+        case '\\': out->push_back('\\'); break;
+        case '"': out->push_back('"'); break;
+        case '\b': out->push_back('b'); break;
+        case '\f': out->push_back('f'); break;
+        case '\n': out->push_back('n'); break;
+        case '\r': out->push_back('r'); break;
+        case '\t': out->push_back('t'); break;
+        default: {
+            static const char hex_digits[] = "0123456789abcdef";
+            const unsigned char c = *str;
+            out->append("u00");
+            out->push_back(hex_digits[c >> 4]);
+            out->push_back(hex_digits[c & 0xF]);
+        } break;
+        }
+        ++str;
+    }
+    out->push_back('"');
+}
+
+static void write_json_number(double d, std::string *out) {
+    // so we can use `signbit` in a GCC 4.4.3-compatible way
+    using namespace std;  // NOLINT(build/namespaces)
+
+    // Most numbers in documents are integers, which we print without going
+    // through `snprintf`.  This gives the same text as the `%.20g` that cJSON
+    // uses for integers below 2^53.
+    if (d > -9007199254740992.0 && d < 9007199254740992.0
+        && d == static_cast<double>(static_cast<int64_t>(d))
+        && !(d == 0 && signbit(d))) {
+        int64_t i = static_cast<int64_t>(d);
+        char buf[24];
+        char *p = buf + sizeof(buf);
+        const bool negative = i < 0;
+        uint64_t u = negative ? -static_cast<uint64_t>(i) : i;
+        do {
+            *--p = '0' + (u % 10);
+            u /= 10;
+        } while (u != 0);
+        if (negative) {
+            *--p = '-';
+        }
+        out->append(p, buf + sizeof(buf) - p);
+    } else {
+        char buf[64];
+        int size = snprintf(buf, sizeof(buf), "%.20g", d);
+        guarantee(size > 0 && static_cast<size_t>(size) < sizeof(buf));
+        out->append(buf, size);
+    }
+}
+
+void datum_t::write_json(std::string *out) const {
+    switch (get_type()) {
+    case R_NULL: out->append("null"); break;
+    case R_BOOL: out->append(r_bool ? "true" : "false"); break;
+    case R_NUM: {
+        // so we can use `isfinite` in a GCC 4.4.3-compatible way
+        using namespace std;  // NOLINT(build/namespaces)
+        r_sanity_check(isfinite(r_num));
+        write_json_number(r_num, out);
+    } break;
+    case R_STR: write_json_string(r_str->data(), r_str->size(), out); break;
+    case R_ARRAY: {
+        out->push_back('[');
+        for (auto it = r_array->begin(); it != r_array->end(); ++it) {
+            if (it != r_array->begin()) {
+                out->push_back(',');
+            }
+            (*it)->write_json(out);
+        }
+        out->push_back(']');
+    } break;
+    case R_OBJECT: {
+        out->push_back('{');
+        for (auto it = r_object->begin(); it != r_object->end(); ++it) {
+            if (it != r_object->begin()) {
+                out->push_back(',');
+            }
+            write_json_string(it->first.data(), it->first.size(), out);
+            out->push_back(':');
+            it->second->write_json(out);
+        }
+        out->push_back('}');
+    } break;
+    case UNINITIALIZED: // fallthru
+    default: unreachable();
+    }
+}
+
 // TODO: make STR and OBJECT convertible to sequence?
 counted_t<datum_stream_t>
 datum_t::as_datum_stream(const protob_t<const Backtrace> &backtrace) const {
@@ -821,55 +1274,76 @@ MUST_USE bool datum_t::add(const std::string &key, counted_t<const datum_t> val,
     check_type(R_OBJECT);
     check_str_validity(key);
     r_sanity_check(val.has());
-    bool key_in_obj = r_object->count(key) > 0;
-    if (!key_in_obj || (clobber_bool == CLOBBER)) (*r_object)[key] = val;
-    return key_in_obj;
+    return r_object->set(key, std::move(val), clobber_bool);
 }
 
 MUST_USE bool datum_t::delete_field(const std::string &key) {
     return r_object->erase(key);
 }
 
+// Both objects' fields are sorted, so the merges below walk them side by side and
+// add the result's fields in order, which `datum_object_t::set` does cheaply.
+
 counted_t<const datum_t> datum_t::merge(counted_t<const datum_t> rhs) const {
     if (get_type() != R_OBJECT || rhs->get_type() != R_OBJECT) { return rhs; }
 
-    datum_ptr_t d(as_object());
-    const std::map<std::string, counted_t<const datum_t> > &rhs_obj = rhs->as_object();
+    datum_ptr_t d(R_OBJECT);
+    const datum_object_t &lhs_obj = as_object();
+    const datum_object_t &rhs_obj = rhs->as_object();
+    auto lhs_it = lhs_obj.begin();
     for (auto it = rhs_obj.begin(); it != rhs_obj.end(); ++it) {
-        counted_t<const datum_t> sub_lhs = d->get(it->first, NOTHROW);
+        for (; lhs_it != lhs_obj.end() && lhs_it->first < it->first; ++lhs_it) {
+            UNUSED bool b = d.add(lhs_it->first, lhs_it->second);
+        }
+        counted_t<const datum_t> sub_lhs;
+        if (lhs_it != lhs_obj.end() && lhs_it->first == it->first) {
+            sub_lhs = lhs_it->second;
+            ++lhs_it;
+        }
         bool is_literal = it->second->is_ptype(pseudo::literal_string);
 
         if (it->second->get_type() == R_OBJECT && sub_lhs && !is_literal) {
-            UNUSED bool b = d.add(it->first, sub_lhs->merge(it->second), CLOBBER);
+            UNUSED bool b = d.add(it->first, sub_lhs->merge(it->second));
         } else {
             if (is_literal) {
                 counted_t<const datum_t> val = it->second->get(pseudo::value_key, NOTHROW);
                 if (val) {
-                    UNUSED bool b = d.add(it->first, val, CLOBBER);
-                } else {
-                    UNUSED bool b = d.delete_field(it->first);
+                    UNUSED bool b = d.add(it->first, val);
                 }
+                // Otherwise the literal deletes the field.
             } else {
-                UNUSED bool b = d.add(it->first, it->second, CLOBBER);
+                UNUSED bool b = d.add(it->first, it->second);
             }
         }
     }
+    for (; lhs_it != lhs_obj.end(); ++lhs_it) {
+        UNUSED bool b = d.add(lhs_it->first, lhs_it->second);
+    }
     return d.to_counted();
 }
 
 counted_t<const datum_t> datum_t::merge(counted_t<const datum_t> rhs,
                                         merge_resoluter_t f) const {
-    datum_ptr_t d(as_object());
-    const std::map<std::string, counted_t<const datum_t> > &rhs_obj = rhs->as_object();
+    datum_ptr_t d(R_OBJECT);
+    const datum_object_t &lhs_obj = as_object();
+    const datum_object_t &rhs_obj = rhs->as_object();
+    auto lhs_it = lhs_obj.begin();
     for (auto it = rhs_obj.begin(); it != rhs_obj.end(); ++it) {
-        if (counted_t<const datum_t> left = get(it->first, NOTHROW)) {
-            bool b = d.add(it->first, f(it->first, left, it->second), CLOBBER);
-            r_sanity_check(b);
+        for (; lhs_it != lhs_obj.end() && lhs_it->first < it->first; ++lhs_it) {
+            UNUSED bool b = d.add(lhs_it->first, lhs_it->second);
+        }
+        if (lhs_it != lhs_obj.end() && lhs_it->first == it->first) {
+            bool b = d.add(it->first, f(it->first, lhs_it->second, it->second));
+            r_sanity_check(!b);
+            ++lhs_it;
         } else {
             bool b = d.add(it->first, it->second);
             r_sanity_check(!b);
         }
     }
+    for (; lhs_it != lhs_obj.end(); ++lhs_it) {
+        UNUSED bool b = d.add(lhs_it->first, lhs_it->second);
+    }
     return d.to_counted();
 }
 
@@ -915,9 +1389,8 @@ int datum_t::cmp(const datum_t &rhs) const {
             }
             return pseudo_cmp(rhs);
         } else {
-            const std::map<std::string, counted_t<const datum_t> > &obj = as_object();
-            const std::map<std::string, counted_t<const datum_t> > &rhs_obj
-                = rhs.as_object();
+            const datum_object_t &obj = as_object();
+            const datum_object_t &rhs_obj = rhs.as_object();
             auto it = obj.begin();
             auto it2 = rhs_obj.begin();
             while (it != obj.end() && it2 != rhs_obj.end()) {
@@ -985,8 +1458,10 @@ void datum_t::init_from_pb(const Datum *d) {
         check_str_validity(r_str);
     } break;
     case Datum::R_JSON: {
-        scoped_cJSON_t cjson(cJSON_Parse(d->r_str().c_str()));
-        init_json(cjson.get());
+        const char *json = d->r_str().c_str();
+        rcheck(init_json(&json), base_exc_t::GENERIC,
+               strprintf("Failed to parse `%.20s` (truncated) as JSON.",
+                         d->r_str().c_str()));
     } break;
     case Datum::R_ARRAY: {
         init_array();
@@ -998,13 +1473,14 @@ void datum_t::init_from_pb(const Datum *d) {
         init_object();
         for (int i = 0; i < d->r_object_size(); ++i) {
             const Datum_AssocPair *ap = &d->r_object(i);
-            const std::string &key = ap->key();
+            std::string key = ap->key();
             check_str_validity(key);
-            rcheck(r_object->count(key) == 0,
-                   base_exc_t::GENERIC,
-                   strprintf("Duplicate key %s in object.", key.c_str()));
-            (*r_object)[key] = make_counted<datum_t>(&ap->val());
+            r_object->append_unsorted(std::move(key), make_counted<datum_t>(&ap->val()));
         }
+        std::string duplicate;
+        rcheck(r_object->sort_fields(&duplicate),
+               base_exc_t::GENERIC,
+               strprintf("Duplicate key %s in object.", duplicate.c_str()));
         std::set<std::string> allowed_ptypes = { pseudo::literal_string };
         maybe_sanitize_ptype(allowed_ptypes);
     } break;
@@ -1075,7 +1551,8 @@ void datum_t::write_to_protobuf(Datum *d, use_json_t use_json) const {
     } break;
     case use_json_t::YES: {
         d->set_type(Datum::R_JSON);
-        d->set_r_str(as_json().PrintUnformatted());
+        d->mutable_r_str()->clear();
+        write_json(d->mutable_r_str());
     } break;
     default: unreachable();
     }
@@ -1090,11 +1567,31 @@ enum class datum_serialized_type_t {
     R_STR = 6,
     INT_NEGATIVE = 7,
     INT_POSITIVE = 8,
+    // An object preceded by a table of field offsets, see `row_datum_t`.
+    R_OBJECT_INDEXED = 9,
 };
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(datum_serialized_type_t, int8_t,
                                       datum_serialized_type_t::R_ARRAY,
-                                      datum_serialized_type_t::INT_POSITIVE);
+                                      datum_serialized_type_t::R_OBJECT_INDEXED);
+
+// An object is serialized the same way as the `std::map` it used to be stored in.
+static size_t serialized_size(const datum_object_t &object) {
+    size_t sz = varint_uint64_serialized_size(object.size());
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        sz += serialized_size(*it);
+    }
+    return sz;
+}
+
+static write_message_t &operator<<(write_message_t &wm,
+                                   const datum_object_t &object) {
+    serialize_varint_uint64(&wm, object.size());
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        wm << *it;
+    }
+    return wm;
+}
 
 // This must be kept in sync with operator<<(write_message_t &, const counted_t<const
 // datum_T> &).
@@ -1184,6 +1681,27 @@ write_message_t &operator<<(write_message_t &wm,
     return wm;
 }
 
+// Reads `num_fields` key/value pairs.  Like deserializing a `std::map`, this keeps
+// the first of any duplicate keys.
+static archive_result_t deserialize_object_fields(read_stream_t *s,
+                                                  uint64_t num_fields,
+                                                  datum_object_t *out) {
+    for (uint64_t i = 0; i < num_fields; ++i) {
+        std::string key;
+        archive_result_t res = deserialize(s, &key);
+        if (bad(res)) {
+            return res;
+        }
+        counted_t<const datum_t> val;
+        res = deserialize(s, &val);
+        if (bad(res)) {
+            return res;
+        }
+        UNUSED bool b = out->set(key, std::move(val), NOCLOBBER);
+    }
+    return archive_result_t::SUCCESS;
+}
+
 archive_result_t deserialize(read_stream_t *s, counted_t<const datum_t> *datum) {
     datum_serialized_type_t type;
     archive_result_t res = deserialize(s, &type);
@@ -1256,8 +1774,38 @@ archive_result_t deserialize(read_stream_t *s, counted_t<const datum_t> *datum)
         }
     } break;
     case datum_serialized_type_t::R_OBJECT: {
-        std::map<std::string, counted_t<const datum_t> > value;
-        res = deserialize(s, &value);
+        uint64_t num_fields;
+        res = deserialize_varint_uint64(s, &num_fields);
+        if (bad(res)) {
+            return res;
+        }
+        datum_object_t value;
+        res = deserialize_object_fields(s, num_fields, &value);
+        if (bad(res)) {
+            return res;
+        }
+        try {
+            datum->reset(new datum_t(std::move(value)));
+        } catch (const base_exc_t &) {
+            return archive_result_t::RANGE_ERROR;
+        }
+    } break;
+    case datum_serialized_type_t::R_OBJECT_INDEXED: {
+        uint64_t num_fields;
+        res = deserialize_varint_uint64(s, &num_fields);
+        if (bad(res)) {
+            return res;
+        }
+        // The offsets are only needed to read single fields.
+        for (uint64_t i = 0; i <= num_fields; ++i) {
+            uint32_t offset;
+            res = deserialize(s, &offset);
+            if (bad(res)) {
+                return res;
+            }
+        }
+        datum_object_t value;
+        res = deserialize_object_fields(s, num_fields, &value);
         if (bad(res)) {
             return res;
         }
@@ -1287,6 +1835,82 @@ archive_result_t deserialize(read_stream_t *s, counted_t<const datum_t> *datum)
     return archive_result_t::SUCCESS;
 }
 
+// An indexed object is serialized as the number of fields, then `num_fields + 1`
+// offsets (relative to the first field, the last one being the end of the object),
+// then the fields as key/value pairs, sorted by key.
+write_message_t &operator<<(write_message_t &wm, const row_datum_t &row) {
+    if (row.datum->get_type() != datum_t::R_OBJECT) {
+        wm << row.datum;
+        return wm;
+    }
+    const datum_object_t &fields = row.datum->as_object();
+    wm << datum_serialized_type_t::R_OBJECT_INDEXED;
+    serialize_varint_uint64(&wm, fields.size());
+    uint64_t offset = 0;
+    for (auto it = fields.begin(); it != fields.end(); ++it) {
+        wm << static_cast<uint32_t>(offset);
+        offset += serialized_size(it->first) + serialized_size(it->second);
+        guarantee(offset <= std::numeric_limits<uint32_t>::max());
+    }
+    wm << static_cast<uint32_t>(offset);
+    for (auto it = fields.begin(); it != fields.end(); ++it) {
+        wm << it->first;
+        wm << it->second;
+    }
+    return wm;
+}
+
+counted_t<const datum_t> deserialize_row_fields(const const_buffer_group_t *group,
+                                                const std::set<std::string> &fields) {
+    buffer_group_read_stream_t s(group);
+    datum_serialized_type_t type;
+    archive_result_t res = deserialize(&s, &type);
+    guarantee_deserialization(res, "row type");
+    // A pseudotype can't be validated from some of its fields.
+    if (type != datum_serialized_type_t::R_OBJECT_INDEXED
+        || fields.count(datum_t::reql_type_string) != 0) {
+        return counted_t<const datum_t>();
+    }
+    uint64_t num_fields;
+    res = deserialize_varint_uint64(&s, &num_fields);
+    guarantee_deserialization(res, "row field count");
+    const int64_t table_start = 1 + varint_uint64_serialized_size(num_fields);
+    const int64_t fields_start = table_start + (num_fields + 1) * sizeof(uint32_t);
+
+    datum_object_t value;
+    for (auto field = fields.begin(); field != fields.end(); ++field) {
+        // Binary search the sorted fields for `*field`.
+        uint64_t lo = 0;
+        uint64_t hi = num_fields;
+        counted_t<const datum_t> field_value;
+        while (lo < hi && !field_value.has()) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            uint32_t offset;
+            guarantee(s.seek(table_start + mid * sizeof(uint32_t)));
+            res = deserialize(&s, &offset);
+            guarantee_deserialization(res, "row field offset");
+            std::string key;
+            guarantee(s.seek(fields_start + offset));
+            res = deserialize(&s, &key);
+            guarantee_deserialization(res, "row field name");
+            const int cmp = key.compare(*field);
+            if (cmp < 0) {
+                lo = mid + 1;
+            } else if (cmp > 0) {
+                hi = mid;
+            } else {
+                res = deserialize(&s, &field_value);
+                guarantee_deserialization(res, "row field");
+            }
+        }
+        if (!field_value.has()) {
+            return counted_t<const datum_t>();
+        }
+        UNUSED bool b = value.set(*field, std::move(field_value), NOCLOBBER);
+    }
+    return make_counted<const datum_t>(std::move(value));
+}
+
 write_message_t &operator<<(write_message_t &wm,
                             const empty_ok_t<const counted_t<const datum_t> > &datum) {
     const counted_t<const datum_t> *pointer = datum.get();
@@ -21,6 +21,7 @@
 #include "rdb_protocol/error.hpp"
 
 class Datum;
+class const_buffer_group_t;
 
 RDB_DECLARE_SERIALIZABLE(Datum);
 
@@ -51,6 +52,48 @@ enum class use_json_t { NO = 0, YES = 1 };
 
 class grouped_data_t;
 
+// The fields of an object `datum_t`, kept sorted by name in a single array.  An
+// object costs one allocation for all of its fields (plus whatever its long field
+// names need), and looking up a field is a binary search over contiguous memory.
+// It offers the part of the `std::map` interface that callers of `as_object` use.
+class datum_object_t {
+public:
+    typedef std::string key_type;
+    typedef std::pair<std::string, counted_t<const datum_t> > value_type;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+    typedef std::vector<value_type>::const_reverse_iterator const_reverse_iterator;
+
+    datum_object_t() { }
+    explicit datum_object_t(std::map<std::string, counted_t<const datum_t> > &&map);
+
+    size_t size() const { return fields.size(); }
+    bool empty() const { return fields.empty(); }
+    const_iterator begin() const { return fields.begin(); }
+    const_iterator end() const { return fields.end(); }
+    const_reverse_iterator rbegin() const { return fields.rbegin(); }
+    const_reverse_iterator rend() const { return fields.rend(); }
+
+    const_iterator find(const std::string &key) const;
+    size_t count(const std::string &key) const { return find(key) == end() ? 0 : 1; }
+
+    // Returns true if `key` was already in the object, in which case its value is
+    // only replaced if `clobber_bool` is `CLOBBER`.  Adding fields in sorted order
+    // is cheap.
+    MUST_USE bool set(const std::string &key, counted_t<const datum_t> val,
+                      clobber_bool_t clobber_bool);
+    // Returns the number of fields removed.
+    size_t erase(const std::string &key);
+
+    // For building an object from fields that arrive in any order: append them all
+    // with `append_unsorted`, then call `sort_fields`, which returns false and sets
+    // `*duplicate_out` if two of them have the same name.
+    void append_unsorted(std::string &&key, counted_t<const datum_t> &&val);
+    MUST_USE bool sort_fields(std::string *duplicate_out);
+
+private:
+    std::vector<value_type> fields;
+};
+
 // A `datum_t` is basically a JSON value, although we may extend it later.
 class datum_t : public slow_atomic_countable_t<datum_t> {
 public:
@@ -76,6 +119,7 @@ public:
     explicit datum_t(const char *cstr);
     explicit datum_t(std::vector<counted_t<const datum_t> > &&_array);
     explicit datum_t(std::map<std::string, counted_t<const datum_t> > &&object);
+    explicit datum_t(datum_object_t &&object);
 
     // This should only be used to send responses to the client.
     explicit datum_t(grouped_data_t &&gd);
@@ -86,10 +130,21 @@ public:
     void init_from_pb(const Datum *d);
     explicit datum_t(cJSON *json);
     explicit datum_t(const scoped_cJSON_t &json);
+    // Parses the NUL-terminated `json` straight into a datum, without building a
+    // `cJSON` tree first.  Returns an empty `counted_t` if `json` isn't valid JSON.
+    static counted_t<const datum_t> parse_json(const char *json);
 
     ~datum_t();
 
+    // Queries create and drop datums at a high rate, so freed ones are kept on a
+    // per-thread free list and handed out again instead of going through malloc.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr);
+
     void write_to_protobuf(Datum *out, use_json_t use_json) const;
+    // Appends the same text as `as_json().PrintUnformatted()` to `out`, without
+    // building a `cJSON` tree first.
+    void write_json(std::string *out) const;
 
     type_t get_type() const;
     bool is_ptype() const;
@@ -126,7 +181,7 @@ public:
     // Access an element of an array.
     counted_t<const datum_t> get(size_t index, throw_bool_t throw_bool = THROW) const;
     // Use of `get` is preferred to `as_object` when possible.
-    const std::map<std::string, counted_t<const datum_t> > &as_object() const;
+    const datum_object_t &as_object() const;
 
     // Access an element of an object.
     counted_t<const datum_t> get(const std::string &key,
@@ -195,6 +250,8 @@ private:
     void init_array();
     void init_object();
     void init_json(cJSON *json);
+    // Parses the JSON value at `*json` and moves `*json` past it.
+    MUST_USE bool init_json(const char **json);
 
     void check_str_validity(const wire_string_t *str);
     void check_str_validity(const std::string &str);
@@ -216,7 +273,7 @@ private:
         double r_num;
         wire_string_t *r_str;
         std::vector<counted_t<const datum_t> > *r_array;
-        std::map<std::string, counted_t<const datum_t> > *r_object;
+        datum_object_t *r_object;
     };
 
 public:
@@ -234,6 +291,23 @@ archive_result_t deserialize(read_stream_t *s, counted_t<const datum_t> *datum);
 write_message_t &operator<<(write_message_t &wm, const empty_ok_t<const counted_t<const datum_t> > &datum);
 archive_result_t deserialize(read_stream_t *s, empty_ok_ref_t<counted_t<const datum_t> > datum);
 
+// Rows get stored through this wrapper, which serializes objects with a sorted table
+// of field offsets in front of the fields.  `deserialize` reads both encodings, and
+// `deserialize_row_fields` reads single fields without touching the rest of the row.
+class row_datum_t {
+public:
+    explicit row_datum_t(const counted_t<const datum_t> &_datum) : datum(_datum) { }
+    const counted_t<const datum_t> &datum;
+};
+
+write_message_t &operator<<(write_message_t &wm, const row_datum_t &row);
+
+// Returns an object with just the fields in `fields` of the row serialized in
+// `group`.  Returns an empty `counted_t` if the row wasn't written with an offset
+// table or lacks one of the fields, in which case the whole row has to be read.
+counted_t<const datum_t> deserialize_row_fields(const const_buffer_group_t *group,
+                                                const std::set<std::string> &fields);
+
 // Converts a double to int, but returns false if it's not an integer or out of range.
 bool number_as_integer(double d, int64_t *i_out);
 
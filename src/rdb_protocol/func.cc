@@ -1,5 +1,7 @@
 #include "rdb_protocol/func.hpp"
 
+#include <algorithm>
+
 #include "rdb_protocol/counted_term.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/minidriver.hpp"
@@ -223,8 +225,7 @@ bool filter_match(counted_t<const datum_t> predicate, counted_t<const datum_t> v
     if (predicate->is_ptype(pseudo::literal_string)) {
         return *predicate->get(pseudo::value_key) == *value;
     } else {
-        const std::map<std::string, counted_t<const datum_t> > &obj
-            = predicate->as_object();
+        const datum_object_t &obj = predicate->as_object();
         for (auto it = obj.begin(); it != obj.end(); ++it) {
             r_sanity_check(it->second.has());
             counted_t<const datum_t> elt = value->get(it->first, NOTHROW);
@@ -321,6 +322,85 @@ bool func_t::filter_call(env_t *env, counted_t<const datum_t> arg, counted_t<fun
     std::rethrow_exception(saved_exception);
 }
 
+// Whether `t` is the variable `var`.  `r.row` is `var` when `var` is the only
+// argument of the function, because it can't be used in nested functions.
+bool term_is_var(const Term &t, sym_t var) {
+    if (t.type() == Term::IMPLICIT_VAR) {
+        return function_emits_implicit_variable(std::vector<sym_t>{var});
+    }
+    return t.type() == Term::VAR
+        && t.args_size() == 1
+        && t.args(0).type() == Term::DATUM
+        && t.args(0).datum().type() == Datum::R_NUM
+        && t.args(0).datum().r_num() == static_cast<double>(var.value);
+}
+
+bool term_fields_read(const Term &t, sym_t var, std::set<std::string> *fields_out) {
+    if (t.type() == Term::IMPLICIT_VAR || term_is_var(t, var)) {
+        // The whole argument gets used (or `r.row` refers to something we don't know).
+        return false;
+    }
+    if ((t.type() == Term::GET_FIELD || t.type() == Term::PLUCK)
+        && t.args_size() >= 2 && term_is_var(t.args(0), var)) {
+        if (t.type() == Term::GET_FIELD && t.args_size() != 2) {
+            return false;
+        }
+        for (int i = 1; i < t.args_size(); ++i) {
+            const Term &field = t.args(i);
+            if (field.type() != Term::DATUM
+                || field.datum().type() != Datum::R_STR) {
+                return false;
+            }
+            fields_out->insert(field.datum().r_str());
+        }
+    } else {
+        for (int i = 0; i < t.args_size(); ++i) {
+            if (!term_fields_read(t.args(i), var, fields_out)) {
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < t.optargs_size(); ++i) {
+        if (!term_fields_read(t.optargs(i).val(), var, fields_out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class field_reads_visitor_t : public func_visitor_t {
+public:
+    explicit field_reads_visitor_t(std::set<std::string> *_fields_out)
+        : fields_out(_fields_out), result(false) { }
+
+    void on_reql_func(const reql_func_t *reql_func) {
+        result = reql_func->arg_names.size() == 1
+            && term_fields_read(*reql_func->body->get_src(),
+                                reql_func->arg_names[0], fields_out);
+    }
+
+    void on_js_func(const js_func_t *) {
+        result = false;
+    }
+
+    std::set<std::string> *fields_out;
+    bool result;
+};
+
+bool func_fields_read(const counted_t<func_t> &f, std::set<std::string> *fields_out) {
+    field_reads_visitor_t v(fields_out);
+    f->visit(&v);
+    return v.result;
+}
+
+bool func_only_reads_fields(const counted_t<func_t> &f,
+                            const std::set<std::string> &fields) {
+    std::set<std::string> fields_read;
+    return func_fields_read(f, &fields_read)
+        && std::includes(fields.begin(), fields.end(),
+                         fields_read.begin(), fields_read.end());
+}
+
 counted_t<func_t> new_constant_func(counted_t<const datum_t> obj,
                                     const protob_t<const Backtrace> &bt_src) {
     protob_t<Term> twrap = r::fun(r::expr(obj)).release_counted();
@@ -3,6 +3,7 @@
 #define RDB_PROTOCOL_FUNC_HPP_
 
 #include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -85,6 +86,7 @@ public:
 
 private:
     friend class wire_func_serialization_visitor_t;
+    friend class field_reads_visitor_t;
     bool filter_helper(env_t *env, counted_t<const datum_t> arg) const;
 
     // Only contains the parts of the scope that `body` uses.
@@ -138,6 +140,16 @@ protected:
     DISABLE_COPYING(func_visitor_t);
 };
 
+// If `f` is a function of one argument that only uses its argument to get fields
+// (with `get_field` or `pluck`), adds those fields to `fields_out` and returns true.
+// Such a function returns the same for an object with just those fields of a row as
+// for the row itself.
+bool func_fields_read(const counted_t<func_t> &f, std::set<std::string> *fields_out);
+
+// Whether `f` only uses its argument to get the fields in `fields`.
+bool func_only_reads_fields(const counted_t<func_t> &f,
+                            const std::set<std::string> &fields);
+
 // Some queries, like filter, can take a shortcut object instead of a
 // function as their argument.
 
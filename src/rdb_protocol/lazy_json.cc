@@ -21,6 +21,26 @@ counted_t<const ql::datum_t> get_data(const rdb_value_t *value, buf_parent_t par
     return data;
 }
 
+counted_t<const ql::datum_t> get_data_fields(const rdb_value_t *value,
+                                             buf_parent_t parent,
+                                             const std::set<std::string> &fields) {
+    rdb_blob_wrapper_t blob(parent.cache()->get_block_size(),
+                            const_cast<rdb_value_t *>(value)->value_ref(),
+                            blob::btree_maxreflen);
+
+    blob_acq_t acq_group;
+    buffer_group_t buffer_group;
+    blob.expose_all(parent, access_t::read, &buffer_group, &acq_group);
+    counted_t<const ql::datum_t> data
+        = ql::deserialize_row_fields(const_view(&buffer_group), fields);
+    if (!data.has()) {
+        buffer_group_read_stream_t read_stream(const_view(&buffer_group));
+        archive_result_t res = deserialize(&read_stream, &data);
+        guarantee_deserialization(res, "rdb value");
+    }
+    return data;
+}
+
 const counted_t<const ql::datum_t> &lazy_json_t::get() const {
     guarantee(pointee.has());
     if (!pointee->ptr.has()) {
@@ -31,6 +51,15 @@ const counted_t<const ql::datum_t> &lazy_json_t::get() const {
     return pointee->ptr;
 }
 
+counted_t<const ql::datum_t>
+lazy_json_t::get_fields(const std::set<std::string> &fields) const {
+    guarantee(pointee.has());
+    if (pointee->ptr.has()) {
+        return pointee->ptr;
+    }
+    return get_data_fields(pointee->rdb_value, pointee->parent, fields);
+}
+
 bool lazy_json_t::references_parent() const {
     return pointee.has() && !pointee->parent.empty();
 }
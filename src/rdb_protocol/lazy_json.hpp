@@ -2,6 +2,9 @@
 #ifndef RDB_PROTOCOL_LAZY_JSON_HPP_
 #define RDB_PROTOCOL_LAZY_JSON_HPP_
 
+#include <set>
+#include <string>
+
 #include "buffer_cache/alt/alt.hpp"
 #include "buffer_cache/alt/blob.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -30,6 +33,12 @@ public:
 counted_t<const ql::datum_t> get_data(const rdb_value_t *value,
                                       buf_parent_t parent);
 
+// Returns an object with just the fields in `fields` of the row, which gets read
+// without deserializing the other fields if possible.
+counted_t<const ql::datum_t> get_data_fields(const rdb_value_t *value,
+                                             buf_parent_t parent,
+                                             const std::set<std::string> &fields);
+
 class lazy_json_pointee_t : public single_threaded_countable_t<lazy_json_pointee_t> {
     lazy_json_pointee_t(const rdb_value_t *_rdb_value, buf_parent_t _parent)
         : rdb_value(_rdb_value), parent(_parent) {
@@ -63,6 +72,9 @@ public:
         : pointee(new lazy_json_pointee_t(rdb_value, parent)) { }
 
     const counted_t<const ql::datum_t> &get() const;
+    // Like `get`, except that only the fields in `fields` have to be in the result.
+    // Doesn't load the rest of the row if it can avoid it.
+    counted_t<const ql::datum_t> get_fields(const std::set<std::string> &fields) const;
     bool references_parent() const;
     void reset();
 
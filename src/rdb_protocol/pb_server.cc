@@ -42,7 +42,8 @@ namespace ql {
              rdb_protocol_t::context_t *ctx,
              signal_t *interruptor,
              Response *res,
-             stream_cache2_t *stream_cache2);
+             stream_cache2_t *stream_cache2,
+             prepared_query_cache_t *prepared_queries);
 }
 
 class scoped_ops_running_stat_t {
@@ -63,6 +64,7 @@ bool query2_server_t::handle(ql::protob_t<Query> q,
                              Response *response_out,
                              context_t *query2_context) {
     ql::stream_cache2_t *stream_cache2 = &query2_context->stream_cache2;
+    ql::prepared_query_cache_t *prepared_queries = &query2_context->prepared_queries;
     signal_t *interruptor = query2_context->interruptor;
     guarantee(interruptor);
     response_out->set_token(q->token());
@@ -75,7 +77,7 @@ bool query2_server_t::handle(ql::protob_t<Query> q,
         scoped_ops_running_stat_t stat(&ctx->ql_ops_running);
         guarantee(ctx->directory_read_manager);
         // `ql::run` will set the status code
-        ql::run(q, ctx, interruptor, response_out, stream_cache2);
+        ql::run(q, ctx, interruptor, response_out, stream_cache2, prepared_queries);
     } catch (const ql::exc_t &e) {
         fill_error(response_out, Response::COMPILE_ERROR, e.what(), e.backtrace());
     } catch (const ql::datum_exc_t &e) {
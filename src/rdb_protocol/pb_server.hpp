@@ -8,6 +8,7 @@
 
 #include "protob/protob.hpp"
 #include "protocol_api.hpp"
+#include "rdb_protocol/prepared_queries.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 
@@ -31,6 +32,7 @@ public:
         static const int32_t no_auth_magic_number = VersionDummy::V0_1;
         static const int32_t auth_magic_number = VersionDummy::V0_2;
         ql::stream_cache2_t stream_cache2;
+        ql::prepared_query_cache_t prepared_queries;
         signal_t *interruptor;
     };
 private:
@@ -0,0 +1,45 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/prepared_queries.hpp"
+
+#include "rdb_protocol/func.hpp"
+
+namespace ql {
+
+prepared_query_cache_t::prepared_query_cache_t()
+    : total_bytes(0), next_id(1), use_counter(0) { }
+
+prepared_query_cache_t::~prepared_query_cache_t() { }
+
+int64_t prepared_query_cache_t::insert(counted_t<func_t> func, size_t bytes) {
+    guarantee(bytes <= MAX_PREPARED_QUERY_BYTES);
+    while (queries.size() >= MAX_PREPARED_QUERIES
+           || total_bytes + bytes > MAX_PREPARED_QUERY_BYTES) {
+        // Preparing is rare next to executing, so a linear scan is fine here.
+        auto oldest = queries.begin();
+        for (auto it = queries.begin(); it != queries.end(); ++it) {
+            if (it->second.last_use < oldest->second.last_use) {
+                oldest = it;
+            }
+        }
+        total_bytes -= oldest->second.bytes;
+        queries.erase(oldest);
+    }
+    const int64_t id = next_id++;
+    entry_t *entry = &queries[id];
+    entry->func = std::move(func);
+    entry->bytes = bytes;
+    entry->last_use = ++use_counter;
+    total_bytes += bytes;
+    return id;
+}
+
+counted_t<func_t> prepared_query_cache_t::get(int64_t id) {
+    auto it = queries.find(id);
+    if (it == queries.end()) {
+        return counted_t<func_t>();
+    }
+    it->second.last_use = ++use_counter;
+    return it->second.func;
+}
+
+} // namespace ql
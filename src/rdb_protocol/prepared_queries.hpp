@@ -0,0 +1,51 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_PREPARED_QUERIES_HPP_
+#define RDB_PROTOCOL_PREPARED_QUERIES_HPP_
+
+#include <map>
+
+#include "config/args.hpp"
+#include "containers/counted.hpp"
+
+namespace ql {
+
+class func_t;
+
+// The functions a connection registered with [PREPARE] queries, compiled and
+// ready to be called by [EXECUTE] queries.  At most `MAX_PREPARED_QUERIES` are
+// kept, and their queries may take up at most `MAX_PREPARED_QUERY_BYTES` (as
+// sent by the client, which is what we can measure cheaply).  The least recently
+// used ones are forgotten to make room for a new one.
+class prepared_query_cache_t {
+public:
+    static const size_t MAX_PREPARED_QUERIES = 1000;
+    static const size_t MAX_PREPARED_QUERY_BYTES = 16 * MEGABYTE;
+
+    prepared_query_cache_t();
+    ~prepared_query_cache_t(); // `func_t` is incomplete
+
+    // Returns the id of the new prepared query, whose query took `bytes`, which must
+    // be at most `MAX_PREPARED_QUERY_BYTES`.  Ids are never reused, so a forgotten
+    // query can't be mistaken for a newer one.
+    int64_t insert(counted_t<func_t> func, size_t bytes);
+    // Returns an empty `counted_t` if there's no prepared query `id` (anymore).
+    counted_t<func_t> get(int64_t id);
+
+private:
+    struct entry_t {
+        counted_t<func_t> func;
+        size_t bytes;
+        uint64_t last_use;
+    };
+
+    std::map<int64_t, entry_t> queries;
+    size_t total_bytes;
+    int64_t next_id;
+    uint64_t use_counter;
+
+    DISABLE_COPYING(prepared_query_cache_t);
+};
+
+} // namespace ql
+
+#endif  // RDB_PROTOCOL_PREPARED_QUERIES_HPP_
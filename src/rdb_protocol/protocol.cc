@@ -145,6 +145,45 @@ key_range_t datum_range_t::to_sindex_keyrange() const {
             : store_key_t::max());
 }
 
+// The prefix of the secondary index keys of rows whose value is `num`: an "N" and
+// the number's bits in hex, which a '#' and the number's printed form follow.
+store_key_t numeric_sindex_key_prefix(double num) {
+    const std::string key
+        = key_to_unescaped_str(ql::datum_t(num).truncated_secondary());
+    return store_key_t(key.substr(0, key.find('#')));
+}
+
+// The first key of a row whose value is `num`, and the key after the last one.
+// Zero has two encodings, -0.0 and 0.0, which are next to each other.
+store_key_t numeric_sindex_keys_start(double num) {
+    return numeric_sindex_key_prefix(num == 0 ? -0.0 : num);
+}
+store_key_t numeric_sindex_keys_end(double num) {
+    // Every key with the prefix continues with '#', so the prefix followed by the
+    // next character is above all of them.
+    const store_key_t prefix = numeric_sindex_key_prefix(num == 0 ? 0.0 : num);
+    return store_key_t(key_to_unescaped_str(prefix) + static_cast<char>('#' + 1));
+}
+
+bool datum_range_t::to_exact_sindex_keyrange(key_range_t *out) const {
+    if (!left_bound.has() || left_bound->get_type() != ql::datum_t::R_NUM
+        || !right_bound.has() || right_bound->get_type() != ql::datum_t::R_NUM) {
+        return false;
+    }
+    const double left_num = left_bound->as_num();
+    const double right_num = right_bound->as_num();
+    const store_key_t left = (left_bound_type == key_range_t::closed
+                              ? numeric_sindex_keys_start(left_num)
+                              : numeric_sindex_keys_end(left_num));
+    const store_key_t right = (right_bound_type == key_range_t::closed
+                               ? numeric_sindex_keys_end(right_num)
+                               : numeric_sindex_keys_start(right_num));
+    *out = (left < right
+            ? key_range_t(key_range_t::closed, left, key_range_t::open, right)
+            : key_range_t::empty());
+    return true;
+}
+
 namespace rdb_protocol_details {
 
 RDB_IMPL_SERIALIZABLE_3(backfill_atom_t, key, value, recency);
@@ -906,7 +945,8 @@ struct rdb_w_shard_visitor_t : public boost::static_visitor<bool> {
         if (!shard_inserts.empty()) {
             *write_out = write_t(
                 batched_insert_t(
-                    std::move(shard_inserts), bi.pkey, bi.upsert, bi.return_vals),
+                    std::move(shard_inserts), bi.pkey, bi.upsert, bi.return_vals,
+                    bi.bulk_load),
                 durability_requirement,
                 profile);
             return true;
@@ -1115,7 +1155,19 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         rget_read_response_t *res =
             boost::get<rget_read_response_t>(&response->response);
 
-        if (!rget.sindex) {
+        // A count that covers all of the store's data is just the number of keys
+        // in the btree.  Counts of a key range add up the key counts that the
+        // btree's internal nodes keep.  Note that the stat block isn't part of the
+        // superblock's snapshot: a whole-store count sees the writes applied by
+        // the time the stat block is read, not the snapshot's state.
+        const bool plain_count
+            = rdb_rget_is_plain_count(rget.transforms, rget.terminal);
+        const bool whole_store = region_is_superset(rget.region, store->get_region());
+
+        if (!rget.sindex && plain_count) {
+            rdb_count_slice(superblock, rget.region.inner, whole_store,
+                            &ql_env, rget.sorting, res);
+        } else if (!rget.sindex) {
             // Normal rget
             rdb_rget_slice(btree, rget.region.inner, superblock,
                            &ql_env, rget.batchspec, rget.transforms, rget.terminal,
@@ -1147,18 +1199,33 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             //  between sindex_start_value and sindex_end_value.
             ql::map_wire_func_t sindex_mapping;
             sindex_multi_bool_t multi_bool = sindex_multi_bool_t::MULTI;
-            inplace_vector_read_stream_t read_stream(&sindex_mapping_data);
-            archive_result_t success = deserialize(&read_stream, &sindex_mapping);
-            guarantee_deserialization(success, "sindex description");
-            success = deserialize(&read_stream, &multi_bool);
-            guarantee_deserialization(success, "sindex description");
+            std::vector<std::string> covered_fields;
+            deserialize_sindex_definition(sindex_mapping_data, &sindex_mapping,
+                                          &multi_bool, &covered_fields);
+
+            // Truncated secondary index keys don't tell whether their row is in a
+            // partial range, so only counts of the whole index and of number
+            // ranges skip the rget.  (As above, the index's stat block isn't
+            // snapshotted.)
+            key_range_t count_range;
+            if (plain_count && whole_store && rget.sindex->original_range.is_universe()) {
+                rdb_count_slice(sindex_sb.get(), rget.sindex->region.inner, true,
+                                &ql_env, rget.sorting, res);
+                return;
+            } else if (plain_count && whole_store
+                       && rget.sindex->original_range.to_exact_sindex_keyrange(
+                           &count_range)) {
+                rdb_count_slice(sindex_sb.get(), count_range, false,
+                                &ql_env, rget.sorting, res);
+                return;
+            }
 
             rdb_rget_secondary_slice(
                 store->get_sindex_slice(rget.sindex->id),
                 rget.sindex->original_range, rget.sindex->region,
                 sindex_sb.get(), &ql_env, rget.batchspec, rget.transforms,
                 rget.terminal, rget.region.inner, rget.sorting,
-                sindex_mapping, multi_bool, res);
+                sindex_mapping, multi_bool, covered_fields, res);
         }
     }
 
@@ -1374,12 +1441,21 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         for (auto it = bi.inserts.begin(); it != bi.inserts.end(); ++it) {
             keys.emplace_back((*it)->get(bi.pkey)->print_primary());
         }
-        response->response =
-            rdb_batched_replace(
-                btree_info_t(btree, timestamp,
-                             &bi.pkey),
-                superblock, keys, &replacer, &sindex_cb,
-                ql_env.trace.get_or_null());
+        if (bi.bulk_load) {
+            response->response =
+                rdb_batched_bulk_load(
+                    btree_info_t(btree, timestamp,
+                                 &bi.pkey),
+                    superblock, keys, &replacer, &sindex_cb,
+                    ql_env.trace.get_or_null());
+        } else {
+            response->response =
+                rdb_batched_replace(
+                    btree_info_t(btree, timestamp,
+                                 &bi.pkey),
+                    superblock, keys, &replacer, &sindex_cb,
+                    ql_env.trace.get_or_null());
+        }
     }
 
     void operator()(const point_write_t &w) {
@@ -1412,8 +1488,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         sindex_create_response_t res;
 
         write_message_t wm;
-        wm << c.mapping;
-        wm << c.multi;
+        serialize_sindex_definition(&wm, c.mapping, c.multi, c.covered_fields);
 
         vector_stream_t stream;
         stream.reserve(wm.size());
@@ -1790,11 +1865,11 @@ private:
                     &sindex_block, &sindexes);
             sindex_block.reset_buf_lock();
 
-            rdb_live_deletion_context_t deletion_context;
             for (size_t i = 0; i < mod_reports.size(); ++i) {
                 queue_wms[i] << rdb_sindex_change_t(mod_reports[i]);
-                rdb_update_sindexes(sindexes, &mod_reports[i], txn, &deletion_context);
             }
+            rdb_live_deletion_context_t deletion_context;
+            rdb_update_sindexes(sindexes, mod_reports, txn, &deletion_context);
         }
 
         // Write mod reports onto the sindex queue. We are in line for the
@@ -1899,13 +1974,14 @@ RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::write_response_t, response, event_log
 
 RDB_IMPL_ME_SERIALIZABLE_5(rdb_protocol_t::batched_replace_t,
                            keys, pkey, f, optargs, return_vals);
-RDB_IMPL_ME_SERIALIZABLE_4(rdb_protocol_t::batched_insert_t,
-                           inserts, pkey, upsert, return_vals);
+RDB_IMPL_ME_SERIALIZABLE_5(rdb_protocol_t::batched_insert_t,
+                           inserts, pkey, upsert, return_vals, bulk_load);
 
 RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::point_write_t, key, data, overwrite);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_delete_t, key);
 
-RDB_IMPL_ME_SERIALIZABLE_4(rdb_protocol_t::sindex_create_t, id, mapping, region, multi);
+RDB_IMPL_ME_SERIALIZABLE_5(rdb_protocol_t::sindex_create_t,
+                           id, mapping, region, multi, covered_fields);
 RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::sindex_drop_t, id, region);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::sync_t, region);
 
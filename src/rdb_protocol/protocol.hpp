@@ -110,6 +110,13 @@ public:
     bool contains(counted_t<const ql::datum_t> val) const;
     bool is_universe() const;
 
+    // If both bounds are numbers, sets `*out` to the secondary index keys whose
+    // value lies in the range and returns true.  Number keys are never truncated
+    // and sort in the order of their values, so the keys are exactly the range's
+    // rows.  Other keys (strings in particular) aren't self-delimiting, so their
+    // order isn't their values' order, and this returns false for them.
+    bool to_exact_sindex_keyrange(key_range_t *out) const;
+
     RDB_DECLARE_ME_SERIALIZABLE;
 
 private:
@@ -522,9 +529,10 @@ struct rdb_protocol_t {
         batched_insert_t() { }
         batched_insert_t(
             std::vector<counted_t<const ql::datum_t> > &&_inserts,
-            const std::string &_pkey, bool _upsert, bool _return_vals)
+            const std::string &_pkey, bool _upsert, bool _return_vals,
+            bool _bulk_load)
             : inserts(std::move(_inserts)), pkey(_pkey),
-              upsert(_upsert), return_vals(_return_vals) {
+              upsert(_upsert), return_vals(_return_vals), bulk_load(_bulk_load) {
             r_sanity_check(inserts.size() != 0);
             r_sanity_check(inserts.size() == 1 || !return_vals);
 #ifndef NDEBUG
@@ -548,6 +556,9 @@ struct rdb_protocol_t {
         std::string pkey;
         bool upsert;
         bool return_vals;
+        // Append rows that go after the end of the table with the btree bulk
+        // loader.  See `rdb_batched_bulk_load`.
+        bool bulk_load;
         RDB_DECLARE_ME_SERIALIZABLE;
     };
 
@@ -581,14 +592,18 @@ struct rdb_protocol_t {
     public:
         sindex_create_t() { }
         sindex_create_t(const std::string &_id, const ql::map_wire_func_t &_mapping,
-                        sindex_multi_bool_t _multi)
-            : id(_id), mapping(_mapping), region(region_t::universe()), multi(_multi)
+                        sindex_multi_bool_t _multi,
+                        const std::vector<std::string> &_covered_fields)
+            : id(_id), mapping(_mapping), region(region_t::universe()), multi(_multi),
+              covered_fields(_covered_fields)
         { }
 
         std::string id;
         ql::map_wire_func_t mapping;
         region_t region;
         sindex_multi_bool_t multi;
+        // The fields of the rows that the index keeps a copy of.
+        std::vector<std::string> covered_fields;
 
         RDB_DECLARE_ME_SERIALIZABLE;
     };
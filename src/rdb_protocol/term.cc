@@ -5,6 +5,7 @@
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/prepared_queries.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rdb_protocol/term_walker.hpp"
 #include "rdb_protocol/validate.hpp"
@@ -168,11 +169,79 @@ counted_t<term_t> compile_term(compile_env_t *env, protob_t<const Term> t) {
     unreachable();
 }
 
+// Returns true if `t` or any of its subterms has type `type`.
+static bool term_contains(const Term &t, Term::TermType type) {
+    if (t.type() == type) {
+        return true;
+    }
+    for (int i = 0; i < t.args_size(); ++i) {
+        if (term_contains(t.args(i), type)) {
+            return true;
+        }
+    }
+    for (int i = 0; i < t.optargs_size(); ++i) {
+        if (term_contains(t.optargs(i).val(), type)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fills in `res` with the value a [START] or [EXECUTE] query evaluated to.  Streams
+// that don't fit in one response are handed over to `stream_cache2`, along with
+// `*env`.
+static void respond_with_val(counted_t<val_t> val,
+                             int64_t token,
+                             use_json_t use_json,
+                             signal_t *interruptor,
+                             scoped_ptr_t<env_t> *env,
+                             Response *res,
+                             stream_cache2_t *stream_cache2) {
+    if (val->get_type().is_convertible(val_t::type_t::DATUM)) {
+        res->set_type(Response_ResponseType_SUCCESS_ATOM);
+        counted_t<const datum_t> d = val->as_datum();
+        d->write_to_protobuf(res->add_response(), use_json);
+        if ((*env)->trace.has()) {
+            (*env)->trace->as_datum()->write_to_protobuf(
+                res->mutable_profile(), use_json);
+        }
+    } else if (counted_t<grouped_data_t> gd
+               = val->maybe_as_promiscuous_grouped_data(env->get())) {
+        res->set_type(Response::SUCCESS_ATOM);
+        datum_t d(std::move(*gd));
+        d.write_to_protobuf(res->add_response(), use_json);
+        if ((*env)->trace.has()) {
+            (*env)->trace->as_datum()->write_to_protobuf(
+                res->mutable_profile(), use_json);
+        }
+    } else if (val->get_type().is_convertible(val_t::type_t::SEQUENCE)) {
+        counted_t<datum_stream_t> seq = val->as_seq(env->get());
+        if (counted_t<const datum_t> arr = seq->as_array(env->get())) {
+            res->set_type(Response_ResponseType_SUCCESS_ATOM);
+            arr->write_to_protobuf(res->add_response(), use_json);
+            if ((*env)->trace.has()) {
+                (*env)->trace->as_datum()->write_to_protobuf(
+                    res->mutable_profile(), use_json);
+            }
+        } else {
+            stream_cache2->insert(token, use_json, std::move(*env), seq);
+            bool b = stream_cache2->serve(token, res, interruptor);
+            r_sanity_check(b);
+        }
+    } else {
+        rfail_toplevel(base_exc_t::GENERIC,
+                       "Query result must be of type "
+                       "DATUM, GROUPED_DATA, or STREAM (got %s).",
+                       val->get_type().name());
+    }
+}
+
 void run(protob_t<Query> q,
          rdb_protocol_t::context_t *ctx,
          signal_t *interruptor,
          Response *res,
-         stream_cache2_t *stream_cache2) {
+         stream_cache2_t *stream_cache2,
+         prepared_query_cache_t *prepared_queries) {
     try {
         validate_pb(*q);
     } catch (const base_exc_t &e) {
@@ -226,43 +295,8 @@ void run(protob_t<Query> q,
         try {
             scope_env_t scope_env(env.get(), var_scope_t());
             counted_t<val_t> val = root_term->eval(&scope_env);
-            if (val->get_type().is_convertible(val_t::type_t::DATUM)) {
-                res->set_type(Response_ResponseType_SUCCESS_ATOM);
-                counted_t<const datum_t> d = val->as_datum();
-                d->write_to_protobuf(res->add_response(), use_json);
-                if (env->trace.has()) {
-                    env->trace->as_datum()->write_to_protobuf(
-                        res->mutable_profile(), use_json);
-                }
-            } else if (counted_t<grouped_data_t> gd
-                       = val->maybe_as_promiscuous_grouped_data(scope_env.env)) {
-                res->set_type(Response::SUCCESS_ATOM);
-                datum_t d(std::move(*gd));
-                d.write_to_protobuf(res->add_response(), use_json);
-                if (env->trace.has()) {
-                    env->trace->as_datum()->write_to_protobuf(
-                        res->mutable_profile(), use_json);
-                }
-            } else if (val->get_type().is_convertible(val_t::type_t::SEQUENCE)) {
-                counted_t<datum_stream_t> seq = val->as_seq(env.get());
-                if (counted_t<const datum_t> arr = seq->as_array(env.get())) {
-                    res->set_type(Response_ResponseType_SUCCESS_ATOM);
-                    arr->write_to_protobuf(res->add_response(), use_json);
-                    if (env->trace.has()) {
-                        env->trace->as_datum()->write_to_protobuf(
-                            res->mutable_profile(), use_json);
-                    }
-                } else {
-                    stream_cache2->insert(token, use_json, std::move(env), seq);
-                    bool b = stream_cache2->serve(token, res, interruptor);
-                    r_sanity_check(b);
-                }
-            } else {
-                rfail_toplevel(base_exc_t::GENERIC,
-                               "Query result must be of type "
-                               "DATUM, GROUPED_DATA, or STREAM (got %s).",
-                               val->get_type().name());
-            }
+            respond_with_val(val, token, use_json, interruptor, &env, res,
+                             stream_cache2);
         } catch (const exc_t &e) {
             fill_error(res, Response::RUNTIME_ERROR, e.what(), e.backtrace());
             return;
@@ -272,6 +306,107 @@ void run(protob_t<Query> q,
         }
 
     } break;
+    case Query_QueryType_PREPARE: {
+        counted_t<func_t> func;
+        const size_t bytes = q->query().ByteSize();
+        try {
+            Term *t = q->mutable_query();
+            rcheck_toplevel(t->type() == Term::FUNC, base_exc_t::GENERIC,
+                            "Only functions can be prepared "
+                            "(their arguments are the query's parameters).");
+            rcheck_toplevel(bytes <= prepared_query_cache_t::MAX_PREPARED_QUERY_BYTES,
+                            base_exc_t::GENERIC,
+                            strprintf("Prepared queries can't be larger than %zu "
+                                      "bytes (this one is %zu).",
+                                      prepared_query_cache_t::MAX_PREPARED_QUERY_BYTES,
+                                      bytes));
+            // `preprocess_term` replaces `r.now()` with the time it runs at, which
+            // would be the time the query was prepared.
+            rcheck_toplevel(!term_contains(*t, Term::NOW), base_exc_t::GENERIC,
+                            "Prepared queries can't use `r.now()` "
+                            "(pass the time as an argument instead).");
+            preprocess_term(t);
+            compile_env_t compile_env((var_visibility_t()));
+            func = make_counted<func_term_t>(&compile_env, q.make_child(t))
+                ->eval_to_func(var_scope_t());
+        } catch (const exc_t &e) {
+            fill_error(res, Response::COMPILE_ERROR, e.what(), e.backtrace());
+            return;
+        } catch (const datum_exc_t &e) {
+            fill_error(res, Response::COMPILE_ERROR, e.what(), backtrace_t());
+            return;
+        }
+
+        const int64_t id = prepared_queries->insert(func, bytes);
+        res->set_type(Response::SUCCESS_ATOM);
+        make_counted<const datum_t>(static_cast<double>(id))->write_to_protobuf(
+            res->add_response(), use_json);
+    } break;
+    case Query_QueryType_EXECUTE: {
+        counted_t<func_t> func;
+        try {
+            func = prepared_queries->get(q->prepared_id());
+            rcheck_toplevel(func.has(), base_exc_t::GENERIC,
+                            strprintf("Prepared query %" PRIi64 " not found.",
+                                      q->prepared_id()));
+            rcheck_toplevel(!stream_cache2->contains(token),
+                            base_exc_t::GENERIC,
+                            strprintf("ERROR: duplicate token %" PRIi64, token));
+        } catch (const exc_t &e) {
+            fill_error(res, Response::CLIENT_ERROR, e.what(), e.backtrace());
+            return;
+        }
+
+        threadnum_t th = get_thread_id();
+        scoped_ptr_t<ql::env_t> env(
+            new ql::env_t(
+                ctx->extproc_pool, ctx->ns_repo,
+                ctx->cross_thread_namespace_watchables[th.threadnum]->get_watchable(),
+                ctx->cross_thread_database_watchables[th.threadnum]->get_watchable(),
+                ctx->cluster_metadata, ctx->directory_read_manager,
+                interruptor, ctx->machine_id, q));
+
+        // Only the arguments are compiled; the function's body was compiled by
+        // the [PREPARE] query.  Clients print backtraces against the prepared
+        // function, so errors in the arguments are reported without one.
+        counted_t<term_t> args_term;
+        try {
+            compile_env_t compile_env((var_visibility_t()));
+            args_term = compile_term(&compile_env, q.make_child(q->mutable_query()));
+        } catch (const exc_t &e) {
+            fill_error(res, Response::COMPILE_ERROR, e.what(), backtrace_t());
+            return;
+        } catch (const datum_exc_t &e) {
+            fill_error(res, Response::COMPILE_ERROR, e.what(), backtrace_t());
+            return;
+        }
+
+        counted_t<const datum_t> args;
+        try {
+            scope_env_t scope_env(env.get(), var_scope_t());
+            args = args_term->eval(&scope_env)->as_datum();
+            rcheck_toplevel(args->get_type() == datum_t::R_ARRAY, base_exc_t::GENERIC,
+                            "The arguments of a prepared query must be an array.");
+        } catch (const exc_t &e) {
+            fill_error(res, Response::RUNTIME_ERROR, e.what(), backtrace_t());
+            return;
+        } catch (const datum_exc_t &e) {
+            fill_error(res, Response::RUNTIME_ERROR, e.what(), backtrace_t());
+            return;
+        }
+
+        try {
+            counted_t<val_t> val = func->call(env.get(), args->as_array());
+            respond_with_val(val, token, use_json, interruptor, &env, res,
+                             stream_cache2);
+        } catch (const exc_t &e) {
+            fill_error(res, Response::RUNTIME_ERROR, e.what(), e.backtrace());
+            return;
+        } catch (const datum_exc_t &e) {
+            fill_error(res, Response::RUNTIME_ERROR, e.what(), backtrace_t());
+            return;
+        }
+    } break;
     case Query_QueryType_CONTINUE: {
         try {
             bool b = stream_cache2->serve(token, res, interruptor);
@@ -175,7 +175,8 @@ class table_create_term_t : public meta_write_op_t {
 public:
     table_create_term_t(compile_env_t *env, const protob_t<const Term> &term) :
         meta_write_op_t(env, term, argspec_t(1, 2),
-                        optargspec_t({"datacenter", "primary_key", "durability"})) { }
+                        optargspec_t({"datacenter", "primary_key", "durability",
+                                      "block_size"})) { }
 private:
     virtual std::string write_eval_impl(scope_env_t *env, UNUSED eval_flags_t flags) {
         uuid_u dc_id = nil_uuid();
@@ -198,6 +199,19 @@ private:
             primary_key = v->as_str().to_std();
         }
 
+        // 0 means the default block size.
+        int64_t block_size = 0;
+        if (counted_t<val_t> v = optarg(env, "block_size")) {
+            block_size = v->as_int();
+            rcheck(block_size >= MIN_BTREE_BLOCK_SIZE
+                   && block_size <= MAX_BTREE_BLOCK_SIZE
+                   && (block_size & (block_size - 1)) == 0,
+                   base_exc_t::GENERIC,
+                   strprintf("Block size must be a power of two between %d and %d "
+                             "(got %" PRIi64 ").",
+                             MIN_BTREE_BLOCK_SIZE, MAX_BTREE_BLOCK_SIZE, block_size));
+        }
+
         uuid_u db_id;
         name_string_t tbl_name;
         if (num_args() == 1) {
@@ -229,7 +243,8 @@ private:
             namespace_semilattice_metadata_t<rdb_protocol_t> ns =
                 new_namespace<rdb_protocol_t>(
                     env->env->cluster_access.this_machine, db_id, dc_id, tbl_name,
-                    primary_key, port_defaults::reql_port);
+                    primary_key, port_defaults::reql_port,
+                    static_cast<int>(block_size));
 
             // Set Durability
             std::map<datacenter_id_t, ack_expectation_t> *ack_map =
@@ -170,8 +170,7 @@ private:
 
                 // OBJECT -> ARRAY
                 if (start_type == R_OBJECT_TYPE && end_type == R_ARRAY_TYPE) {
-                    const std::map<std::string, counted_t<const datum_t> > &obj
-                        = d->as_object();
+                    const datum_object_t &obj = d->as_object();
                     std::vector<counted_t<const datum_t> > arr;
                     arr.reserve(obj.size());
                     for (auto it = obj.begin(); it != obj.end(); ++it) {
@@ -219,25 +218,32 @@ private:
 
             // SEQUENCE -> OBJECT
             if (start_type == R_ARRAY_TYPE && end_type == R_OBJECT_TYPE) {
-                datum_ptr_t obj(datum_t::R_OBJECT);
+                // The pairs can come in any order, so we sort them once at the end
+                // instead of inserting each one in its place.
+                datum_object_t obj;
                 batchspec_t batchspec
                     = batchspec_t::user(batch_type_t::TERMINAL, env->env);
                 {
                     profile::sampler_t sampler("Coercing to object.", env->env->trace);
                     while (auto pair = ds->next(env->env, batchspec)) {
-                        std::string key = pair->get(0)->as_str().to_std();
-                        counted_t<const datum_t> keyval = pair->get(1);
-                        bool b = obj.add(key, keyval);
-                        rcheck(!b, base_exc_t::GENERIC,
-                               strprintf("Duplicate key `%s` in coerced object.  "
-                                         "(got `%s` and `%s` as values)",
-                                         key.c_str(),
-                                         obj->get(key)->trunc_print().c_str(),
-                                         keyval->trunc_print().c_str()));
+                        obj.append_unsorted(pair->get(0)->as_str().to_std(),
+                                            pair->get(1));
                         sampler.new_sample();
                     }
                 }
-                return new_val(obj.to_counted());
+                std::string key;
+                if (!obj.sort_fields(&key)) {
+                    // Sorting is stable, so these are the first two values for `key`
+                    // in the order they came in.
+                    datum_object_t::const_iterator first = obj.find(key);
+                    rfail(base_exc_t::GENERIC,
+                          "Duplicate key `%s` in coerced object.  "
+                          "(got `%s` and `%s` as values)",
+                          key.c_str(),
+                          first->second->trunc_print().c_str(),
+                          (first + 1)->second->trunc_print().c_str());
+                }
+                return new_val(make_counted<const datum_t>(std::move(obj)));
             }
         }
 
@@ -45,7 +45,7 @@ class insert_term_t : public op_term_t {
 public:
     insert_term_t(compile_env_t *env, const protob_t<const Term> &term)
         : op_term_t(env, term, argspec_t(2),
-                    optargspec_t({"upsert", "durability", "return_vals"})) { }
+                    optargspec_t({"upsert", "durability", "return_vals", "bulk_load"})) { }
 
 private:
     void maybe_generate_key(counted_t<table_t> tbl,
@@ -73,6 +73,10 @@ private:
         bool upsert = upsert_val.has() ? upsert_val->as_bool() : false;
         counted_t<val_t> return_vals_val = optarg(env, "return_vals");
         bool return_vals = return_vals_val.has() ? return_vals_val->as_bool() : false;
+        // Builds the tree bottom-up where the new rows go after the existing ones,
+        // which is what you want for importing data into a new table.
+        counted_t<val_t> bulk_load_val = optarg(env, "bulk_load");
+        bool bulk_load = bulk_load_val.has() ? bulk_load_val->as_bool() : false;
 
         const durability_requirement_t durability_requirement
             = parse_durability_optarg(optarg(env, "durability"), this);
@@ -94,7 +98,7 @@ private:
                 }
                 counted_t<const datum_t> replace_stats = t->batched_insert(
                     env->env, std::move(datums), upsert,
-                    durability_requirement, return_vals);
+                    durability_requirement, return_vals, bulk_load);
                 stats = stats->merge(replace_stats, stats_merge);
                 done = true;
             }
@@ -123,7 +127,8 @@ private:
                 }
 
                 counted_t<const datum_t> replace_stats = t->batched_insert(
-                    env->env, std::move(datums), upsert, durability_requirement, false);
+                    env->env, std::move(datums), upsert, durability_requirement, false,
+                    bulk_load);
                 stats = stats->merge(replace_stats, stats_merge);
             }
         }
@@ -139,7 +139,8 @@ counted_t<const datum_t> table_t::batched_insert(
     std::vector<counted_t<const datum_t> > &&insert_datums,
     bool upsert,
     durability_requirement_t durability_requirement,
-    bool return_vals) {
+    bool return_vals,
+    bool bulk_load) {
 
     datum_ptr_t stats(datum_t::R_OBJECT);
     std::vector<counted_t<const datum_t> > valid_inserts;
@@ -166,7 +167,7 @@ counted_t<const datum_t> table_t::batched_insert(
     counted_t<const datum_t> insert_stats = do_batched_write(
         env,
         rdb_protocol_t::batched_insert_t(
-            std::move(valid_inserts), get_pkey(), upsert, return_vals),
+            std::move(valid_inserts), get_pkey(), upsert, return_vals, bulk_load),
         durability_requirement);
     return stats.to_counted()->merge(insert_stats, stats_merge);
 }
@@ -174,11 +175,13 @@ counted_t<const datum_t> table_t::batched_insert(
 MUST_USE bool table_t::sindex_create(env_t *env,
                                      const std::string &id,
                                      counted_t<func_t> index_func,
-                                     sindex_multi_bool_t multi) {
+                                     sindex_multi_bool_t multi,
+                                     const std::vector<std::string> &covered_fields) {
     index_func->assert_deterministic("Index functions must be deterministic.");
     map_wire_func_t wire_func(index_func);
     rdb_protocol_t::write_t write(
-            rdb_protocol_t::sindex_create_t(id, wire_func, multi), env->profile());
+            rdb_protocol_t::sindex_create_t(id, wire_func, multi, covered_fields),
+            env->profile());
 
     rdb_protocol_t::write_response_t res;
     access->get_namespace_if().write(
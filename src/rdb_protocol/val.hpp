@@ -66,11 +66,13 @@ public:
         std::vector<counted_t<const datum_t> > &&insert_datums,
         bool upsert,
         durability_requirement_t durability_requirement,
-        bool return_vals);
+        bool return_vals,
+        bool bulk_load = false);
 
     MUST_USE bool sindex_create(
         env_t *env, const std::string &name,
-        counted_t<func_t> index_func, sindex_multi_bool_t multi);
+        counted_t<func_t> index_func, sindex_multi_bool_t multi,
+        const std::vector<std::string> &covered_fields);
     MUST_USE bool sindex_drop(env_t *env, const std::string &name);
     counted_t<const datum_t> sindex_list(env_t *env);
     counted_t<const datum_t> sindex_status(env_t *env,
@@ -40,12 +40,19 @@
 
 void validate_pb(const Query &q) {
     check_has(q, has_type, "type");
-    if (q.type() == Query::START) {
+    if (q.type() == Query::START
+        || q.type() == Query::PREPARE
+        || q.type() == Query::EXECUTE) {
         check_has(q, has_query, "query");
         validate_pb(q.query());
     } else {
         check_not_has(q, has_query, "query");
     }
+    if (q.type() == Query::EXECUTE) {
+        check_has(q, has_prepared_id, "prepared_id");
+    } else {
+        check_not_has(q, has_prepared_id, "prepared_id");
+    }
     check_has(q, has_token, "token");
     for (int i = 0; i < q.global_optargs_size(); ++i) {
         validate_pb(q.global_optargs(i).val());
@@ -0,0 +1,112 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/log/aligned_buffer_pool.hpp"
+
+#include <stdlib.h>
+
+#include "config/args.hpp"
+#include "perfmon/perfmon.hpp"
+#include "utils.hpp"
+
+aligned_buffer_t::aligned_buffer_t()
+    : pool_(NULL), ptr_(NULL), capacity_(0) { }
+
+aligned_buffer_t::aligned_buffer_t(aligned_buffer_pool_t *pool, char *ptr,
+                                   size_t capacity)
+    : pool_(pool), ptr_(ptr), capacity_(capacity) { }
+
+aligned_buffer_t::aligned_buffer_t(aligned_buffer_t &&movee)
+    : pool_(movee.pool_), ptr_(movee.ptr_), capacity_(movee.capacity_) {
+    movee.pool_ = NULL;
+    movee.ptr_ = NULL;
+    movee.capacity_ = 0;
+}
+
+aligned_buffer_t::~aligned_buffer_t() {
+    reset();
+}
+
+void aligned_buffer_t::operator=(aligned_buffer_t &&movee) {
+    reset();
+    pool_ = movee.pool_;
+    ptr_ = movee.ptr_;
+    capacity_ = movee.capacity_;
+    movee.pool_ = NULL;
+    movee.ptr_ = NULL;
+    movee.capacity_ = 0;
+}
+
+void aligned_buffer_t::reset() {
+    if (ptr_ != NULL) {
+        pool_->release(ptr_, capacity_);
+        pool_ = NULL;
+        ptr_ = NULL;
+        capacity_ = 0;
+    }
+}
+
+aligned_buffer_pool_t::aligned_buffer_pool_t(size_t max_cached_bytes,
+                                             perfmon_counter_t *cached_bytes_counter)
+    : max_cached_bytes_(max_cached_bytes), cached_bytes_(0),
+      cached_bytes_counter_(cached_bytes_counter) { }
+
+aligned_buffer_pool_t::~aligned_buffer_pool_t() {
+    trim(0);
+}
+
+void aligned_buffer_pool_t::trim(size_t max_bytes) {
+    assert_thread();
+    while (cached_bytes_ > max_bytes) {
+        auto it = free_buffers_.end();
+        --it;
+        if (it->second.empty()) {
+            free_buffers_.erase(it);
+            continue;
+        }
+        free(it->second.back());
+        it->second.pop_back();
+        add_cached_bytes(-static_cast<int64_t>(it->first));
+    }
+}
+
+void aligned_buffer_pool_t::add_cached_bytes(int64_t change) {
+    cached_bytes_ += change;
+    if (cached_bytes_counter_ != NULL) {
+        *cached_bytes_counter_ += change;
+    }
+}
+
+size_t aligned_buffer_pool_t::capacity_for_size(size_t size) {
+    size_t capacity = DEVICE_BLOCK_SIZE;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+aligned_buffer_t aligned_buffer_pool_t::acquire(size_t size) {
+    assert_thread();
+    const size_t capacity = capacity_for_size(size);
+
+    auto it = free_buffers_.find(capacity);
+    if (it != free_buffers_.end() && !it->second.empty()) {
+        char *ptr = it->second.back();
+        it->second.pop_back();
+        add_cached_bytes(-static_cast<int64_t>(capacity));
+        return aligned_buffer_t(this, ptr, capacity);
+    }
+
+    return aligned_buffer_t(this,
+                            static_cast<char *>(malloc_aligned(capacity,
+                                                               DEVICE_BLOCK_SIZE)),
+                            capacity);
+}
+
+void aligned_buffer_pool_t::release(char *ptr, size_t capacity) {
+    assert_thread();
+    if (cached_bytes_ + capacity > max_cached_bytes_) {
+        free(ptr);
+        return;
+    }
+    free_buffers_[capacity].push_back(ptr);
+    add_cached_bytes(capacity);
+}
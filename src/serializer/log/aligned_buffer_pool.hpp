@@ -0,0 +1,81 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_ALIGNED_BUFFER_POOL_HPP_
+#define SERIALIZER_LOG_ALIGNED_BUFFER_POOL_HPP_
+
+#include <stddef.h>
+
+#include <map>
+#include <vector>
+
+#include "errors.hpp"
+#include "threading.hpp"
+
+class aligned_buffer_pool_t;
+class perfmon_counter_t;
+
+/* A `DEVICE_BLOCK_SIZE`-aligned buffer borrowed from an `aligned_buffer_pool_t`.
+It goes back to the pool when it is destroyed or reset. */
+class aligned_buffer_t {
+public:
+    aligned_buffer_t();
+    aligned_buffer_t(aligned_buffer_t &&movee);
+    ~aligned_buffer_t();
+
+    void operator=(aligned_buffer_t &&movee);
+
+    char *get() const { return ptr_; }
+    bool has() const { return ptr_ != NULL; }
+    void reset();
+
+private:
+    friend class aligned_buffer_pool_t;
+    aligned_buffer_t(aligned_buffer_pool_t *pool, char *ptr, size_t capacity);
+
+    aligned_buffer_pool_t *pool_;
+    char *ptr_;
+    size_t capacity_;
+
+    DISABLE_COPYING(aligned_buffer_t);
+};
+
+/* Hands out `DEVICE_BLOCK_SIZE`-aligned buffers for direct I/O and keeps
+released ones around for reuse, so that the serializer's bounce buffers,
+read-ahead buffers and GC buffers don't go through `posix_memalign` and `free`
+on every read. Buffers are rounded up to a power of two so that they can be
+reused across requests of slightly different sizes. At most `max_cached_bytes`
+worth of released buffers are kept; anything beyond that is freed. If
+`cached_bytes_counter` isn't NULL, it follows `cached_bytes()`. */
+class aligned_buffer_pool_t : public home_thread_mixin_debug_only_t {
+public:
+    explicit aligned_buffer_pool_t(size_t max_cached_bytes,
+                                   perfmon_counter_t *cached_bytes_counter = NULL);
+    ~aligned_buffer_pool_t();
+
+    // The returned buffer has room for at least `size` bytes.
+    aligned_buffer_t acquire(size_t size);
+
+    // Frees released buffers, the biggest ones first, until at most `max_bytes`
+    // worth of them are left.
+    void trim(size_t max_bytes);
+
+    size_t cached_bytes() const { return cached_bytes_; }
+
+private:
+    friend class aligned_buffer_t;
+    void release(char *ptr, size_t capacity);
+
+    static size_t capacity_for_size(size_t size);
+
+    void add_cached_bytes(int64_t change);
+
+    const size_t max_cached_bytes_;
+    size_t cached_bytes_;
+    perfmon_counter_t *const cached_bytes_counter_;
+
+    // Released buffers, by capacity.
+    std::map<size_t, std::vector<char *> > free_buffers_;
+
+    DISABLE_COPYING(aligned_buffer_pool_t);
+};
+
+#endif  // SERIALIZER_LOG_ALIGNED_BUFFER_POOL_HPP_
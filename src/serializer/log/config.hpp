@@ -15,14 +15,22 @@ struct log_serializer_dynamic_config_t {
     log_serializer_dynamic_config_t() {
         gc_low_ratio = DEFAULT_GC_LOW_RATIO;
         gc_high_ratio = DEFAULT_GC_HIGH_RATIO;
+        gc_min_bytes_per_sec = DEFAULT_GC_MIN_BYTES_PER_SEC;
+        gc_max_bytes_per_sec = DEFAULT_GC_MAX_BYTES_PER_SEC;
         read_ahead = true;
         io_batch_factor = DEFAULT_IO_BATCH_FACTOR;
+        compress_blocks = false;
+        index_snapshots = true;
     }
 
     /* When the proportion of garbage blocks hits gc_high_ratio, then the serializer will collect
     garbage until it reaches gc_low_ratio. */
     double gc_low_ratio, gc_high_ratio;
 
+    /* How fast the GC moves live data between those two ratios, in bytes per
+    second: the minimum at gc_low_ratio, up to the maximum at gc_high_ratio. */
+    int64_t gc_min_bytes_per_sec, gc_max_bytes_per_sec;
+
     /* The (minimal) batch size of i/o requests being taken from a single i/o account.
     It is a factor because the actual batch size is this factor multiplied by the
     i/o priority of the account. */
@@ -31,7 +39,17 @@ struct log_serializer_dynamic_config_t {
     /* Enable reading more data than requested to let the cache warmup more quickly esp. on rotational drives */
     bool read_ahead;
 
-    RDB_MAKE_ME_SERIALIZABLE_4(gc_low_ratio, gc_high_ratio, io_batch_factor, read_ahead);
+    /* Store data blocks zlib-compressed when that makes them take up less space on
+    disk.  Blocks that were written compressed can be read back either way. */
+    bool compress_blocks;
+
+    /* Save a snapshot of the block index at clean shutdown, so that the next
+    startup doesn't have to replay the whole LBA. */
+    bool index_snapshots;
+
+    RDB_MAKE_ME_SERIALIZABLE_8(gc_low_ratio, gc_high_ratio, gc_min_bytes_per_sec,
+                               gc_max_bytes_per_sec, io_batch_factor, read_ahead,
+                               compress_blocks, index_snapshots);
 };
 
 /* This is equivalent to log_serializer_static_config_t below, but is an on-disk
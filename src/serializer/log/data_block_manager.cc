@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 #include <sys/uio.h>
+#include <zlib.h>
 
 #include "errors.hpp"
 #include <boost/bind.hpp>
@@ -18,6 +19,63 @@
 // Max amount of bytes which can be read ahead in one i/o transaction (if enabled)
 const int64_t APPROXIMATE_READ_AHEAD_SIZE = 32 * DEFAULT_BTREE_BLOCK_SIZE;
 
+// How many bytes of released I/O buffers to keep around for reuse, beyond the
+// GC's extent-sized buffer (which is only kept until the GC pass ends).  This
+// leaves room for a few concurrent read-ahead buffers.
+const int64_t IO_BUFFER_POOL_SLACK = 4 * APPROXIMATE_READ_AHEAD_SIZE;
+
+// A compressed block keeps its ls_buf_data_t header as is, so that read-ahead and
+// the GC can still see its block id, followed by the deflated rest of the block.
+
+// How much room compress_block might need.
+static uint32_t compressed_block_bound(block_size_t block_size) {
+    return ceil_aligned(sizeof(ls_buf_data_t) + compressBound(block_size.value()),
+                        DEVICE_BLOCK_SIZE);
+}
+
+// Compresses the block in `buf` into `out`, which must have room for
+// compressed_block_bound(block_size) bytes, and pads it with zeroes up to the next
+// device block boundary.  Returns the compressed size, or 0 if compressing the
+// block wouldn't save any space on disk.
+static uint32_t compress_block(const ser_buffer_t *buf, block_size_t block_size, char *out) {
+    memcpy(out, &buf->ser_header, sizeof(ls_buf_data_t));
+    uLongf deflated_size = compressBound(block_size.value());
+    int res = compress2(reinterpret_cast<Bytef *>(out + sizeof(ls_buf_data_t)),
+                        &deflated_size,
+                        reinterpret_cast<const Bytef *>(buf->cache_data),
+                        block_size.value(), Z_BEST_SPEED);
+    guarantee(res == Z_OK, "compress2 failed (%d)", res);
+
+    const uint32_t compressed_size = sizeof(ls_buf_data_t) + deflated_size;
+    const uint32_t aligned_size = ceil_aligned(compressed_size, DEVICE_BLOCK_SIZE);
+    if (aligned_size >= ceil_aligned(block_size.ser_value(), DEVICE_BLOCK_SIZE)) {
+        return 0;
+    }
+    memset(out + compressed_size, 0, aligned_size - compressed_size);
+    return compressed_size;
+}
+
+// Copies the block stored on disk at `data` (which is compressed if compressed_size
+// is nonzero) into `buf_out`.
+static void unpack_block(const char *data, uint32_t ser_block_size,
+                         uint32_t compressed_size, void *buf_out) {
+    if (compressed_size == 0) {
+        memcpy(buf_out, data, ser_block_size);
+        return;
+    }
+
+    guarantee(compressed_size > sizeof(ls_buf_data_t));
+    ser_buffer_t *const buf = static_cast<ser_buffer_t *>(buf_out);
+    memcpy(&buf->ser_header, data, sizeof(ls_buf_data_t));
+    const uLongf expected_size = ser_block_size - sizeof(ls_buf_data_t);
+    uLongf inflated_size = expected_size;
+    int res = uncompress(reinterpret_cast<Bytef *>(buf->cache_data), &inflated_size,
+                         reinterpret_cast<const Bytef *>(data + sizeof(ls_buf_data_t)),
+                         compressed_size - sizeof(ls_buf_data_t));
+    guarantee(res == Z_OK && inflated_size == expected_size,
+              "Corrupted compressed block (uncompress returned %d)", res);
+}
+
 // Identifies an extent, the time we started writing to the
 // extent, whether it's the extent we're currently writing to, and
 // describes blocks are garbage.
@@ -26,8 +84,16 @@ private:
     struct block_info_t {
         uint32_t relative_offset;
         block_size_t block_size;
+        // See lba_entry_t::compressed_size.
+        uint32_t compressed_size;
         bool token_referenced;
         bool index_referenced;
+
+        block_size_t disk_size() const {
+            return compressed_size != 0
+                ? block_size_t::unsafe_make(compressed_size)
+                : block_size;
+        }
     };
 
 public:
@@ -36,6 +102,8 @@ public:
         : parent(_parent),
           extent_ref(parent->extent_manager->gen_extent()),
           timestamp(current_microtime()),
+          data_timestamp(timestamp),
+          gc_score(0),
           was_written(false),
           state(state_active),
           garbage_bytes_stat(_parent->static_config->extent_size()),
@@ -50,6 +118,8 @@ public:
         : parent(_parent),
           extent_ref(parent->extent_manager->reserve_extent(_offset)),
           timestamp(current_microtime()),
+          data_timestamp(timestamp),
+          gc_score(0),
           was_written(false),
           state(state_reconstructing),
           garbage_bytes_stat(_parent->static_config->extent_size()),
@@ -91,17 +161,32 @@ public:
         return block_infos.empty()
             ? 0
             : block_infos.back().relative_offset
-            + aligned_value(block_infos.back().block_size);
+            + aligned_value(block_infos.back().disk_size());
     }
 
-    // Returns the ostensible size of the block_index'th block.  Note that
-    // block_boundaries[i] + block_size(i) <= block_boundaries[i + 1].
+    // Returns the ostensible size of the block_index'th block.
     block_size_t block_size(unsigned int block_index) const {
         guarantee(state != state_reconstructing);
         guarantee(block_index < block_infos.size());
         return block_infos[block_index].block_size;
     }
 
+    // Returns the compressed size of the block_index'th block, or 0 if it's stored
+    // uncompressed.
+    uint32_t compressed_size(unsigned int block_index) const {
+        guarantee(state != state_reconstructing);
+        guarantee(block_index < block_infos.size());
+        return block_infos[block_index].compressed_size;
+    }
+
+    // Returns the space the block_index'th block takes up on disk.  Note that
+    // block_boundaries[i] + disk_size(i) <= block_boundaries[i + 1].
+    block_size_t disk_size(unsigned int block_index) const {
+        guarantee(state != state_reconstructing);
+        guarantee(block_index < block_infos.size());
+        return block_infos[block_index].disk_size();
+    }
+
     // Returns block_boundaries()[block_index].
     uint32_t relative_offset(unsigned int block_index) const {
         guarantee(state != state_reconstructing);
@@ -120,23 +205,26 @@ public:
         return it - block_infos.begin();
     }
 
-    bool new_offset(block_size_t block_size,
+    bool new_offset(block_size_t block_size, uint32_t compressed_size,
                     uint32_t *relative_offset_out,
                     unsigned int *block_index_out) {
         // Returns true if there's enough room at the end of the extent for the new
         // block.
         guarantee(state == state_active);
-        guarantee(block_size.ser_value() <= parent->static_config->extent_size());
+        const block_info_t info{0, block_size, compressed_size, false, false};
+        const uint32_t disk_size = info.disk_size().ser_value();
+        guarantee(disk_size <= parent->static_config->extent_size());
 
         uint32_t offset = back_relative_offset();
         guarantee(offset <= parent->static_config->extent_size());
 
-        if (offset > parent->static_config->extent_size() - block_size.ser_value()) {
+        if (offset > parent->static_config->extent_size() - disk_size) {
             return false;
         } else {
             *relative_offset_out = offset;
             *block_index_out = block_infos.size();
-            block_infos.push_back(block_info_t{offset, block_size, false, false});
+            block_infos.push_back(info);
+            block_infos.back().relative_offset = offset;
             update_stats(NULL, &block_infos.back());
             return true;
         }
@@ -189,7 +277,7 @@ public:
         uint32_t b = 0;
         for (auto it = block_infos.begin(); it < block_infos.end(); ++it) {
             if (it->token_referenced) {
-                b += aligned_value(it->block_size);
+                b += aligned_value(it->disk_size());
             }
         }
         return b;
@@ -203,22 +291,26 @@ public:
         return std::lower_bound(block_infos.begin(), block_infos.end(), relative_offset, &gc_entry_t::info_less);
     }
 
-    void mark_live_indexwise_with_offset(int64_t offset, block_size_t block_size) {
+    void mark_live_indexwise_with_offset(int64_t offset, block_size_t block_size,
+                                         uint32_t compressed_size) {
         guarantee(offset >= extent_ref.offset() && offset < extent_ref.offset() + UINT32_MAX);
 
         uint32_t relative_offset = offset - extent_ref.offset();
+        const block_info_t info{relative_offset, block_size, compressed_size,
+                                false, true};
 
         auto it = find_lower_bound_iter(relative_offset);
         if (it == block_infos.end()) {
-            block_infos.push_back(block_info_t{relative_offset, block_size, false, true});
+            block_infos.push_back(info);
             update_stats(NULL, &block_infos.back());
         } else if (it->relative_offset > relative_offset) {
-            guarantee(it->relative_offset >= relative_offset + aligned_value(block_size));
-            auto new_block = block_infos.insert(it, block_info_t{relative_offset, block_size, false, true});
+            guarantee(it->relative_offset >= relative_offset + aligned_value(info.disk_size()));
+            auto new_block = block_infos.insert(it, info);
             update_stats(NULL, &*new_block);
         } else {
             guarantee(it->relative_offset == relative_offset);
             guarantee(it->block_size == block_size);
+            guarantee(it->compressed_size == compressed_size);
             const block_info_t old_info = *it;
             it->index_referenced = true;
             update_stats(&old_info, &*it);
@@ -242,7 +334,7 @@ public:
         uint32_t b = 0;
         for (auto it = block_infos.begin(); it < block_infos.end(); ++it) {
             if (it->index_referenced) {
-                b += aligned_value(it->block_size);
+                b += aligned_value(it->disk_size());
             }
         }
         return b;
@@ -253,13 +345,20 @@ public:
         state = state_active;
     }
 
+    // See gc_cost_benefit().
+    double cost_benefit(microtime_t now) const {
+        const double extent_size = parent->static_config->extent_size();
+        return gc_cost_benefit((extent_size - garbage_bytes()) / extent_size,
+                               data_timestamp, now);
+    }
+
     std::string format_block_infos(const char *separator) const {
         const int64_t offset = extent_ref.offset();
         std::string ret;
         for (auto it = block_infos.begin(); it != block_infos.end(); ++it) {
             ret += strprintf("%s[%" PRIi64 "..+%" PRIu32 ") %c%c",
                              it == block_infos.begin() ? "" : separator,
-                             offset + it->relative_offset, it->block_size.ser_value(),
+                             offset + it->relative_offset, it->disk_size().ser_value(),
                              it->token_referenced ? 'T' : ' ',
                              it->index_referenced ? 'I' : ' ');
         }
@@ -278,7 +377,7 @@ private:
         uint32_t b = parent->static_config->extent_size();
         for (auto it = block_infos.begin(); it < block_infos.end(); ++it) {
             if (it->token_referenced || it->index_referenced) {
-                b -= aligned_value(it->block_size);
+                b -= aligned_value(it->disk_size());
             }
         }
         return b;
@@ -302,14 +401,14 @@ private:
             if (old_block->token_referenced || old_block->index_referenced) {
                 // Block is live
                 num_live_blocks_stat -= 1;
-                garbage_bytes_stat += aligned_value(old_block->block_size);
+                garbage_bytes_stat += aligned_value(old_block->disk_size());
             }
         }
         // Apply new_block
         if (new_block->token_referenced || new_block->index_referenced) {
             // Block is live
             num_live_blocks_stat += 1;
-            garbage_bytes_stat -= aligned_value(new_block->block_size);
+            garbage_bytes_stat -= aligned_value(new_block->disk_size());
         }
     }
     
@@ -331,6 +430,14 @@ public:
     // When we started writing to the extent (this time).
     const microtime_t timestamp;
 
+    // How old the extent's data is.  That's `timestamp`, except for extents the
+    // GC moved blocks to, which take the age of the oldest extent they got blocks
+    // from.  We don't know about data ages from before the serializer started.
+    microtime_t data_timestamp;
+
+    // Our cost_benefit() as of the parent's gc_score_epoch, which orders gc_pq.
+    double gc_score;
+
     // The PQ entry pointing to us.
     priority_queue_t<gc_entry_t *, gc_entry_less_t>::entry_t *our_pq_entry;
 
@@ -341,7 +448,7 @@ public:
         // It has been, or is being, reconstructed from data on disk.
         state_reconstructing,
         // We are currently putting things on this extent. It is equal to
-        // last_data_extent.
+        // active_extent or gc_active_extent.
         state_active,
         // Not active, but not a GC candidate yet. It is in young_extent_queue.
         state_young,
@@ -383,6 +490,12 @@ private:
 data_block_manager_t::data_block_manager_t(const log_serializer_dynamic_config_t *_dynamic_config, extent_manager_t *em, log_serializer_t *_serializer, const log_serializer_on_disk_static_config_t *_static_config, log_serializer_stats_t *_stats)
     : stats(_stats), shutdown_callback(NULL), state(state_unstarted), dynamic_config(_dynamic_config),
       static_config(_static_config), extent_manager(em), serializer(_serializer),
+      io_buffers(static_config->extent_size() + IO_BUFFER_POOL_SLACK,
+                 &_stats->pm_serializer_io_buffer_pool_bytes),
+      gc_active_extent(NULL), gc_score_epoch(current_microtime()),
+      gc_pacing_timer(NULL), published_gc_rate(0), published_gc_debt(0),
+      data_bytes_written(0), gc_bytes_written(0),
+      published_write_amplification_percent(0),
       gc_state(), gc_stats(stats)
 {
     rassert(dynamic_config != NULL);
@@ -408,7 +521,8 @@ void data_block_manager_t::start_reconstruct() {
 // gc_entry_t in the entries table.  (This is used when we start up, when
 // everything is presumed to be garbage, until we mark it as
 // non-garbage.)
-void data_block_manager_t::mark_live(int64_t offset, block_size_t ser_block_size) {
+void data_block_manager_t::mark_live(int64_t offset, block_size_t ser_block_size,
+                                     uint32_t compressed_size) {
     uint64_t extent_id = static_config->extent_index(offset);
 
     if (entries.get(extent_id) == NULL) {
@@ -419,7 +533,7 @@ void data_block_manager_t::mark_live(int64_t offset, block_size_t ser_block_size
     }
 
     gc_entry_t *entry = entries.get(extent_id);
-    entry->mark_live_indexwise_with_offset(offset, ser_block_size);
+    entry->mark_live_indexwise_with_offset(offset, ser_block_size, compressed_size);
 }
 
 void data_block_manager_t::end_reconstruct() {
@@ -465,12 +579,7 @@ void data_block_manager_t::start_existing(file_t *file,
         reconstructed_extents.remove(entry);
 
         guarantee(entry->state == gc_entry_t::state_reconstructing);
-        entry->state = gc_entry_t::state_old;
-
-        entry->our_pq_entry = gc_pq.push(entry);
-
-        gc_stats.old_total_block_bytes += static_config->extent_size();
-        gc_stats.old_garbage_block_bytes += entry->garbage_bytes();
+        make_entry_old(entry);
     }
 
     state = state_ready;
@@ -579,6 +688,7 @@ public:
     static void perform_read_ahead(data_block_manager_t *const parent,
                                    const int64_t off_in,
                                    const uint32_t ser_block_size_in,
+                                   const uint32_t compressed_size_in,
                                    void *const buf_out,
                                    file_account_t *const io_account) {
         const std::vector<uint32_t> boundaries = get_boundaries(parent, off_in);
@@ -588,14 +698,14 @@ public:
 
         // Finish initialization.
         read_ahead_offset_and_size(off_in,
-                                   ser_block_size_in,
+                                   compressed_size_in != 0
+                                   ? compressed_size_in : ser_block_size_in,
                                    parent->static_config->extent_size(),
                                    boundaries,
                                    &read_ahead_offset,
                                    &read_ahead_size);
 
-        scoped_malloc_t<char> read_ahead_buf(
-                malloc_aligned(read_ahead_size, DEVICE_BLOCK_SIZE));
+        aligned_buffer_t read_ahead_buf = parent->io_buffers.acquire(read_ahead_size);
 
         // Do the disk read!
         co_read(parent->dbfile, read_ahead_offset, read_ahead_size,
@@ -624,7 +734,8 @@ public:
             if (current_offset == off_in) {
                 guarantee(!handled_required_block);
 
-                memcpy(buf_out, current_buf, ser_block_size_in);
+                unpack_block(current_buf, ser_block_size_in, compressed_size_in,
+                             buf_out);
                 handled_required_block = true;
             } else {
                 const block_id_t block_id
@@ -642,12 +753,14 @@ public:
 
                 scoped_malloc_t<ser_buffer_t> data
                     = serializer_t::allocate_buffer(parent->serializer->max_block_size());
-                memcpy(data.get(), current_buf, info.ser_block_size);
-                guarantee(info.ser_block_size <= *(lower_it + 1) - *lower_it);
+                guarantee(info.disk_block_size() <= *(lower_it + 1) - *lower_it);
+                unpack_block(current_buf, info.ser_block_size, info.compressed_size,
+                             data.get());
 
                 counted_t<ls_block_token_pointee_t> ls_token
                     = parent->serializer->generate_block_token(current_offset,
-                                                               block_size_t::unsafe_make(info.ser_block_size));
+                                                               block_size_t::unsafe_make(info.ser_block_size),
+                                                               info.compressed_size);
 
                 counted_t<standard_block_token_t> token
                     = to_standard_block_token(block_id, ls_token);
@@ -676,26 +789,30 @@ bool data_block_manager_t::should_perform_read_ahead(int64_t offset) {
 }
 
 void data_block_manager_t::read(int64_t off_in, uint32_t ser_block_size_in,
+                                uint32_t compressed_size_in,
                                 void *buf_out, file_account_t *io_account) {
     guarantee(state == state_ready);
     if (should_perform_read_ahead(off_in)) {
         dbm_read_ahead_t::perform_read_ahead(this, off_in, ser_block_size_in,
-                                             buf_out, io_account);
+                                             compressed_size_in, buf_out, io_account);
     } else {
-        if (divides(DEVICE_BLOCK_SIZE, reinterpret_cast<intptr_t>(buf_out)) &&
+        if (compressed_size_in == 0 &&
+            divides(DEVICE_BLOCK_SIZE, reinterpret_cast<intptr_t>(buf_out)) &&
             divides(DEVICE_BLOCK_SIZE, off_in) &&
             divides(DEVICE_BLOCK_SIZE, ser_block_size_in)) {
             co_read(dbfile, off_in, ser_block_size_in, buf_out, io_account);
         } else {
+            const uint32_t disk_size = compressed_size_in != 0
+                ? compressed_size_in : ser_block_size_in;
             int64_t floor_off_in = floor_aligned(off_in, DEVICE_BLOCK_SIZE);
-            int64_t ceil_off_end = ceil_aligned(off_in + ser_block_size_in,
+            int64_t ceil_off_end = ceil_aligned(off_in + disk_size,
                                                 DEVICE_BLOCK_SIZE);
-            scoped_malloc_t<char> buf(malloc_aligned(ceil_off_end - floor_off_in,
-                                                     DEVICE_BLOCK_SIZE));
+            aligned_buffer_t buf = io_buffers.acquire(ceil_off_end - floor_off_in);
             co_read(dbfile, floor_off_in, ceil_off_end - floor_off_in,
                     buf.get(), io_account);
 
-            memcpy(buf_out, buf.get() + (off_in - floor_off_in), ser_block_size_in);
+            unpack_block(buf.get() + (off_in - floor_off_in), ser_block_size_in,
+                         compressed_size_in, buf_out);
         }
     }
 }
@@ -704,24 +821,34 @@ std::vector<counted_t<ls_block_token_pointee_t> >
 data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
                                   file_account_t *io_account,
                                   iocallback_t *cb) {
+    std::vector<extent_write_t> extent_writes;
+    extent_writes.reserve(writes.size());
+    for (auto it = writes.begin(); it != writes.end(); ++it) {
+        it->buf->ser_header.block_id = it->block_id;
+        extent_writes.push_back(extent_write_t{it->buf, it->block_size, 0});
+    }
+
+    return many_extent_writes(extent_writes, NULL, io_account, cb);
+}
+
+std::vector<counted_t<ls_block_token_pointee_t> >
+data_block_manager_t::many_extent_writes(const std::vector<extent_write_t> &writes_in,
+                                         const gc_entry_t *gc_source,
+                                         file_account_t *io_account,
+                                         iocallback_t *cb) {
     // Either we're ready to write, or we're shutting down and just finished reading
     // blocks for gc and called do_write.
     guarantee(state == state_ready ||
               (state == state_shutting_down && gc_state.step() == gc_write));
 
-    // These tokens are grouped by extent.  You can do a contiguous write in each
-    // extent.
-    std::vector<std::vector<counted_t<ls_block_token_pointee_t> > > token_groups
-        = gimme_some_new_offsets(writes);
-
-    for (auto it = writes.begin(); it != writes.end(); ++it) {
-        it->buf->ser_header.block_id = it->block_id;
-    }
-
     struct intermediate_cb_t : public iocallback_t {
         virtual void on_io_complete() {
             --ops_remaining;
             if (ops_remaining == 0) {
+                if (foreground_parent != NULL) {
+                    foreground_parent->gc_rate.note_foreground_write(
+                        current_microtime() - start_time);
+                }
                 iocallback_t *local_cb = cb;
                 delete this;
                 local_cb->on_io_complete();
@@ -730,20 +857,56 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
 
         size_t ops_remaining;
         iocallback_t *cb;
+        // Set for writes from the cache, whose latency the GC rate depends on.
+        data_block_manager_t *foreground_parent;
+        microtime_t start_time;
+        // The compressed blocks we're writing, which have to stay around until
+        // the writes are done.
+        std::vector<aligned_buffer_t> compressed_bufs;
     };
 
     intermediate_cb_t *const intermediate_cb = new intermediate_cb_t;
+
+    std::vector<extent_write_t> writes = writes_in;
+    // The GC copies blocks verbatim: `remap_block_to_new_offset` only moves the
+    // tokens that point at a block, so the block has to keep its on-disk form.
+    if (dynamic_config->compress_blocks && gc_source == NULL) {
+        for (auto it = writes.begin(); it != writes.end(); ++it) {
+            guarantee(it->compressed_size == 0);
+            aligned_buffer_t buf = io_buffers.acquire(compressed_block_bound(it->block_size));
+            const uint32_t compressed_size
+                = compress_block(static_cast<const ser_buffer_t *>(it->data),
+                                 it->block_size, buf.get());
+            if (compressed_size != 0) {
+                it->data = buf.get();
+                it->compressed_size = compressed_size;
+                intermediate_cb->compressed_bufs.push_back(std::move(buf));
+
+                ++stats->pm_serializer_compressed_block_writes;
+                stats->pm_serializer_compressed_bytes_saved
+                    += gc_entry_t::aligned_value(it->block_size)
+                    - gc_entry_t::aligned_value(it->disk_size());
+            }
+        }
+    }
+
+    // These tokens are grouped by extent.  You can do a contiguous write in each
+    // extent.
+    std::vector<std::vector<counted_t<ls_block_token_pointee_t> > > token_groups
+        = gimme_some_new_offsets(writes, gc_source);
     // We add 1 for degenerate case where token_groups is empty -- we call
     // intermediate_cb->on_io_complete later.
     intermediate_cb->ops_remaining = token_groups.size() + 1;
     intermediate_cb->cb = cb;
+    intermediate_cb->foreground_parent = gc_source == NULL ? this : NULL;
+    intermediate_cb->start_time = current_microtime();
 
     size_t write_number = 0;
     for (size_t i = 0; i < token_groups.size(); ++i) {
 
         const int64_t front_offset = token_groups[i].front()->offset();
         const int64_t back_offset = token_groups[i].back()->offset()
-            + gc_entry_t::aligned_value(token_groups[i].back()->block_size());
+            + gc_entry_t::aligned_value(token_groups[i].back()->disk_block_size());
 
         guarantee(divides(DEVICE_BLOCK_SIZE, front_offset));
 
@@ -755,15 +918,15 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
 
         for (size_t j = 0; j < token_groups[i].size(); ++j) {
             const int64_t j_offset = token_groups[i][j]->offset();
-            const block_size_t j_block_size = token_groups[i][j]->block_size();
+            const block_size_t j_disk_size = token_groups[i][j]->disk_block_size();
             guarantee(j_offset == last_written_offset);
-            const size_t j_aligned_size = gc_entry_t::aligned_value(j_block_size);
+            const size_t j_aligned_size = gc_entry_t::aligned_value(j_disk_size);
 
             // The behavior of gimme_some_new_offsets is supposed to retain order, so
             // we expect writes[write_number] to have the currently-relevant write.
-            guarantee(writes[write_number].block_size == j_block_size);
+            guarantee(writes[write_number].disk_size() == j_disk_size);
 
-            iovecs[j].iov_base = writes[write_number].buf;
+            iovecs[j].iov_base = writes[write_number].data;
             iovecs[j].iov_len = j_aligned_size;
             last_written_offset = j_offset + j_aligned_size;
 
@@ -771,6 +934,7 @@ data_block_manager_t::many_writes(const std::vector<buf_write_info_t> &writes,
         }
 
         guarantee(last_written_offset == back_offset);
+        note_bytes_written(write_size, gc_source != NULL);
 
         dbfile->writev_async(front_offset, write_size,
                              std::move(iovecs), io_account, intermediate_cb);
@@ -835,13 +999,12 @@ void data_block_manager_t::check_and_handle_empty_extent(uint64_t extent_id) {
         destroy_entry(entry);
 
     } else if (entry->state == gc_entry_t::state_old) {
+        entry->gc_score = entry->cost_benefit(gc_score_epoch);
         entry->our_pq_entry->update();
     }
 }
 
 file_account_t *data_block_manager_t::choose_gc_io_account() {
-    // Start going into high priority as soon as the garbage ratio is more than
-    // 2% above the configured goal.
     // The idea is that we use the nice i/o account whenever possible, except
     // if it proves insufficient to maintain an acceptable garbage ratio, in
     // which case we switch over to the high priority account until the situation
@@ -849,7 +1012,7 @@ file_account_t *data_block_manager_t::choose_gc_io_account() {
 
     // This means that we can end up oscillating between both accounts, which
     // is probably fine. TODO: Make sure it actually is in practice!
-    if (garbage_ratio() > dynamic_config->gc_high_ratio * 1.02) {
+    if (gc_is_urgent()) {
         return gc_io_account_high.get();
     } else {
         return gc_io_account_nice.get();
@@ -871,7 +1034,7 @@ void data_block_manager_t::mark_garbage(int64_t offset, extent_transaction_t *tx
     // Add to old garbage count if necessary (works because of the
     // !entry->block_is_garbage(block_index) assertion above).
     if (entry->state == gc_entry_t::state_old && entry->block_is_garbage(block_index)) {
-        gc_stats.old_garbage_block_bytes += gc_entry_t::aligned_value(entry->block_size(block_index));
+        gc_stats.old_garbage_block_bytes += gc_entry_t::aligned_value(entry->disk_size(block_index));
     }
 
     check_and_handle_empty_extent(extent_id);
@@ -901,7 +1064,7 @@ void data_block_manager_t::mark_garbage_tokenwise_with_offset(int64_t offset) {
     // Add to old garbage count if necessary (works because of the
     // !entry->block_is_garbage(block_index) assertion above).
     if (entry->state == gc_entry_t::state_old && entry->block_is_garbage(block_index)) {
-        gc_stats.old_garbage_block_bytes += gc_entry_t::aligned_value(entry->block_size(block_index));
+        gc_stats.old_garbage_block_bytes += gc_entry_t::aligned_value(entry->disk_size(block_index));
     }
 
     check_and_handle_empty_extent(extent_id);
@@ -945,20 +1108,23 @@ void data_block_manager_t::gc_writer_t::write_gcs(gc_write_t *writes, size_t num
             // Step 1: Write buffers to disk and assemble index operations
             ASSERT_NO_CORO_WAITING;
 
-            std::vector<buf_write_info_t> the_writes;
+            std::vector<extent_write_t> the_writes;
             the_writes.reserve(num_writes);
             for (size_t i = 0; i < num_writes; ++i) {
                 old_block_tokens.push_back(parent->serializer->generate_block_token(writes[i].old_offset,
-                                                                                    writes[i].block_size));
+                                                                                    writes[i].block_size,
+                                                                                    writes[i].compressed_size));
 
-                the_writes.push_back(buf_write_info_t(writes[i].buf,
-                                                      writes[i].block_size,
-                                                      writes[i].buf->ser_header.block_id));
+                the_writes.push_back(extent_write_t{writes[i].buf,
+                                                    writes[i].block_size,
+                                                    writes[i].compressed_size});
             }
 
             new_block_tokens
-                = parent->many_writes(the_writes, parent->choose_gc_io_account(),
-                                      &block_write_cond);
+                = parent->many_extent_writes(the_writes,
+                                             parent->gc_state.current_entry,
+                                             parent->choose_gc_io_account(),
+                                             &block_write_cond);
 
             guarantee(new_block_tokens.size() == num_writes);
         }
@@ -1055,11 +1221,34 @@ void data_block_manager_t::run_gc() {
         switch (gc_state.step()) {
             case gc_ready: {
                 if (gc_pq.empty() || !should_we_keep_gcing()) {
+                    // The GC pass is over.  Its extent-sized buffer only gets
+                    // reused until then.
+                    io_buffers.trim(IO_BUFFER_POOL_SLACK);
+                    return;
+                }
+
+                if (gc_pacing_timer != NULL) {
+                    // on_timer will get us going again.
                     return;
                 }
 
                 ASSERT_NO_CORO_WAITING;
 
+                maybe_rescore_old_extents();
+
+                if (!gc_is_urgent()) {
+                    update_gc_rate();
+                    const gc_entry_t *next = gc_pq.peak();
+                    const microtime_t wait = gc_rate.request(
+                        static_config->extent_size() - next->garbage_bytes(),
+                        current_microtime());
+                    if (wait > 0) {
+                        gc_pacing_timer = fire_timer_once(
+                            (wait + THOUSAND - 1) / THOUSAND, this);
+                        return;
+                    }
+                }
+
                 ++stats->pm_serializer_data_extents_gced;
 
                 /* grab the entry */
@@ -1086,8 +1275,7 @@ void data_block_manager_t::run_gc() {
                 gc_state.refcount++;
 
                 guarantee(!gc_state.gc_blocks.has());
-                gc_state.gc_blocks.init(malloc_aligned(extent_manager->extent_size,
-                                                       DEVICE_BLOCK_SIZE));
+                gc_state.gc_blocks = io_buffers.acquire(extent_manager->extent_size);
                 gc_state.set_step(gc_read);
 
                 // We're going to send as few discrete reads as possible, minimizing
@@ -1109,7 +1297,7 @@ void data_block_manager_t::run_gc() {
 
                         const uint32_t end
                             = gc_state.current_entry->relative_offset(i)
-                            + gc_entry_t::aligned_value(gc_state.current_entry->block_size(i));
+                            + gc_entry_t::aligned_value(gc_state.current_entry->disk_size(i));
 
                         if (beg <= current_interval_end) {
                             current_interval_end = end;
@@ -1180,7 +1368,8 @@ void data_block_manager_t::run_gc() {
                         + gc_state.current_entry->relative_offset(i);
 
                     gc_writes.push_back(gc_write_t(block, block_offset,
-                                                   gc_state.current_entry->block_size(i)));
+                                                   gc_state.current_entry->block_size(i),
+                                                   gc_state.current_entry->compressed_size(i)));
                 }
 
                 guarantee(gc_writes.size() == num_writes);
@@ -1274,6 +1463,17 @@ void data_block_manager_t::actually_shutdown() {
         active_extent = NULL;
     }
 
+    if (gc_pacing_timer != NULL) {
+        cancel_timer(gc_pacing_timer);
+        gc_pacing_timer = NULL;
+    }
+
+    if (gc_active_extent != NULL) {
+        UNUSED int64_t extent = gc_active_extent->extent_ref.release();
+        delete gc_active_extent;
+        gc_active_extent = NULL;
+    }
+
     while (gc_entry_t *entry = young_extent_queue.head()) {
         young_extent_queue.remove(entry);
         UNUSED int64_t extent = entry->extent_ref.release();
@@ -1292,17 +1492,20 @@ void data_block_manager_t::actually_shutdown() {
 }
 
 std::vector<std::vector<counted_t<ls_block_token_pointee_t> > >
-data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes) {
+data_block_manager_t::gimme_some_new_offsets(const std::vector<extent_write_t> &writes,
+                                             const gc_entry_t *gc_source) {
     ASSERT_NO_CORO_WAITING;
 
+    gc_entry_t **const active = gc_source == NULL ? &active_extent : &gc_active_extent;
+
     // Start a new extent if necessary.
-    if (active_extent == NULL) {
-        active_extent = new gc_entry_t(this);
+    if (*active == NULL) {
+        *active = new gc_entry_t(this);
         ++stats->pm_serializer_data_extents_allocated;
     }
 
 
-    guarantee(active_extent->state == gc_entry_t::state_active);
+    guarantee((*active)->state == gc_entry_t::state_active);
 
     std::vector<std::vector<counted_t<ls_block_token_pointee_t> > > ret;
 
@@ -1310,25 +1513,31 @@ data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t>
     for (auto it = writes.begin(); it != writes.end(); ++it) {
         uint32_t relative_offset = valgrind_undefined<uint32_t>(UINT32_MAX);
         unsigned int block_index = valgrind_undefined<unsigned int>(UINT_MAX);
-        if (!active_extent->new_offset(it->block_size,
-                                       &relative_offset, &block_index)) {
-            // Move the active_extent gc_entry_t to the young extent queue (if it's
-            // not already empty), and make a new gc_entry_t.
-            if (active_extent->num_live_blocks() == 0) {
-                gc_entry_t *old_active_extent = active_extent;
-                active_extent = new gc_entry_t(this);
+        if (!(*active)->new_offset(it->block_size, it->compressed_size,
+                                   &relative_offset, &block_index)) {
+            // Retire the full extent (unless it's already empty), and make a new
+            // gc_entry_t.  Extents of blocks from the cache go to the young extent
+            // queue; the blocks the GC moved have already proven long-lived, so
+            // their extents are GC candidates right away.
+            if ((*active)->num_live_blocks() == 0) {
+                gc_entry_t *old_active_extent = *active;
+                *active = new gc_entry_t(this);
                 destroy_entry(old_active_extent);
-            } else {
-                active_extent->state = gc_entry_t::state_young;
-                young_extent_queue.push_back(active_extent);
+            } else if (gc_source == NULL) {
+                (*active)->state = gc_entry_t::state_young;
+                young_extent_queue.push_back(*active);
                 mark_unyoung_entries();
-                active_extent = new gc_entry_t(this);
+                *active = new gc_entry_t(this);
+            } else {
+                make_entry_old(*active);
+                *active = new gc_entry_t(this);
             }
 
             ++stats->pm_serializer_data_extents_allocated;
-            const bool succeeded = active_extent->new_offset(it->block_size,
-                                                             &relative_offset,
-                                                             &block_index);
+            const bool succeeded = (*active)->new_offset(it->block_size,
+                                                         it->compressed_size,
+                                                         &relative_offset,
+                                                         &block_index);
             guarantee(succeeded);
 
             // Push the current group of tokens, if it's nonempty, onto the return vector.
@@ -1338,11 +1547,16 @@ data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t>
             }
         }
 
-        const int64_t offset = active_extent->extent_ref.offset() + relative_offset;
-        active_extent->was_written = true;
-        active_extent->mark_live_tokenwise(block_index);
+        const int64_t offset = (*active)->extent_ref.offset() + relative_offset;
+        (*active)->was_written = true;
+        (*active)->mark_live_tokenwise(block_index);
+        if (gc_source != NULL) {
+            (*active)->data_timestamp = std::min((*active)->data_timestamp,
+                                                 gc_source->data_timestamp);
+        }
 
-        tokens.push_back(serializer->generate_block_token(offset, it->block_size));
+        tokens.push_back(serializer->generate_block_token(offset, it->block_size,
+                                                          it->compressed_size));
     }
 
     if (!tokens.empty()) {
@@ -1352,6 +1566,28 @@ data_block_manager_t::gimme_some_new_offsets(const std::vector<buf_write_info_t>
     return ret;
 }
 
+void data_block_manager_t::note_bytes_written(int64_t bytes, bool by_gc) {
+    if (by_gc) {
+        gc_bytes_written += bytes;
+        stats->pm_serializer_gc_bytes_written += bytes;
+    } else {
+        data_bytes_written += bytes;
+        stats->pm_serializer_data_bytes_written += bytes;
+    }
+
+    // The counter can only be adjusted, so we add the difference to what we
+    // published last time.
+    if (data_bytes_written > 0) {
+        const int64_t percent
+            = 100 * (data_bytes_written + gc_bytes_written) / data_bytes_written;
+        stats->pm_serializer_write_amplification_percent
+            += percent - published_write_amplification_percent;
+        published_write_amplification_percent = percent;
+    }
+
+    update_gc_rate();
+}
+
 // Looks at young_extent_queue and pops things off the queue that are
 // no longer deemed young, putting them on the priority queue.
 void data_block_manager_t::mark_unyoung_entries() {
@@ -1376,14 +1612,33 @@ void data_block_manager_t::remove_last_unyoung_entry() {
     young_extent_queue.remove(entry);
 
     guarantee(entry->state == gc_entry_t::state_young);
+    make_entry_old(entry);
+}
+
+void data_block_manager_t::make_entry_old(gc_entry_t *entry) {
+    ASSERT_NO_CORO_WAITING;
     entry->state = gc_entry_t::state_old;
 
+    entry->gc_score = entry->cost_benefit(gc_score_epoch);
     entry->our_pq_entry = gc_pq.push(entry);
 
     gc_stats.old_total_block_bytes += static_config->extent_size();
     gc_stats.old_garbage_block_bytes += entry->garbage_bytes();
 }
 
+// Scores only get recomputed when an extent's blocks die, so without this the
+// extents' ages would stop counting for the GC order.  Since all scores are
+// relative to the same epoch, rescoring all of them keeps them comparable.
+void data_block_manager_t::maybe_rescore_old_extents() {
+    ASSERT_NO_CORO_WAITING;
+    const microtime_t now = current_microtime();
+    if (now - gc_score_epoch < GC_RESCORE_INTERVAL_MICROS) {
+        return;
+    }
+    gc_score_epoch = now;
+    rescore_gc_queue(&gc_pq, now);
+}
+
 /* functions for gc structures */
 
 // Answers the following question: We're in the middle of gc'ing, and
@@ -1401,8 +1656,51 @@ bool data_block_manager_t::do_we_want_to_start_gcing() const {
     return garbage_ratio() > dynamic_config->gc_high_ratio;
 }
 
+bool data_block_manager_t::gc_is_urgent() const {
+    // Start going all out as soon as the garbage ratio is more than 2% above the
+    // configured goal.
+    return garbage_ratio() > dynamic_config->gc_high_ratio * 1.02;
+}
+
+int64_t data_block_manager_t::gc_debt_bytes() const {
+    const double total = gc_stats.old_total_block_bytes.get()
+        + extent_manager->held_extents() * static_config->extent_size();
+    const double allowed = dynamic_config->gc_low_ratio * total;
+    return std::max<int64_t>(0, gc_stats.old_garbage_block_bytes.get() - allowed);
+}
+
+void data_block_manager_t::update_gc_rate() {
+    const double low = dynamic_config->gc_low_ratio;
+    const double high = dynamic_config->gc_high_ratio;
+    const double pressure = high > low ? (garbage_ratio() - low) / (high - low) : 1.0;
+    gc_rate.set_pressure(pressure, dynamic_config->gc_min_bytes_per_sec,
+                         dynamic_config->gc_max_bytes_per_sec);
+
+    const int64_t rate = gc_rate.bytes_per_sec();
+    stats->pm_serializer_gc_rate_bytes_per_sec += rate - published_gc_rate;
+    published_gc_rate = rate;
+
+    const int64_t debt = gc_debt_bytes();
+    stats->pm_serializer_gc_debt_bytes += debt - published_gc_debt;
+    published_gc_debt = debt;
+}
+
+void data_block_manager_t::on_timer() {
+    gc_pacing_timer = NULL;
+    if (state == state_ready && gc_state.step() == gc_ready) {
+        run_gc();
+    }
+}
+
 bool gc_entry_less_t::operator()(const gc_entry_t *x, const gc_entry_t *y) {
-    return x->garbage_bytes() < y->garbage_bytes();
+    return x->gc_score < y->gc_score;
+}
+
+double gc_cost_benefit(double utilization, microtime_t data_timestamp, microtime_t now) {
+    const double age_secs = now > data_timestamp
+        ? (now - data_timestamp) / static_cast<double>(MILLION)
+        : 0.0;
+    return (1.0 - utilization) * (1.0 + age_secs) / (1.0 + utilization);
 }
 
 /****************
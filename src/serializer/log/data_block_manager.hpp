@@ -4,15 +4,19 @@
 
 #include <vector>
 
+#include "arch/timer.hpp"
 #include "arch/types.hpp"
 #include "containers/bitset.hpp"
 #include "containers/priority_queue.hpp"
 #include "containers/scoped.hpp"
 #include "containers/two_level_array.hpp"
 #include "perfmon/types.hpp"
+#include "serializer/log/aligned_buffer_pool.hpp"
 #include "serializer/log/config.hpp"
 #include "serializer/log/extent_manager.hpp"
+#include "serializer/log/gc_rate_controller.hpp"
 #include "serializer/types.hpp"
+#include "time.hpp"
 
 class log_serializer_t;
 
@@ -24,12 +28,35 @@ struct gc_entry_less_t {
     bool operator() (const gc_entry_t *x, const gc_entry_t *y);
 };
 
+// The LFS cost-benefit score of GCing an extent whose live fraction is
+// `utilization` and whose data has been around since `data_timestamp`: how much
+// space it frees up, weighted by the data's age, per byte of extent that has to be
+// read and rewritten.  Old data that has held up so far is likely to stay alive, so
+// GCing a mostly-full extent of it is still worth it, while a young extent will
+// likely become emptier without our help.
+double gc_cost_benefit(double utilization, microtime_t data_timestamp, microtime_t now);
+
+// Recomputes the `gc_score` of every entry in `pq` as of `now`, using its
+// `cost_benefit(now)`, and rebuilds the queue in the new order.
+template <class entry_t, class less_t>
+void rescore_gc_queue(priority_queue_t<entry_t *, less_t> *pq, microtime_t now) {
+    std::vector<entry_t *> entries;
+    entries.reserve(pq->size());
+    while (!pq->empty()) {
+        entries.push_back(pq->pop());
+    }
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        (*it)->gc_score = (*it)->cost_benefit(now);
+        (*it)->our_pq_entry = pq->push(*it);
+    }
+}
+
 namespace data_block_manager {
 struct shutdown_callback_t;  // see log_serializer.hpp.
 struct metablock_mixin_t;  // see log_serializer.hpp.
 }  // namespace data_block_manager
 
-class data_block_manager_t {
+class data_block_manager_t : private timer_callback_t {
     friend class gc_entry_t;
     friend class dbm_read_ahead_t;
 private:
@@ -37,10 +64,26 @@ private:
         ser_buffer_t *buf;
         int64_t old_offset;
         block_size_t block_size;
+        // The block is stored (and `buf` holds it) compressed if this is nonzero.
+        uint32_t compressed_size;
         gc_write_t(ser_buffer_t *b, int64_t _old_offset,
-                   block_size_t _block_size)
+                   block_size_t _block_size, uint32_t _compressed_size)
             : buf(b), old_offset(_old_offset),
-              block_size(_block_size) { }
+              block_size(_block_size), compressed_size(_compressed_size) { }
+    };
+
+    // A block the way it gets written to an extent: `data` holds the block itself
+    // or, if compressed_size is nonzero, its compressed form.
+    struct extent_write_t {
+        void *data;
+        block_size_t block_size;
+        uint32_t compressed_size;
+
+        block_size_t disk_size() const {
+            return compressed_size != 0
+                ? block_size_t::unsafe_make(compressed_size)
+                : block_size;
+        }
     };
 
     struct gc_writer_t {
@@ -64,7 +107,8 @@ public:
     static void prepare_initial_metablock(data_block_manager::metablock_mixin_t *mb);
     void start_existing(file_t *dbfile, data_block_manager::metablock_mixin_t *last_metablock);
 
-    void read(int64_t off_in, uint32_t ser_block_size,
+    // compressed_size is the block's lba_entry_t::compressed_size.
+    void read(int64_t off_in, uint32_t ser_block_size, uint32_t compressed_size,
               void *buf_out, file_account_t *io_account);
 
     /* exposed gc api */
@@ -73,7 +117,7 @@ public:
 
     /* r{start,end}_reconstruct functions for safety */
     void start_reconstruct();
-    void mark_live(int64_t offset, block_size_t block_size);
+    void mark_live(int64_t offset, block_size_t block_size, uint32_t compressed_size);
     void end_reconstruct();
 
     /* We must make sure that blocks which have tokens pointing to them don't
@@ -97,20 +141,46 @@ public:
     // ratio of garbage to blocks in the system
     double garbage_ratio() const;
 
+    // Compresses the blocks first if dynamic_config->compress_blocks is set.
     std::vector<counted_t<ls_block_token_pointee_t> >
     many_writes(const std::vector<buf_write_info_t> &writes,
                 file_account_t *io_account,
                 iocallback_t *cb);
 
+private:
+    // `gc_source` is NULL for writes from the cache.  For the GC's writes it is
+    // the extent the blocks are being moved out of; those blocks go to
+    // gc_active_extent instead of active_extent.
+    std::vector<counted_t<ls_block_token_pointee_t> >
+    many_extent_writes(const std::vector<extent_write_t> &writes,
+                       const gc_entry_t *gc_source,
+                       file_account_t *io_account,
+                       iocallback_t *cb);
+
     std::vector<std::vector<counted_t<ls_block_token_pointee_t> > >
-    gimme_some_new_offsets(const std::vector<buf_write_info_t> &writes);
+    gimme_some_new_offsets(const std::vector<extent_write_t> &writes,
+                           const gc_entry_t *gc_source);
 
+    // Counts bytes written to data extents, for the write amplification stats.
+    void note_bytes_written(int64_t bytes, bool by_gc);
 
-private:
     void actually_shutdown();
 
     file_account_t *choose_gc_io_account();
 
+    // Whether the garbage ratio has gotten far enough above gc_high_ratio that the
+    // GC should neither be throttled nor nice about its i/o.
+    bool gc_is_urgent() const;
+
+    // How many bytes of garbage there are beyond what gc_low_ratio allows for.
+    int64_t gc_debt_bytes() const;
+
+    // Updates gc_rate (and its stats) for the current garbage ratio.
+    void update_gc_rate();
+
+    // Resumes the GC once it has waited for gc_rate.
+    void on_timer();
+
     /* Checks whether the extent is empty and if it is, notifies the extent manager
        and cleans up */
     void check_and_handle_empty_extent(uint64_t extent_id);
@@ -125,6 +195,13 @@ private:
     // to be not young.
     void remove_last_unyoung_entry();
 
+    // Turns a full active or young extent into a GC candidate.
+    void make_entry_old(gc_entry_t *entry);
+
+    // Recomputes the GC score of every extent in gc_pq, if it has been
+    // GC_RESCORE_INTERVAL_MICROS since we last did.
+    void maybe_rescore_old_extents();
+
     void destroy_entry(gc_entry_t *entry);
 
     bool should_perform_read_ahead(int64_t offset);
@@ -165,6 +242,11 @@ private:
     scoped_ptr_t<file_account_t> gc_io_account_nice;
     scoped_ptr_t<file_account_t> gc_io_account_high;
 
+    /* Aligned buffers for reads that can't go straight into the caller's buffer
+    (read-ahead, unaligned reads) and for the GC's extent buffer. Declared before
+    `gc_state` so that it outlives `gc_state.gc_blocks`. */
+    aligned_buffer_pool_t io_buffers;
+
     /* Contains a pointer to every gc_entry_t, regardless of what its current state
        is */
     two_level_array_t<gc_entry_t *> entries;
@@ -172,15 +254,38 @@ private:
     /* Contains every extent in the gc_entry_t::state_reconstructing state */
     intrusive_list_t<gc_entry_t> reconstructed_extents;
 
-    /* Contains the extent in the gc_entry_t::state_active state. */
+    /* The extents in the gc_entry_t::state_active state: the one that new blocks
+       from the cache go to, and the one that the GC moves live blocks to.  Blocks
+       that survived long enough to get GCed tend to stay around, so we don't mix
+       them with the recently written blocks, which tend to get overwritten soon.
+       Only active_extent is recorded in the metablock; after a restart
+       gc_active_extent's blocks are found in an ordinary old extent. */
     gc_entry_t *active_extent;
+    gc_entry_t *gc_active_extent;
 
     /* Contains every extent in the gc_entry_t::state_young state */
     intrusive_list_t<gc_entry_t> young_extent_queue;
 
-    /* Contains every extent in the gc_entry_t::state_old state */
+    /* Contains every extent in the gc_entry_t::state_old state, ordered by
+       gc_entry_t::gc_score. */
     priority_queue_t<gc_entry_t *, gc_entry_less_t> gc_pq;
 
+    /* The time that the GC scores of the extents in gc_pq are relative to. */
+    microtime_t gc_score_epoch;
+
+    /* Paces the GC, and the timer that resumes it when it had to wait. */
+    gc_rate_controller_t gc_rate;
+    timer_token_t *gc_pacing_timer;
+
+    /* The values we last added to the GC rate and debt stats. */
+    int64_t published_gc_rate;
+    int64_t published_gc_debt;
+
+    /* Totals behind the write amplification stats. */
+    int64_t data_bytes_written;
+    int64_t gc_bytes_written;
+    int64_t published_write_amplification_percent;
+
 
     /* Buffer used during GC. */
     std::vector<gc_write_t> gc_writes;
@@ -216,7 +321,7 @@ private:
         int refcount;
 
         // A buffer for blocks we're transferring.
-        scoped_malloc_t<char> gc_blocks;
+        aligned_buffer_t gc_blocks;
 
 
         // The entry we're currently GCing.
@@ -0,0 +1,59 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/log/gc_rate_controller.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "config/args.hpp"
+
+const double gc_rate_controller_t::LATENCY_TOLERANCE = 2.0;
+const double gc_rate_controller_t::MAX_BURST_SECS = 1.0;
+
+// Weights of a new latency sample in the fast and the slow moving average.
+static const double RECENT_LATENCY_WEIGHT = 0.2;
+static const double USUAL_LATENCY_WEIGHT = 0.01;
+
+gc_rate_controller_t::gc_rate_controller_t()
+    : rate_(DEFAULT_GC_MIN_BYTES_PER_SEC), budget_(0), last_refill_(0),
+      recent_latency_(0), usual_latency_(0) { }
+
+void gc_rate_controller_t::note_foreground_write(microtime_t latency) {
+    if (usual_latency_ == 0) {
+        recent_latency_ = usual_latency_ = latency;
+    } else {
+        recent_latency_ += RECENT_LATENCY_WEIGHT * (latency - recent_latency_);
+        usual_latency_ += USUAL_LATENCY_WEIGHT * (latency - usual_latency_);
+    }
+}
+
+void gc_rate_controller_t::set_pressure(double pressure, int64_t min_bytes_per_sec,
+                                        int64_t max_bytes_per_sec) {
+    guarantee(0 < min_bytes_per_sec && min_bytes_per_sec <= max_bytes_per_sec);
+    pressure = std::min(std::max(pressure, 0.0), 1.0);
+
+    double slowdown = 1.0;
+    if (recent_latency_ > LATENCY_TOLERANCE * usual_latency_) {
+        slowdown = LATENCY_TOLERANCE * usual_latency_ / recent_latency_;
+    }
+
+    rate_ = min_bytes_per_sec
+        + (max_bytes_per_sec - min_bytes_per_sec) * pressure * slowdown;
+}
+
+microtime_t gc_rate_controller_t::request(int64_t bytes, microtime_t now) {
+    refill(now);
+    if (budget_ < 0) {
+        return static_cast<microtime_t>(ceil(-budget_ / rate_ * MILLION));
+    }
+    budget_ -= bytes;
+    return 0;
+}
+
+void gc_rate_controller_t::refill(microtime_t now) {
+    if (last_refill_ != 0 && now > last_refill_) {
+        budget_ += rate_ * (now - last_refill_) / MILLION;
+        budget_ = std::min(budget_, rate_ * MAX_BURST_SECS);
+    }
+    last_refill_ = now;
+}
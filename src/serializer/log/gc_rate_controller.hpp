@@ -0,0 +1,58 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_GC_RATE_CONTROLLER_HPP_
+#define SERIALIZER_LOG_GC_RATE_CONTROLLER_HPP_
+
+#include <stdint.h>
+
+#include "errors.hpp"
+#include "time.hpp"
+
+/* Decides how fast the data block GC may move live data, so that it works off
+garbage steadily instead of switching between idling and a full-priority burst.
+
+The rate goes from the configured minimum when the garbage ratio is at
+`gc_low_ratio` up to the maximum when it reaches `gc_high_ratio`.  While writes from
+the cache take much longer than they usually do, the rate is cut back (but never
+below the minimum).  The GC spends the rate like a token bucket: it may start
+moving an extent whenever the budget isn't negative, and then has to wait until
+the budget has been paid back. */
+class gc_rate_controller_t {
+public:
+    gc_rate_controller_t();
+
+    // Records how long a write from the cache took.
+    void note_foreground_write(microtime_t latency);
+
+    // Recomputes the rate.  `pressure` is 0 when the garbage ratio is at the low
+    // ratio and 1 when it is at the high ratio.
+    void set_pressure(double pressure, int64_t min_bytes_per_sec,
+                      int64_t max_bytes_per_sec);
+
+    // Asks to move `bytes`.  Returns 0 and charges the bytes if the GC may go ahead
+    // now; otherwise returns how many microseconds to wait before asking again.
+    microtime_t request(int64_t bytes, microtime_t now);
+
+    int64_t bytes_per_sec() const { return static_cast<int64_t>(rate_); }
+
+    // Writes are considered slow once they take this many times as long as usual.
+    static const double LATENCY_TOLERANCE;
+    // The budget can't build up beyond this many seconds' worth of the rate.
+    static const double MAX_BURST_SECS;
+
+private:
+    void refill(microtime_t now);
+
+    double rate_;
+    double budget_;
+    microtime_t last_refill_;
+
+    // Moving averages of foreground write latency: a fast one for how writes are
+    // doing right now and a slow one for how they usually do.  Zero until the
+    // first write.
+    double recent_latency_;
+    double usual_latency_;
+
+    DISABLE_COPYING(gc_rate_controller_t);
+};
+
+#endif  // SERIALIZER_LOG_GC_RATE_CONTROLLER_HPP_
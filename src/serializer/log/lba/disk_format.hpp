@@ -64,24 +64,24 @@ struct lba_entry_t {
 
     uint32_t ser_block_size;
 
-    // TODO: Remove the need for these fields (or this zero field).  Remove the
-    // requirement that lba_entry_t be a divisor of DEVICE_BLOCK_SIZE.  When doing
-    // so, be sure to make lba entries backwards compatiblizable for now.  (We could
-    // in the future use this value being non-zero to mean the lba entry is a
-    // new-style entry.)
-    uint32_t zero2;
+    // If nonzero, the block is stored zlib-compressed (see
+    // data_block_manager_t::many_writes) and takes up this many bytes on disk
+    // instead of ser_block_size.
+    uint32_t compressed_size;
 
     repli_timestamp_t recency;
     // An offset into the file, with is_delete set appropriately.
     flagged_off64_t offset;
 
     static lba_entry_t make(block_id_t block_id, repli_timestamp_t recency,
-                            flagged_off64_t offset, uint32_t ser_block_size) {
+                            flagged_off64_t offset, uint32_t ser_block_size,
+                            uint32_t compressed_size) {
         guarantee(ser_block_size != 0 || !offset.has_value());
+        guarantee(compressed_size < ser_block_size || compressed_size == 0);
         lba_entry_t entry;
         entry.block_id = block_id;
         entry.ser_block_size = ser_block_size;
-        entry.zero2 = 0;
+        entry.compressed_size = compressed_size;
         entry.recency = recency;
         entry.offset = offset;
         return entry;
@@ -92,7 +92,7 @@ struct lba_entry_t {
     }
 
     static lba_entry_t make_padding_entry() {
-        return make(PADDING_BLOCK_ID, repli_timestamp_t::invalid, flagged_off64_t::padding(), 0);
+        return make(PADDING_BLOCK_ID, repli_timestamp_t::invalid, flagged_off64_t::padding(), 0, 0);
     }
 } __attribute__((__packed__));
 
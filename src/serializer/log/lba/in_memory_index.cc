@@ -3,25 +3,429 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
+#include <boost/crc.hpp>
+
+#include "arch/arch.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "math.hpp"
 #include "serializer/log/lba/disk_format.hpp"
 
-in_memory_index_t::in_memory_index_t() : end_block_id_(0) { }
+static const uint64_t NO_RECENCY_BASE = UINT64_MAX;
+// A chunk's recency base is picked this far below the first recency stored in it,
+// so that somewhat older recencies can be encoded too.
+static const uint64_t RECENCY_BASE_SLACK = 1ull << 31;
+static const uint32_t MAX_SIZE_CLASSES = 1 << (64 - compact_block_info_t::OFFSET_BITS);
+
+in_memory_index_t::chunk_t::chunk_t()
+    : recency_base(NO_RECENCY_BASE), count(0), infos() { }
+
+in_memory_index_t::shard_t::~shard_t() {
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        delete *it;
+    }
+}
+
+bool in_memory_index_t::shard_t::encode(chunk_t *chunk, const index_block_info_t &info,
+                                        compact_block_info_t *out) {
+    uint64_t offset_code;
+    if (info.offset.has_value()) {
+        const int64_t offset = info.offset.get_value();
+        if (!divides(DEVICE_BLOCK_SIZE, offset)) {
+            return false;
+        }
+        offset_code = offset / DEVICE_BLOCK_SIZE + 1;
+        if (offset_code >= (1ull << compact_block_info_t::OFFSET_BITS)) {
+            return false;
+        }
+    } else {
+        if (!(info.offset == flagged_off64_t::unused())) {
+            return false;
+        }
+        offset_code = 0;
+    }
+
+    uint32_t recency_code;
+    if (info.recency == repli_timestamp_t::invalid) {
+        recency_code = 0;
+    } else {
+        const uint64_t recency = info.recency.longtime;
+        if (chunk->recency_base == NO_RECENCY_BASE) {
+            chunk->recency_base = recency > RECENCY_BASE_SLACK
+                ? recency - RECENCY_BASE_SLACK : 0;
+        }
+        if (recency < chunk->recency_base
+            || recency - chunk->recency_base + 1 >= compact_block_info_t::RECENCY_OVERFLOW) {
+            return false;
+        }
+        recency_code = recency - chunk->recency_base + 1;
+    }
+
+    uint32_t size_class;
+    const uint64_t sizes = (static_cast<uint64_t>(info.ser_block_size) << 32)
+        | info.compressed_size;
+    if (size_classes.empty()) {
+        size_classes.push_back(std::make_pair(0, 0));
+        size_class_ids[0] = 0;
+    }
+    auto it = size_class_ids.find(sizes);
+    if (it != size_class_ids.end()) {
+        size_class = it->second;
+    } else {
+        if (size_classes.size() >= MAX_SIZE_CLASSES) {
+            return false;
+        }
+        size_class = size_classes.size();
+        size_classes.push_back(std::make_pair(info.ser_block_size, info.compressed_size));
+        size_class_ids[sizes] = size_class;
+    }
+
+    out->offset_and_size_class = offset_code
+        | (static_cast<uint64_t>(size_class) << compact_block_info_t::OFFSET_BITS);
+    out->recency = recency_code;
+    return true;
+}
+
+index_block_info_t in_memory_index_t::shard_t::decode(
+        const chunk_t *chunk, const compact_block_info_t &compact) const {
+    rassert(compact.recency != compact_block_info_t::RECENCY_OVERFLOW);
+    const uint64_t offset_code = compact.offset_and_size_class
+        & ((1ull << compact_block_info_t::OFFSET_BITS) - 1);
+    const uint32_t size_class
+        = compact.offset_and_size_class >> compact_block_info_t::OFFSET_BITS;
+
+    index_block_info_t info;
+    if (offset_code != 0) {
+        info.offset = flagged_off64_t::make((offset_code - 1) * DEVICE_BLOCK_SIZE);
+    }
+    if (compact.recency != 0) {
+        info.recency.longtime = chunk->recency_base + compact.recency - 1;
+    }
+    if (size_class != 0) {
+        info.ser_block_size = size_classes[size_class].first;
+        info.compressed_size = size_classes[size_class].second;
+    }
+    return info;
+}
+
+void in_memory_index_t::shard_t::rebase(chunk_t *chunk, size_t first_index,
+                                        uint64_t recency) {
+    std::vector<index_block_info_t> infos(CHUNK_SIZE);
+    uint64_t oldest = recency;
+    uint64_t newest = recency;
+    for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+        const compact_block_info_t &compact = chunk->infos[i];
+        if (compact.recency == compact_block_info_t::RECENCY_OVERFLOW) {
+            auto it = overflow.find(first_index + i);
+            guarantee(it != overflow.end());
+            infos[i] = it->second;
+            overflow.erase(it);
+        } else {
+            infos[i] = decode(chunk, compact);
+        }
+        if (infos[i].recency != repli_timestamp_t::invalid) {
+            oldest = std::min(oldest, infos[i].recency.longtime);
+            newest = std::max(newest, infos[i].recency.longtime);
+        }
+    }
+
+    // Leave as much room above the newest recency as a new chunk gets below its
+    // first one.
+    chunk->recency_base = newest > RECENCY_BASE_SLACK
+        ? std::max(oldest, newest - RECENCY_BASE_SLACK) : oldest;
+    for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+        compact_block_info_t *compact = &chunk->infos[i];
+        if (infos[i] == index_block_info_t()) {
+            compact->offset_and_size_class = 0;
+            compact->recency = 0;
+        } else if (!encode(chunk, infos[i], compact)) {
+            compact->offset_and_size_class = 0;
+            compact->recency = compact_block_info_t::RECENCY_OVERFLOW;
+            overflow[first_index + i] = infos[i];
+        }
+    }
+}
+
+index_block_info_t in_memory_index_t::shard_t::get(size_t index) const {
+    const size_t chunk_id = index / CHUNK_SIZE;
+    if (chunk_id >= chunks.size() || chunks[chunk_id] == NULL) {
+        return index_block_info_t();
+    }
+    const chunk_t *chunk = chunks[chunk_id];
+    const compact_block_info_t &compact = chunk->infos[index % CHUNK_SIZE];
+    if (compact.recency == compact_block_info_t::RECENCY_OVERFLOW) {
+        auto it = overflow.find(index);
+        guarantee(it != overflow.end());
+        return it->second;
+    }
+    return decode(chunk, compact);
+}
+
+void in_memory_index_t::shard_t::set(size_t index, const index_block_info_t &info) {
+    const bool is_empty = info == index_block_info_t();
+    const size_t chunk_id = index / CHUNK_SIZE;
+    if (chunk_id >= chunks.size() || chunks[chunk_id] == NULL) {
+        if (is_empty) {
+            return;
+        }
+        if (chunk_id >= chunks.size()) {
+            chunks.resize(chunk_id + 1, NULL);
+        }
+        chunks[chunk_id] = new chunk_t;
+    }
+
+    chunk_t *chunk = chunks[chunk_id];
+    if (!is_empty && info.recency != repli_timestamp_t::invalid
+        && chunk->recency_base != NO_RECENCY_BASE
+        && info.recency.longtime >= chunk->recency_base
+        && info.recency.longtime - chunk->recency_base + 1
+           >= compact_block_info_t::RECENCY_OVERFLOW) {
+        // Recencies only grow, so this happens at most once per 2^31 of them.
+        rebase(chunk, chunk_id * CHUNK_SIZE, info.recency.longtime);
+    }
+    compact_block_info_t *compact = &chunk->infos[index % CHUNK_SIZE];
+    const bool was_empty = compact->offset_and_size_class == 0 && compact->recency == 0;
+    if (compact->recency == compact_block_info_t::RECENCY_OVERFLOW) {
+        overflow.erase(index);
+    }
+
+    if (is_empty) {
+        compact->offset_and_size_class = 0;
+        compact->recency = 0;
+    } else if (!encode(chunk, info, compact)) {
+        compact->offset_and_size_class = 0;
+        compact->recency = compact_block_info_t::RECENCY_OVERFLOW;
+        overflow[index] = info;
+    }
+
+    if (!was_empty) {
+        --chunk->count;
+    }
+    if (!is_empty) {
+        ++chunk->count;
+    }
+
+    if (chunk->count == 0) {
+        chunks[chunk_id] = NULL;
+        delete chunk;
+
+        while (!chunks.empty() && chunks.back() == NULL) {
+            chunks.pop_back();
+        }
+    }
+}
+
+in_memory_index_t::in_memory_index_t() { }
 
 block_id_t in_memory_index_t::end_block_id() {
-    return end_block_id_;
+    block_id_t ret = 0;
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        ret = std::max(ret, shards_[i].end_block_id);
+    }
+    return ret;
 }
 
 index_block_info_t in_memory_index_t::get_block_info(block_id_t id) {
-    return infos_.get(id);
+    return shards_[id % LBA_SHARD_FACTOR].get(id / LBA_SHARD_FACTOR);
 }
 
 void in_memory_index_t::set_block_info(block_id_t id, repli_timestamp_t recency,
-                                       flagged_off64_t offset, uint32_t ser_block_size) {
-    if (id >= end_block_id_) {
-        end_block_id_ = id + 1;
+                                       flagged_off64_t offset, uint32_t ser_block_size,
+                                       uint32_t compressed_size) {
+    shard_t *shard = &shards_[id % LBA_SHARD_FACTOR];
+    if (id >= shard->end_block_id) {
+        shard->end_block_id = id + 1;
+    }
+
+    index_block_info_t info(offset, recency, ser_block_size, compressed_size);
+    shard->set(id / LBA_SHARD_FACTOR, info);
+}
+
+void in_memory_index_t::swap(in_memory_index_t *other) {
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        shard_t *ours = &shards_[i];
+        shard_t *theirs = &other->shards_[i];
+        ours->chunks.swap(theirs->chunks);
+        std::swap(ours->end_block_id, theirs->end_block_id);
+        ours->size_classes.swap(theirs->size_classes);
+        ours->size_class_ids.swap(theirs->size_class_ids);
+        ours->overflow.swap(theirs->overflow);
+    }
+}
+
+size_t in_memory_index_t::memory_usage() const {
+    // Roughly what a node of an unordered_map costs on top of its value.
+    const size_t hash_node_overhead = 2 * sizeof(void *);
+    size_t ret = sizeof(*this);
+    for (int i = 0; i < LBA_SHARD_FACTOR; ++i) {
+        const shard_t *shard = &shards_[i];
+        ret += shard->chunks.capacity() * sizeof(chunk_t *);
+        for (auto it = shard->chunks.begin(); it != shard->chunks.end(); ++it) {
+            if (*it != NULL) {
+                ret += sizeof(chunk_t);
+            }
+        }
+        ret += shard->size_classes.capacity() * sizeof(shard->size_classes[0]);
+        ret += shard->size_class_ids.bucket_count() * sizeof(void *)
+            + shard->size_class_ids.size()
+              * (sizeof(std::pair<uint64_t, uint32_t>) + hash_node_overhead);
+        ret += shard->overflow.bucket_count() * sizeof(void *)
+            + shard->overflow.size()
+              * (sizeof(std::pair<size_t, index_block_info_t>) + hash_node_overhead);
+    }
+    return ret;
+}
+
+/* A snapshot file starts with one device block holding an index_snapshot_header_t,
+followed by `entry_count` index_snapshot_entry_t's, zero-padded to a whole number of
+device blocks.  The header is written last, so a snapshot whose writing got
+interrupted doesn't have a valid header. */
+
+#define INDEX_SNAPSHOT_MAGIC "idxsnap1"
+#define INDEX_SNAPSHOT_CHUNK_SIZE MEGABYTE
+
+struct index_snapshot_header_t {
+    char magic[sizeof(INDEX_SNAPSHOT_MAGIC)];
+    int64_t metablock_version;
+    uint64_t entry_count;
+    uint32_t entries_crc;
+    // The CRC of the fields above.
+    uint32_t header_crc;
+
+    uint32_t compute_header_crc() const {
+        boost::crc_32_type crc_computer;
+        crc_computer.process_bytes(this, offsetof(index_snapshot_header_t, header_crc));
+        return crc_computer.checksum();
+    }
+} __attribute__((__packed__));
+
+struct index_snapshot_entry_t {
+    block_id_t block_id;
+    index_block_info_t info;
+} __attribute__((__packed__));
+
+static_assert(INDEX_SNAPSHOT_CHUNK_SIZE % sizeof(index_snapshot_entry_t) == 0,
+              "Snapshot chunks must hold a whole number of entries.");
+static_assert(INDEX_SNAPSHOT_CHUNK_SIZE % DEVICE_BLOCK_SIZE == 0,
+              "Snapshot chunks must be device block aligned.");
+
+void in_memory_index_t::write_snapshot(file_t *file, int64_t metablock_version) {
+    char *buffer = reinterpret_cast<char *>(
+        malloc_aligned(INDEX_SNAPSHOT_CHUNK_SIZE, DEVICE_BLOCK_SIZE));
+    index_snapshot_entry_t *entries = reinterpret_cast<index_snapshot_entry_t *>(buffer);
+    const size_t entries_per_chunk
+        = INDEX_SNAPSHOT_CHUNK_SIZE / sizeof(index_snapshot_entry_t);
+
+    boost::crc_32_type crc_computer;
+    uint64_t entry_count = 0;
+    int64_t offset = DEVICE_BLOCK_SIZE;
+    size_t in_chunk = 0;
+
+    auto flush_chunk = [&]() {
+        const size_t size = ceil_aligned(in_chunk * sizeof(index_snapshot_entry_t),
+                                         DEVICE_BLOCK_SIZE);
+        memset(buffer + in_chunk * sizeof(index_snapshot_entry_t), 0,
+               size - in_chunk * sizeof(index_snapshot_entry_t));
+        crc_computer.process_bytes(buffer, in_chunk * sizeof(index_snapshot_entry_t));
+        file->set_file_size_at_least(offset + size);
+        co_write(file, offset, size, buffer, DEFAULT_DISK_ACCOUNT, file_t::NO_DATASYNCS);
+        offset += size;
+        in_chunk = 0;
+    };
+
+    for (int shard = 0; shard < LBA_SHARD_FACTOR; ++shard) {
+        for (block_id_t id = shard; id < shards_[shard].end_block_id; id += LBA_SHARD_FACTOR) {
+            const index_block_info_t info = get_block_info(id);
+            if (info == index_block_info_t()) {
+                continue;
+            }
+            entries[in_chunk].block_id = id;
+            entries[in_chunk].info = info;
+            ++in_chunk;
+            ++entry_count;
+            if (in_chunk == entries_per_chunk) {
+                flush_chunk();
+            }
+        }
+    }
+    if (in_chunk > 0) {
+        flush_chunk();
+    }
+
+    // The datasyncs around the header write make sure that the entries are on
+    // disk before a valid header is.
+    bzero(buffer, DEVICE_BLOCK_SIZE);
+    index_snapshot_header_t *header = reinterpret_cast<index_snapshot_header_t *>(buffer);
+    memcpy(header->magic, INDEX_SNAPSHOT_MAGIC, sizeof(INDEX_SNAPSHOT_MAGIC));
+    header->metablock_version = metablock_version;
+    header->entry_count = entry_count;
+    header->entries_crc = crc_computer.checksum();
+    header->header_crc = header->compute_header_crc();
+    file->set_file_size_at_least(DEVICE_BLOCK_SIZE);
+    co_write(file, 0, DEVICE_BLOCK_SIZE, buffer, DEFAULT_DISK_ACCOUNT,
+             file_t::WRAP_IN_DATASYNCS);
+
+    free(buffer);
+}
+
+bool in_memory_index_t::read_snapshot(file_t *file, int64_t *metablock_version_out) {
+    rassert(end_block_id() == 0);
+    if (file->get_file_size() < DEVICE_BLOCK_SIZE) {
+        return false;
+    }
+
+    char *buffer = reinterpret_cast<char *>(
+        malloc_aligned(INDEX_SNAPSHOT_CHUNK_SIZE, DEVICE_BLOCK_SIZE));
+    co_read(file, 0, DEVICE_BLOCK_SIZE, buffer, DEFAULT_DISK_ACCOUNT);
+    const index_snapshot_header_t header
+        = *reinterpret_cast<index_snapshot_header_t *>(buffer);
+
+    const int64_t entries_size = header.entry_count * sizeof(index_snapshot_entry_t);
+    if (memcmp(header.magic, INDEX_SNAPSHOT_MAGIC, sizeof(INDEX_SNAPSHOT_MAGIC)) != 0
+        || header.header_crc != header.compute_header_crc()
+        || file->get_file_size() < DEVICE_BLOCK_SIZE + entries_size) {
+        free(buffer);
+        return false;
     }
 
-    index_block_info_t info(offset, recency, ser_block_size);
-    infos_.set(id, info);
+    boost::crc_32_type crc_computer;
+    const index_snapshot_entry_t *entries
+        = reinterpret_cast<const index_snapshot_entry_t *>(buffer);
+    int64_t offset = DEVICE_BLOCK_SIZE;
+    uint64_t remaining = header.entry_count;
+    while (remaining > 0) {
+        const size_t count = std::min<uint64_t>(
+            remaining, INDEX_SNAPSHOT_CHUNK_SIZE / sizeof(index_snapshot_entry_t));
+        const size_t size = ceil_aligned(count * sizeof(index_snapshot_entry_t),
+                                         DEVICE_BLOCK_SIZE);
+        co_read(file, offset, size, buffer, DEFAULT_DISK_ACCOUNT);
+        crc_computer.process_bytes(buffer, count * sizeof(index_snapshot_entry_t));
+        for (size_t i = 0; i < count; ++i) {
+            const index_block_info_t &info = entries[i].info;
+            set_block_info(entries[i].block_id, info.recency, info.offset,
+                           info.ser_block_size, info.compressed_size);
+        }
+        offset += size;
+        remaining -= count;
+    }
+    free(buffer);
+
+    if (crc_computer.checksum() != header.entries_crc) {
+        return false;
+    }
+    *metablock_version_out = header.metablock_version;
+    return true;
 }
 
+void in_memory_index_t::invalidate_snapshot(file_t *file) {
+    if (file->get_file_size() < DEVICE_BLOCK_SIZE) {
+        return;
+    }
+    char *buffer = reinterpret_cast<char *>(
+        malloc_aligned(DEVICE_BLOCK_SIZE, DEVICE_BLOCK_SIZE));
+    bzero(buffer, DEVICE_BLOCK_SIZE);
+    co_write(file, 0, DEVICE_BLOCK_SIZE, buffer, DEFAULT_DISK_ACCOUNT,
+             file_t::WRAP_IN_DATASYNCS);
+    free(buffer);
+}
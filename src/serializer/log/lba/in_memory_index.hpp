@@ -2,7 +2,10 @@
 #ifndef SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 #define SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 
-#include "containers/two_level_array.hpp"
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "config/args.hpp"
 #include "serializer/serializer.hpp"
 #include "serializer/log/lba/disk_format.hpp"
@@ -11,32 +14,117 @@ struct index_block_info_t {
     index_block_info_t()
         : offset(flagged_off64_t::unused()),
           recency(repli_timestamp_t::invalid),
-          ser_block_size(0) { }
+          ser_block_size(0),
+          compressed_size(0) { }
 
     index_block_info_t(flagged_off64_t _offset,
                        repli_timestamp_t _recency,
-                       uint32_t _ser_block_size)
+                       uint32_t _ser_block_size,
+                       uint32_t _compressed_size)
         : offset(_offset),
           recency(_recency),
-          ser_block_size(_ser_block_size) { }
+          ser_block_size(_ser_block_size),
+          compressed_size(_compressed_size) { }
+
+    // The number of bytes the block takes up on disk.
+    uint32_t disk_block_size() const {
+        return compressed_size != 0 ? compressed_size : ser_block_size;
+    }
 
-    // For two_level_array_t.
     bool operator==(const index_block_info_t &other) const {
         return offset == other.offset &&
             recency == other.recency &&
-            ser_block_size == other.ser_block_size;
+            ser_block_size == other.ser_block_size &&
+            compressed_size == other.compressed_size;
     }
 
     flagged_off64_t offset;
     repli_timestamp_t recency;
     uint32_t ser_block_size;
+    // See lba_entry_t::compressed_size.
+    uint32_t compressed_size;
 } __attribute__((__packed__));
 
 
 
+/* The in-memory index keeps 12 bytes per block instead of a whole
+index_block_info_t:
+
+ - the offset is stored in units of DEVICE_BLOCK_SIZE, in 40 bits,
+ - the recency is stored as a 32-bit delta from a base recency that each chunk of
+   the index picks when it's allocated,
+ - the block size and compressed size are replaced by a 24-bit "size class", an
+   index into a table of the (ser_block_size, compressed_size) pairs that have been
+   seen so far.  There are very few distinct pairs in practice.
+
+Entries that can't be encoded this way (a recency too far from the chunk's base,
+an unaligned offset, or too many distinct sizes) are kept uncompressed in a hash
+table on the side.  When a recency is too far above a chunk's base, the chunk gets a
+new base and is re-encoded, so that recencies that keep growing don't push every
+entry into that table. */
+struct compact_block_info_t {
+    // The low OFFSET_BITS bits hold the offset in device blocks plus one (zero
+    // means "unused"), the remaining bits hold the size class.
+    uint64_t offset_and_size_class;
+    // Zero means repli_timestamp_t::invalid, RECENCY_OVERFLOW means that the
+    // whole entry lives in the overflow table.  Otherwise the recency is the
+    // chunk's base plus this minus one.
+    uint32_t recency;
+
+    static const int OFFSET_BITS = 40;
+    static const uint32_t RECENCY_OVERFLOW = UINT32_MAX;
+} __attribute__((__packed__));
+
 class in_memory_index_t {
-    two_level_array_t<index_block_info_t> infos_;
-    block_id_t end_block_id_;
+    static const size_t CHUNK_SIZE = 1 << 14;
+
+    struct chunk_t {
+        chunk_t();
+        // NO_RECENCY_BASE until the first valid recency is stored in the chunk.
+        uint64_t recency_base;
+        // How many entries aren't equal to index_block_info_t().
+        size_t count;
+        compact_block_info_t infos[CHUNK_SIZE];
+    };
+
+    // Block ids are spread over LBA_SHARD_FACTOR shards the same way the LBA
+    // spreads them over its disk structures, so that the shards can be replayed
+    // on different threads at startup without sharing any state.  Block `id`
+    // lives in `shards_[id % LBA_SHARD_FACTOR]` at index `id / LBA_SHARD_FACTOR`.
+    struct shard_t {
+        shard_t() : end_block_id(0) { }
+        ~shard_t();
+
+        std::vector<chunk_t *> chunks;
+        block_id_t end_block_id;
+
+        // Size class i stands for size_classes[i]; size class 0 is (0, 0).
+        std::vector<std::pair<uint32_t, uint32_t> > size_classes;
+        std::unordered_map<uint64_t, uint32_t> size_class_ids;
+
+        // Entries whose recency field is RECENCY_OVERFLOW, by shard index.
+        std::unordered_map<size_t, index_block_info_t> overflow;
+
+        index_block_info_t get(size_t index) const;
+        void set(size_t index, const index_block_info_t &info);
+
+        // Returns false if `info` can't be encoded relative to `chunk`.  May pick
+        // the chunk's recency base, and may add a size class.
+        bool encode(chunk_t *chunk, const index_block_info_t &info,
+                    compact_block_info_t *out);
+        index_block_info_t decode(const chunk_t *chunk,
+                                  const compact_block_info_t &compact) const;
+
+        // Moves the recency base of `chunk`, which holds the entries from
+        // `first_index` on, up so that `recency` can be encoded, and re-encodes the
+        // chunk's entries.  Entries that are now too old go to `overflow`; those in
+        // `overflow` that fit again come back.
+        void rebase(chunk_t *chunk, size_t first_index, uint64_t recency);
+
+        DISABLE_COPYING(shard_t);
+    };
+
+    shard_t shards_[LBA_SHARD_FACTOR];
 
 public:
     in_memory_index_t();
@@ -45,9 +133,33 @@ public:
     block_id_t end_block_id();
 
     index_block_info_t get_block_info(block_id_t id);
+
+    // Calls for block ids in different LBA shards may run concurrently on
+    // different threads.
     void set_block_info(block_id_t id, repli_timestamp_t recency,
-                        flagged_off64_t offset, uint32_t ser_block_size);
+                        flagged_off64_t offset, uint32_t ser_block_size,
+                        uint32_t compressed_size);
+
+    void swap(in_memory_index_t *other);
+
+    // An estimate of how much memory the index uses.
+    size_t memory_usage() const;
+
+    // Writes a snapshot of the index to `file`, tagged with the version of the
+    // metablock the index is up to date with.  Must be called in a coroutine.
+    void write_snapshot(file_t *file, int64_t metablock_version);
+
+    // Loads the snapshot in `file` into this index, which must be empty, and
+    // returns the metablock version it was tagged with.  Returns false if `file`
+    // holds no valid snapshot, in which case the index is left in an unspecified
+    // state.  Must be called in a coroutine.
+    bool read_snapshot(file_t *file, int64_t *metablock_version_out);
+
+    // Overwrites the snapshot in `file` so it doesn't get loaded again.
+    static void invalidate_snapshot(file_t *file);
 
+private:
+    DISABLE_COPYING(in_memory_index_t);
 };
 
 #endif  // SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
@@ -10,6 +10,7 @@
 #include "perfmon/perfmon.hpp"
 #include "serializer/log/stats.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
 
 // TODO: Some of the code in this file is bullshit disgusting shit.
 
@@ -62,8 +63,9 @@ public:
     lba_list_t *owner;
     lba_list_t::ready_callback_t *callback;
 
-    lba_start_fsm_t(lba_list_t *l, lba_list_t::metablock_mixin_t *last_metablock)
-        : owner(l), callback(NULL)
+    lba_start_fsm_t(lba_list_t *l, lba_list_t::metablock_mixin_t *last_metablock,
+                    in_memory_index_t *_index_snapshot)
+        : owner(l), callback(NULL), index_snapshot(_index_snapshot)
     {
         rassert(owner->state == lba_list_t::state_unstarted);
         owner->state = lba_list_t::state_starting_up;
@@ -88,9 +90,24 @@ public:
         rassert(cbs_out > 0);
         cbs_out--;
         if (cbs_out == 0) {
+            if (index_snapshot != NULL) {
+                // The snapshot already reflects both the LBA extents and the
+                // inlined entries.
+                owner->in_memory_index.swap(index_snapshot);
+                finish();
+                return;
+            }
+
+            // Each shard's entries only touch its own part of the in-memory
+            // index, so we replay the shards on different threads.  Reading
+            // stays on this thread.
             cbs_out = LBA_SHARD_FACTOR;
+            const int num_threads = get_num_threads();
+            const int our_thread = get_thread_id().threadnum;
             for (int i = 0; i < LBA_SHARD_FACTOR; i++) {
-                owner->disk_structures[i]->read(&owner->in_memory_index, this);
+                const threadnum_t replay_thread((our_thread + 1 + i) % num_threads);
+                owner->disk_structures[i]->read(&owner->in_memory_index, replay_thread,
+                                                this);
             }
         }
     }
@@ -108,24 +125,32 @@ public:
                         e->block_id,
                         e->recency,
                         e->offset,
-                        e->ser_block_size);
+                        e->ser_block_size,
+                        e->compressed_size);
             }
-            
-            owner->state = lba_list_t::state_ready;
-            if (callback) callback->on_lba_ready();
-            delete this;
+
+            finish();
         }
     }
+
+    void finish() {
+        owner->state = lba_list_t::state_ready;
+        if (callback) callback->on_lba_ready();
+        delete this;
+    }
+
+private:
+    in_memory_index_t *index_snapshot;
 };
 
 bool lba_list_t::start_existing(file_t *file, metablock_mixin_t *last_metablock,
-        ready_callback_t *cb) {
+        in_memory_index_t *index_snapshot, ready_callback_t *cb) {
     rassert(state == state_unstarted);
 
     dbfile = file;
     gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY));
 
-    lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock);
+    lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock, index_snapshot);
     if (state == state_ready) {
         return true;
     } else {
@@ -134,6 +159,11 @@ bool lba_list_t::start_existing(file_t *file, metablock_mixin_t *last_metablock,
     }
 }
 
+void lba_list_t::write_index_snapshot(file_t *file, int64_t metablock_version) {
+    rassert(state == state_ready || state == state_gc_shutting_down);
+    in_memory_index.write_snapshot(file, metablock_version);
+}
+
 block_id_t lba_list_t::end_block_id() {
     rassert(state == state_ready || state == state_gc_shutting_down);
 
@@ -183,10 +213,12 @@ segmented_vector_t<repli_timestamp_t> lba_list_t::get_block_recencies(block_id_t
 
 void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
                                 flagged_off64_t offset, uint32_t ser_block_size,
+                                uint32_t compressed_size,
                                 file_account_t *io_account, extent_transaction_t *txn) {
     rassert(state == state_ready || state == state_gc_shutting_down);
 
-    in_memory_index.set_block_info(block, recency, offset, ser_block_size);
+    in_memory_index.set_block_info(block, recency, offset, ser_block_size,
+                                   compressed_size);
 
     // If the inline LBA is full, free it up first by moving its entries to
     // the LBA extents
@@ -195,7 +227,7 @@ void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
         rassert(!check_inline_lba_full());
     }
     // Then store the entry inline
-    add_inline_entry(block, recency, offset, ser_block_size);
+    add_inline_entry(block, recency, offset, ser_block_size, compressed_size);
 }
 
 bool lba_list_t::check_inline_lba_full() const {
@@ -233,6 +265,7 @@ void lba_list_t::move_inline_entries_to_extents(file_account_t *io_account, exte
                 e.recency,
                 e.offset,
                 e.ser_block_size,
+                e.compressed_size,
                 io_account,
                 txn);
     }
@@ -241,11 +274,12 @@ void lba_list_t::move_inline_entries_to_extents(file_account_t *io_account, exte
 }
 
 void lba_list_t::add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                                flagged_off64_t offset, uint32_t ser_block_size) {
+                                flagged_off64_t offset, uint32_t ser_block_size,
+                                uint32_t compressed_size) {
     
     rassert(!check_inline_lba_full());
     inline_lba_entries[inline_lba_entries_count++] =
-            lba_entry_t::make(block, recency, offset, ser_block_size);
+            lba_entry_t::make(block, recency, offset, ser_block_size, compressed_size);
 }
 
 class lba_syncer_t :
@@ -321,10 +355,11 @@ void lba_list_t::gc(int lba_shard, auto_drainer_t::lock_t) {
     for (block_id_t id = lba_shard; id < end_id; id += LBA_SHARD_FACTOR) {
         flagged_off64_t off = get_block_offset(id);
         if (off.has_value()) {
-            uint32_t ser_block_size = get_ser_block_size(id);
+            const index_block_info_t info = get_block_info(id);
             disk_structures[lba_shard]->add_entry(id,
-                                                  get_block_recency(id),
-                                                  off, ser_block_size,
+                                                  info.recency,
+                                                  off, info.ser_block_size,
+                                                  info.compressed_size,
                                                   gc_io_account.get(), &txns.back());
         }
 
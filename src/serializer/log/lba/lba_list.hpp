@@ -37,8 +37,15 @@ public:
         virtual void on_lba_ready() = 0;
         virtual ~ready_callback_t() {}
     };
+    // If `index_snapshot` isn't NULL, it must be a snapshot of the index that is
+    // up to date with `last_metablock`.  Its contents are taken over instead of
+    // replaying the LBA from disk.
     bool start_existing(file_t *dbfile, metablock_mixin_t *last_metablock,
-                        ready_callback_t *cb);
+                        in_memory_index_t *index_snapshot, ready_callback_t *cb);
+
+    // Writes a snapshot of the in-memory index to `file`.  See
+    // in_memory_index_t::write_snapshot().
+    void write_index_snapshot(file_t *file, int64_t metablock_version);
 
     index_block_info_t get_block_info(block_id_t block);
 
@@ -62,6 +69,7 @@ public:
 
     void set_block_info(block_id_t block, repli_timestamp_t recency,
                         flagged_off64_t offset, uint32_t ser_block_size,
+                        uint32_t compressed_size,
                         file_account_t *io_account,
                         extent_transaction_t *txn);
 
@@ -114,7 +122,8 @@ private:
     bool check_inline_lba_full() const;
     void move_inline_entries_to_extents(file_account_t *io_account, extent_transaction_t *txn);
     void add_inline_entry(block_id_t block, repli_timestamp_t recency,
-                                flagged_off64_t offset, uint32_t ser_block_size);
+                                flagged_off64_t offset, uint32_t ser_block_size,
+                                uint32_t compressed_size);
 
     lba_disk_structure_t *disk_structures[LBA_SHARD_FACTOR];
 
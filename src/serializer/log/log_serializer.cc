@@ -16,6 +16,7 @@
 #include "logger.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/log/data_block_manager.hpp"
+#include "time.hpp"
 
 filepath_file_opener_t::filepath_file_opener_t(const serializer_filepath_t &filepath,
                                                io_backender_t *backender)
@@ -39,7 +40,8 @@ std::string filepath_file_opener_t::current_file_name() const {
 
 void filepath_file_opener_t::open_serializer_file(const std::string &path, int extra_flags, scoped_ptr_t<file_t> *file_out) {
     const file_open_result_t res = open_file(path.c_str(),
-                                             linux_file_t::mode_read | linux_file_t::mode_write | extra_flags,
+                                             linux_file_t::mode_read | linux_file_t::mode_write
+                                             | linux_file_t::mode_random_access | extra_flags,
                                              backender_,
                                              file_out);
     if (res.outcome == file_open_result_t::ERROR) {
@@ -96,6 +98,32 @@ void filepath_file_opener_t::unlink_serializer_file() {
     guarantee_err(res == 0, "unlink() failed");
 }
 
+bool filepath_file_opener_t::open_index_snapshot_file(bool create,
+                                                      scoped_ptr_t<file_t> *file_out) {
+    mutex_assertion_t::acq_t acq(&reentrance_mutex_);
+    // Files that are still being created (or that will be unlinked right away, like
+    // those of disk-backed queues) don't get a snapshot.
+    if (opened_temporary_) {
+        return false;
+    }
+    const std::string path = filepath_.index_snapshot_path();
+    const file_open_result_t res
+        = open_file(path.c_str(),
+                    linux_file_t::mode_read | linux_file_t::mode_write
+                    | (create ? linux_file_t::mode_create : 0),
+                    backender_,
+                    file_out);
+    if (res.outcome == file_open_result_t::ERROR) {
+        if (res.errsv != ENOENT) {
+            logWRN("Could not open index snapshot file \"%s\" (%s).  The table will "
+                   "take longer to start up.", path.c_str(),
+                   errno_string(res.errsv).c_str());
+        }
+        return false;
+    }
+    return true;
+}
+
 #ifdef SEMANTIC_SERIALIZER_CHECK
 void filepath_file_opener_t::open_semantic_checking_file(scoped_ptr_t<semantic_checking_file_t> *file_out) {
     const std::string semantic_filepath = filepath_.permanent_path() + "_semantic";
@@ -130,7 +158,17 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_data_extents_gced(),
       pm_serializer_old_garbage_block_bytes(),
       pm_serializer_old_total_block_bytes(),
+      pm_serializer_compressed_block_writes(),
+      pm_serializer_compressed_bytes_saved(),
+      pm_serializer_data_bytes_written(),
+      pm_serializer_gc_bytes_written(),
+      pm_serializer_write_amplification_percent(),
+      pm_serializer_gc_rate_bytes_per_sec(),
+      pm_serializer_gc_debt_bytes(),
+      pm_serializer_io_buffer_pool_bytes(),
       pm_serializer_lba_gcs(),
+      pm_serializer_startup_time_ms(),
+      pm_serializer_index_snapshot_loads(),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
           &pm_serializer_block_reads, "serializer_block_reads",
@@ -146,7 +184,18 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_data_extents_gced, "serializer_data_extents_gced",
           &pm_serializer_old_garbage_block_bytes, "serializer_old_garbage_block_bytes",
           &pm_serializer_old_total_block_bytes, "serializer_old_total_block_bytes",
-          &pm_serializer_lba_gcs, "serializer_lba_gcs")
+          &pm_serializer_compressed_block_writes, "serializer_compressed_block_writes",
+          &pm_serializer_compressed_bytes_saved, "serializer_compressed_bytes_saved",
+          &pm_serializer_data_bytes_written, "serializer_data_bytes_written",
+          &pm_serializer_gc_bytes_written, "serializer_gc_bytes_written",
+          &pm_serializer_write_amplification_percent,
+          "serializer_write_amplification_percent",
+          &pm_serializer_gc_rate_bytes_per_sec, "serializer_gc_rate_bytes_per_sec",
+          &pm_serializer_gc_debt_bytes, "serializer_gc_debt_bytes",
+          &pm_serializer_io_buffer_pool_bytes, "serializer_io_buffer_pool_bytes",
+          &pm_serializer_lba_gcs, "serializer_lba_gcs",
+          &pm_serializer_startup_time_ms, "serializer_startup_time_ms",
+          &pm_serializer_index_snapshot_loads, "serializer_index_snapshot_loads")
 { }
 
 void log_serializer_t::create(serializer_file_opener_t *file_opener, static_config_t static_config) {
@@ -259,8 +308,18 @@ struct ls_start_existing_fsm_t :
             // STATE G
             guarantee(metablock_found, "Could not find any valid metablock.");
 
+            // A snapshot saved at the last clean shutdown is only usable if no
+            // metablock got written since then.
+            in_memory_index_t *usable_snapshot = NULL;
+            if (index_snapshot.has()
+                && index_snapshot_version == ser->metablock_manager->latest_version()) {
+                usable_snapshot = index_snapshot.get();
+                ++ser->stats->pm_serializer_index_snapshot_loads;
+            }
+
             // STATE H
-            if (ser->lba_index->start_existing(ser->dbfile, &metablock_buffer.lba_index_part, this)) {
+            if (ser->lba_index->start_existing(ser->dbfile, &metablock_buffer.lba_index_part,
+                                               usable_snapshot, this)) {
                 start_existing_state = state_reconstruct;
                 // STATE J
             } else {
@@ -283,8 +342,11 @@ struct ls_start_existing_fsm_t :
             for (; num_blocks_reconstructed < ser->lba_index->end_block_id(); num_blocks_reconstructed++) {
                 flagged_off64_t offset = ser->lba_index->get_block_offset(num_blocks_reconstructed);
                 if (offset.has_value()) {
+                    const index_block_info_t info
+                        = ser->lba_index->get_block_info(num_blocks_reconstructed);
                     ser->data_block_manager->mark_live(offset.get_value(),
-                        ser->lba_index->get_block_size(num_blocks_reconstructed));
+                        block_size_t::unsafe_make(info.ser_block_size),
+                        info.compressed_size);
                 }
                 ++batch;
                 if (batch >= LBA_RECONSTRUCTION_BATCH_SIZE) {
@@ -366,6 +428,11 @@ struct ls_start_existing_fsm_t :
     bool metablock_found;
     log_serializer_t::metablock_t metablock_buffer;
 
+    // The index snapshot found at startup, if any, and the metablock version it
+    // was saved with.
+    scoped_ptr_t<in_memory_index_t> index_snapshot;
+    int64_t index_snapshot_version;
+
 private:
     DISABLE_COPYING(ls_start_existing_fsm_t);
 };
@@ -386,11 +453,39 @@ log_serializer_t::log_serializer_t(dynamic_config_t _dynamic_config, serializer_
       lba_index(NULL),
       data_block_manager(NULL),
       active_write_count(0) {
+    const ticks_t start_ticks = get_ticks();
+
     // STATE A
     /* This is because the serializer is not completely converted to coroutines yet. */
     ls_start_existing_fsm_t *s = new ls_start_existing_fsm_t(this);
+    load_index_snapshot(file_opener, &s->index_snapshot, &s->index_snapshot_version);
     cond_t cond;
     if (!s->run(&cond, file_opener)) cond.wait();
+
+    stats->pm_serializer_startup_time_ms
+        += static_cast<int64_t>(ticks_to_secs(get_ticks() - start_ticks) * 1000);
+}
+
+void log_serializer_t::load_index_snapshot(serializer_file_opener_t *file_opener,
+                                           scoped_ptr_t<in_memory_index_t> *index_out,
+                                           int64_t *metablock_version_out) {
+    scoped_ptr_t<file_t> file;
+    if (!file_opener->open_index_snapshot_file(dynamic_config.index_snapshots, &file)) {
+        return;
+    }
+
+    scoped_ptr_t<in_memory_index_t> index(new in_memory_index_t);
+    if (index->read_snapshot(file.get(), metablock_version_out)) {
+        *index_out = std::move(index);
+    }
+
+    // A snapshot only describes the state of the file at the time it was saved,
+    // so make sure it doesn't get loaded again after we've written more stuff.
+    in_memory_index_t::invalidate_snapshot(file.get());
+
+    if (dynamic_config.index_snapshots) {
+        index_snapshot_file = std::move(file);
+    }
 }
 
 log_serializer_t::~log_serializer_t() {
@@ -419,7 +514,7 @@ void log_serializer_t::block_read(const counted_t<ls_block_token_pointee_t> &tok
     stats->pm_serializer_block_reads.begin(&pm_time);
 
     data_block_manager->read(token->offset_, token->block_size().ser_value(),
-                             buf, io_account);
+                             token->compressed_size(), buf, io_account);
 
     stats->pm_serializer_block_reads.end(&pm_time);
 }
@@ -463,8 +558,10 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
              write_op_it != write_ops.end();
              ++write_op_it) {
             const index_write_op_t &op = *write_op_it;
-            flagged_off64_t offset = lba_index->get_block_offset(op.block_id);
-            uint32_t ser_block_size = lba_index->get_ser_block_size(op.block_id);
+            const index_block_info_t old_info = lba_index->get_block_info(op.block_id);
+            flagged_off64_t offset = old_info.offset;
+            uint32_t ser_block_size = old_info.ser_block_size;
+            uint32_t compressed_size = old_info.compressed_size;
 
             if (op.token) {
                 // Update the offset pointed to, and mark garbage/liveness as necessary.
@@ -480,12 +577,15 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 if (token.has()) {
                     offset = flagged_off64_t::make(token->offset_);
                     ser_block_size = token->block_size().ser_value();
+                    compressed_size = token->compressed_size();
 
                     /* mark the life */
-                    data_block_manager->mark_live(offset.get_value(), token->block_size());
+                    data_block_manager->mark_live(offset.get_value(), token->block_size(),
+                                                  token->compressed_size());
                 } else {
                     offset = flagged_off64_t::unused();
                     ser_block_size = 0;
+                    compressed_size = 0;
                 }
             }
 
@@ -493,7 +593,7 @@ void log_serializer_t::index_write(new_mutex_in_line_t *mutex_acq,
                 : lba_index->get_block_recency(op.block_id);
 
             lba_index->set_block_info(op.block_id, recency,
-                                      offset, ser_block_size,
+                                      offset, ser_block_size, compressed_size,
                                       io_account, &txn);
         }
     }
@@ -601,9 +701,11 @@ void log_serializer_t::write_metablock_sans_pipelining(const signal_t *safe_to_w
 }
 
 counted_t<ls_block_token_pointee_t>
-log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size) {
+log_serializer_t::generate_block_token(int64_t offset, block_size_t block_size,
+                                       uint32_t compressed_size) {
     assert_thread();
-    counted_t<ls_block_token_pointee_t> ret(new ls_block_token_pointee_t(this, offset, block_size));
+    counted_t<ls_block_token_pointee_t> ret(new ls_block_token_pointee_t(this, offset, block_size,
+                                                                         compressed_size));
     return ret;
 }
 
@@ -736,7 +838,9 @@ counted_t<ls_block_token_pointee_t> log_serializer_t::index_read(block_id_t bloc
 
     index_block_info_t info = lba_index->get_block_info(block_id);
     if (info.offset.has_value()) {
-        return generate_block_token(info.offset.get_value(), block_size_t::unsafe_make(info.ser_block_size));
+        return generate_block_token(info.offset.get_value(),
+                                    block_size_t::unsafe_make(info.ser_block_size),
+                                    info.compressed_size);
     } else {
         return counted_t<ls_block_token_pointee_t>();
     }
@@ -815,6 +919,16 @@ bool log_serializer_t::next_shutdown_step() {
     rassert(expecting_no_more_tokens);
 
     if (shutdown_state == shutdown_waiting_on_block_tokens) {
+        shutdown_state = shutdown_waiting_on_index_snapshot;
+        if (index_snapshot_file.has()) {
+            coro_t::spawn_sometime(std::bind(
+                &log_serializer_t::write_index_snapshot_and_continue_shutdown, this));
+            shutdown_in_one_shot = false;
+            return false;
+        }
+    }
+
+    if (shutdown_state == shutdown_waiting_on_index_snapshot) {
         lba_index->shutdown();
         metablock_manager->shutdown();
         extent_manager->shutdown();
@@ -858,6 +972,15 @@ bool log_serializer_t::next_shutdown_step() {
     return true; // make compiler happy
 }
 
+void log_serializer_t::write_index_snapshot_and_continue_shutdown() {
+    // No more writes can happen, so the index is up to date with the latest
+    // metablock.
+    lba_index->write_index_snapshot(index_snapshot_file.get(),
+                                    metablock_manager->latest_version());
+    index_snapshot_file.reset();
+    next_shutdown_step();
+}
+
 void log_serializer_t::delete_dbfile_and_continue_shutdown() {
     rassert(dbfile != NULL);
     delete dbfile;
@@ -932,9 +1055,11 @@ bool log_serializer_t::should_perform_read_ahead() {
 
 ls_block_token_pointee_t::ls_block_token_pointee_t(log_serializer_t *serializer,
                                                    int64_t initial_offset,
-                                                   block_size_t initial_block_size)
+                                                   block_size_t initial_block_size,
+                                                   uint32_t compressed_size)
     : serializer_(serializer), ref_count_(0),
-      block_size_(initial_block_size), offset_(initial_offset) {
+      block_size_(initial_block_size), compressed_size_(compressed_size),
+      offset_(initial_offset) {
     serializer_->assert_thread();
     serializer_->register_block_token(this, initial_offset);
 }
@@ -949,8 +1074,9 @@ void ls_block_token_pointee_t::do_destroy() {
 void debug_print(printf_buffer_t *buf,
                  const counted_t<ls_block_token_pointee_t> &token) {
     if (token.has()) {
-        buf->appendf("ls_block_token{%" PRIi64 ", +%" PRIu32 "}",
-                     token->offset(), token->block_size().ser_value());
+        buf->appendf("ls_block_token{%" PRIi64 ", +%" PRIu32 ", z%" PRIu32 "}",
+                     token->offset(), token->block_size().ser_value(),
+                     token->compressed_size());
     } else {
         buf->appendf("nil");
     }
@@ -68,6 +68,7 @@ public:
     void move_serializer_file_to_permanent_location();
     void open_serializer_file_existing(scoped_ptr_t<file_t> *file_out);
     void unlink_serializer_file();
+    bool open_index_snapshot_file(bool create, scoped_ptr_t<file_t> *file_out);
 #ifdef SEMANTIC_SERIALIZER_CHECK
     void open_semantic_checking_file(scoped_ptr_t<semantic_checking_file_t> *file_out);
 #endif
@@ -166,7 +167,8 @@ private:
     void unregister_block_token(ls_block_token_pointee_t *token);
     void remap_block_to_new_offset(int64_t current_offset, int64_t new_offset);
     counted_t<ls_block_token_pointee_t> generate_block_token(int64_t offset,
-                                                             block_size_t block_size);
+                                                             block_size_t block_size,
+                                                             uint32_t compressed_size);
 
     void offer_buf_to_read_ahead_callbacks(
             block_id_t block_id,
@@ -186,6 +188,14 @@ private:
     bool shutdown(cond_t *cb);
     bool next_shutdown_step();
 
+    /* Loads the index snapshot saved at the last clean shutdown, if there is a
+    valid one, and makes sure it won't be loaded again.  Keeps the snapshot file
+    open in `index_snapshot_file` if we're going to save a new snapshot. */
+    void load_index_snapshot(serializer_file_opener_t *file_opener,
+                             scoped_ptr_t<in_memory_index_t> *index_out,
+                             int64_t *metablock_version_out);
+
+    void write_index_snapshot_and_continue_shutdown();
     void delete_dbfile_and_continue_shutdown();
 
     virtual void on_datablock_manager_shutdown();
@@ -235,6 +245,7 @@ private:
         shutdown_waiting_on_serializer,
         shutdown_waiting_on_datablock_manager,
         shutdown_waiting_on_block_tokens,
+        shutdown_waiting_on_index_snapshot,
         shutdown_waiting_on_dbfile_destruction,
     } shutdown_state;
     bool shutdown_in_one_shot;
@@ -249,6 +260,10 @@ private:
 
     file_t *dbfile;
 
+    // Where we save a snapshot of the LBA's in-memory index at shutdown, if
+    // `dynamic_config.index_snapshots` is set.
+    scoped_ptr_t<file_t> index_snapshot_file;
+
     extent_manager_t *extent_manager;
     mb_manager_t *metablock_manager;
     lba_list_t *lba_index;
@@ -102,6 +102,10 @@ public:
 
     void read_next_metablock();
 
+    // The version of the most recent metablock that was found at startup or
+    // written since.
+    metablock_version_t latest_version() const { return next_version_number - 1; }
+
 private:
     struct head_t {
     private:
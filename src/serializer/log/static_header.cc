@@ -62,7 +62,19 @@ void co_static_header_read(file_t *file, static_header_read_callback_t *callback
         fail_due_to_user_error("This doesn't appear to be a RethinkDB data file.");
     }
 
-    if (memcmp(buffer->version, SERIALIZER_VERSION_STRING, sizeof(SERIALIZER_VERSION_STRING)) != 0) {
+    // Version 1.12 files differ only in that their LBA entries have a zero where
+    // 1.13 keeps the compressed size, which reads as "not compressed".
+    if (memcmp(buffer->version, SERIALIZER_UNCOMPRESSED_VERSION_STRING,
+               sizeof(SERIALIZER_UNCOMPRESSED_VERSION_STRING)) == 0) {
+        // We tag the file as 1.13 before we write anything to it.  A 1.12 server
+        // would return compressed blocks as if they were data, so it has to refuse
+        // the file from now on.
+        memcpy(buffer->version, SERIALIZER_VERSION_STRING,
+               sizeof(SERIALIZER_VERSION_STRING));
+        co_write(file, 0, DEVICE_BLOCK_SIZE, buffer, DEFAULT_DISK_ACCOUNT,
+                 file_t::WRAP_IN_DATASYNCS);
+    } else if (memcmp(buffer->version, SERIALIZER_VERSION_STRING,
+                      sizeof(SERIALIZER_VERSION_STRING)) != 0) {
         fail_due_to_user_error("File version is incorrect. This file was created with "
                                "RethinkDB's serializer version %s, but you are trying "
                                "to read it with version %s.  See "
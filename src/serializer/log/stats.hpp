@@ -27,10 +27,30 @@ struct log_serializer_stats_t {
     perfmon_counter_t pm_serializer_data_extents_gced;
     perfmon_counter_t pm_serializer_old_garbage_block_bytes;
     perfmon_counter_t pm_serializer_old_total_block_bytes;
+    perfmon_counter_t pm_serializer_compressed_block_writes;
+    perfmon_counter_t pm_serializer_compressed_bytes_saved;
+    // Bytes written to data extents for the cache and for the GC, and how many
+    // bytes get written per 100 bytes the cache asked for.
+    perfmon_counter_t pm_serializer_data_bytes_written;
+    perfmon_counter_t pm_serializer_gc_bytes_written;
+    perfmon_counter_t pm_serializer_write_amplification_percent;
+    // How fast the GC may currently move data (unless it's far behind, when it
+    // isn't throttled), and how many bytes of garbage it has to collect to get
+    // back down to the low garbage ratio.
+    perfmon_counter_t pm_serializer_gc_rate_bytes_per_sec;
+    perfmon_counter_t pm_serializer_gc_debt_bytes;
+    // Memory held by released I/O buffers that are kept around for reuse.
+    perfmon_counter_t pm_serializer_io_buffer_pool_bytes;
 
     /* used in serializer/log/lba/lba_list.cc */
     perfmon_counter_t pm_serializer_lba_gcs;
 
+    /* used in serializer/log/log_serializer.cc */
+    // How long the last startup took, and whether it could use an index snapshot
+    // instead of replaying the LBA.
+    perfmon_counter_t pm_serializer_startup_time_ms;
+    perfmon_counter_t pm_serializer_index_snapshot_loads;
+
     perfmon_membership_t parent_collection_membership;
     perfmon_multi_membership_t stats_membership;
 };
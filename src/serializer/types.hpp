@@ -95,6 +95,17 @@ public:
     int64_t offset() const { return offset_; }
     block_size_t block_size() const { return block_size_; }
 
+    // Nonzero if the block is stored compressed, in which case it takes up this
+    // many bytes on disk instead of block_size().ser_value().
+    uint32_t compressed_size() const { return compressed_size_; }
+
+    // The space the block takes up on disk.
+    block_size_t disk_block_size() const {
+        return compressed_size_ != 0
+            ? block_size_t::unsafe_make(compressed_size_)
+            : block_size_;
+    }
+
 private:
     friend class log_serializer_t;
     friend class dbm_read_ahead_fsm_t;  // For read-ahead tokens.
@@ -103,7 +114,8 @@ private:
 
     ls_block_token_pointee_t(log_serializer_t *serializer,
                              int64_t initial_offset,
-                             block_size_t initial_ser_block_size);
+                             block_size_t initial_ser_block_size,
+                             uint32_t compressed_size);
 
     log_serializer_t *serializer_;
     intptr_t ref_count_;
@@ -111,6 +123,9 @@ private:
     // The block's size.
     block_size_t block_size_;
 
+    // The block's compressed size on disk, or 0 if it isn't compressed.
+    uint32_t compressed_size_;
+
     // The block's offset on disk.
     int64_t offset_;
 
@@ -145,6 +160,11 @@ public:
     virtual void move_serializer_file_to_permanent_location() = 0;
     virtual void open_serializer_file_existing(scoped_ptr_t<file_t> *file_out) = 0;
     virtual void unlink_serializer_file() = 0;
+
+    // Opens the file the serializer keeps a snapshot of its block index in across
+    // a clean shutdown, creating it if `create` is true.  Returns false if there is
+    // no such file or it can't be opened; the snapshot is only an optimization.
+    virtual bool open_index_snapshot_file(bool create, scoped_ptr_t<file_t> *file_out) = 0;
 #ifdef SEMANTIC_SERIALIZER_CHECK
     virtual void open_semantic_checking_file(scoped_ptr_t<semantic_checking_file_t> *file_out) = 0;
 #endif
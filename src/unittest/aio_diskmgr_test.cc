@@ -0,0 +1,91 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include "arch/arch.hpp"
+#include "arch/io/disk.hpp"
+#include "arch/io/disk/aio.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+struct aio_test_countdown_t : public linux_iocallback_t {
+    explicit aio_test_countdown_t(int n) : remaining(n) { }
+    void on_io_complete() {
+        if (--remaining == 0) {
+            done.pulse();
+        }
+    }
+    int remaining;
+    cond_t done;
+};
+
+void run_aio_round_trip_test(file_direct_io_mode_t direct_io_mode) {
+    if (!aio_diskmgr_t::is_supported()) {
+        // Nothing to test; the server falls back to the pool backend here.
+        return;
+    }
+
+    // More blocks than fit into the kernel's queue at once.
+    const int num_blocks = 2 * DEFAULT_MAX_CONCURRENT_IO_REQUESTS + 3;
+    const size_t length = num_blocks * DEVICE_BLOCK_SIZE;
+
+    temp_file_t temp_file;
+    io_backender_t io_backender(direct_io_mode, DEFAULT_MAX_CONCURRENT_IO_REQUESTS,
+                                io_backend_t::native_aio);
+    scoped_ptr_t<file_t> file;
+    const file_open_result_t res
+        = open_file(temp_file.name().permanent_path().c_str(),
+                    linux_file_t::mode_read | linux_file_t::mode_write
+                    | linux_file_t::mode_create,
+                    &io_backender, &file);
+    ASSERT_NE(file_open_result_t::ERROR, res.outcome);
+    file->set_file_size_at_least(length);
+
+    char *written = static_cast<char *>(malloc_aligned(length, DEVICE_BLOCK_SIZE));
+    char *read = static_cast<char *>(malloc_aligned(length, DEVICE_BLOCK_SIZE));
+    for (int i = 0; i < num_blocks; ++i) {
+        memset(written + i * DEVICE_BLOCK_SIZE, 'a' + i % 26, DEVICE_BLOCK_SIZE);
+    }
+    memset(read, 0, length);
+
+    // All writes are in flight at once, so they get submitted in batches.  Every
+    // other one is wrapped in datasyncs, which AIO hands over to its thread pool;
+    // there are more of those than the queue depth allows at once.
+    {
+        aio_test_countdown_t writes(num_blocks);
+        for (int i = 0; i < num_blocks; ++i) {
+            file->write_async(i * DEVICE_BLOCK_SIZE, DEVICE_BLOCK_SIZE,
+                              written + i * DEVICE_BLOCK_SIZE, DEFAULT_DISK_ACCOUNT,
+                              &writes,
+                              i % 2 == 1
+                              ? file_t::WRAP_IN_DATASYNCS
+                              : file_t::NO_DATASYNCS);
+        }
+        writes.done.wait();
+    }
+
+    {
+        aio_test_countdown_t reads(num_blocks);
+        for (int i = num_blocks - 1; i >= 0; --i) {
+            file->read_async(i * DEVICE_BLOCK_SIZE, DEVICE_BLOCK_SIZE,
+                             read + i * DEVICE_BLOCK_SIZE, DEFAULT_DISK_ACCOUNT, &reads);
+        }
+        reads.done.wait();
+    }
+    EXPECT_EQ(0, memcmp(written, read, length));
+
+    free(written);
+    free(read);
+}
+
+TPTEST(AioDiskmgr, DirectRoundTrip) {
+    run_aio_round_trip_test(file_direct_io_mode_t::direct_desired);
+}
+
+TPTEST(AioDiskmgr, BufferedRoundTrip) {
+    run_aio_round_trip_test(file_direct_io_mode_t::buffered_desired);
+}
+
+}  // namespace unittest
@@ -0,0 +1,81 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include "config/args.hpp"
+#include "math.hpp"
+#include "serializer/log/aligned_buffer_pool.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(AlignedBufferPoolTest, Alignment) {
+    aligned_buffer_pool_t pool(MEGABYTE);
+    for (size_t size = 1; size < 100 * KILOBYTE; size = size * 3 + 1) {
+        aligned_buffer_t buf = pool.acquire(size);
+        ASSERT_TRUE(buf.has());
+        ASSERT_TRUE(divides(DEVICE_BLOCK_SIZE, reinterpret_cast<intptr_t>(buf.get())));
+        // The whole requested size must be writable.
+        memset(buf.get(), 0xab, size);
+    }
+}
+
+TPTEST(AlignedBufferPoolTest, Reuse) {
+    aligned_buffer_pool_t pool(MEGABYTE);
+    char *first;
+    {
+        aligned_buffer_t buf = pool.acquire(3 * KILOBYTE);
+        first = buf.get();
+        ASSERT_EQ(0u, pool.cached_bytes());
+    }
+    ASSERT_EQ(static_cast<size_t>(4 * KILOBYTE), pool.cached_bytes());
+
+    // A request that rounds up to the same capacity gets the same buffer back.
+    aligned_buffer_t buf = pool.acquire(4 * KILOBYTE);
+    ASSERT_EQ(first, buf.get());
+    ASSERT_EQ(0u, pool.cached_bytes());
+
+    buf.reset();
+    ASSERT_FALSE(buf.has());
+    ASSERT_EQ(static_cast<size_t>(4 * KILOBYTE), pool.cached_bytes());
+}
+
+TPTEST(AlignedBufferPoolTest, CachedBytesAreBounded) {
+    aligned_buffer_pool_t pool(8 * KILOBYTE);
+    {
+        aligned_buffer_t a = pool.acquire(4 * KILOBYTE);
+        aligned_buffer_t b = pool.acquire(4 * KILOBYTE);
+        aligned_buffer_t c = pool.acquire(4 * KILOBYTE);
+    }
+    ASSERT_EQ(static_cast<size_t>(8 * KILOBYTE), pool.cached_bytes());
+}
+
+TPTEST(AlignedBufferPoolTest, TrimFreesBigBuffersFirst) {
+    aligned_buffer_pool_t pool(MEGABYTE);
+    {
+        aligned_buffer_t small = pool.acquire(4 * KILOBYTE);
+        aligned_buffer_t big = pool.acquire(512 * KILOBYTE);
+    }
+    ASSERT_EQ(static_cast<size_t>(516 * KILOBYTE), pool.cached_bytes());
+
+    pool.trim(64 * KILOBYTE);
+    ASSERT_EQ(static_cast<size_t>(4 * KILOBYTE), pool.cached_bytes());
+
+    pool.trim(0);
+    ASSERT_EQ(0u, pool.cached_bytes());
+}
+
+TPTEST(AlignedBufferPoolTest, Move) {
+    aligned_buffer_pool_t pool(MEGABYTE);
+    aligned_buffer_t a = pool.acquire(KILOBYTE);
+    char *ptr = a.get();
+    aligned_buffer_t b(std::move(a));
+    ASSERT_FALSE(a.has());
+    ASSERT_EQ(ptr, b.get());
+    aligned_buffer_t c;
+    c = std::move(b);
+    ASSERT_FALSE(b.has());
+    ASSERT_EQ(ptr, c.get());
+}
+
+}  // namespace unittest
@@ -0,0 +1,318 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <set>
+#include <string>
+#include <vector>
+
+#include "btree/btree_store.hpp"
+#include "btree/bulk_load.hpp"
+#include "btree/depth_first_traversal.hpp"
+#include "btree/erase_range.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "btree/slice.hpp"
+#include "buffer_cache/alt/alt.hpp"
+#include "buffer_cache/alt/cache_balancer.hpp"
+#include "serializer/config.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_file.hpp"
+#include "unittest/unittest_utils.hpp"
+
+// A value of COUNT_TEST_VALUE_SIZE bytes.
+struct count_test_value_t;
+
+const int COUNT_TEST_VALUE_SIZE = 16;
+
+template <>
+class value_sizer_t<count_test_value_t> : public value_sizer_t<void> {
+public:
+    explicit value_sizer_t<count_test_value_t>(block_size_t bs) : block_size_(bs) { }
+
+    int size(const void *) const { return COUNT_TEST_VALUE_SIZE; }
+
+    bool fits(const void *, int length_available) const {
+        return length_available >= COUNT_TEST_VALUE_SIZE;
+    }
+
+    int max_possible_size() const { return COUNT_TEST_VALUE_SIZE; }
+
+    block_magic_t btree_leaf_magic() const {
+        block_magic_t magic = { { 'c', 't', 'L', 'F' } };
+        return magic;
+    }
+
+    block_size_t block_size() const { return block_size_; }
+
+private:
+    block_size_t block_size_;
+
+    DISABLE_COPYING(value_sizer_t<count_test_value_t>);
+};
+
+namespace unittest {
+
+store_key_t count_test_key(int i) {
+    return store_key_t(strprintf("%06d", i));
+}
+
+// Erases the keys whose number is a multiple of three.
+class every_third_key_tester_t : public key_tester_t {
+public:
+    bool key_should_be_erased(const btree_key_t *key) {
+        return atoi(key_to_unescaped_str(store_key_t(key)).c_str()) % 3 == 0;
+    }
+};
+
+/* A btree of `count_test_value_t`s in a mock file, and the set of keys it should
+hold. */
+class count_test_tree_t {
+public:
+    count_test_tree_t() : stats(&get_global_perfmon_collection(), "count_test"),
+                          balancer(GIGABYTE) {
+        standard_serializer_t::create(&file_opener,
+                                      standard_serializer_t::static_config_t());
+        serializer.init(new standard_serializer_t(
+            standard_serializer_t::dynamic_config_t(), &file_opener,
+            &get_global_perfmon_collection()));
+        cache.init(new cache_t(serializer.get(), &balancer,
+                               &get_global_perfmon_collection()));
+        cache_conn.init(new cache_conn_t(cache.get()));
+
+        txn_t txn(cache_conn.get(), write_durability_t::HARD,
+                  repli_timestamp_t::invalid, 1);
+        buf_lock_t superblock(&txn, SUPERBLOCK_ID, alt_create_t::create);
+        buf_write_t sb_write(&superblock);
+        btree_slice_t::init_superblock(&superblock,
+                                       std::vector<char>(), std::vector<char>());
+    }
+
+    // Inserts the key `i` (if `insert`) or deletes it, one descent per key.
+    void write(const std::vector<int> &keys, bool insert) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn(cache_conn.get(), write_access_t::write,
+                                     keys.size(), repli_timestamp_t::distant_past,
+                                     write_durability_t::SOFT, &superblock, &txn);
+        superblock_t *sb = superblock.get();
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            const store_key_t key = count_test_key(*it);
+            promise_t<superblock_t *> pass_back_superblock;
+            {
+                keyvalue_location_t<count_test_value_t> kv_location;
+                find_keyvalue_location_for_write(sb, key.btree_key(), &deleter,
+                                                 &kv_location, &stats, NULL,
+                                                 &pass_back_superblock);
+                if (insert) {
+                    scoped_malloc_t<count_test_value_t> value(COUNT_TEST_VALUE_SIZE);
+                    memset(value.get(), 'v', COUNT_TEST_VALUE_SIZE);
+                    kv_location.value = std::move(value);
+                    keys_.insert(key);
+                } else {
+                    kv_location.value.reset();
+                    keys_.erase(key);
+                }
+                null_key_modification_callback_t<count_test_value_t> null_cb;
+                apply_keyvalue_change(&kv_location, key.btree_key(),
+                                      repli_timestamp_t::distant_past, expired_t::NO,
+                                      &deleter, &null_cb);
+            }
+            sb = pass_back_superblock.wait();
+        }
+    }
+
+    // Appends the keys `begin` to `end - 1` with a bulk loader.  They must be above
+    // every key in the tree.
+    void bulk_load(int begin, int end) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn(cache_conn.get(), write_access_t::write, 1,
+                                     repli_timestamp_t::distant_past,
+                                     write_durability_t::SOFT, &superblock, &txn);
+        value_sizer_t<count_test_value_t> sizer(cache->get_block_size());
+        btree_bulk_loader_t loader(&sizer, superblock.get(), &stats);
+        const std::string value(COUNT_TEST_VALUE_SIZE, 'v');
+        for (int i = begin; i < end; ++i) {
+            ASSERT_TRUE(loader.can_append(count_test_key(i).btree_key()));
+            loader.append(count_test_key(i).btree_key(), value.data(),
+                          repli_timestamp_t::distant_past);
+            keys_.insert(count_test_key(i));
+        }
+    }
+
+    // Erases every third key in (left, right].
+    void erase_every_third(int left, int right) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn(cache_conn.get(), write_access_t::write, 1,
+                                     repli_timestamp_t::distant_past,
+                                     write_durability_t::SOFT, &superblock, &txn);
+        value_sizer_t<count_test_value_t> sizer(cache->get_block_size());
+        every_third_key_tester_t tester;
+        const store_key_t left_key = count_test_key(left);
+        const store_key_t right_key = count_test_key(right);
+        cond_t non_interruptor;
+        btree_erase_range_generic(&sizer, &tester, &deleter, left_key.btree_key(),
+                                  right_key.btree_key(), superblock.get(),
+                                  &non_interruptor);
+        for (int i = left + 1; i <= right; ++i) {
+            if (i % 3 == 0) {
+                keys_.erase(count_test_key(i));
+            }
+        }
+    }
+
+    uint64_t count(const key_range_t &range) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn_for_reading(cache_conn.get(), CACHE_SNAPSHOTTED_NO,
+                                                 &superblock, &txn);
+        return btree_count_keys(superblock.get(), range, NULL);
+    }
+
+    // The keys of every leaf, in key order.  Also checks every counted internal
+    // node's key counts against its children's keys.
+    std::vector<store_key_t> scan() {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn_for_reading(cache_conn.get(), CACHE_SNAPSHOTTED_NO,
+                                                 &superblock, &txn);
+        std::vector<store_key_t> keys;
+        const block_id_t root_id = superblock->get_root_block_id();
+        if (root_id != NULL_BLOCK_ID) {
+            buf_lock_t root(superblock->expose_buf(), root_id, access_t::read);
+            superblock->release();
+            walk(&root, &keys);
+        }
+        return keys;
+    }
+
+    const std::set<store_key_t> &keys() const { return keys_; }
+
+private:
+    void walk(buf_lock_t *buf, std::vector<store_key_t> *keys_out) {
+        std::vector<block_id_t> children;
+        std::vector<int64_t> child_counts;
+        {
+            buf_read_t read(buf);
+            const node_t *node = static_cast<const node_t *>(read.get_data_read());
+            if (node::is_leaf(node)) {
+                const leaf_node_t *leaf = reinterpret_cast<const leaf_node_t *>(node);
+                for (auto it = leaf::begin(*leaf); it != leaf::end(*leaf); ++it) {
+                    keys_out->push_back(store_key_t((*it).first));
+                }
+                return;
+            }
+            const internal_node_t *inode
+                = reinterpret_cast<const internal_node_t *>(node);
+            EXPECT_TRUE(internal_node::is_counted(inode));
+            for (int i = 0; i < inode->npairs; ++i) {
+                children.push_back(internal_node::get_pair_by_index(inode, i)->lnode);
+                child_counts.push_back(internal_node::child_key_count(inode, i));
+            }
+        }
+        for (size_t i = 0; i < children.size(); ++i) {
+            const size_t keys_before = keys_out->size();
+            buf_lock_t child(buf, children[i], access_t::read);
+            walk(&child, keys_out);
+            EXPECT_EQ(child_counts[i], static_cast<int64_t>(keys_out->size() - keys_before));
+        }
+    }
+
+    std::set<store_key_t> keys_;
+
+    btree_stats_t stats;
+    noop_value_deleter_t deleter;
+    mock_file_opener_t file_opener;
+    scoped_ptr_t<standard_serializer_t> serializer;
+    dummy_cache_balancer_t balancer;
+    scoped_ptr_t<cache_t> cache;
+    scoped_ptr_t<cache_conn_t> cache_conn;
+
+    DISABLE_COPYING(count_test_tree_t);
+};
+
+// Checks the tree's keys against the expected ones, and the counts of some ranges
+// against the keys that a scan finds in them.
+void check_count_test_tree(count_test_tree_t *tree, int max_key) {
+    const std::vector<store_key_t> keys = tree->scan();
+    ASSERT_TRUE(std::vector<store_key_t>(tree->keys().begin(), tree->keys().end())
+                == keys);
+
+    std::vector<key_range_t> ranges;
+    ranges.push_back(key_range_t::universe());
+    ranges.push_back(key_range_t::empty());
+    for (int i = 0; i < 50; ++i) {
+        int left = randint(max_key + 1);
+        int right = randint(max_key + 1);
+        if (left > right) {
+            std::swap(left, right);
+        }
+        ranges.push_back(key_range_t(key_range_t::closed, count_test_key(left),
+                                     key_range_t::open, count_test_key(right)));
+        ranges.push_back(key_range_t(key_range_t::open, count_test_key(left),
+                                     key_range_t::none, store_key_t()));
+        ranges.push_back(key_range_t(key_range_t::none, store_key_t(),
+                                     key_range_t::closed, count_test_key(right)));
+    }
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        uint64_t expected = 0;
+        for (auto jt = keys.begin(); jt != keys.end(); ++jt) {
+            if (it->contains_key(*jt)) {
+                ++expected;
+            }
+        }
+        ASSERT_EQ(expected, tree->count(*it));
+    }
+}
+
+/* Range counts add up the key counts of the internal nodes, which inserts, deletes,
+range erasures and bulk loads all have to keep up to date. */
+TPTEST(BTreeCountKeys, RangeCountsMatchScans) {
+    count_test_tree_t tree;
+    const int num_keys = 6000;
+
+    // Mostly inserts, which split nodes, and then mostly deletes, which merge and
+    // level them.
+    for (int round = 0; round < 4; ++round) {
+        std::vector<int> inserts;
+        std::vector<int> deletes;
+        for (int i = 0; i < num_keys / 2; ++i) {
+            if (randint(100) < (round % 2 == 0 ? 90 : 20)) {
+                inserts.push_back(randint(num_keys));
+            } else {
+                deletes.push_back(randint(num_keys));
+            }
+        }
+        tree.write(inserts, true);
+        tree.write(deletes, false);
+        check_count_test_tree(&tree, num_keys);
+    }
+
+    tree.erase_every_third(num_keys / 4, 3 * num_keys / 4);
+    check_count_test_tree(&tree, num_keys);
+
+    tree.bulk_load(num_keys, 3 * num_keys);
+    check_count_test_tree(&tree, 3 * num_keys);
+
+    tree.erase_every_third(0, 3 * num_keys);
+    check_count_test_tree(&tree, 3 * num_keys);
+}
+
+// A tree that the bulk loader builds from scratch.
+TPTEST(BTreeCountKeys, BulkLoadedTree) {
+    count_test_tree_t tree;
+    const int num_keys = 50000;
+    tree.bulk_load(0, num_keys / 2);
+    tree.bulk_load(num_keys / 2, num_keys);
+    check_count_test_tree(&tree, num_keys);
+
+    std::vector<int> deletes;
+    for (int i = 0; i < num_keys / 10; ++i) {
+        deletes.push_back(randint(num_keys));
+    }
+    tree.write(deletes, false);
+    check_count_test_tree(&tree, num_keys);
+}
+
+}  // namespace unittest
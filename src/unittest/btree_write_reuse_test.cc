@@ -0,0 +1,237 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "btree/btree_store.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "btree/slice.hpp"
+#include "buffer_cache/alt/alt.hpp"
+#include "buffer_cache/alt/cache_balancer.hpp"
+#include "serializer/config.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_file.hpp"
+#include "unittest/unittest_utils.hpp"
+
+// A value of up to 255 bytes, prefixed by its length.  They're big enough that a
+// few dozen writes split or merge a leaf.
+struct reuse_test_value_t;
+
+template <>
+class value_sizer_t<reuse_test_value_t> : public value_sizer_t<void> {
+public:
+    explicit value_sizer_t<reuse_test_value_t>(block_size_t bs) : block_size_(bs) { }
+
+    int size(const void *value) const {
+        return 1 + *static_cast<const uint8_t *>(value);
+    }
+
+    bool fits(const void *value, int length_available) const {
+        return length_available > 0 && size(value) <= length_available;
+    }
+
+    int max_possible_size() const { return 256; }
+
+    block_magic_t btree_leaf_magic() const {
+        block_magic_t magic = { { 'r', 'u', 'L', 'F' } };
+        return magic;
+    }
+
+    block_size_t block_size() const { return block_size_; }
+
+private:
+    block_size_t block_size_;
+
+    DISABLE_COPYING(value_sizer_t<reuse_test_value_t>);
+};
+
+namespace unittest {
+
+struct reuse_test_change_t {
+    store_key_t key;
+    // Empty for deletions.
+    std::string value;
+};
+
+bool reuse_test_change_less(const reuse_test_change_t &a,
+                            const reuse_test_change_t &b) {
+    return a.key < b.key;
+}
+
+/* A btree of `reuse_test_value_t`s in a mock file. */
+class reuse_test_tree_t {
+public:
+    reuse_test_tree_t() : stats(&get_global_perfmon_collection(), "reuse_test"),
+                          balancer(GIGABYTE) {
+        standard_serializer_t::create(&file_opener,
+                                      standard_serializer_t::static_config_t());
+        serializer.init(new standard_serializer_t(
+            standard_serializer_t::dynamic_config_t(), &file_opener,
+            &get_global_perfmon_collection()));
+        cache.init(new cache_t(serializer.get(), &balancer,
+                               &get_global_perfmon_collection()));
+        cache_conn.init(new cache_conn_t(cache.get()));
+
+        txn_t txn(cache_conn.get(), write_durability_t::HARD,
+                  repli_timestamp_t::invalid, 1);
+        buf_lock_t superblock(&txn, SUPERBLOCK_ID, alt_create_t::create);
+        buf_write_t sb_write(&superblock);
+        btree_slice_t::init_superblock(&superblock,
+                                       std::vector<char>(), std::vector<char>());
+    }
+
+    /* Applies `changes`, which must be sorted by key, in one transaction.  With
+    `reuse`, this goes through the leaves the way `apply_sindex_key_changes` does;
+    otherwise every change descends from the superblock. */
+    void apply(const std::vector<reuse_test_change_t> &changes, bool reuse) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn(cache_conn.get(), write_access_t::write,
+                                     changes.size(), repli_timestamp_t::distant_past,
+                                     write_durability_t::SOFT, &superblock, &txn);
+        superblock_t *sb = superblock.get();
+        size_t i = 0;
+        while (i < changes.size()) {
+            promise_t<superblock_t *> pass_back_superblock;
+            {
+                keyvalue_location_t<reuse_test_value_t> kv_location;
+                find_keyvalue_location_for_write(sb, changes[i].key.btree_key(),
+                                                 &deleter, &kv_location, &stats,
+                                                 NULL, &pass_back_superblock);
+                do {
+                    apply_change(&kv_location, changes[i]);
+                    ++i;
+                } while (reuse && i < changes.size()
+                         && reuse_keyvalue_location_for_write(
+                             &kv_location, changes[i].key.btree_key()));
+            }
+            sb = pass_back_superblock.wait();
+        }
+    }
+
+    // The key/value pairs in key order.  Also validates every node.
+    std::vector<std::pair<store_key_t, std::string> > contents() {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn_for_reading(cache_conn.get(), CACHE_SNAPSHOTTED_NO,
+                                                 &superblock, &txn);
+        std::vector<std::pair<store_key_t, std::string> > pairs;
+        const block_id_t root_id = superblock->get_root_block_id();
+        if (root_id != NULL_BLOCK_ID) {
+            buf_lock_t root(superblock->expose_buf(), root_id, access_t::read);
+            superblock->release();
+            value_sizer_t<reuse_test_value_t> sizer(cache->get_block_size());
+            walk(&sizer, &root, &pairs);
+        }
+        return pairs;
+    }
+
+private:
+    void apply_change(keyvalue_location_t<reuse_test_value_t> *kv_location,
+                      const reuse_test_change_t &change) {
+        if (!change.value.empty()) {
+            scoped_malloc_t<reuse_test_value_t> value(1 + change.value.size());
+            uint8_t *data = reinterpret_cast<uint8_t *>(value.get());
+            data[0] = change.value.size();
+            memcpy(data + 1, change.value.data(), change.value.size());
+            kv_location->value = std::move(value);
+        } else if (kv_location->value.has()) {
+            kv_location->value.reset();
+        } else {
+            return;
+        }
+        null_key_modification_callback_t<reuse_test_value_t> null_cb;
+        apply_keyvalue_change(kv_location, change.key.btree_key(),
+                              repli_timestamp_t::distant_past, expired_t::NO,
+                              &deleter, &null_cb);
+    }
+
+    void walk(value_sizer_t<void> *sizer, buf_lock_t *buf,
+              std::vector<std::pair<store_key_t, std::string> > *pairs_out) {
+        std::vector<block_id_t> children;
+        {
+            buf_read_t read(buf);
+            const node_t *node = static_cast<const node_t *>(read.get_data_read());
+            node::validate(sizer, node);
+            if (node::is_leaf(node)) {
+                const leaf_node_t *leaf = reinterpret_cast<const leaf_node_t *>(node);
+                for (auto it = leaf::begin(*leaf); it != leaf::end(*leaf); ++it) {
+                    const uint8_t *value = static_cast<const uint8_t *>((*it).second);
+                    pairs_out->push_back(std::make_pair(
+                        store_key_t((*it).first),
+                        std::string(reinterpret_cast<const char *>(value + 1),
+                                    value[0])));
+                }
+                return;
+            }
+            const internal_node_t *inode
+                = reinterpret_cast<const internal_node_t *>(node);
+            for (int i = 0; i < inode->npairs; ++i) {
+                children.push_back(internal_node::get_pair_by_index(inode, i)->lnode);
+            }
+        }
+        for (auto it = children.begin(); it != children.end(); ++it) {
+            buf_lock_t child(buf, *it, access_t::read);
+            walk(sizer, &child, pairs_out);
+        }
+    }
+
+    btree_stats_t stats;
+    noop_value_deleter_t deleter;
+    mock_file_opener_t file_opener;
+    scoped_ptr_t<standard_serializer_t> serializer;
+    dummy_cache_balancer_t balancer;
+    scoped_ptr_t<cache_t> cache;
+    scoped_ptr_t<cache_conn_t> cache_conn;
+
+    DISABLE_COPYING(reuse_test_tree_t);
+};
+
+/* Applies batches of sorted writes, first mostly inserts (which split leaves) and
+then mostly deletions (which merge them), to one tree through
+`reuse_keyvalue_location_for_write` and to another one key at a time.  Both trees
+must end up with the same contents as a map that got the same writes. */
+TPTEST(BTreeWriteReuse, ConsecutiveWritesMatchFullDescents) {
+    reuse_test_tree_t reused;
+    reuse_test_tree_t descended;
+    std::map<store_key_t, std::string> expected;
+
+    const int num_keys = 3000;
+    for (int round = 0; round < 8; ++round) {
+        // Every other round deletes most of the keys it touches.
+        const int delete_percent = round % 2 == 0 ? 10 : 80;
+        std::vector<reuse_test_change_t> changes;
+        for (int i = 0; i < num_keys / 2; ++i) {
+            reuse_test_change_t change;
+            change.key = store_key_t(strprintf("%05d", randint(num_keys)));
+            if (randint(100) >= delete_percent) {
+                change.value = std::string(1 + randint(200), 'a' + randint(26));
+            }
+            changes.push_back(change);
+        }
+        // Writes to the same key stay in order, like in apply_sindex_key_changes.
+        std::stable_sort(changes.begin(), changes.end(), &reuse_test_change_less);
+
+        reused.apply(changes, true);
+        descended.apply(changes, false);
+        for (auto it = changes.begin(); it != changes.end(); ++it) {
+            if (it->value.empty()) {
+                expected.erase(it->key);
+            } else {
+                expected[it->key] = it->value;
+            }
+        }
+
+        const std::vector<std::pair<store_key_t, std::string> > expected_pairs(
+            expected.begin(), expected.end());
+        ASSERT_TRUE(expected_pairs == reused.contents());
+        ASSERT_TRUE(expected_pairs == descended.contents());
+    }
+}
+
+}  // namespace unittest
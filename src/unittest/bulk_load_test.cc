@@ -0,0 +1,207 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "btree/bulk_load.hpp"
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "btree/slice.hpp"
+#include "buffer_cache/alt/alt.hpp"
+#include "buffer_cache/alt/cache_balancer.hpp"
+#include "serializer/config.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_file.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+namespace {
+
+const int BULK_VALUE_SIZE = 16;
+
+// Every value takes up BULK_VALUE_SIZE bytes.
+class bulk_value_sizer_t : public value_sizer_t<void> {
+public:
+    explicit bulk_value_sizer_t(block_size_t bs) : block_size_(bs) { }
+
+    int size(const void *) const { return BULK_VALUE_SIZE; }
+
+    bool fits(const void *, int length_available) const {
+        return length_available >= BULK_VALUE_SIZE;
+    }
+
+    int max_possible_size() const { return BULK_VALUE_SIZE; }
+
+    block_magic_t btree_leaf_magic() const {
+        block_magic_t magic = { { 'b', 'l', 'L', 'F' } };
+        return magic;
+    }
+
+    block_size_t block_size() const { return block_size_; }
+
+private:
+    block_size_t block_size_;
+
+    DISABLE_COPYING(bulk_value_sizer_t);
+};
+
+store_key_t bulk_key(int i) {
+    return store_key_t(strprintf("key%06d", i));
+}
+
+std::string bulk_value(int i) {
+    return std::string(BULK_VALUE_SIZE, 'a' + i % 26);
+}
+
+void append_keys(cache_conn_t *cache_conn, btree_stats_t *stats, int begin, int end) {
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    get_btree_superblock_and_txn(cache_conn, write_access_t::write, 1 + (end - begin) / 50,
+                                 repli_timestamp_t::distant_past,
+                                 write_durability_t::SOFT, &superblock, &txn);
+    bulk_value_sizer_t sizer(cache_conn->cache()->get_block_size());
+    btree_bulk_loader_t loader(&sizer, superblock.get(), stats);
+    if (begin > 0) {
+        ASSERT_FALSE(loader.can_append(bulk_key(begin - 1).btree_key()));
+        ASSERT_FALSE(loader.can_append(bulk_key(0).btree_key()));
+    }
+    for (int i = begin; i < end; ++i) {
+        ASSERT_TRUE(loader.can_append(bulk_key(i).btree_key()));
+        loader.append(bulk_key(i).btree_key(), bulk_value(i).data(),
+                      repli_timestamp_t::distant_past);
+    }
+}
+
+struct bulk_tree_shape_t {
+    bulk_tree_shape_t() : num_keys(0), num_leaves(0), leaf_depth(-1),
+                          leaves_at_other_depths(0), leaves_with_room(0),
+                          internal_nodes_with_one_child(0) { }
+    int num_keys;
+    int num_leaves;
+    int leaf_depth;
+    int leaves_at_other_depths;
+    // Leaves that the next key would still have fit into.
+    int leaves_with_room;
+    int internal_nodes_with_one_child;
+};
+
+// Walks the tree in key order and checks that it holds the keys bulk_key(0),
+// bulk_key(1), ... with their values.
+void walk_bulk_tree(value_sizer_t<void> *sizer, buf_lock_t *buf, int depth,
+                    bulk_tree_shape_t *shape) {
+    std::vector<block_id_t> children;
+    {
+        buf_read_t read(buf);
+        const node_t *node = static_cast<const node_t *>(read.get_data_read());
+        if (node::is_leaf(node)) {
+            const leaf_node_t *leaf = reinterpret_cast<const leaf_node_t *>(node);
+            for (auto it = leaf::begin(*leaf); it != leaf::end(*leaf); ++it) {
+                EXPECT_EQ(bulk_key(shape->num_keys), store_key_t((*it).first));
+                EXPECT_EQ(bulk_value(shape->num_keys),
+                          std::string(static_cast<const char *>((*it).second),
+                                      BULK_VALUE_SIZE));
+                ++shape->num_keys;
+            }
+            ++shape->num_leaves;
+            if (shape->leaf_depth == -1) {
+                shape->leaf_depth = depth;
+            } else if (shape->leaf_depth != depth) {
+                ++shape->leaves_at_other_depths;
+            }
+            if (!leaf::is_full(sizer, leaf, bulk_key(shape->num_keys).btree_key(),
+                               bulk_value(shape->num_keys).data())) {
+                ++shape->leaves_with_room;
+            }
+            return;
+        }
+        const internal_node_t *inode = reinterpret_cast<const internal_node_t *>(node);
+        if (inode->npairs < 2) {
+            ++shape->internal_nodes_with_one_child;
+        }
+        for (int i = 0; i < inode->npairs; ++i) {
+            children.push_back(internal_node::get_pair_by_index(inode, i)->lnode);
+        }
+    }
+    for (auto it = children.begin(); it != children.end(); ++it) {
+        buf_lock_t child(buf, *it, access_t::read);
+        walk_bulk_tree(sizer, &child, depth + 1, shape);
+    }
+}
+
+void check_bulk_tree(cache_conn_t *cache_conn, int num_keys) {
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    get_btree_superblock_and_txn(cache_conn, write_access_t::write, 1,
+                                 repli_timestamp_t::distant_past,
+                                 write_durability_t::SOFT, &superblock, &txn);
+    bulk_value_sizer_t sizer(cache_conn->cache()->get_block_size());
+
+    bulk_tree_shape_t shape;
+    {
+        buf_lock_t root(superblock->expose_buf(), superblock->get_root_block_id(),
+                        access_t::read);
+        walk_bulk_tree(&sizer, &root, 0, &shape);
+    }
+    EXPECT_EQ(num_keys, shape.num_keys);
+    EXPECT_EQ(0, shape.leaves_at_other_depths);
+    EXPECT_EQ(0, shape.internal_nodes_with_one_child);
+    // Only the rightmost leaf may have room left.
+    EXPECT_LE(shape.leaves_with_room, 1);
+    // Enough keys for a root above internal nodes.
+    EXPECT_GE(shape.leaf_depth, 2);
+
+    buf_lock_t stat_block(buf_parent_t(txn.get()), superblock->get_stat_block_id(),
+                          access_t::read);
+    buf_read_t stat_read(&stat_block);
+    EXPECT_EQ(num_keys, static_cast<const btree_statblock_t *>(
+                  stat_read.get_data_read())->population);
+}
+
+}  // anonymous namespace
+
+void run_bulk_load_test(const std::vector<int> &batch_ends) {
+    mock_file_opener_t file_opener;
+    standard_serializer_t::create(&file_opener, standard_serializer_t::static_config_t());
+    standard_serializer_t serializer(standard_serializer_t::dynamic_config_t(),
+                                     &file_opener,
+                                     &get_global_perfmon_collection());
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    cache_t cache(&serializer, &balancer, &get_global_perfmon_collection());
+    cache_conn_t cache_conn(&cache);
+
+    {
+        txn_t txn(&cache_conn, write_durability_t::HARD, repli_timestamp_t::invalid, 1);
+        buf_lock_t superblock(&txn, SUPERBLOCK_ID, alt_create_t::create);
+        buf_write_t sb_write(&superblock);
+        btree_slice_t::init_superblock(&superblock,
+                                       std::vector<char>(), std::vector<char>());
+    }
+
+    btree_stats_t stats(&get_global_perfmon_collection(), "bulk_load_test");
+    int begin = 0;
+    for (auto it = batch_ends.begin(); it != batch_ends.end(); ++it) {
+        append_keys(&cache_conn, &stats, begin, *it);
+        begin = *it;
+    }
+    check_bulk_tree(&cache_conn, begin);
+}
+
+TPTEST(BTreeBulkLoader, EmptyTree) {
+    std::vector<int> batch_ends;
+    batch_ends.push_back(100000);
+    run_bulk_load_test(batch_ends);
+}
+
+// Later loaders pick up the right spine that the earlier ones left behind.
+TPTEST(BTreeBulkLoader, SeveralTransactions) {
+    std::vector<int> batch_ends;
+    batch_ends.push_back(1);
+    batch_ends.push_back(1000);
+    batch_ends.push_back(50000);
+    batch_ends.push_back(100000);
+    run_bulk_load_test(batch_ends);
+}
+
+}  // namespace unittest
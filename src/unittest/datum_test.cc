@@ -1,8 +1,14 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 
+#include <map>
+
+#include "containers/archive/stl_types.hpp"
 #include "containers/archive/string_stream.hpp"
+#include "containers/buffer_group.hpp"
 #include "rdb_protocol/datum.hpp"
+#include "time.hpp"
 #include "unittest/gtest.hpp"
+#include "utils.hpp"
 
 
 namespace unittest {
@@ -62,6 +68,207 @@ TEST(DatumTest, NumericSerialization) {
     test_datum_serialization(make_counted<ql::datum_t>(std::move(vec)));
 }
 
+void test_datum_json(const std::string &json) {
+    counted_t<const ql::datum_t> datum = ql::datum_t::parse_json(json.c_str());
+    ASSERT_TRUE(datum.has());
+
+    // The direct writer and parser agree with cJSON.
+    scoped_cJSON_t cjson(cJSON_Parse(json.c_str()));
+    ASSERT_TRUE(cjson.get() != NULL);
+    ASSERT_EQ(*make_counted<const ql::datum_t>(cjson), *datum);
+
+    std::string written;
+    datum->write_json(&written);
+    ASSERT_EQ(datum->as_json().PrintUnformatted(), written);
+    ASSERT_EQ(*datum, *ql::datum_t::parse_json(written.c_str()));
+}
+
+TEST(DatumTest, Json) {
+    test_datum_json("null");
+    test_datum_json(" true ");
+    test_datum_json("[false, 0, -0, 1, -17, 0.5, 1e300, 9007199254740993, 1.1]");
+    test_datum_json("\"a \\\"b\\\" \\n\\t\\u0001 \\u00e9 \\ud83d\\ude00\"");
+    test_datum_json("{\"b\": [1, {\"c\": {}}], \"a\": \"x\", \"\\u001f\": []}");
+    // cJSON's quirks: NULs and unpaired surrogates are dropped, hexadecimal numbers
+    // end at the `x`, and trailing garbage is ignored.
+    test_datum_json("\"\\u0000a\\udc00b\\ud800c\\ud800\\u0041\"");
+    test_datum_json("0x10");
+    test_datum_json("[1] ]");
+
+    ASSERT_FALSE(ql::datum_t::parse_json("[1, 2").has());
+    ASSERT_FALSE(ql::datum_t::parse_json("{\"a\" 1}").has());
+    ASSERT_FALSE(ql::datum_t::parse_json("nul").has());
+    ASSERT_FALSE(ql::datum_t::parse_json("").has());
+    ASSERT_FALSE(ql::datum_t::parse_json("[0x10]").has());
+    // Where cJSON reads past the input or uses garbage, we fail.
+    ASSERT_FALSE(ql::datum_t::parse_json("\"abc").has());
+    ASSERT_FALSE(ql::datum_t::parse_json("\"\\u12g4\"").has());
+}
+
+TEST(DatumTest, RowSerialization) {
+    counted_t<const ql::datum_t> row = ql::datum_t::parse_json(
+        "{\"id\": 5, \"a\": [1, 2], \"b\": {\"c\": \"d\"}, \"e\": null}");
+    ASSERT_TRUE(row.has());
+
+    write_message_t wm;
+    wm << ql::row_datum_t(row);
+    string_stream_t write_stream;
+    ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+    const std::string serialized = write_stream.str();
+
+    // Rows with field offsets deserialize like any other datum.
+    string_read_stream_t read_stream(std::string(serialized), 0);
+    counted_t<const ql::datum_t> deserialized;
+    ASSERT_EQ(archive_result_t::SUCCESS, deserialize(&read_stream, &deserialized));
+    ASSERT_EQ(*row, *deserialized);
+
+    // Split the row over several buffers, like a blob spanning several blocks.
+    const_buffer_group_t group;
+    for (size_t i = 0; i < serialized.size(); i += 7) {
+        group.add_buffer(std::min<size_t>(7, serialized.size() - i),
+                         serialized.data() + i);
+    }
+    counted_t<const ql::datum_t> fields
+        = ql::deserialize_row_fields(&group, std::set<std::string>{"b", "id"});
+    ASSERT_TRUE(fields.has());
+    ASSERT_EQ(2u, fields->as_object().size());
+    ASSERT_EQ(*row->get("b"), *fields->get("b"));
+    ASSERT_EQ(*row->get("id"), *fields->get("id"));
+
+    // Missing fields make the caller read the whole row.
+    ASSERT_FALSE(ql::deserialize_row_fields(
+                     &group, std::set<std::string>{"a", "f"}).has());
+}
+
+TEST(DatumTest, ObjectFields) {
+    ql::datum_object_t object;
+    counted_t<const ql::datum_t> one = make_counted<const ql::datum_t>(1.0);
+    counted_t<const ql::datum_t> two = make_counted<const ql::datum_t>(2.0);
+    ASSERT_FALSE(object.set("b", one, ql::NOCLOBBER));
+    ASSERT_FALSE(object.set("c", one, ql::NOCLOBBER));
+    ASSERT_FALSE(object.set("a", one, ql::NOCLOBBER));
+    ASSERT_TRUE(object.set("b", two, ql::NOCLOBBER));
+    ASSERT_EQ(*one, *object.find("b")->second);
+    ASSERT_TRUE(object.set("b", two, ql::CLOBBER));
+    ASSERT_EQ(*two, *object.find("b")->second);
+
+    std::vector<std::string> keys;
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        keys.push_back(it->first);
+    }
+    ASSERT_EQ((std::vector<std::string>{"a", "b", "c"}), keys);
+    ASSERT_TRUE(object.find("d") == object.end());
+    ASSERT_EQ(1u, object.erase("a"));
+    ASSERT_EQ(0u, object.erase("a"));
+    ASSERT_EQ(2u, object.size());
+
+    ql::datum_object_t unsorted;
+    unsorted.append_unsorted("y", counted_t<const ql::datum_t>(one));
+    unsorted.append_unsorted("x", counted_t<const ql::datum_t>(two));
+    std::string duplicate;
+    ASSERT_TRUE(unsorted.sort_fields(&duplicate));
+    ASSERT_EQ("x", unsorted.begin()->first);
+    unsorted.append_unsorted("x", counted_t<const ql::datum_t>(one));
+    ASSERT_FALSE(unsorted.sort_fields(&duplicate));
+    ASSERT_EQ("x", duplicate);
+
+    ASSERT_THROW(ql::datum_t::parse_json("{\"a\": 1, \"b\": 2, \"a\": 3}"),
+                 ql::base_exc_t);
+}
+
+#if !defined(THREADED_COROUTINES) && !defined(VALGRIND)
+TEST(DatumTest, FreeList) {
+    // A freed datum is handed out again by the next allocation on this thread.
+    ql::datum_t *first = new ql::datum_t(1.0);
+    delete first;
+    ql::datum_t *second = new ql::datum_t("abc");
+    ASSERT_EQ(first, second);
+    ASSERT_EQ("abc", second->as_str().to_std());
+    delete second;
+}
+#endif
+
+// How many heap blocks `str` holds: none if it's short enough to be stored inside
+// the string object.
+static int string_heap_blocks(const std::string &str) {
+    const char *object = reinterpret_cast<const char *>(&str);
+    return str.capacity() > 0
+        && !(str.data() >= object && str.data() < object + sizeof(str)) ? 1 : 0;
+}
+
+// Times reading rows and looking up their fields, and counts the allocations a
+// read makes, against the `std::map` objects used to be stored in.  Run it with --gtest_also_run_disabled_tests.
+TEST(DatumTest, DISABLED_ObjectBenchmark) {
+    const int num_fields = 20;
+    std::map<std::string, counted_t<const ql::datum_t> > fields;
+    std::vector<std::string> keys;
+    for (int i = 0; i < num_fields; ++i) {
+        keys.push_back(strprintf("field_%d", i * 7919 % 1000));
+        fields[keys.back()] = make_counted<const ql::datum_t>(static_cast<double>(i));
+    }
+    write_message_t wm;
+    wm << make_counted<const ql::datum_t>(
+        std::map<std::string, counted_t<const ql::datum_t> >(fields));
+    string_stream_t write_stream;
+    ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+    const std::string serialized = write_stream.str();
+
+    // Skip the type byte, which leaves what a serialized `std::map` looks like.
+    const int num_reads = 100000;
+    ticks_t start = get_ticks();
+    for (int i = 0; i < num_reads; ++i) {
+        string_read_stream_t s(std::string(serialized), 1);
+        std::map<std::string, counted_t<const ql::datum_t> > map;
+        ASSERT_EQ(archive_result_t::SUCCESS, deserialize(&s, &map));
+    }
+    const double map_read_secs = ticks_to_secs(get_ticks() - start);
 
+    start = get_ticks();
+    counted_t<const ql::datum_t> datum;
+    for (int i = 0; i < num_reads; ++i) {
+        string_read_stream_t s(std::string(serialized), 0);
+        ASSERT_EQ(archive_result_t::SUCCESS, deserialize(&s, &datum));
+    }
+    const double datum_read_secs = ticks_to_secs(get_ticks() - start);
+
+    const int num_lookups = 4000000;
+    int found = 0;
+    start = get_ticks();
+    for (int i = 0; i < num_lookups; ++i) {
+        found += fields.find(keys[i % num_fields])->second.has();
+    }
+    const double map_lookup_secs = ticks_to_secs(get_ticks() - start);
+    ASSERT_EQ(num_lookups, found);
+
+    found = 0;
+    start = get_ticks();
+    for (int i = 0; i < num_lookups; ++i) {
+        found += datum->get(keys[i % num_fields], ql::NOTHROW).has();
+    }
+    const double datum_lookup_secs = ticks_to_secs(get_ticks() - start);
+    ASSERT_EQ(num_lookups, found);
+
+    // Every read allocates the heap blocks that the fields end up in.
+    string_read_stream_t s(std::string(serialized), 1);
+    std::map<std::string, counted_t<const ql::datum_t> > map;
+    ASSERT_EQ(archive_result_t::SUCCESS, deserialize(&s, &map));
+    int map_allocations = map.size();
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        map_allocations += string_heap_blocks(it->first);
+    }
+    const ql::datum_object_t &object = datum->as_object();
+    int datum_allocations = object.empty() ? 0 : 1;
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        datum_allocations += string_heap_blocks(it->first);
+    }
+
+    printf("%d-field objects: std::map %.2f us/read, %d allocations/read, "
+           "%.1f ns/lookup; datum_object_t %.2f us/read, %d allocations/read, "
+           "%.1f ns/lookup\n", num_fields,
+           map_read_secs * 1e6 / num_reads, map_allocations,
+           map_lookup_secs * 1e9 / num_lookups,
+           datum_read_secs * 1e6 / num_reads, datum_allocations,
+           datum_lookup_secs * 1e9 / num_lookups);
+}
 
 }  // namespace unittest
@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "math.hpp"
 #include "serializer/log/lba/disk_format.hpp"
+#include "serializer/log/lba/in_memory_index.hpp"
 #include "serializer/log/log_serializer.hpp"
 
 #include "unittest/gtest.hpp"
@@ -56,6 +57,8 @@ TEST(DiskFormatTest, LbaMetablockMixinT) {
 
 TEST(DiskFormatTest, LbaEntryT) {
     EXPECT_EQ(0u, offsetof(lba_entry_t, block_id));
+    EXPECT_EQ(8u, offsetof(lba_entry_t, ser_block_size));
+    EXPECT_EQ(12u, offsetof(lba_entry_t, compressed_size));
     EXPECT_EQ(16u, offsetof(lba_entry_t, recency));
     EXPECT_EQ(24u, offsetof(lba_entry_t, offset));
     EXPECT_EQ(32u, sizeof(lba_entry_t));
@@ -66,14 +69,44 @@ TEST(DiskFormatTest, LbaEntryT) {
     ASSERT_TRUE(lba_entry_t::is_padding(&ent));
     flagged_off64_t real = flagged_off64_t::unused();
     real = flagged_off64_t::make(1);
-    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, real, 1234);
+    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, real, 1234, 0);
     ASSERT_FALSE(lba_entry_t::is_padding(&ent));
     flagged_off64_t deleteblock = flagged_off64_t::unused();
     deleteblock = flagged_off64_t::make(1);
-    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, deleteblock, 1234);
+    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, deleteblock, 1234, 0);
     ASSERT_FALSE(lba_entry_t::is_padding(&ent));
 }
 
+TEST(DiskFormatTest, CompressedLbaEntryT) {
+    // Entries written before block compression existed have a zero in the
+    // compressed_size field, which means the block isn't compressed.
+    flagged_off64_t real = flagged_off64_t::make(4096);
+    lba_entry_t ent = lba_entry_t::make(1, repli_timestamp_t::invalid, real, 4096, 0);
+    EXPECT_EQ(4096u, ent.ser_block_size);
+    EXPECT_EQ(0u, ent.compressed_size);
+
+    ent = lba_entry_t::make(1, repli_timestamp_t::invalid, real, 4096, 700);
+    EXPECT_EQ(4096u, ent.ser_block_size);
+    EXPECT_EQ(700u, ent.compressed_size);
+    EXPECT_FALSE(lba_entry_t::is_padding(&ent));
+
+    lba_entry_t padding = lba_entry_t::make_padding_entry();
+    EXPECT_EQ(0u, padding.compressed_size);
+
+    EXPECT_EQ(4096u, index_block_info_t(real, repli_timestamp_t::invalid,
+                                        4096, 0).disk_block_size());
+    EXPECT_EQ(700u, index_block_info_t(real, repli_timestamp_t::invalid,
+                                       4096, 700).disk_block_size());
+}
+
+TEST(DiskFormatTest, SerializerVersion) {
+    // Bump this along with SERIALIZER_VERSION_STRING whenever the on-disk format
+    // changes.  1.13 added compressed data blocks; 1.12 files are read as files
+    // whose blocks are all uncompressed.
+    EXPECT_STREQ("1.13", SERIALIZER_VERSION_STRING);
+    EXPECT_STREQ("1.12", SERIALIZER_UNCOMPRESSED_VERSION_STRING);
+}
+
 TEST(DiskFormatTest, LbaExtentT) {
     EXPECT_EQ(32u, sizeof(lba_extent_t::header_t));
 
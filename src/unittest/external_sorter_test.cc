@@ -0,0 +1,61 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "arch/io/disk.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/external_sorter.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+void run_sort_test(int num_items, size_t max_memory_bytes) {
+    char dir[] = "/tmp/rdb_unittest_sorter_XXXXXX";
+    guarantee(mkdtemp(dir) != NULL);
+    base_path_t base_path(dir);
+    recreate_temporary_directory(base_path);
+
+    {
+        io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+        external_sorter_t<std::pair<int, std::string> > sorter(
+            &io_backender, base_path, "sort_run", &get_global_perfmon_collection(),
+            max_memory_bytes);
+
+        std::vector<std::pair<int, std::string> > expected;
+        for (int i = 0; i < num_items; ++i) {
+            std::pair<int, std::string> item(randint(num_items), std::string(i % 7, 'x'));
+            expected.push_back(item);
+            sorter.add(item, sizeof(item) + item.second.size());
+        }
+        sorter.finish();
+        std::sort(expected.begin(), expected.end());
+
+        std::pair<int, std::string> item;
+        for (auto it = expected.begin(); it != expected.end(); ++it) {
+            ASSERT_TRUE(sorter.next(&item));
+            EXPECT_EQ(*it, item);
+        }
+        EXPECT_FALSE(sorter.next(&item));
+    }
+
+    remove_directory_recursive(dir);
+}
+
+TPTEST(ExternalSorter, InMemory) {
+    run_sort_test(1000, MEGABYTE);
+}
+
+TPTEST(ExternalSorter, OneMergePass) {
+    // About five runs.
+    run_sort_test(5000, 1000 * 40);
+}
+
+TPTEST(ExternalSorter, SeveralMergePasses) {
+    // More runs than get merged at once.
+    run_sort_test(20000, 500 * 40);
+}
+
+}  // namespace unittest
@@ -0,0 +1,73 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "config/args.hpp"
+#include "serializer/log/data_block_manager.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+struct test_extent_t;
+
+struct test_extent_less_t {
+    bool operator()(const test_extent_t *x, const test_extent_t *y);
+};
+
+// Stands in for gc_entry_t, with a fixed utilization and data age.
+struct test_extent_t {
+    test_extent_t(double _utilization, microtime_t _data_timestamp)
+        : utilization(_utilization), data_timestamp(_data_timestamp), gc_score(0),
+          our_pq_entry(NULL) { }
+
+    double cost_benefit(microtime_t now) const {
+        return gc_cost_benefit(utilization, data_timestamp, now);
+    }
+
+    double utilization;
+    microtime_t data_timestamp;
+    double gc_score;
+    priority_queue_t<test_extent_t *, test_extent_less_t>::entry_t *our_pq_entry;
+};
+
+bool test_extent_less_t::operator()(const test_extent_t *x, const test_extent_t *y) {
+    return x->gc_score < y->gc_score;
+}
+
+TEST(GcCostBenefitTest, PrefersEmptyAndOldExtents) {
+    const microtime_t now = 1000 * MILLION;
+    EXPECT_GT(gc_cost_benefit(0.2, now, now), gc_cost_benefit(0.5, now, now));
+    EXPECT_GT(gc_cost_benefit(0.5, now - 10 * MILLION, now),
+              gc_cost_benefit(0.5, now, now));
+    // A mostly full extent of old data beats a half empty one that was just
+    // written.
+    EXPECT_GT(gc_cost_benefit(0.8, now - 100 * MILLION, now),
+              gc_cost_benefit(0.5, now, now));
+    // A full extent isn't worth anything, however old it is.
+    EXPECT_EQ(0.0, gc_cost_benefit(1.0, 0, now));
+    // Data from the future (after the clock went backwards) counts as new.
+    EXPECT_EQ(gc_cost_benefit(0.5, now, now), gc_cost_benefit(0.5, now + MILLION, now));
+}
+
+TEST(GcCostBenefitTest, RescoringLetsExtentsAge) {
+    const microtime_t start = 1000 * MILLION;
+    test_extent_t fresh_half_full(0.5, start);
+    test_extent_t old_mostly_full(0.9, start - 100 * MILLION);
+    test_extent_t fresh_full(0.95, start);
+
+    priority_queue_t<test_extent_t *, test_extent_less_t> pq;
+    test_extent_t *extents[] = { &fresh_half_full, &old_mostly_full, &fresh_full };
+    for (size_t i = 0; i < sizeof(extents) / sizeof(extents[0]); ++i) {
+        extents[i]->gc_score = extents[i]->cost_benefit(start);
+        extents[i]->our_pq_entry = pq.push(extents[i]);
+    }
+    // 0.1 * 101 / 1.9 beats 0.5 * 1 / 1.5.
+    EXPECT_EQ(&old_mostly_full, pq.peak());
+
+    // After another 100 seconds the half full extent has aged enough to be worth
+    // more: 0.5 * 101 / 1.5 against 0.1 * 201 / 1.9.
+    rescore_gc_queue(&pq, start + 100 * MILLION);
+    ASSERT_EQ(3u, pq.size());
+    EXPECT_EQ(&fresh_half_full, pq.pop());
+    EXPECT_EQ(&old_mostly_full, pq.pop());
+    EXPECT_EQ(&fresh_full, pq.pop());
+}
+
+}  // namespace unittest
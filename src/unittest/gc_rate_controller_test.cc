@@ -0,0 +1,57 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "config/args.hpp"
+#include "serializer/log/gc_rate_controller.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(GcRateControllerTest, RateFollowsPressure) {
+    gc_rate_controller_t controller;
+    controller.set_pressure(-0.5, 1000, 5000);
+    EXPECT_EQ(1000, controller.bytes_per_sec());
+    controller.set_pressure(0.5, 1000, 5000);
+    EXPECT_EQ(3000, controller.bytes_per_sec());
+    controller.set_pressure(2.0, 1000, 5000);
+    EXPECT_EQ(5000, controller.bytes_per_sec());
+}
+
+TEST(GcRateControllerTest, SlowWritesSlowDownTheGc) {
+    gc_rate_controller_t controller;
+    for (int i = 0; i < 1000; ++i) {
+        controller.note_foreground_write(100);
+    }
+    controller.set_pressure(1.0, 1000, 5000);
+    EXPECT_EQ(5000, controller.bytes_per_sec());
+
+    for (int i = 0; i < 20; ++i) {
+        controller.note_foreground_write(2000);
+    }
+    controller.set_pressure(1.0, 1000, 5000);
+    EXPECT_LT(controller.bytes_per_sec(), 3000);
+    EXPECT_GE(controller.bytes_per_sec(), 1000);
+
+    for (int i = 0; i < 50; ++i) {
+        controller.note_foreground_write(100);
+    }
+    controller.set_pressure(1.0, 1000, 5000);
+    EXPECT_EQ(5000, controller.bytes_per_sec());
+}
+
+TEST(GcRateControllerTest, RequestsArePaced) {
+    gc_rate_controller_t controller;
+    controller.set_pressure(0.0, 1000, 1000);
+    const microtime_t start = 1000 * MILLION;
+
+    // The budget starts out empty but not negative, so the first request goes
+    // through and the next one has to wait until it's paid back.
+    EXPECT_EQ(0u, controller.request(2000, start));
+    EXPECT_EQ(2 * MILLION, controller.request(100, start));
+    EXPECT_EQ(MILLION, controller.request(100, start + MILLION));
+    EXPECT_EQ(0u, controller.request(100, start + 2 * MILLION));
+
+    // An idle GC can't save up more than a short burst.
+    EXPECT_EQ(0u, controller.request(5000, start + 100 * MILLION));
+    EXPECT_GT(controller.request(100, start + 100 * MILLION), 3 * MILLION);
+}
+
+}  // namespace unittest
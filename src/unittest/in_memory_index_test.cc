@@ -0,0 +1,160 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <map>
+
+#include "containers/two_level_array.hpp"
+#include "serializer/log/lba/in_memory_index.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+static repli_timestamp_t make_recency(uint64_t longtime) {
+    repli_timestamp_t ret;
+    ret.longtime = longtime;
+    return ret;
+}
+
+static void set_info(in_memory_index_t *index, block_id_t id,
+                     const index_block_info_t &info) {
+    index->set_block_info(id, info.recency, info.offset, info.ser_block_size,
+                          info.compressed_size);
+}
+
+TEST(InMemoryIndexTest, CompactEntrySize) {
+    EXPECT_EQ(12u, sizeof(compact_block_info_t));
+}
+
+TEST(InMemoryIndexTest, RoundTrip) {
+    in_memory_index_t index;
+    std::map<block_id_t, index_block_info_t> expected;
+
+    // Entries that fit the compact encoding...
+    expected[0] = index_block_info_t(flagged_off64_t::make(0),
+                                     make_recency(5), 4096, 0);
+    expected[1] = index_block_info_t(flagged_off64_t::make(DEVICE_BLOCK_SIZE * 1000),
+                                     repli_timestamp_t::invalid, 4000, 2048);
+    expected[7] = index_block_info_t(flagged_off64_t::unused(),
+                                     make_recency(3), 0, 0);
+    // ...and entries that don't: an unaligned offset, recencies far away from the
+    // chunk's first one, and an offset beyond 40 bits worth of device blocks.
+    expected[2] = index_block_info_t(flagged_off64_t::make(12345),
+                                     make_recency(5), 4096, 0);
+    expected[3] = index_block_info_t(flagged_off64_t::make(DEVICE_BLOCK_SIZE),
+                                     make_recency(UINT64_MAX - 7), 4096, 0);
+    expected[11] = index_block_info_t(flagged_off64_t::make(DEVICE_BLOCK_SIZE),
+                                      make_recency(1ull << 40), 4096, 0);
+    expected[4] = index_block_info_t(
+        flagged_off64_t::make(static_cast<int64_t>(DEVICE_BLOCK_SIZE) << 41),
+        make_recency(6), 4096, 0);
+    // A block id in a different chunk.
+    expected[1000000] = index_block_info_t(flagged_off64_t::make(DEVICE_BLOCK_SIZE * 3),
+                                           make_recency(1ull << 40), 512, 0);
+
+    for (auto it = expected.begin(); it != expected.end(); ++it) {
+        set_info(&index, it->first, it->second);
+    }
+    ASSERT_EQ(1000001u, index.end_block_id());
+    for (block_id_t id = 0; id < 20; ++id) {
+        auto it = expected.find(id);
+        const index_block_info_t want
+            = it == expected.end() ? index_block_info_t() : it->second;
+        EXPECT_TRUE(want == index.get_block_info(id)) << "block " << id;
+    }
+    EXPECT_TRUE(expected[1000000] == index.get_block_info(1000000));
+
+    // Overwriting an entry that lived in the overflow table with one that doesn't
+    // need it, and clearing entries altogether.
+    const index_block_info_t plain(flagged_off64_t::make(DEVICE_BLOCK_SIZE * 2),
+                                   make_recency(6), 4096, 0);
+    set_info(&index, 2, plain);
+    EXPECT_TRUE(plain == index.get_block_info(2));
+    set_info(&index, 3, index_block_info_t());
+    EXPECT_TRUE(index_block_info_t() == index.get_block_info(3));
+    set_info(&index, 1000000, index_block_info_t());
+    EXPECT_TRUE(index_block_info_t() == index.get_block_info(1000000));
+}
+
+static index_block_info_t benchmark_info(block_id_t id) {
+    return index_block_info_t(flagged_off64_t::make(id * DEVICE_BLOCK_SIZE),
+                              make_recency(1000000 + id / 16),
+                              4096, id % 4 == 0 ? 1024 : 0);
+}
+
+// Fills whole chunks in every shard, so half-empty ones don't skew the memory per
+// block.
+static const block_id_t MEMORY_TEST_BLOCKS = 1 << 18;
+
+TEST(InMemoryIndexTest, MemoryUsage) {
+    in_memory_index_t index;
+    for (block_id_t id = 0; id < MEMORY_TEST_BLOCKS; ++id) {
+        set_info(&index, id, benchmark_info(id));
+    }
+    for (block_id_t id = 0; id < MEMORY_TEST_BLOCKS; ++id) {
+        ASSERT_TRUE(benchmark_info(id) == index.get_block_info(id));
+    }
+    EXPECT_LT(index.memory_usage(), 13 * MEMORY_TEST_BLOCKS);
+}
+
+// Recencies that outgrow a chunk's base don't end up in the overflow table.
+TEST(InMemoryIndexTest, RecenciesFarApart) {
+    in_memory_index_t index;
+    std::map<block_id_t, index_block_info_t> expected;
+    const uint64_t generations[] = { 1000, 1000 + (1ull << 33), 1ull << 34 };
+    for (size_t g = 0; g < sizeof(generations) / sizeof(generations[0]); ++g) {
+        for (block_id_t id = 0; id < MEMORY_TEST_BLOCKS; ++id) {
+            // A few blocks keep their first recency, which is now much too old for
+            // their chunk's base.
+            if (g > 0 && id % 100 == 0) {
+                continue;
+            }
+            expected[id] = index_block_info_t(
+                flagged_off64_t::make(id * DEVICE_BLOCK_SIZE),
+                make_recency(generations[g] + id), 4096, 0);
+            set_info(&index, id, expected[id]);
+        }
+    }
+    for (auto it = expected.begin(); it != expected.end(); ++it) {
+        ASSERT_TRUE(it->second == index.get_block_info(it->first)) << it->first;
+    }
+    // Without rebasing, every block would take up a whole index_block_info_t in
+    // the overflow table on top of its compact entry, about 70 bytes in all.
+    EXPECT_LT(index.memory_usage(), 20 * MEMORY_TEST_BLOCKS);
+}
+
+// Prints how fast the index is next to the plain two_level_array_t it replaced.
+// Only runs with --gtest_also_run_disabled_tests.
+TEST(InMemoryIndexTest, DISABLED_Benchmark) {
+    const block_id_t num_blocks = 4000000;
+    in_memory_index_t index;
+    two_level_array_t<index_block_info_t> plain;
+
+    ticks_t start = get_ticks();
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        set_info(&index, id, benchmark_info(id));
+    }
+    const double set_secs = ticks_to_secs(get_ticks() - start);
+
+    start = get_ticks();
+    uint64_t checksum = 0;
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        checksum += index.get_block_info(id).ser_block_size;
+    }
+    const double get_secs = ticks_to_secs(get_ticks() - start);
+    ASSERT_EQ(4096u * num_blocks, checksum);
+
+    start = get_ticks();
+    for (block_id_t id = 0; id < num_blocks; ++id) {
+        plain.set(id, benchmark_info(id));
+    }
+    const double plain_set_secs = ticks_to_secs(get_ticks() - start);
+
+    const double millions = num_blocks / 1000000.0;
+    printf("in_memory_index_t: %.1f M sets/s, %.1f M gets/s, %.1f MB per million blocks\n",
+           millions / set_secs, millions / get_secs,
+           index.memory_usage() / millions / MEGABYTE);
+    printf("two_level_array_t: %.1f M sets/s, %.1f MB per million blocks\n",
+           millions / plain_set_secs,
+           sizeof(index_block_info_t) * 1000000.0 / MEGABYTE);
+}
+
+}  // namespace unittest
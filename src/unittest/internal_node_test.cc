@@ -29,7 +29,7 @@ void verify(block_size_t block_size, const internal_node_t *buf) {
     for (std::vector<uint16_t>::const_iterator p = offsets.begin(), e = offsets.end(); p < e; ++p) {
         ASSERT_LE(expected, block_size.value());
         ASSERT_EQ(expected, *p);
-        expected += internal_node::pair_size(internal_node::get_pair(buf, *p));
+        expected += internal_node::pair_size(buf, internal_node::get_pair(buf, *p));
     }
     ASSERT_EQ(block_size.value(), expected);
 
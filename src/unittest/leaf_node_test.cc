@@ -1,10 +1,12 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include <map>
+#include <vector>
 
 #include "btree/leaf_node.hpp"
 #include "btree/node.hpp"
 #include "containers/scoped.hpp"
 #include "repli_timestamp.hpp"
+#include "time.hpp"
 #include "unittest/gtest.hpp"
 #include "utils.hpp"
 
@@ -70,8 +72,9 @@ private:
 
 class LeafNodeTracker {
 public:
-    LeafNodeTracker() : bs_(block_size_t::unsafe_make(4096)), sizer_(bs_), node_(bs_.value()),
-                        tstamp_counter_(0) {
+    explicit LeafNodeTracker(uint32_t ser_block_size = 4096)
+        : bs_(block_size_t::unsafe_make(ser_block_size)), sizer_(bs_),
+          node_(bs_.value()), tstamp_counter_(0) {
         leaf::init(&sizer_, node_.get());
         Print();
     }
@@ -159,17 +162,15 @@ public:
             if (nodecmp_value < 0) {
                 // Copy keys from front of sibling until and including replacement key.
 
+                // The replacement key separates the keys, but need not be one.
                 std::map<store_key_t, std::string>::iterator p = sibling->kv_.begin();
-                while (p != sibling->kv_.end() && p->first < replacement) {
+                ASSERT_TRUE(p != sibling->kv_.end() && p->first <= replacement);
+                while (p != sibling->kv_.end() && p->first <= replacement) {
                     kv_[p->first] = p->second;
                     std::map<store_key_t, std::string>::iterator prev = p;
                     ++p;
                     sibling->kv_.erase(prev);
                 }
-                ASSERT_TRUE(p != sibling->kv_.end());
-                ASSERT_EQ(key_to_unescaped_str(p->first), key_to_unescaped_str(replacement));
-                kv_[p->first] = p->second;
-                sibling->kv_.erase(p);
             } else {
                 // Copy keys from end of sibling until but not including replacement key.
 
@@ -182,7 +183,7 @@ public:
                     sibling->kv_.erase(prev);
                 }
 
-                ASSERT_EQ(key_to_unescaped_str(p->first), key_to_unescaped_str(replacement));
+                ASSERT_TRUE(p->first <= replacement);
             }
         }
 
@@ -192,7 +193,7 @@ public:
         sibling->Verify();
     }
 
-    void Split(LeafNodeTracker *right) {
+    void Split(LeafNodeTracker *right, store_key_t *median_out) {
         ASSERT_EQ(bs_.ser_value(), right->bs_.ser_value());
 
         ASSERT_TRUE(leaf::is_empty(right->node()));
@@ -209,7 +210,8 @@ public:
             kv_.erase(prev);
         }
 
-        ASSERT_EQ(key_to_unescaped_str(p->first), key_to_unescaped_str(median));
+        ASSERT_TRUE(p->first <= median);
+        *median_out = median;
     }
 
     bool IsFull(const store_key_t& key, const std::string& value) {
@@ -606,7 +608,26 @@ TEST(LeafNodeTest, Splitting) {
 
     LeafNodeTracker right;
 
-    left.Split(&right);
+    store_key_t median;
+    left.Split(&right, &median);
+}
+
+TEST(LeafNodeTest, SplittingShortensSeparator) {
+    // Like secondary index keys, these only differ in their second byte.
+    LeafNodeTracker left;
+    for (int i = 0; ; ++i) {
+        store_key_t key(strprintf("%c%c", 'a' + i / 26, 'a' + i % 26) + std::string(100, 'z'));
+        if (left.IsFull(key, "v")) {
+            break;
+        }
+        left.Insert(key, "v");
+    }
+
+    LeafNodeTracker right;
+
+    store_key_t median;
+    left.Split(&right, &median);
+    ASSERT_EQ(2, median.size());
 }
 
 TEST(LeafNodeTest, Fullness) {
@@ -619,4 +640,93 @@ TEST(LeafNodeTest, Fullness) {
     ASSERT_TRUE(node.IsFull(store_key_t(strprintf("a%d", i)), strprintf("A%d", i)));
 }
 
+TEST(LeafNodeTest, LargestBlocks) {
+    // The node's offsets are uint16_t, so this is as large as a leaf gets.
+    LeafNodeTracker left(MAX_BTREE_BLOCK_SIZE);
+    int i;
+    for (i = 0; ; ++i) {
+        store_key_t key(strprintf("a%05d", i));
+        if (left.IsFull(key, strprintf("A%d", i))) {
+            break;
+        }
+        left.Insert(key, strprintf("A%d", i));
+    }
+    // A pair takes at most a 2-byte offset, an 8-byte timestamp, a 7-byte key and,
+    // while there are fewer than 10000 pairs, a 6-byte value.  That is still more
+    // pairs than a block half the size could hold at 12 bytes each.
+    ASSERT_LT(i, 10000);
+    const int max_pair_size = sizeof(uint16_t) + sizeof(repli_timestamp_t) + 7 + 6;
+    const int usable_size
+        = block_size_t::unsafe_make(MAX_BTREE_BLOCK_SIZE).value() - sizeof(leaf_node_t);
+    ASSERT_GT(i, usable_size / max_pair_size);
+
+    LeafNodeTracker right(MAX_BTREE_BLOCK_SIZE);
+    store_key_t median;
+    left.Split(&right, &median);
+
+    // The two halves fit into one block again once they have lost most of their
+    // pairs.  Both nodes share one clock, as they would in a tree, so that the
+    // deletions are newer than every pair that split moved into `right`.
+    repli_timestamp_t tstamp;
+    tstamp.longtime = i;
+    for (int j = 0; j < i; ++j) {
+        if (j % 4 != 0) {
+            store_key_t key(strprintf("a%05d", j));
+            tstamp.longtime++;
+            if (left.ShouldHave(key)) {
+                left.Remove(key, tstamp);
+            } else {
+                right.Remove(key, tstamp);
+            }
+        }
+    }
+    right.Merge(&left);
+}
+
+// Fills a leaf with keys made by `make_key` and prints how many lookups of those
+// keys leaf::find_key does per second.
+void run_lookup_benchmark(const char *name, std::string (*make_key)(int)) {
+    LeafNodeTracker node;
+    std::vector<store_key_t> keys;
+    for (int i = 0; ; ++i) {
+        store_key_t key(make_key(i));
+        if (node.IsFull(key, "v")) {
+            break;
+        }
+        node.Insert(key, "v");
+        keys.push_back(key);
+    }
+
+    const int num_lookups = 4000000;
+    int found = 0;
+    ticks_t start = get_ticks();
+    for (int i = 0; i < num_lookups; ++i) {
+        const store_key_t &key = keys[(static_cast<size_t>(i) * 7919) % keys.size()];
+        int index;
+        found += leaf::find_key(node.node(), key.btree_key(), &index);
+    }
+    const double secs = ticks_to_secs(get_ticks() - start);
+    ASSERT_EQ(num_lookups, found);
+
+    printf("leaf::find_key, %zu %s keys: %.1f M lookups/s\n",
+           keys.size(), name, num_lookups / secs / 1000000.0);
+}
+
+std::string make_short_key(int i) {
+    return strprintf("%08x", i * 2654435761u);
+}
+
+std::string make_sindex_key(int i) {
+    // A secondary index key: a shared secondary value with the primary key appended.
+    return std::string(40, 's') + strprintf("%08x", i * 2654435761u);
+}
+
+// Compares lookups of short keys with lookups of secondary index keys, which share a
+// long prefix.  It checks nothing the other tests don't, so it only runs with
+// --gtest_also_run_disabled_tests.
+TEST(LeafNodeTest, DISABLED_LookupBenchmark) {
+    run_lookup_benchmark("short", &make_short_key);
+    run_lookup_benchmark("secondary index", &make_sindex_key);
+}
+
 }  // namespace unittest
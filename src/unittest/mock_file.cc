@@ -118,6 +118,16 @@ void mock_file_opener_t::unlink_serializer_file() {
     file_existence_state_ = unlinked_file;
 }
 
+bool mock_file_opener_t::open_index_snapshot_file(bool create,
+                                                  scoped_ptr_t<file_t> *file_out) {
+    if (!has_index_snapshot_file_ && !create) {
+        return false;
+    }
+    has_index_snapshot_file_ = true;
+    file_out->init(new mock_file_t(mock_file_t::mode_rw, &index_snapshot_file_));
+    return true;
+}
+
 #ifdef SEMANTIC_SERIALIZER_CHECK
 void mock_file_opener_t::open_semantic_checking_file(scoped_ptr_t<semantic_checking_file_t> *file_out) {
     file_out->init(new mock_semantic_checking_file_t(&semantic_checking_file_));
@@ -69,21 +69,26 @@ private:
 
 class mock_file_opener_t : public serializer_file_opener_t {
 public:
-    mock_file_opener_t() : file_existence_state_(no_file) { }
+    mock_file_opener_t() : file_existence_state_(no_file), has_index_snapshot_file_(false) { }
     std::string file_name() const;
 
     void open_serializer_file_create_temporary(scoped_ptr_t<file_t> *file_out);
     void move_serializer_file_to_permanent_location();
     void open_serializer_file_existing(scoped_ptr_t<file_t> *file_out);
     void unlink_serializer_file();
+    bool open_index_snapshot_file(bool create, scoped_ptr_t<file_t> *file_out);
 #ifdef SEMANTIC_SERIALIZER_CHECK
     void open_semantic_checking_file(scoped_ptr_t<semantic_checking_file_t> *file_out);
 #endif
 
+    bool has_index_snapshot_file() const { return has_index_snapshot_file_; }
+
 private:
     enum existence_state_t { no_file, temporary_file, permanent_file, unlinked_file };
     existence_state_t file_existence_state_;
     std::vector<char> file_;
+    bool has_index_snapshot_file_;
+    std::vector<char> index_snapshot_file_;
 #ifdef SEMANTIC_SERIALIZER_CHECK
     std::vector<char> semantic_checking_file_;
 #endif
@@ -53,7 +53,7 @@ public:
     test_cache_t(serializer_t *serializer,
                  cache_balancer_t *balancer,
                  alt_txn_throttler_t *throttler)
-        : page_cache_t(serializer, balancer, throttler),
+        : page_cache_t(serializer, balancer, throttler, NULL),
           throttler_(throttler) { }
 
     void flush(scoped_ptr_t<test_txn_t> txn) {
@@ -315,6 +315,328 @@ TPTEST(PageTest, WriteWaitForFlush, 4) {
     pmap(2, std::bind(&WriteWaitForFlush_cases, &s, &page_cache, ph::_1));
 }
 
+TPTEST(PageTest, Prefetch, 4) {
+    mock_ser_t mock;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    block_id_t block_id;
+    {
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_id = acq.block_id();
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            memset(page_acq.get_buf_write(), 'p', page_cache.max_block_size().value());
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    // A new cache has to load the block from the serializer.
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    // Block ids that were never used get ignored.
+    page_cache.prefetch(block_id + 1);
+    page_cache.prefetch(block_id);
+    // So do blocks that are already being loaded.
+    page_cache.prefetch(block_id);
+
+    current_test_acq_t acq(&page_cache, block_id, read_access_t::read);
+    test_acq_t page_acq;
+    page_acq.init(acq.current_page_for_read(), &page_cache);
+    const char *const p = static_cast<const char *>(page_acq.get_buf_read());
+    ASSERT_EQ(std::string(page_cache.max_block_size().value(), 'p'),
+              std::string(p, page_cache.max_block_size().value()));
+}
+
+// Gives a cache a fixed memory limit and the eviction policy under test, and lets
+// the test look at the cache's evicter.
+class eviction_test_balancer_t : public cache_balancer_t {
+public:
+    eviction_test_balancer_t(uint64_t memory_limit, cache_eviction_policy_t policy,
+                             double compressed_memory_proportion = 0)
+        : memory_limit_(memory_limit), policy_(policy),
+          compressed_memory_proportion_(compressed_memory_proportion),
+          evicter_(NULL) { }
+
+    uint64_t base_mem_per_store() const { return memory_limit_; }
+    bool read_ahead_ok_at_start() const { return false; }
+    cache_eviction_policy_t eviction_policy() const { return policy_; }
+    double compressed_memory_proportion() const {
+        return compressed_memory_proportion_;
+    }
+
+    alt::evicter_t *evicter() const {
+        guarantee(evicter_ != NULL);
+        return evicter_;
+    }
+
+private:
+    void add_evicter(alt::evicter_t *evicter) { evicter_ = evicter; }
+    void remove_evicter(alt::evicter_t *) { evicter_ = NULL; }
+
+    const uint64_t memory_limit_;
+    const cache_eviction_policy_t policy_;
+    const double compressed_memory_proportion_;
+    alt::evicter_t *evicter_;
+
+    DISABLE_COPYING(eviction_test_balancer_t);
+};
+
+// The contents of the `i`th block that create_eviction_test_blocks creates: half
+// of it is one byte over and over, and half of it doesn't compress.
+std::string eviction_test_block_contents(int i, size_t block_size) {
+    std::string contents(block_size / 2, 'a' + i % 26);
+    uint32_t state = i;
+    while (contents.size() < block_size) {
+        state = state * 1103515245 + 12345;
+        contents.push_back(static_cast<char>(state >> 16));
+    }
+    return contents;
+}
+
+// Creates `count` blocks, so that a cache made afterwards finds them on disk.
+std::vector<block_id_t> create_eviction_test_blocks(mock_ser_t *mock, int count) {
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock->ser.get(), &balancer, mock->throttler.get());
+    std::vector<block_id_t> block_ids;
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    for (int i = 0; i < count; ++i) {
+        current_test_acq_t acq(txn.get(), alt_create_t::create);
+        block_ids.push_back(acq.block_id());
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_write(), &page_cache);
+        const std::string contents
+            = eviction_test_block_contents(i, page_cache.max_block_size().value());
+        memcpy(page_acq.get_buf_write(), contents.data(), contents.size());
+    }
+    page_cache.flush(std::move(txn));
+    return block_ids;
+}
+
+// Reads the blocks one after another and returns how many of them weren't in
+// memory.
+size_t read_eviction_test_blocks(test_cache_t *page_cache,
+                                 const std::vector<block_id_t> &block_ids) {
+    size_t misses = 0;
+    for (auto it = block_ids.begin(); it != block_ids.end(); ++it) {
+        current_test_acq_t acq(page_cache, *it, read_access_t::read);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_read(), page_cache);
+        if (!page_acq.buf_ready_signal()->is_pulsed()) {
+            ++misses;
+            page_acq.buf_ready_signal()->wait();
+        }
+    }
+    return misses;
+}
+
+// Reads a hot set twice, then scans through many more blocks than fit into the
+// cache once.  Returns how many blocks of the hot set had to be loaded again
+// afterwards.
+size_t hot_set_loads_after_scan(cache_eviction_policy_t policy) {
+    mock_ser_t mock;
+    const std::vector<block_id_t> block_ids = create_eviction_test_blocks(&mock, 300);
+    const std::vector<block_id_t> hot_set(block_ids.begin(), block_ids.begin() + 16);
+    const std::vector<block_id_t> scan(block_ids.begin() + 16, block_ids.end());
+
+    eviction_test_balancer_t balancer(64 * mock.ser->max_block_size().ser_value(),
+                                      policy);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    EXPECT_EQ(hot_set.size(), read_eviction_test_blocks(&page_cache, hot_set));
+    EXPECT_EQ(0u, read_eviction_test_blocks(&page_cache, hot_set));
+    EXPECT_EQ(scan.size(), read_eviction_test_blocks(&page_cache, scan));
+    return read_eviction_test_blocks(&page_cache, hot_set);
+}
+
+TPTEST(PageTest, TwoQueueScanKeepsHotSet, 4) {
+    EXPECT_EQ(0u, hot_set_loads_after_scan(cache_eviction_policy_t::two_queue));
+    // Random sampling evicts the hot set, which makes sure the scan really did push
+    // it towards the end of the cache.
+    EXPECT_LT(0u, hot_set_loads_after_scan(cache_eviction_policy_t::random_sample));
+}
+
+TPTEST(PageTest, TwoQueueGhostHitMakesPageHot, 4) {
+    mock_ser_t mock;
+    const std::vector<block_id_t> block_ids = create_eviction_test_blocks(&mock, 4);
+    const block_id_t held = block_ids[0];
+    const block_id_t reused = block_ids[1];
+    const block_id_t other = block_ids[2];
+    const block_id_t last = block_ids[3];
+
+    // Room for two blocks, and a ghost list that remembers one.
+    eviction_test_balancer_t balancer(2 * mock.ser->max_block_size().ser_value(),
+                                      cache_eviction_policy_t::two_queue);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+
+    // `reused` gets read once, so it's cold.
+    ASSERT_EQ(1u, read_eviction_test_blocks(&page_cache,
+                                            std::vector<block_id_t>(1, reused)));
+    {
+        // With `held` acquired, `reused` is the only page that can make room for
+        // `other`, and then `other` is the only one that can make room for
+        // `reused` again.
+        current_test_acq_t held_acq(&page_cache, held, read_access_t::read);
+        test_acq_t held_page_acq;
+        held_page_acq.init(held_acq.current_page_for_read(), &page_cache);
+        held_page_acq.buf_ready_signal()->wait();
+        ASSERT_EQ(1u, read_eviction_test_blocks(&page_cache,
+                                                std::vector<block_id_t>(1, other)));
+
+        // `reused` was evicted from the cold queue a moment ago, so coming back
+        // makes it hot.
+        ASSERT_EQ(1u, read_eviction_test_blocks(&page_cache,
+                                                std::vector<block_id_t>(1, reused)));
+
+        // Use `held` again, without acquiring it again, so that it's more recently
+        // used than `reused` but still cold.
+        held_page_acq.get_buf_read();
+    }
+
+    // Going by access times, `reused` would be evicted next.  But it's hot, so
+    // `held` gets evicted in its place.
+    ASSERT_EQ(1u, read_eviction_test_blocks(&page_cache,
+                                            std::vector<block_id_t>(1, last)));
+    EXPECT_EQ(0u, read_eviction_test_blocks(&page_cache,
+                                            std::vector<block_id_t>(1, reused)));
+    EXPECT_EQ(1u, read_eviction_test_blocks(&page_cache,
+                                            std::vector<block_id_t>(1, held)));
+}
+
+void mark_eviction_test_blocks_pinned(test_cache_t *page_cache,
+                                      const std::vector<block_id_t> &block_ids,
+                                      bool pinned) {
+    for (auto it = block_ids.begin(); it != block_ids.end(); ++it) {
+        current_test_acq_t acq(page_cache, *it, read_access_t::read);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_read(), page_cache);
+        page_acq.buf_ready_signal()->wait();
+        if (pinned) {
+            page_acq.mark_pinned();
+        } else {
+            page_acq.mark_unpinned();
+        }
+    }
+}
+
+TPTEST(PageTest, PinnedPagesSurviveScan, 4) {
+    mock_ser_t mock;
+    const std::vector<block_id_t> block_ids = create_eviction_test_blocks(&mock, 300);
+    const std::vector<block_id_t> pinned(block_ids.begin(), block_ids.begin() + 8);
+    const std::vector<block_id_t> scan(block_ids.begin() + 8, block_ids.end());
+
+    // The pinned blocks use up exactly their share of the memory limit.
+    eviction_test_balancer_t balancer(32 * mock.ser->max_block_size().ser_value(),
+                                      cache_eviction_policy_t::random_sample);
+    ASSERT_EQ(0.25, balancer.pinned_memory_proportion());
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+
+    mark_eviction_test_blocks_pinned(&page_cache, pinned, true);
+    EXPECT_EQ(scan.size(), read_eviction_test_blocks(&page_cache, scan));
+    EXPECT_EQ(0u, read_eviction_test_blocks(&page_cache, pinned));
+
+    // Once unpinned, they're the least recently used blocks in the cache, and the
+    // next scan evicts them.
+    mark_eviction_test_blocks_pinned(&page_cache, pinned, false);
+    read_eviction_test_blocks(&page_cache, scan);
+    EXPECT_EQ(pinned.size(), read_eviction_test_blocks(&page_cache, pinned));
+}
+
+// Checks the contents of the blocks that create_eviction_test_blocks returned.
+void check_eviction_test_blocks(test_cache_t *page_cache,
+                                const std::vector<block_id_t> &block_ids) {
+    const size_t block_size = page_cache->max_block_size().value();
+    for (size_t i = 0; i < block_ids.size(); ++i) {
+        current_test_acq_t acq(page_cache, block_ids[i], read_access_t::read);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_read(), page_cache);
+        const char *buf = static_cast<const char *>(page_acq.get_buf_read());
+        ASSERT_EQ(eviction_test_block_contents(i, block_size),
+                  std::string(buf, block_size));
+    }
+}
+
+struct compressed_tier_usage_t {
+    size_t pages_in_memory;
+    size_t compressed_copies;
+};
+
+// Looks at the page of every block, which must not load any of them.
+compressed_tier_usage_t compressed_tier_usage(test_cache_t *page_cache,
+                                              const std::vector<block_id_t> &block_ids) {
+    compressed_tier_usage_t usage = { 0, 0 };
+    for (auto it = block_ids.begin(); it != block_ids.end(); ++it) {
+        current_test_acq_t acq(page_cache, *it, read_access_t::read);
+        page_t *page = acq.current_page_for_read();
+        if (!page->is_not_loaded()) {
+            ++usage.pages_in_memory;
+        } else {
+            EXPECT_TRUE(page->has_compressed_copy());
+            ++usage.compressed_copies;
+        }
+    }
+    return usage;
+}
+
+TPTEST(PageTest, CompressedTierRoundTrip, 4) {
+    mock_ser_t mock;
+    const std::vector<block_id_t> block_ids = create_eviction_test_blocks(&mock, 20);
+    const uint64_t block_size = mock.ser->max_block_size().ser_value();
+
+    // Compressed copies take up about half a block, and they all fit into the
+    // compressed tier's share.
+    eviction_test_balancer_t balancer(16 * block_size,
+                                      cache_eviction_policy_t::random_sample, 0.5);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    alt::evicter_t *evicter = balancer.evicter();
+
+    ASSERT_EQ(block_ids.size(), read_eviction_test_blocks(&page_cache, block_ids));
+
+    // Every evicted page has a compressed copy, and the copies count towards the
+    // memory limit.
+    const compressed_tier_usage_t usage = compressed_tier_usage(&page_cache, block_ids);
+    ASSERT_EQ(block_ids.size(), usage.pages_in_memory + usage.compressed_copies);
+    ASSERT_LT(0u, usage.compressed_copies);
+    EXPECT_EQ(usage.pages_in_memory * block_size + evicter->compressed_size(),
+              evicter->in_memory_size());
+    EXPECT_LE(evicter->in_memory_size(), evicter->memory_limit());
+    EXPECT_LT(usage.compressed_copies * block_size / 2 * 0.9,
+              evicter->compressed_size());
+    EXPECT_GT(usage.compressed_copies * block_size
+              * (1.0 - alt::compressed_page_tier_t::MIN_SPACE_SAVING),
+              evicter->compressed_size());
+
+    // Reloading the pages decompresses their copies.
+    check_eviction_test_blocks(&page_cache, block_ids);
+    const compressed_tier_usage_t after = compressed_tier_usage(&page_cache, block_ids);
+    ASSERT_EQ(block_ids.size(), after.pages_in_memory + after.compressed_copies);
+    EXPECT_EQ(after.pages_in_memory * block_size + evicter->compressed_size(),
+              evicter->in_memory_size());
+    EXPECT_LE(evicter->in_memory_size(), evicter->memory_limit());
+}
+
+TPTEST(PageTest, CompressedTierStaysWithinItsShare, 4) {
+    mock_ser_t mock;
+    const std::vector<block_id_t> block_ids = create_eviction_test_blocks(&mock, 200);
+    const uint64_t block_size = mock.ser->max_block_size().ser_value();
+
+    eviction_test_balancer_t balancer(16 * block_size,
+                                      cache_eviction_policy_t::random_sample, 0.25);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    alt::evicter_t *evicter = balancer.evicter();
+
+    // Far more pages get evicted than the tier has room for, so it has to drop the
+    // copies of some of them.
+    ASSERT_EQ(block_ids.size(), read_eviction_test_blocks(&page_cache, block_ids));
+    EXPECT_LT(0u, evicter->compressed_size());
+    EXPECT_LE(evicter->compressed_size(), 4 * block_size);
+    EXPECT_LE(evicter->in_memory_size(), evicter->memory_limit());
+
+    // Pages whose copies were dropped get read from disk again.
+    check_eviction_test_blocks(&page_cache, block_ids);
+    EXPECT_LE(evicter->compressed_size(), 4 * block_size);
+    EXPECT_LE(evicter->in_memory_size(), evicter->memory_limit());
+}
+
 class bigger_test_t {
 public:
     explicit bigger_test_t(uint64_t _memory_limit)
@@ -269,7 +269,8 @@ void run_sindex_backfill_test(std::pair<io_backender_t *, simple_mailbox_cluster
         ql::map_wire_func_t m(mapping, make_vector(one), get_backtrace(mapping));
 
         rdb_protocol_t::write_t write(
-            rdb_protocol_t::sindex_create_t(id, m, sindex_multi_bool_t::SINGLE),
+            rdb_protocol_t::sindex_create_t(id, m, sindex_multi_bool_t::SINGLE,
+                                            std::vector<std::string>()),
             profile_bool_t::PROFILE);
 
         fake_fifo_enforcement_t enforce;
@@ -176,7 +176,10 @@ std::string create_sindex(namespace_interface_t<rdb_protocol_t> *nsi,
 
     ql::map_wire_func_t m(mapping, make_vector(arg), get_backtrace(mapping));
 
-    rdb_protocol_t::write_t write(rdb_protocol_t::sindex_create_t(id, m, sindex_multi_bool_t::SINGLE), profile_bool_t::PROFILE);
+    rdb_protocol_t::write_t write(
+        rdb_protocol_t::sindex_create_t(id, m, sindex_multi_bool_t::SINGLE,
+                                        std::vector<std::string>()),
+        profile_bool_t::PROFILE);
     rdb_protocol_t::write_response_t response;
 
     cond_t interruptor;
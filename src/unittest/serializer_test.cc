@@ -1,8 +1,11 @@
 #include <functional>
+#include <map>
 
+#include "arch/arch.hpp"
 #include "arch/runtime/starter.hpp"
 #include "concurrency/new_mutex.hpp"
 #include "serializer/config.hpp"
+#include "serializer/log/static_header.hpp"
 #include "unittest/mock_file.hpp"
 #include "unittest/gtest.hpp"
 #include "unittest/unittest_utils.hpp"
@@ -91,5 +94,216 @@ TEST(SerializerTest, AddDeleteRepeatedlyWithIndex) {
     run_in_thread_pool(std::bind(run_AddDeleteRepeatedly, true), 4);
 }
 
+// Writes blocks 0 through `count - 1`, deleting every third one again.
+void write_blocks_for_snapshot_test(standard_serializer_t *ser, block_id_t count) {
+    scoped_malloc_t<ser_buffer_t> buf
+        = serializer_t::allocate_buffer(ser->max_block_size());
+    memset(buf->cache_data, 0, ser->max_block_size().value());
+    scoped_ptr_t<file_account_t> account(ser->make_io_account(1));
+
+    for (block_id_t block_id = 0; block_id < count; ++block_id) {
+        std::vector<buf_write_info_t> infos;
+        infos.push_back(buf_write_info_t(buf.get(), ser->max_block_size(), block_id));
+        struct : public iocallback_t, public cond_t {
+            void on_io_complete() {
+                pulse();
+            }
+        } cb;
+        std::vector<counted_t<standard_block_token_t> > tokens
+            = ser->block_writes(infos, account.get(), &cb);
+        cb.wait();
+
+        std::vector<index_write_op_t> write_ops;
+        if (block_id % 3 == 2) {
+            write_ops.push_back(index_write_op_t(block_id, counted_t<standard_block_token_t>()));
+        } else {
+            write_ops.push_back(index_write_op_t(block_id, tokens[0],
+                                                 repli_timestamp_t::distant_past));
+        }
+        new_mutex_in_line_t dummy_acq;
+        ser->index_write(&dummy_acq, write_ops, account.get());
+    }
+}
+
+void check_blocks_for_snapshot_test(standard_serializer_t *ser, block_id_t count) {
+    for (block_id_t block_id = 0; block_id < count; ++block_id) {
+        counted_t<standard_block_token_t> token = ser->index_read(block_id);
+        if (block_id % 3 == 2) {
+            ASSERT_FALSE(token.has());
+        } else {
+            ASSERT_TRUE(token.has());
+            ASSERT_EQ(ser->max_block_size().ser_value(), token->block_size().ser_value());
+        }
+    }
+}
+
+TPTEST(SerializerTest, IndexSnapshot) {
+    mock_file_opener_t file_opener;
+    standard_serializer_t::create(&file_opener, standard_serializer_t::static_config_t());
+    {
+        standard_serializer_t ser(standard_serializer_t::dynamic_config_t(),
+                                  &file_opener,
+                                  &get_global_perfmon_collection());
+        write_blocks_for_snapshot_test(&ser, 100);
+    }
+    ASSERT_TRUE(file_opener.has_index_snapshot_file());
+
+    // The first restart starts from the snapshot, the second one from a snapshot
+    // that includes the writes after the first restart.
+    {
+        standard_serializer_t ser(standard_serializer_t::dynamic_config_t(),
+                                  &file_opener,
+                                  &get_global_perfmon_collection());
+        check_blocks_for_snapshot_test(&ser, 100);
+        write_blocks_for_snapshot_test(&ser, 200);
+    }
+    {
+        standard_serializer_t ser(standard_serializer_t::dynamic_config_t(),
+                                  &file_opener,
+                                  &get_global_perfmon_collection());
+        check_blocks_for_snapshot_test(&ser, 200);
+    }
+
+    // Without snapshots we have to replay the LBA, which must give the same result.
+    standard_serializer_t::dynamic_config_t no_snapshots;
+    no_snapshots.index_snapshots = false;
+    {
+        standard_serializer_t ser(no_snapshots, &file_opener,
+                                  &get_global_perfmon_collection());
+        check_blocks_for_snapshot_test(&ser, 200);
+    }
+}
+
+// Reads the serializer file's static header version, or overwrites it if
+// `new_version` isn't NULL.
+std::string static_header_version(mock_file_opener_t *file_opener,
+                                  const char *new_version) {
+    scoped_ptr_t<file_t> file;
+    file_opener->open_serializer_file_existing(&file);
+    static_header_t *header = reinterpret_cast<static_header_t *>(
+        malloc_aligned(DEVICE_BLOCK_SIZE, DEVICE_BLOCK_SIZE));
+    co_read(file.get(), 0, DEVICE_BLOCK_SIZE, header, DEFAULT_DISK_ACCOUNT);
+    if (new_version != NULL) {
+        strncpy(header->version, new_version, sizeof(header->version));
+        co_write(file.get(), 0, DEVICE_BLOCK_SIZE, header, DEFAULT_DISK_ACCOUNT,
+                 file_t::WRAP_IN_DATASYNCS);
+    }
+    const std::string ret(header->version,
+                          strnlen(header->version, sizeof(header->version)));
+    free(header);
+    return ret;
+}
+
+// Files from before compressed blocks existed differ only in the version string.
+// Once opened, they get tagged with the new version, so that older servers don't
+// read the compressed blocks we write to them.
+TPTEST(SerializerTest, ReadsUncompressedVersionFiles) {
+    mock_file_opener_t file_opener;
+    standard_serializer_t::create(&file_opener, standard_serializer_t::static_config_t());
+    {
+        standard_serializer_t ser(standard_serializer_t::dynamic_config_t(),
+                                  &file_opener,
+                                  &get_global_perfmon_collection());
+        write_blocks_for_snapshot_test(&ser, 100);
+    }
+    static_header_version(&file_opener, SERIALIZER_UNCOMPRESSED_VERSION_STRING);
+    ASSERT_EQ(SERIALIZER_UNCOMPRESSED_VERSION_STRING,
+              static_header_version(&file_opener, NULL));
+
+    standard_serializer_t::dynamic_config_t compressing;
+    compressing.compress_blocks = true;
+    {
+        standard_serializer_t ser(compressing, &file_opener,
+                                  &get_global_perfmon_collection());
+        check_blocks_for_snapshot_test(&ser, 100);
+        write_blocks_for_snapshot_test(&ser, 200);
+    }
+    ASSERT_EQ(SERIALIZER_VERSION_STRING, static_header_version(&file_opener, NULL));
+
+    standard_serializer_t ser(compressing, &file_opener,
+                              &get_global_perfmon_collection());
+    check_blocks_for_snapshot_test(&ser, 200);
+}
+
+void write_block_for_gc_test(standard_serializer_t *ser, file_account_t *account,
+                             block_id_t block_id, bool keep) {
+    scoped_malloc_t<ser_buffer_t> buf
+        = serializer_t::allocate_buffer(ser->max_block_size());
+    memset(buf->cache_data, 'a' + block_id % 26, ser->max_block_size().value());
+
+    std::vector<buf_write_info_t> infos;
+    infos.push_back(buf_write_info_t(buf.get(), ser->max_block_size(), block_id));
+    struct : public iocallback_t, public cond_t {
+        void on_io_complete() {
+            pulse();
+        }
+    } cb;
+    std::vector<counted_t<standard_block_token_t> > tokens
+        = ser->block_writes(infos, account, &cb);
+    cb.wait();
+
+    std::vector<index_write_op_t> write_ops;
+    if (keep) {
+        write_ops.push_back(index_write_op_t(block_id, tokens[0],
+                                             repli_timestamp_t::distant_past));
+    } else {
+        write_ops.push_back(index_write_op_t(block_id, counted_t<standard_block_token_t>()));
+    }
+    new_mutex_in_line_t dummy_acq;
+    ser->index_write(&dummy_acq, write_ops, account);
+}
+
+// Blocks written without compression must still read back after the GC moved them
+// with compression turned on, also through tokens that were held across the move.
+TPTEST(SerializerTest, CompressedGCKeepsHeldTokensReadable) {
+    const block_id_t num_blocks = 512;
+    mock_file_opener_t file_opener;
+    standard_serializer_t::create(&file_opener, standard_serializer_t::static_config_t());
+    {
+        standard_serializer_t ser(standard_serializer_t::dynamic_config_t(),
+                                  &file_opener,
+                                  &get_global_perfmon_collection());
+        scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+        // Three out of four blocks are garbage, so the GC wants these extents.
+        for (block_id_t block_id = 0; block_id < num_blocks; ++block_id) {
+            write_block_for_gc_test(&ser, account.get(), block_id, block_id % 4 == 0);
+        }
+    }
+
+    standard_serializer_t::dynamic_config_t config;
+    config.compress_blocks = true;
+    config.gc_min_bytes_per_sec = config.gc_max_bytes_per_sec = GIGABYTE;
+    standard_serializer_t ser(config, &file_opener, &get_global_perfmon_collection());
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+
+    std::map<block_id_t, counted_t<standard_block_token_t> > held;
+    std::map<block_id_t, int64_t> old_offsets;
+    for (block_id_t block_id = 0; block_id < num_blocks; block_id += 4) {
+        held[block_id] = ser.index_read(block_id);
+        ASSERT_TRUE(held[block_id].has());
+        old_offsets[block_id] = held[block_id]->offset();
+    }
+
+    // Keep writing (and dropping) a block until the GC has moved one of the held
+    // blocks.
+    bool moved = false;
+    for (int i = 0; i < 2000 && !moved; ++i) {
+        write_block_for_gc_test(&ser, account.get(), num_blocks, false);
+        for (auto it = held.begin(); it != held.end(); ++it) {
+            moved = moved || it->second->offset() != old_offsets[it->first];
+        }
+    }
+    ASSERT_TRUE(moved);
+
+    scoped_malloc_t<ser_buffer_t> buf
+        = serializer_t::allocate_buffer(ser.max_block_size());
+    for (auto it = held.begin(); it != held.end(); ++it) {
+        ser.block_read(it->second, buf.get(), account.get());
+        const char *data = reinterpret_cast<const char *>(buf->cache_data);
+        for (uint32_t j = 0; j < ser.max_block_size().value(); ++j) {
+            ASSERT_EQ('a' + it->first % 26, data[j]);
+        }
+    }
+}
 
 }  // namespace unittest
@@ -192,6 +192,10 @@ public:
     std::string permanent_path() const { return permanent_path_; }
     std::string temporary_path() const { return temporary_path_; }
 
+    // Where log_serializer_t keeps a snapshot of its block index between a clean
+    // shutdown and the next startup.
+    std::string index_snapshot_path() const { return permanent_path_ + "_index"; }
+
 private:
     friend serializer_filepath_t unittest::manual_serializer_filepath(const std::string& permanent_path,
                                                                       const std::string& temporary_path);
@@ -62,6 +62,14 @@ table_queries = [
         "query": "r.db('test').table(table['name']).filter(r.row['field0'].gt('5'))",
         "tag": "filter_string_5"
     },
+    {
+        "query": "r.db('test').table(table['name']).filter(r.row['field0'].gt('5')).count()",
+        "tag": "filter_string_5_count"
+    },
+    {
+        "query": "r.db('test').table(table['name']).filter(r.row['boolean']).map(r.row['field0'])",
+        "tag": "filter_field_bool_map_field"
+    },
     {
         "query": "r.db('test').table(table['name']).limit(100).inner_join(r.db('test').table(table['name']), lambda left, right: left['id'] == right['id'])",
         "tag": "inner_join"
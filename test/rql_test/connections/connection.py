@@ -397,6 +397,49 @@ class TestGroupWithTimeKey(TestWithConnection):
         groups = r.table('times').group('time').coerce_to('array').run(c)
         self.assertEqual(groups, {dt1:[expected_row1],dt2:[expected_row2]})
 
+class TestPreparedQueries(TestWithConnection):
+    def runTest(self):
+        c = r.connect(port=self.port)
+
+        r.db('test').table_create('prepared').run(c)
+        r.table('prepared').insert([{'id':i, 'a':i % 3} for i in xrange(10)]).run(c)
+
+        get = c.prepare(lambda key: r.table('prepared').get(key))
+        self.assertEqual(get.run(4), {'id':4, 'a':1})
+        self.assertEqual(get.run(7), {'id':7, 'a':1})
+        self.assertEqual(get.run(20), None)
+
+        between = c.prepare(lambda lo, hi: r.table('prepared').between(lo, hi).order_by('id')['id'])
+        self.assertEqual(between.run(2, 5), [2, 3, 4])
+        self.assertEqual(len(list(c.prepare(lambda: r.table('prepared')['id']).run())), 10)
+
+        insert = c.prepare(lambda row: r.table('prepared').insert(row))
+        self.assertEqual(insert.run({'id':10, 'a':0})['inserted'], 1)
+        self.assertEqual(get.run(10), {'id':10, 'a':0})
+
+        self.assertRaisesRegexp(
+            r.RqlRuntimeError, "Expected 1 argument\(s\) but found 2.",
+            get.run, 1, 2)
+        # Errors in the arguments don't have a backtrace into the prepared query.
+        try:
+            get.run(r.error('bad argument'))
+            self.fail("expected an error")
+        except r.RqlRuntimeError as e:
+            self.assertEqual(e.message, 'bad argument')
+            self.assertEqual(e.frames, [])
+        self.assertRaisesRegexp(
+            r.RqlDriverError, "Only functions can be prepared.",
+            c.prepare, r.expr(1))
+        self.assertRaisesRegexp(
+            r.RqlCompileError, "Prepared queries can't use `r.now\(\)`",
+            c.prepare, lambda x: r.now())
+
+        # Prepared queries don't survive reconnecting.
+        c.reconnect()
+        self.assertRaisesRegexp(
+            r.RqlDriverError, "Prepared query belongs to a previous connection.",
+            get.run, 4)
+
 
 if __name__ == '__main__':
     print "Running py connection tests"
@@ -411,6 +454,7 @@ if __name__ == '__main__':
     suite.addTest(TestPrinting())
     suite.addTest(TestBatching())
     suite.addTest(TestGroupWithTimeKey())
+    suite.addTest(TestPreparedQueries())
 
     res = unittest.TextTestRunner(verbosity=2).run(suite)
 